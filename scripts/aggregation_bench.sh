@@ -0,0 +1,46 @@
+#!/bin/bash
+#
+# Time aggregation plus the threshold and alert check at 4, 16 and 64
+# registered sensors (make HOST=1 aggregation_bench).
+#
+# For each size a text trace is generated with the sensors spread evenly over
+# the four types, each read once a second for AGGREGATIONS seconds, with an
+# aggregation after every round of readings. Doors and motion change every
+# few minutes, so the alert path runs as well. The trace is replayed with
+# `central_analyzer -r -s max -q` and its [REPLAY] timing line is reported.
+
+BIN_DIR=${BIN_DIR:-bins/host}
+AGGREGATIONS=${AGGREGATIONS:-3600}
+
+work=$(mktemp -d)
+trap 'rm -rf "$work"' EXIT
+mkdir "$work/ipc"
+
+for sensors in 4 16 64; do
+    awk -v n=$((sensors / 4)) -v rounds="$AGGREGATIONS" 'BEGIN {
+        print "zone 0 bench"
+        print "start 1000000 1790000000"
+        for (i = 0; i < n; i++) {
+            printf "sensor dht11 temp%d pin=%d\n", i, i
+            printf "sensor gas gas%d pin=%d\n", i, 16 + i
+            printf "sensor pir pir%d pin=%d\n", i, 32 + i
+            printf "sensor ultrasonic door%d trig=%d echo=%d\n", i, 48 + i, 64 + i
+        }
+        for (r = 0; r < rounds; r++) {
+            t = r * 1000
+            for (i = 0; i < n; i++) {
+                printf "sample %d temp%d 1 %d %d 1 4000 0\n", t + 10, i, 21 + (r + i) % 3, 45 + (r + i) % 5
+                printf "sample %d gas%d 1 0 0 0 0 0\n", t + 20, i
+                printf "sample %d pir%d 1 %d 0 0 0 0\n", t + 30, i, int((r + 60 * i) / 120) % 2
+                printf "sample %d door%d 1 %d 0 100 20000 0\n", t + 40, i, int((r + 45 * i) / 300) % 2 ? 5 : 120
+            }
+            printf "aggregate %d\n", t + 500
+        }
+    }' > "$work/bench$sensors.txt"
+
+    if ! "$BIN_DIR/trace_text" -w "$work/bench$sensors.trc" "$work/bench$sensors.txt"; then
+        exit 1
+    fi
+    HOME_SAFETY_IPC_DIR="$work/ipc" "$BIN_DIR/central_analyzer" -r "$work/bench$sensors.trc" -s max -q \
+        -c /nonexistent 2>&1 | sed -n 's/^\[REPLAY\] aggregation and threshold check of //p'
+done
@@ -0,0 +1,62 @@
+#!/bin/bash
+#
+# Replay every trace in tests/replay through central_analyzer and compare the
+# output with the recorded .expected file (make HOST=1 replay_check).
+#
+#   tests/replay/<name>.txt        trace in the text format of trace_text
+#   tests/replay/<name>.expected   output of `central_analyzer -r -s max -q`
+#
+# Lines of a trace starting with "# expect: " name text the output must
+# contain, so an alert cannot silently disappear from a regenerated .expected.
+# UPDATE=1 rewrites the .expected files from the current build.
+
+BIN_DIR=${BIN_DIR:-bins/host}
+TRACE_DIR=${TRACE_DIR:-tests/replay}
+
+work=$(mktemp -d)
+trap 'rm -rf "$work"' EXIT
+mkdir "$work/ipc"
+
+# No server is running in the empty IPC dir; times are printed in UTC. The
+# [SCHED] policies depend on the host and the [REPLAY] timings on its load.
+replay() {
+    HOME_SAFETY_IPC_DIR="$work/ipc" TZ=UTC "$BIN_DIR/central_analyzer" -r "$1" -s max -q -c /nonexistent 2>&1 |
+        sed -e '/^\[SCHED\]/d' -e '/^\[REPLAY\] .* at max speed$/d' -e '/^\[REPLAY\] aggregation /d' \
+            -e 's/ in [0-9.]* s ([0-9]* samples\/s)$//'
+}
+
+failed=0
+for text in "$TRACE_DIR"/*.txt; do
+    name=$(basename "$text" .txt)
+    expected="$TRACE_DIR/$name.expected"
+
+    if ! "$BIN_DIR/trace_text" -w "$work/$name.trc" "$text"; then
+        echo "FAIL $name: cannot convert $text"
+        failed=1
+        continue
+    fi
+    replay "$work/$name.trc" > "$work/$name.out"
+
+    if [ -n "$UPDATE" ]; then
+        cp "$work/$name.out" "$expected"
+    elif ! diff -u "$expected" "$work/$name.out"; then
+        echo "FAIL $name: output differs from $expected"
+        failed=1
+        continue
+    fi
+
+    missing=0
+    while IFS= read -r want; do
+        if ! grep -qF -- "$want" "$work/$name.out"; then
+            echo "FAIL $name: no line containing \"$want\""
+            missing=1
+        fi
+    done < <(sed -n 's/^# expect: //p' "$text")
+    if [ $missing -ne 0 ]; then
+        failed=1
+        continue
+    fi
+    echo "ok   $name ($(grep -c '^\[ALERT\]' "$work/$name.out") alerts)"
+done
+
+exit $failed
@@ -0,0 +1,72 @@
+#!/bin/bash
+#
+# Run N central_analyzer zones against one stats_update on this machine and
+# report the merge throughput (make HOST=1 zone_scale).
+#
+#   scripts/zone_scale.sh [zones ...]       default: 1 8 16 32 48
+#
+# Each step starts a fresh stats_update and the given number of analyzers
+# (-z <i> -n zone<i> -S none, simulated GPIO, home_safety.conf.example) in an
+# empty IPC dir, lets them settle for WARMUP seconds, then samples
+# dashboard.json over DURATION seconds. It prints the zones online, the
+# snapshots merged per second, the mean snapshot-to-merge latency of the
+# zones and the CPU used by stats_update.
+
+BIN_DIR=${BIN_DIR:-bins/host}
+CONFIG=${CONFIG:-home_safety.conf.example}
+WARMUP=${WARMUP:-5}
+DURATION=${DURATION:-20}
+STEPS=${*:-1 8 16 32 48}
+
+BIN_DIR=$(cd "$BIN_DIR" && pwd) || exit 1
+CONFIG=$(cd "$(dirname "$CONFIG")" && pwd)/$(basename "$CONFIG")
+work=$(mktemp -d)
+pids=()
+
+stop_all() {
+    [ ${#pids[@]} -gt 0 ] && kill "${pids[@]}" 2> /dev/null
+    wait 2> /dev/null
+    pids=()
+}
+trap 'stop_all; rm -rf "$work"' EXIT
+
+# Sum of "updates" over the zones of dashboard.json
+merged() {
+    awk -F': ' '/"updates":/ { n += $2 } END { print n + 0 }' "$work/dashboard.json"
+}
+
+# CPU ticks (user + system) of a process
+cpu_ticks() {
+    awk '{ print $14 + $15 }' "/proc/$1/stat"
+}
+
+printf "%6s %7s %12s %12s %14s\n" zones online merged/s latency_ms stats_update%
+for zones in $STEPS; do
+    rm -rf "$work/ipc" "$work/dashboard.json"
+    mkdir "$work/ipc"
+    export HOME_SAFETY_IPC_DIR="$work/ipc"
+
+    (cd "$work" && exec "$BIN_DIR/stats_update" -c "$CONFIG" > /dev/null 2>&1) &
+    server=$!
+    pids+=($server)
+    sleep 1
+    for ((i = 1; i <= zones; i++)); do
+        "$BIN_DIR/central_analyzer" -z $i -n zone$i -S none -c "$CONFIG" > /dev/null 2>&1 &
+        pids+=($!)
+    done
+
+    sleep "$WARMUP"
+    start_merged=$(merged)
+    start_ticks=$(cpu_ticks $server)
+    sleep "$DURATION"
+    end_merged=$(merged)
+    end_ticks=$(cpu_ticks $server)
+
+    awk -v zones=$zones -v merged=$((end_merged - start_merged)) -v ticks=$((end_ticks - start_ticks)) \
+        -v hz="$(getconf CLK_TCK)" -v secs="$DURATION" '
+        /"online": true/ { online++ }
+        /"latency_ms":/ { latency += $2; n++ }
+        END { printf "%6d %7d %12.1f %12.1f %14.1f\n", zones, online, merged / secs, n ? latency / n : 0,
+              100 * ticks / hz / secs }' FS=': ' "$work/dashboard.json"
+    stop_all
+done
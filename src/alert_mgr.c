@@ -5,21 +5,85 @@
  *      Author: saura
  */
 
+#include <pthread.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <time.h>
 #include <unistd.h>
 #include <sys/dispatch.h>
 #include <sys/neutrino.h>
 
 #include "alert_pulse_def.h"
+#include "common/binlog.h"
+#include "common/heartbeat.h"
+#include "common/mono_time.h"
+#include "common/span_trace.h"
+#include "common/thread_policy.h"
 #include "common/public/rpi_gpio.h"
 
 #define LED_PIN GPIO16
 
+// The LED is switched on by the receive loop and off by led_thread, so the loop
+// never sleeps and a gas pulse is not queued behind a motion alert's hold time
+typedef struct
+{
+    pthread_mutex_t lock;
+    pthread_cond_t cond; // CLOCK_MONOTONIC; signalled when off_ms moves
+    uint64_t off_ms;     // Time to switch the LED off (0 = off)
+} led_state_t;
+
+static led_state_t g_led = {.lock = PTHREAD_MUTEX_INITIALIZER};
+
+// Light the LED for an alert; the span runs from the pulse's arrival to the LED turning on
+static void led_alert(unsigned int seconds, const char *what, uint32_t seq, uint64_t span)
+{
+    uint64_t off_ms = mono_time_ms() + seconds * 1000ULL;
+
+    pthread_mutex_lock(&g_led.lock);
+    rpi_gpio_output(LED_PIN, GPIO_HIGH);
+    span_end(span, "led_actuation", seq, what);
+    // Overlapping alerts keep the LED on until the last one ends
+    if (off_ms > g_led.off_ms)
+    {
+        g_led.off_ms = off_ms;
+        pthread_cond_signal(&g_led.cond);
+    }
+    pthread_mutex_unlock(&g_led.lock);
+}
+
+// Switch the LED off when the hold time of the last alert has passed
+static void *led_thread(void *arg)
+{
+    (void)arg;
+
+    pthread_mutex_lock(&g_led.lock);
+    while (1)
+    {
+        if (g_led.off_ms == 0)
+        {
+            pthread_cond_wait(&g_led.cond, &g_led.lock);
+            continue;
+        }
+        if (mono_time_ms() < g_led.off_ms)
+        {
+            struct timespec deadline = {(time_t)(g_led.off_ms / 1000), (long)(g_led.off_ms % 1000) * 1000000L};
+
+            pthread_cond_timedwait(&g_led.cond, &g_led.lock, &deadline);
+            continue;
+        }
+        rpi_gpio_output(LED_PIN, GPIO_LOW);
+        g_led.off_ms = 0;
+    }
+    return NULL;
+}
+
 int main(void)
 {
     name_attach_t *attach;
     struct _pulse pulse;
+    pthread_condattr_t cond_attr;
+    pthread_t led;
     int rcvid;
     
     printf("Starting Alert Manager.......\n");
@@ -30,6 +94,9 @@ int main(void)
         exit(EXIT_FAILURE);
     }
     printf("Alert Manager waiting for pulses at /alert_manager\n");
+
+    // Pulses drive the alarm LED, so receive them at IPC priority
+    thread_policy_apply_self(THREAD_CLASS_IPC);
     
     if (rpi_gpio_setup(LED_PIN, GPIO_OUT) != 0)
     {
@@ -38,6 +105,24 @@ int main(void)
     }
     rpi_gpio_output(LED_PIN, GPIO_LOW);
 
+    pthread_condattr_init(&cond_attr);
+    pthread_condattr_setclock(&cond_attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&g_led.cond, &cond_attr);
+    pthread_condattr_destroy(&cond_attr);
+    if (thread_policy_create(THREAD_CLASS_ANALYSIS, &led, led_thread, NULL) != 0)
+    {
+        fprintf(stderr, "Failed to create LED thread\n");
+        exit(EXIT_FAILURE);
+    }
+
+    // Heartbeats come from their own thread, so they do not depend on pulse traffic
+    heartbeat_start(NULL, 0);
+    binlog_init(NULL);
+    if (span_trace_init("alert_mgr") != 0)
+    {
+        perror("span_trace_init");
+    }
+
     while (1)
     {
         rcvid = MsgReceive(attach->chid, &pulse, sizeof(pulse), NULL);
@@ -48,38 +133,34 @@ int main(void)
         }
         if (rcvid == 0)
         {
+            // The analyzer sends the snapshot sequence number as the pulse value
+            uint32_t seq = (uint32_t)pulse.value.sival_int;
+            uint64_t span = span_begin(seq);
+
             switch (pulse.code)
             {
             case MOTION_DETECTED:
-                printf("Alert Manager: MOTION DETECTED → LED ON\n");
-                rpi_gpio_output(LED_PIN, GPIO_HIGH);
-                sleep(2);
-                rpi_gpio_output(LED_PIN, GPIO_LOW);
+                LOG_INFO("Alert Manager: MOTION DETECTED → LED ON");
+                led_alert(2, "motion", seq, span);
                 break;
 
             case HIGH_CO2:
-                printf("Alert Manager: HIGH CO2/GAS LEVEL → LED ON\n");
-                rpi_gpio_output(LED_PIN, GPIO_HIGH);
-                sleep(5);
-                rpi_gpio_output(LED_PIN, GPIO_LOW);
+                LOG_INFO("Alert Manager: HIGH CO2/GAS LEVEL → LED ON");
+                led_alert(5, "gas", seq, span);
                 break;
 
             case HIGH_TEMP:
-                printf("Alert Manager: HIGH TEMPERATURE → LED ON\n");
-                rpi_gpio_output(LED_PIN, GPIO_HIGH);
-                sleep(3);
-                rpi_gpio_output(LED_PIN, GPIO_LOW);
+                LOG_INFO("Alert Manager: HIGH TEMPERATURE → LED ON");
+                led_alert(3, "temperature", seq, span);
                 break;
             
             case DOOR_OPEN:
-                printf("Alert Manager: DOOR OPEN → LED ON\n");
-                rpi_gpio_output(LED_PIN, GPIO_HIGH);
-                sleep(3);
-                rpi_gpio_output(LED_PIN, GPIO_LOW);
+                LOG_INFO("Alert Manager: DOOR OPEN → LED ON");
+                led_alert(3, "door", seq, span);
                 break;
 
             default:
-                printf("Alert Manager: Unknown pulse code: %d\n", pulse.code);
+                LOG_WARN("Alert Manager: Unknown pulse code: %d", pulse.code);
                 break;
             }
         }
@@ -6,4 +6,8 @@
 #define HIGH_TEMP (_PULSE_CODE_MINAVAIL + 3)
 #define DOOR_OPEN (_PULSE_CODE_MINAVAIL + 4)
 
+// Priority of the pulses of critical alerts: above the acquisition (30) and
+// ipc (20) thread classes, so alert_mgr handles them before anything else
+#define ALERT_PULSE_PRIORITY_CRITICAL 40
+
 #endif
@@ -0,0 +1,134 @@
+/*
+ * anomaly_detector.h - Streaming rate-of-rise and outlier detection
+ *
+ * A fixed threshold only fires once a fire is well under way. This detector
+ * looks at how the signal behaves instead, in constant time per sample:
+ *
+ *  - Rate of rise: two EWMAs with time constants tau_f < tau_s both lag a
+ *    linear ramp of slope r by r * tau, so r = (fast - slow) / (tau_s - tau_f).
+ *    This is far less noisy than differencing integer DHT11 readings.
+ *  - Outliers: a z-score against an exponentially weighted baseline
+ *    mean/variance (~10 minute memory). The standard deviation is floored so a
+ *    perfectly flat signal does not turn a 1-step change into a huge z-score.
+ *
+ * Both checks are held off until ANOMALY_WARMUP_SAMPLES samples have been seen,
+ * and each alarm clears with hysteresis (half the trigger level).
+ */
+
+#ifndef ANOMALY_DETECTOR_H
+#define ANOMALY_DETECTOR_H
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#define ANOMALY_TAU_FAST_MS 5000.0       // Fast slope EWMA
+#define ANOMALY_TAU_SLOW_MS 20000.0      // Slow slope EWMA
+#define ANOMALY_TAU_BASELINE_MS 600000.0 // Baseline mean/variance memory
+#define ANOMALY_WARMUP_SAMPLES 30        // Samples before alarms may fire
+
+typedef struct
+{
+    double fast;         // Fast EWMA of the value
+    double slow;         // Slow EWMA of the value
+    double base_mean;    // Baseline mean
+    double base_var;     // Baseline variance
+    uint64_t last_ms;    // Time of the previous sample
+    uint32_t count;      // Samples seen
+    float rate_per_min;  // Estimated rate of change (units per minute)
+    float zscore;        // z-score of the latest sample against the baseline
+    uint8_t rise_alarm;  // 1 while the rate of rise is abnormal
+    uint8_t outlier;     // 1 while the value is a statistical outlier
+} anomaly_detector_t;
+
+/**
+ * Reset a detector
+ */
+static inline void anomaly_detector_init(anomaly_detector_t *det)
+{
+    det->fast = det->slow = 0.0;
+    det->base_mean = det->base_var = 0.0;
+    det->last_ms = 0;
+    det->count = 0;
+    det->rate_per_min = 0.0f;
+    det->zscore = 0.0f;
+    det->rise_alarm = 0;
+    det->outlier = 0;
+}
+
+/**
+ * Feed one sample into the detector
+ *
+ * @param det            Detector to update
+ * @param value          Sample value
+ * @param now_ms         Monotonic time of the sample
+ * @param max_rise       Rate of rise (units/minute) that raises the alarm
+ * @param z_threshold    |z| above which the sample is an outlier
+ * @param min_stddev     Floor for the baseline standard deviation
+ */
+static inline void anomaly_detector_update(anomaly_detector_t *det, double value, uint64_t now_ms,
+                                           double max_rise, double z_threshold, double min_stddev)
+{
+    if (det->count == 0)
+    {
+        det->fast = det->slow = det->base_mean = value;
+        det->base_var = 0.0;
+        det->last_ms = now_ms;
+        det->count = 1;
+        return;
+    }
+
+    double dt = (double)(now_ms - det->last_ms);
+    det->last_ms = now_ms;
+    det->count++;
+
+    // Score against the baseline before the sample is absorbed into it
+    double stddev = sqrt(det->base_var);
+    if (stddev < min_stddev)
+    {
+        stddev = min_stddev;
+    }
+    det->zscore = (float)((value - det->base_mean) / stddev);
+
+    double a_fast = 1.0 - exp(-dt / ANOMALY_TAU_FAST_MS);
+    double a_slow = 1.0 - exp(-dt / ANOMALY_TAU_SLOW_MS);
+    double a_base = 1.0 - exp(-dt / ANOMALY_TAU_BASELINE_MS);
+
+    det->fast += a_fast * (value - det->fast);
+    det->slow += a_slow * (value - det->slow);
+
+    // Exponentially weighted mean/variance
+    double diff = value - det->base_mean;
+    double incr = a_base * diff;
+    det->base_mean += incr;
+    det->base_var = (1.0 - a_base) * (det->base_var + diff * incr);
+
+    det->rate_per_min =
+        (float)((det->fast - det->slow) / (ANOMALY_TAU_SLOW_MS - ANOMALY_TAU_FAST_MS) * 60000.0);
+
+    if (det->count < ANOMALY_WARMUP_SAMPLES)
+    {
+        return;
+    }
+
+    if (det->rise_alarm)
+    {
+        det->rise_alarm = det->rate_per_min > max_rise / 2.0;
+    }
+    else
+    {
+        det->rise_alarm = det->rate_per_min > max_rise;
+    }
+
+    double z = fabs(det->zscore);
+    if (det->outlier)
+    {
+        det->outlier = z > z_threshold / 2.0;
+    }
+    else
+    {
+        det->outlier = z > z_threshold;
+    }
+}
+
+#endif // ANOMALY_DETECTOR_H
@@ -0,0 +1,117 @@
+/*
+ * burst_filter.h - Robust combination of a burst of noisy readings
+ *
+ * A single HC-SR04 ping is easily spoiled by a stray echo or a missed edge.
+ * Taking a short burst and combining it robustly removes most of that:
+ *
+ *  - failed pings (timeouts) are dropped
+ *  - the (lower) median of the remaining pings is taken as a first estimate
+ *  - pings further than BURST_OUTLIER_K * MAD (median absolute deviation,
+ *    floored at BURST_MIN_MAD) from it are rejected as outliers
+ *  - the result is the mean of the surviving pings
+ *
+ * Confidence is the share of the burst that survived, so a reading built from
+ * 5 of 5 consistent pings scores 100 and one built from 2 of 5 scores 40.
+ * Bursts are at most BURST_MAX_SAMPLES long; the insertion sort is cheaper
+ * than anything cleverer at that size.
+ */
+
+#ifndef BURST_FILTER_H
+#define BURST_FILTER_H
+
+#include <stdint.h>
+
+#define BURST_MAX_SAMPLES 9 // Longest supported burst
+#define BURST_OUTLIER_K 3   // Reject samples further than K * MAD from the median
+#define BURST_MIN_MAD 2     // MAD floor, so tight bursts still tolerate 1-2 units of jitter
+
+static inline void burst_sort(uint16_t *v, int n)
+{
+    int i, j;
+
+    for (i = 1; i < n; i++)
+    {
+        uint16_t x = v[i];
+        for (j = i; j > 0 && v[j - 1] > x; j--)
+        {
+            v[j] = v[j - 1];
+        }
+        v[j] = x;
+    }
+}
+
+// Lower median: with an even count, averaging the middle pair would let two
+// outliers drag the estimate (and the MAD) halfway towards them
+static inline uint16_t burst_median_sorted(const uint16_t *v, int n)
+{
+    return v[(n - 1) / 2];
+}
+
+/**
+ * Combine a burst of readings into one value
+ *
+ * @param samples    Readings of the burst
+ * @param valid      valid[i] is non-zero if samples[i] was read successfully
+ * @param n          Burst length (at most BURST_MAX_SAMPLES)
+ * @param value      Filled with the combined reading
+ * @param confidence Filled with the share of the burst that was used (0..100)
+ * @return number of readings used (0 = no usable reading, value untouched)
+ */
+static inline int burst_filter(const uint16_t *samples, const uint8_t *valid, int n,
+                               uint16_t *value, uint8_t *confidence)
+{
+    uint16_t good[BURST_MAX_SAMPLES];
+    uint16_t dev[BURST_MAX_SAMPLES];
+    int count = 0;
+    int used = 0;
+    uint32_t sum = 0;
+    int i;
+
+    if (n > BURST_MAX_SAMPLES)
+    {
+        n = BURST_MAX_SAMPLES;
+    }
+    for (i = 0; i < n; i++)
+    {
+        if (valid[i])
+        {
+            good[count++] = samples[i];
+        }
+    }
+    *confidence = 0;
+    if (count == 0)
+    {
+        return 0;
+    }
+
+    burst_sort(good, count);
+    uint16_t median = burst_median_sorted(good, count);
+
+    for (i = 0; i < count; i++)
+    {
+        dev[i] = good[i] > median ? good[i] - median : median - good[i];
+    }
+    burst_sort(dev, count);
+    uint32_t limit = BURST_OUTLIER_K * burst_median_sorted(dev, count);
+    if (limit < BURST_OUTLIER_K * BURST_MIN_MAD)
+    {
+        limit = BURST_OUTLIER_K * BURST_MIN_MAD;
+    }
+
+    for (i = 0; i < count; i++)
+    {
+        uint32_t d = good[i] > median ? good[i] - median : median - good[i];
+        if (d <= limit)
+        {
+            sum += good[i];
+            used++;
+        }
+    }
+
+    // The median itself is always within the limit, so used >= 1
+    *value = (uint16_t)((sum + used / 2) / used);
+    *confidence = (uint8_t)(used * 100 / n);
+    return used;
+}
+
+#endif // BURST_FILTER_H
@@ -0,0 +1,255 @@
+/*
+ * event_correlator.h - Composite event correlation across sensors
+ *
+ * Single-sensor checks cannot tell "someone came in through the door" from
+ * "the cat walked past the PIR". The correlator keeps a bounded, timestamped
+ * queue per event kind and matches rules of the form
+ *
+ *     <count x first> followed by <second> within <window_ms>
+ *
+ * e.g. "door opened, then motion within 30 s while armed". Rules may also be
+ * unordered ("gas and a temperature rise within 60 s, either order").
+ *
+ * Queues hold timestamps in arrival order, so the number of partner events in
+ * the window is found with a binary search: O(log n) per rule, with n bounded
+ * by CORR_QUEUE_CAP. Matches are queued for the caller to turn into alerts.
+ */
+
+#ifndef EVENT_CORRELATOR_H
+#define EVENT_CORRELATOR_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define CORR_QUEUE_CAP 64   // Events remembered per kind
+#define CORR_MAX_RULES 16   // Rules per correlator
+#define CORR_MATCH_CAP 16   // Matches waiting to be drained
+
+typedef enum
+{
+    CORR_EVT_DOOR_OPENED,
+    CORR_EVT_DOOR_CLOSED,
+    CORR_EVT_MOTION,
+    CORR_EVT_GAS,
+    CORR_EVT_TEMP_RISE,
+    CORR_EVT_COUNT
+} corr_event_t;
+
+typedef struct
+{
+    corr_event_t first;      // Event that has to happen first (unless unordered)
+    uint8_t first_count;     // How many "first" events are needed in the window
+    corr_event_t second;     // Event that completes the pattern
+    uint32_t window_ms;      // Maximum time between the events
+    uint8_t unordered;       // 1 if the events may arrive in either order
+    uint8_t requires_armed;  // 1 if the rule only applies while the system is armed
+    uint32_t cooldown_ms;    // Minimum time between two matches of this rule
+    uint8_t alert_type;      // ALERT_TYPE_* raised on a match
+    uint8_t alert_level;     // ALERT_LEVEL_* raised on a match
+    int pulse_code;          // Pulse sent to the alert manager (-1 = none)
+    const char *description; // Alert text
+} corr_rule_t;
+
+typedef struct
+{
+    int rule;                // Index into the rule table
+    uint64_t t_ms;           // Time of the completing event
+    uint32_t events;         // Events of the rule's kinds within its window
+} corr_match_t;
+
+// Ring buffer of event timestamps, oldest first
+typedef struct
+{
+    uint64_t t_ms[CORR_QUEUE_CAP];
+    uint16_t head;
+    uint16_t count;
+} corr_queue_t;
+
+typedef struct
+{
+    corr_queue_t queues[CORR_EVT_COUNT];
+    const corr_rule_t *rules;
+    int rule_count;
+    uint64_t last_fired_ms[CORR_MAX_RULES];
+    uint8_t fired[CORR_MAX_RULES];
+
+    corr_match_t matches[CORR_MATCH_CAP];
+    uint16_t match_head;
+    uint16_t match_count;
+
+    uint32_t events;         // Events posted
+    uint32_t total_matches;  // Rules matched
+    uint32_t dropped;        // Matches lost because nobody drained them
+} correlator_t;
+
+static inline uint64_t corr_queue_at(const corr_queue_t *q, uint16_t i)
+{
+    return q->t_ms[(q->head + i) % CORR_QUEUE_CAP];
+}
+
+static inline void corr_queue_push(corr_queue_t *q, uint64_t t_ms)
+{
+    if (q->count == CORR_QUEUE_CAP)
+    {
+        q->head = (q->head + 1) % CORR_QUEUE_CAP;
+        q->count--;
+    }
+    q->t_ms[(q->head + q->count) % CORR_QUEUE_CAP] = t_ms;
+    q->count++;
+}
+
+/**
+ * Count queued events with timestamp >= since_ms (binary search)
+ */
+static inline uint16_t corr_queue_count_since(const corr_queue_t *q, uint64_t since_ms)
+{
+    uint16_t lo = 0;
+    uint16_t hi = q->count;
+
+    while (lo < hi)
+    {
+        uint16_t mid = lo + (hi - lo) / 2;
+        if (corr_queue_at(q, mid) < since_ms)
+        {
+            lo = mid + 1;
+        }
+        else
+        {
+            hi = mid;
+        }
+    }
+    return q->count - lo;
+}
+
+/**
+ * Initialize a correlator with a rule table
+ *
+ * @param corr       Correlator to initialize
+ * @param rules      Rule table (must outlive the correlator)
+ * @param rule_count Number of rules (at most CORR_MAX_RULES)
+ */
+static inline void correlator_init(correlator_t *corr, const corr_rule_t *rules, int rule_count)
+{
+    int i;
+
+    for (i = 0; i < CORR_EVT_COUNT; i++)
+    {
+        corr->queues[i].head = corr->queues[i].count = 0;
+    }
+    corr->rules = rules;
+    corr->rule_count = rule_count > CORR_MAX_RULES ? CORR_MAX_RULES : rule_count;
+    for (i = 0; i < CORR_MAX_RULES; i++)
+    {
+        corr->last_fired_ms[i] = 0;
+        corr->fired[i] = 0;
+    }
+    corr->match_head = corr->match_count = 0;
+    corr->events = corr->total_matches = corr->dropped = 0;
+}
+
+static inline bool corr_rule_satisfied(const correlator_t *corr, const corr_rule_t *rule,
+                                       corr_event_t partner, uint8_t needed, uint64_t now_ms)
+{
+    uint64_t since = now_ms > rule->window_ms ? now_ms - rule->window_ms : 0;
+    return corr_queue_count_since(&corr->queues[partner], since) >= needed;
+}
+
+/**
+ * Post an event and evaluate the rules it can complete
+ *
+ * @param corr    Correlator
+ * @param event   Event kind
+ * @param now_ms  Monotonic time of the event
+ * @param armed   true if the system is currently armed
+ * @return number of rules matched by this event
+ */
+static inline int correlator_post(correlator_t *corr, corr_event_t event, uint64_t now_ms, bool armed)
+{
+    corr_queue_t *q = &corr->queues[event];
+    int matched = 0;
+    int i;
+
+    // Keep every queue sorted even if callers race slightly on timestamps
+    if (q->count > 0 && now_ms < corr_queue_at(q, q->count - 1))
+    {
+        now_ms = corr_queue_at(q, q->count - 1);
+    }
+    corr_queue_push(q, now_ms);
+    corr->events++;
+
+    for (i = 0; i < corr->rule_count; i++)
+    {
+        const corr_rule_t *rule = &corr->rules[i];
+        bool hit = false;
+
+        if (rule->requires_armed && !armed)
+        {
+            continue;
+        }
+
+        if (rule->second == event)
+        {
+            hit = corr_rule_satisfied(corr, rule, rule->first, rule->first_count, now_ms);
+        }
+        if (!hit && rule->unordered && rule->first == event)
+        {
+            // The "first" event may complete an unordered rule; it must itself
+            // have happened first_count times within the window
+            hit = corr_rule_satisfied(corr, rule, rule->second, 1, now_ms) &&
+                  corr_rule_satisfied(corr, rule, rule->first, rule->first_count, now_ms);
+        }
+        if (!hit)
+        {
+            continue;
+        }
+        if (corr->fired[i] && now_ms - corr->last_fired_ms[i] < rule->cooldown_ms)
+        {
+            continue;
+        }
+
+        corr->fired[i] = 1;
+        corr->last_fired_ms[i] = now_ms;
+        corr->total_matches++;
+        matched++;
+
+        if (corr->match_count == CORR_MATCH_CAP)
+        {
+            corr->match_head = (corr->match_head + 1) % CORR_MATCH_CAP;
+            corr->match_count--;
+            corr->dropped++;
+        }
+        corr_match_t *slot = &corr->matches[(corr->match_head + corr->match_count) % CORR_MATCH_CAP];
+        uint64_t since = now_ms > rule->window_ms ? now_ms - rule->window_ms : 0;
+        slot->rule = i;
+        slot->t_ms = now_ms;
+        slot->events = corr_queue_count_since(&corr->queues[rule->first], since);
+        if (rule->second != rule->first)
+        {
+            slot->events += corr_queue_count_since(&corr->queues[rule->second], since);
+        }
+        corr->match_count++;
+    }
+
+    return matched;
+}
+
+/**
+ * Take the oldest pending match
+ *
+ * @param corr  Correlator
+ * @param match Filled with the match
+ * @return true if a match was returned
+ */
+static inline bool correlator_pop(correlator_t *corr, corr_match_t *match)
+{
+    if (corr->match_count == 0)
+    {
+        return false;
+    }
+    *match = corr->matches[corr->match_head];
+    corr->match_head = (corr->match_head + 1) % CORR_MATCH_CAP;
+    corr->match_count--;
+    return true;
+}
+
+#endif // EVENT_CORRELATOR_H
@@ -0,0 +1,286 @@
+/*
+ * rolling_stats.h - Streaming statistics for a single sensor value
+ *
+ * Everything here runs in constant time and memory per sample:
+ *  - EWMA at several time constants (alpha derived from the sample spacing,
+ *    so irregular read intervals are handled correctly)
+ *  - Welford running mean/variance
+ *  - Min/max over a sliding time window using monotonic deques
+ *    (amortized O(1) per sample, bounded by ROLLING_WINDOW_CAP entries)
+ *
+ * The deques keep at most one entry per ROLLING_BUCKET_MS slice of the window:
+ * a sample that lands in the slice of the back entry and does not beat it only
+ * moves that entry's time forward. A window of any sample rate then fits in
+ * ROLLING_WINDOW_CAP entries, at the cost of an extreme being held up to one
+ * bucket (about 0.6 s) past the end of the window. Without the buckets,
+ * boosted polling (an ultrasonic sensor every 60 ms is 5000 samples per
+ * window) would overflow the deque and drop its front entry, which is the
+ * current extreme.
+ */
+
+#ifndef ROLLING_STATS_H
+#define ROLLING_STATS_H
+
+#include <math.h>
+#include <stdint.h>
+
+#include "../msg_def.h"
+
+#define ROLLING_WINDOW_CAP 512        // Max samples held by each min/max deque
+#define ROLLING_WINDOW_MS (5 * 60000) // Min/max window length (5 minutes)
+// One deque entry per bucket; a window touches at most ROLLING_WINDOW_CAP - 1 buckets, so
+// the entry of a new sample always fits
+#define ROLLING_BUCKET_MS (ROLLING_WINDOW_MS / (ROLLING_WINDOW_CAP - 3))
+
+// EWMA time constants, matching the slots of sensor_stats_t.ewma[]
+static const double rolling_ewma_tau_ms[SENSOR_STATS_EWMA_COUNT] = {10000.0, 60000.0, 600000.0};
+
+typedef struct
+{
+    uint64_t t_ms;
+    float value;
+} rolling_entry_t;
+
+// Fixed-capacity ring buffer used as a monotonic deque
+typedef struct
+{
+    rolling_entry_t entries[ROLLING_WINDOW_CAP];
+    uint16_t head;
+    uint16_t count;
+} rolling_deque_t;
+
+typedef struct
+{
+    double ewma[SENSOR_STATS_EWMA_COUNT];
+    uint64_t last_ms;
+
+    uint32_t count;
+    double mean;
+    double m2;
+
+    rolling_deque_t min_q; // Increasing values front to back
+    rolling_deque_t max_q; // Decreasing values front to back
+    uint32_t truncated;    // Front entries dropped from a full deque (window cut short)
+} rolling_stats_t;
+
+// rolling_stats_t without its deques, for checkpoints: the moments and the current window extremes
+typedef struct
+{
+    double ewma[SENSOR_STATS_EWMA_COUNT];
+    uint64_t last_ms;
+    uint32_t count;
+    uint32_t truncated;
+    double mean;
+    double m2;
+    rolling_entry_t min; // Front of min_q (valid when count > 0)
+    rolling_entry_t max; // Front of max_q
+} rolling_stats_saved_t;
+
+static inline rolling_entry_t *rolling_deque_at(rolling_deque_t *q, uint16_t i)
+{
+    return &q->entries[(q->head + i) % ROLLING_WINDOW_CAP];
+}
+
+/**
+ * Push a sample onto the back of a deque
+ *
+ * @return 1 if the front entry had to be dropped to make room, else 0
+ */
+static inline int rolling_deque_push(rolling_deque_t *q, uint64_t t_ms, float value, int keep_min)
+{
+    int dropped = 0;
+
+    // Drop entries from the back that can never be the window extreme again
+    while (q->count > 0)
+    {
+        float back = rolling_deque_at(q, q->count - 1)->value;
+        if (keep_min ? (back < value) : (back > value))
+        {
+            break;
+        }
+        q->count--;
+    }
+
+    // The back entry beats this sample within the same bucket: it stands for both
+    if (q->count > 0)
+    {
+        rolling_entry_t *back = rolling_deque_at(q, q->count - 1);
+        if (back->t_ms / ROLLING_BUCKET_MS == t_ms / ROLLING_BUCKET_MS)
+        {
+            back->t_ms = t_ms;
+            return 0;
+        }
+    }
+
+    // Out of room: the oldest entry is sacrificed (window shrinks slightly).
+    // Buckets keep this from happening unless the clock jumps backwards.
+    if (q->count == ROLLING_WINDOW_CAP)
+    {
+        q->head = (q->head + 1) % ROLLING_WINDOW_CAP;
+        q->count--;
+        dropped = 1;
+    }
+
+    rolling_entry_t *slot = rolling_deque_at(q, q->count);
+    slot->t_ms = t_ms;
+    slot->value = value;
+    q->count++;
+    return dropped;
+}
+
+static inline void rolling_deque_expire(rolling_deque_t *q, uint64_t now_ms)
+{
+    while (q->count > 1 && now_ms - q->entries[q->head].t_ms > ROLLING_WINDOW_MS)
+    {
+        q->head = (q->head + 1) % ROLLING_WINDOW_CAP;
+        q->count--;
+    }
+}
+
+/**
+ * Reset statistics
+ */
+static inline void rolling_stats_init(rolling_stats_t *stats)
+{
+    stats->count = 0;
+    stats->mean = 0.0;
+    stats->m2 = 0.0;
+    stats->last_ms = 0;
+    stats->min_q.head = stats->min_q.count = 0;
+    stats->max_q.head = stats->max_q.count = 0;
+    stats->truncated = 0;
+}
+
+/**
+ * Add one sample
+ *
+ * @param stats  Statistics to update
+ * @param value  Sample value
+ * @param now_ms Monotonic time of the sample
+ */
+static inline void rolling_stats_add(rolling_stats_t *stats, double value, uint64_t now_ms)
+{
+    int i;
+
+    if (stats->count == 0)
+    {
+        for (i = 0; i < SENSOR_STATS_EWMA_COUNT; i++)
+        {
+            stats->ewma[i] = value;
+        }
+    }
+    else
+    {
+        double dt = (double)(now_ms - stats->last_ms);
+        for (i = 0; i < SENSOR_STATS_EWMA_COUNT; i++)
+        {
+            double alpha = 1.0 - exp(-dt / rolling_ewma_tau_ms[i]);
+            stats->ewma[i] += alpha * (value - stats->ewma[i]);
+        }
+    }
+    stats->last_ms = now_ms;
+
+    // Welford's online algorithm
+    stats->count++;
+    double delta = value - stats->mean;
+    stats->mean += delta / stats->count;
+    stats->m2 += delta * (value - stats->mean);
+
+    stats->truncated += rolling_deque_push(&stats->min_q, now_ms, (float)value, 1);
+    stats->truncated += rolling_deque_push(&stats->max_q, now_ms, (float)value, 0);
+    rolling_deque_expire(&stats->min_q, now_ms);
+    rolling_deque_expire(&stats->max_q, now_ms);
+}
+
+/**
+ * Sample variance (0 until at least two samples have been seen)
+ */
+static inline double rolling_stats_variance(const rolling_stats_t *stats)
+{
+    return stats->count > 1 ? stats->m2 / (stats->count - 1) : 0.0;
+}
+
+/**
+ * Save the moments and window extremes (under 100 bytes instead of the deques)
+ */
+static inline void rolling_stats_save(const rolling_stats_t *stats, rolling_stats_saved_t *out)
+{
+    int i;
+
+    for (i = 0; i < SENSOR_STATS_EWMA_COUNT; i++)
+    {
+        out->ewma[i] = stats->ewma[i];
+    }
+    out->last_ms = stats->last_ms;
+    out->count = stats->count;
+    out->truncated = stats->truncated;
+    out->mean = stats->mean;
+    out->m2 = stats->m2;
+    out->min = stats->min_q.entries[stats->min_q.head];
+    out->max = stats->max_q.entries[stats->max_q.head];
+}
+
+/**
+ * Restore statistics saved by rolling_stats_save()
+ *
+ * The saved extremes seed the deques and expire with the window as usual;
+ * the samples between them and the save are gone, so until they expire the
+ * window min/max only know the extremes and the samples added since.
+ */
+static inline void rolling_stats_restore(rolling_stats_t *stats, const rolling_stats_saved_t *in)
+{
+    int i;
+
+    rolling_stats_init(stats);
+    if (in->count == 0)
+    {
+        return;
+    }
+    for (i = 0; i < SENSOR_STATS_EWMA_COUNT; i++)
+    {
+        stats->ewma[i] = in->ewma[i];
+    }
+    stats->last_ms = in->last_ms;
+    stats->count = in->count;
+    stats->truncated = in->truncated;
+    stats->mean = in->mean;
+    stats->m2 = in->m2;
+    stats->min_q.entries[0] = in->min;
+    stats->min_q.count = 1;
+    stats->max_q.entries[0] = in->max;
+    stats->max_q.count = 1;
+}
+
+/**
+ * Copy the current statistics into the wire format
+ *
+ * @param stats  Statistics to read
+ * @param out    Snapshot written into the sensor data message
+ */
+static inline void rolling_stats_snapshot(const rolling_stats_t *stats, sensor_stats_t *out)
+{
+    int i;
+
+    out->count = stats->count;
+    out->truncated = stats->truncated;
+    if (stats->count == 0)
+    {
+        for (i = 0; i < SENSOR_STATS_EWMA_COUNT; i++)
+        {
+            out->ewma[i] = 0.0f;
+        }
+        out->mean = out->variance = out->min = out->max = 0.0f;
+        return;
+    }
+
+    for (i = 0; i < SENSOR_STATS_EWMA_COUNT; i++)
+    {
+        out->ewma[i] = (float)stats->ewma[i];
+    }
+    out->mean = (float)stats->mean;
+    out->variance = (float)rolling_stats_variance(stats);
+    out->min = stats->min_q.entries[stats->min_q.head].value;
+    out->max = stats->max_q.entries[stats->max_q.head].value;
+}
+
+#endif // ROLLING_STATS_H
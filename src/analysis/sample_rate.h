@@ -0,0 +1,93 @@
+/*
+ * sample_rate.h - Activity-driven adaptive sampling interval
+ *
+ * Polling every sensor once a second wastes wakeups while nothing happens and
+ * is still too slow during an incident. Each adaptive sensor keeps its own
+ * interval between a hardware minimum and an idle maximum:
+ *
+ *  - while readings are stable the interval grows by 50% per sample up to max_ms
+ *  - a reading that moves by more than `tolerance`, or a related event
+ *    elsewhere (door activity, temperature rising, ...), boosts the sensor to
+ *    min_ms and holds it there for hold_ms
+ *
+ * min_ms is where hardware limits go (the DHT11 cannot be read faster than
+ * once per second). Everything is O(1) per sample.
+ */
+
+#ifndef SAMPLE_RATE_H
+#define SAMPLE_RATE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+typedef struct
+{
+    uint32_t interval_ms;    // Interval until the next read
+    uint64_t boost_until_ms; // Fast sampling is held until this time
+    int last_value;          // Previous reading
+    uint8_t has_value;       // 1 once a reading has been seen
+    uint32_t boosts;         // Times the sensor was boosted
+} sample_rate_t;
+
+/**
+ * Boost a sensor to its fastest rate
+ *
+ * @param rate    Sampling state
+ * @param now_ms  Monotonic time
+ * @param min_ms  Fastest allowed interval
+ * @param hold_ms How long to stay at the fast rate
+ * @return true if the sensor was sampling slower than min_ms (its sleeping
+ *         thread should be woken so the new rate applies immediately)
+ */
+static inline bool sample_rate_boost(sample_rate_t *rate, uint64_t now_ms, uint32_t min_ms,
+                                     uint32_t hold_ms)
+{
+    bool was_slow = rate->interval_ms > min_ms;
+
+    if (now_ms + hold_ms > rate->boost_until_ms)
+    {
+        rate->boost_until_ms = now_ms + hold_ms;
+    }
+    rate->interval_ms = min_ms;
+    rate->boosts++;
+    return was_slow;
+}
+
+/**
+ * Feed a reading and get the interval until the next one
+ *
+ * @param rate      Sampling state
+ * @param value     Latest reading
+ * @param now_ms    Monotonic time of the reading
+ * @param min_ms    Fastest allowed interval
+ * @param max_ms    Interval used when everything is quiet
+ * @param tolerance Change in value that counts as activity
+ * @param hold_ms   How long activity keeps the fast rate
+ * @return interval until the next read (ms)
+ */
+static inline uint32_t sample_rate_update(sample_rate_t *rate, int value, uint64_t now_ms,
+                                          uint32_t min_ms, uint32_t max_ms, int tolerance,
+                                          uint32_t hold_ms)
+{
+    if (rate->has_value && abs(value - rate->last_value) > tolerance)
+    {
+        sample_rate_boost(rate, now_ms, min_ms, hold_ms);
+    }
+    rate->last_value = value;
+    rate->has_value = 1;
+
+    if (rate->interval_ms < min_ms || now_ms < rate->boost_until_ms)
+    {
+        rate->interval_ms = min_ms;
+    }
+    else
+    {
+        // Quiet: back off gradually towards the idle rate
+        uint32_t next = rate->interval_ms + rate->interval_ms / 2;
+        rate->interval_ms = next < max_ms ? next : max_ms;
+    }
+    return rate->interval_ms;
+}
+
+#endif // SAMPLE_RATE_H
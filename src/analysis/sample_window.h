@@ -0,0 +1,84 @@
+/*
+ * sample_window.h - Statistics over one aggregation interval
+ *
+ * A snapshot used to carry only the last value of each sensor, so a motion
+ * blip or gas spike that started and ended between two aggregator ticks never
+ * reached an alert or the dashboard. Each sensor task now adds every good
+ * sample to its instance's window; the aggregator closes the window into the
+ * snapshot (count, active samples, state edges, min/max/mean) and starts the
+ * next one. The message rate does not change.
+ */
+
+#ifndef SAMPLE_WINDOW_H
+#define SAMPLE_WINDOW_H
+
+#include <stdint.h>
+#include <string.h>
+
+#include "../msg_def.h"
+
+typedef struct
+{
+    uint32_t samples;   // Good samples since the window opened
+    uint32_t active;    // ... with the state active
+    uint32_t rising;    // Inactive -> active edges
+    uint32_t falling;   // Active -> inactive edges
+    int32_t min;
+    int32_t max;
+    double sum;
+    uint8_t state;      // State of the latest sample (carried into the next window)
+    uint8_t have_state; // 0 until the first sample ever
+} sample_window_t;
+
+/**
+ * Add a good sample
+ * @param value Reading (°C, cm, or 0/1 for gas and motion)
+ * @param state Filtered state after the sample (1 = active)
+ */
+static inline void sample_window_add(sample_window_t *w, int32_t value, uint8_t state)
+{
+    if (w->samples == 0 || value < w->min)
+    {
+        w->min = value;
+    }
+    if (w->samples == 0 || value > w->max)
+    {
+        w->max = value;
+    }
+    w->samples++;
+    w->sum += value;
+    w->active += state != 0;
+    if (w->have_state && state && !w->state)
+    {
+        w->rising++;
+    }
+    else if (w->have_state && !state && w->state)
+    {
+        w->falling++;
+    }
+    w->state = state != 0;
+    w->have_state = 1;
+}
+
+/**
+ * Copy the window into a snapshot and open the next one
+ * @param out Window statistics of the snapshot (all zero if no sample arrived)
+ */
+static inline void sample_window_close(sample_window_t *w, sensor_window_t *out)
+{
+    memset(out, 0, sizeof(*out));
+    if (w->samples > 0)
+    {
+        out->samples = (uint16_t)(w->samples > UINT16_MAX ? UINT16_MAX : w->samples);
+        out->active = (uint16_t)(w->active > UINT16_MAX ? UINT16_MAX : w->active);
+        out->rising = (uint16_t)(w->rising > UINT16_MAX ? UINT16_MAX : w->rising);
+        out->falling = (uint16_t)(w->falling > UINT16_MAX ? UINT16_MAX : w->falling);
+        out->min = w->min;
+        out->max = w->max;
+        out->mean = (float)(w->sum / w->samples);
+    }
+    w->samples = w->active = w->rising = w->falling = 0;
+    w->sum = 0.0;
+}
+
+#endif // SAMPLE_WINDOW_H
@@ -0,0 +1,140 @@
+/*
+ * sensor_filter.h - Hysteresis and debounce filtering for sensor states
+ *
+ * Turns a noisy reading into a stable boolean state (door closed, temperature
+ * high, gas detected, ...). Each filter is a small O(1) state machine:
+ *
+ *  - Hysteresis: once a threshold has been crossed, the value has to move back
+ *    past the threshold by `band` before the state is allowed to clear.
+ *  - Debounce: a new state has to persist for `dwell_ms` before it is accepted.
+ *
+ * Every naive threshold flip is counted next to the accepted transitions, so
+ * the number of spurious transitions filtered out can be reported.
+ */
+
+#ifndef SENSOR_FILTER_H
+#define SENSOR_FILTER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef struct
+{
+    uint8_t state;             // Filtered (accepted) state
+    uint8_t raw_state;         // Last unfiltered threshold decision
+    uint8_t pending;           // Candidate state waiting out the dwell time
+    uint64_t pending_since_ms; // When the candidate state was first seen
+    uint32_t raw_transitions;  // Flips of the unfiltered decision
+    uint32_t transitions;      // Flips of the filtered state
+} sensor_filter_t;
+
+/**
+ * Reset a filter to a known state
+ *
+ * @param filter  Filter to initialize
+ * @param initial Initial state (0 or 1)
+ */
+static inline void sensor_filter_init(sensor_filter_t *filter, uint8_t initial)
+{
+    filter->state = initial;
+    filter->raw_state = initial;
+    filter->pending = initial;
+    filter->pending_since_ms = 0;
+    filter->raw_transitions = 0;
+    filter->transitions = 0;
+}
+
+/**
+ * Feed one decision through the debounce stage
+ *
+ * @param filter    Filter to update
+ * @param raw       Unfiltered threshold decision (plain comparison)
+ * @param candidate Decision after hysteresis has been applied
+ * @param dwell_ms  Time the candidate must persist before it is accepted
+ * @param now_ms    Monotonic time of the sample
+ * @return true if the filtered state changed on this sample
+ */
+static inline bool sensor_filter_debounce(sensor_filter_t *filter, bool raw, bool candidate,
+                                          uint32_t dwell_ms, uint64_t now_ms)
+{
+    if ((uint8_t)raw != filter->raw_state)
+    {
+        filter->raw_state = raw ? 1 : 0;
+        filter->raw_transitions++;
+    }
+
+    if ((uint8_t)candidate == filter->state)
+    {
+        // Back to the accepted state, drop any pending change
+        filter->pending = filter->state;
+        return false;
+    }
+
+    if (filter->pending != (uint8_t)candidate)
+    {
+        filter->pending = candidate ? 1 : 0;
+        filter->pending_since_ms = now_ms;
+    }
+
+    if (now_ms - filter->pending_since_ms >= dwell_ms)
+    {
+        filter->state = filter->pending;
+        filter->transitions++;
+        return true;
+    }
+
+    return false;
+}
+
+/**
+ * Update a boolean sensor (gas, motion) with debounce only
+ *
+ * @return true if the filtered state changed on this sample
+ */
+static inline bool sensor_filter_update(sensor_filter_t *filter, bool value, uint32_t dwell_ms,
+                                        uint64_t now_ms)
+{
+    return sensor_filter_debounce(filter, value, value, dwell_ms, now_ms);
+}
+
+/**
+ * Update an "above threshold" state (e.g. temperature high)
+ *
+ * Becomes active when value > threshold and clears once value <= threshold - band.
+ *
+ * @return true if the filtered state changed on this sample
+ */
+static inline bool sensor_filter_update_above(sensor_filter_t *filter, int value, int threshold,
+                                              int band, uint32_t dwell_ms, uint64_t now_ms)
+{
+    bool raw = value > threshold;
+    bool candidate = filter->state ? (value > threshold - band) : raw;
+    return sensor_filter_debounce(filter, raw, candidate, dwell_ms, now_ms);
+}
+
+/**
+ * Update a "below threshold" state (e.g. temperature low, door closed)
+ *
+ * Becomes active when value < threshold and clears once value >= threshold + band.
+ *
+ * @return true if the filtered state changed on this sample
+ */
+static inline bool sensor_filter_update_below(sensor_filter_t *filter, int value, int threshold,
+                                              int band, uint32_t dwell_ms, uint64_t now_ms)
+{
+    bool raw = value < threshold;
+    bool candidate = filter->state ? (value < threshold + band) : raw;
+    return sensor_filter_debounce(filter, raw, candidate, dwell_ms, now_ms);
+}
+
+/**
+ * Number of unfiltered flips that never became accepted transitions
+ */
+static inline uint32_t sensor_filter_suppressed(const sensor_filter_t *filter)
+{
+    return filter->raw_transitions > filter->transitions
+               ? filter->raw_transitions - filter->transitions
+               : 0;
+}
+
+#endif // SENSOR_FILTER_H
@@ -0,0 +1,197 @@
+/*
+ * sensor_health.h - Per-sensor health tracking and polling back-off
+ *
+ * A single *_valid flag only says whether the last read worked. The health
+ * monitor keeps enough history to tell a flaky sensor from a dead or stuck one:
+ *
+ *  - failure rate (EWMA over reads) and consecutive failures
+ *  - stuck-at detection: the same value for longer than a per-sensor limit
+ *    (e.g. a DHT11 frozen on one reading, a PIR output stuck high)
+ *  - read-time anomalies: reads taking far longer than usual
+ *
+ * Sensors that keep failing are polled with exponential back-off instead of
+ * being hammered every cycle.
+ */
+
+#ifndef SENSOR_HEALTH_H
+#define SENSOR_HEALTH_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "../msg_def.h"
+
+#define HEALTH_FAIL_RATE_ALPHA 0.1f   // EWMA weight of each read in the failure rate
+#define HEALTH_DEGRADED_RATE 0.2f     // Failure rate above which a sensor is degraded
+#define HEALTH_SLOW_READ_FACTOR 4     // Read is slow if it takes this many times the average
+#define HEALTH_SLOW_READ_MIN_US 5000  // ... and at least this long
+#define HEALTH_SLOW_READ_ALPHA 0.05f  // EWMA weight of each read in the average read time
+
+typedef struct
+{
+    uint32_t reads;            // Total reads attempted
+    uint32_t failures;         // Total failed reads
+    uint32_t consecutive_failures;
+    uint32_t slow_reads;       // Reads flagged as taking abnormally long
+    float failure_rate;        // EWMA of failures (0..1)
+    float avg_read_us;         // EWMA of read duration
+    uint32_t max_read_us;      // Longest read seen
+
+    int last_value;            // Value used for stuck-at detection
+    uint64_t same_since_ms;    // Time the value last changed
+    uint8_t stuck;             // 1 while the value is considered stuck
+
+    uint8_t state;             // SENSOR_HEALTH_*
+    uint32_t poll_interval_ms; // Interval chosen for the next read
+} sensor_health_t;
+
+static inline void sensor_health_classify(sensor_health_t *h, uint32_t fail_threshold)
+{
+    if (h->consecutive_failures >= fail_threshold)
+    {
+        h->state = SENSOR_HEALTH_FAILED;
+    }
+    else if (h->stuck)
+    {
+        h->state = SENSOR_HEALTH_STUCK;
+    }
+    else if (h->failure_rate > HEALTH_DEGRADED_RATE)
+    {
+        h->state = SENSOR_HEALTH_DEGRADED;
+    }
+    else
+    {
+        h->state = SENSOR_HEALTH_OK;
+    }
+}
+
+static inline void sensor_health_record_time(sensor_health_t *h, uint32_t read_us)
+{
+    if (h->reads > 1 && read_us > HEALTH_SLOW_READ_MIN_US &&
+        read_us > HEALTH_SLOW_READ_FACTOR * h->avg_read_us)
+    {
+        h->slow_reads++;
+    }
+    h->avg_read_us = h->reads > 1 ? h->avg_read_us + HEALTH_SLOW_READ_ALPHA * (read_us - h->avg_read_us)
+                                  : (float)read_us;
+    if (read_us > h->max_read_us)
+    {
+        h->max_read_us = read_us;
+    }
+}
+
+/**
+ * Record a successful read
+ *
+ * @param h              Health state
+ * @param value          Value read (used for stuck-at detection)
+ * @param read_us        Time the read took
+ * @param now_ms         Monotonic time of the read
+ * @param stuck_after_ms Value unchanged for this long = stuck (0 = no stuck check)
+ * @param fail_threshold Consecutive failures that mark the sensor failed
+ */
+static inline void sensor_health_success(sensor_health_t *h, int value, uint32_t read_us,
+                                         uint64_t now_ms, uint32_t stuck_after_ms,
+                                         uint32_t fail_threshold)
+{
+    h->reads++;
+    h->consecutive_failures = 0;
+    h->failure_rate *= 1.0f - HEALTH_FAIL_RATE_ALPHA;
+    sensor_health_record_time(h, read_us);
+
+    if (h->reads == 1 || value != h->last_value || stuck_after_ms == 0)
+    {
+        h->last_value = value;
+        h->same_since_ms = now_ms;
+        h->stuck = 0;
+    }
+    else if (now_ms - h->same_since_ms >= stuck_after_ms)
+    {
+        h->stuck = 1;
+    }
+
+    sensor_health_classify(h, fail_threshold);
+}
+
+/**
+ * Record a failed read
+ *
+ * @param h              Health state
+ * @param read_us        Time the failed read took
+ * @param fail_threshold Consecutive failures that mark the sensor failed
+ */
+static inline void sensor_health_failure(sensor_health_t *h, uint32_t read_us, uint32_t fail_threshold)
+{
+    h->reads++;
+    h->failures++;
+    h->consecutive_failures++;
+    h->failure_rate += HEALTH_FAIL_RATE_ALPHA * (1.0f - h->failure_rate);
+    sensor_health_record_time(h, read_us);
+    sensor_health_classify(h, fail_threshold);
+}
+
+/**
+ * Polling interval for the next read
+ *
+ * Healthy sensors use the base interval. Once a sensor has failed
+ * fail_threshold times in a row the interval doubles with every further
+ * failure, up to max_ms.
+ *
+ * @param h              Health state
+ * @param base_ms        Normal polling interval
+ * @param max_ms         Longest back-off interval
+ * @param fail_threshold Consecutive failures before back-off starts
+ */
+static inline uint32_t sensor_health_interval_ms(const sensor_health_t *h, uint32_t base_ms,
+                                                 uint32_t max_ms, uint32_t fail_threshold)
+{
+    uint32_t interval = base_ms;
+    uint32_t n;
+
+    if (h->consecutive_failures < fail_threshold)
+    {
+        return base_ms;
+    }
+    for (n = fail_threshold; n <= h->consecutive_failures && interval < max_ms; n++)
+    {
+        interval *= 2;
+    }
+    return interval < max_ms ? interval : max_ms;
+}
+
+/**
+ * Copy the health state into the wire format
+ */
+static inline void sensor_health_snapshot(const sensor_health_t *h, sensor_health_info_t *out)
+{
+    out->state = h->state;
+    out->failure_pct = (uint8_t)(h->failure_rate * 100.0f + 0.5f);
+    out->poll_interval_ms = h->poll_interval_ms;
+    out->reads = h->reads;
+    out->failures = h->failures;
+    out->slow_reads = h->slow_reads;
+}
+
+/**
+ * Short name of a health state (for logs and dashboard.json)
+ */
+static inline const char *sensor_health_name(uint8_t state)
+{
+    switch (state)
+    {
+    case SENSOR_HEALTH_UNKNOWN:
+        return "unknown";
+    case SENSOR_HEALTH_OK:
+        return "ok";
+    case SENSOR_HEALTH_DEGRADED:
+        return "degraded";
+    case SENSOR_HEALTH_STUCK:
+        return "stuck";
+    case SENSOR_HEALTH_FAILED:
+        return "failed";
+    default:
+        return "unknown";
+    }
+}
+
+#endif // SENSOR_HEALTH_H
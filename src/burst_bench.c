@@ -0,0 +1,351 @@
+/*
+ * burst_bench.c
+ *
+ *  Ultrasonic Burst Filter Benchmark:
+ *  - Replays a file of recorded HC-SR04 pings through burst_filter()
+ *    (analysis/burst_filter.h) at several burst lengths (-k), grouping
+ *    consecutive pings into bursts as ultrasonic_sensor_read_burst() does
+ *  - Each reading goes through the analyzer's door filter with its default
+ *    settings: closed at <= 10 cm, 3 cm hysteresis, 1 s dwell, readings
+ *    under 60% confidence ignored
+ *  - Reports readings lost (no usable ping) or ignored (low confidence), the
+ *    unfiltered threshold flips and the accepted door toggles, and the mean,
+ *    p50, p99 and worst time of one burst_filter() call
+ *  - A burst length of 1 is a single raw ping per reading, the baseline
+ *
+ *  The ping file is text, one ping per line ("-1" for a ping without echo):
+ *
+ *      # changes: 6        door changes in the capture, if known
+ *      ping <ms> <cm>
+ *
+ *  With a "changes" line the toggles are also reported against it: above it
+ *  the filter let stray pings through, below it a door change was missed.
+ *  -C trig,echo records such a file from a sensor, pinging every
+ *  ULTRASONIC_MIN_INTERVAL_MS for -t seconds (simulated GPIO in the host build).
+ */
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/neutrino.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "analysis/burst_filter.h"
+#include "analysis/sensor_filter.h"
+#include "common/mono_time.h"
+#include "sensors/ultrasonic_sensor.h"
+
+#define BENCH_BUCKETS 64 // Power-of-two histogram of per-call ns
+
+// central_analyzer's defaults (door_closed_dist_cm, door_hysteresis_cm, ...)
+#define BENCH_CLOSED_CM 10
+#define BENCH_HYSTERESIS_CM 3
+#define BENCH_DWELL_MS 1000
+#define BENCH_MIN_CONFIDENCE 60
+
+volatile uint32_t *__RPI_GPIO_REGS = NULL;
+
+typedef struct
+{
+    uint64_t total_ns;
+    uint64_t max_ns;
+    uint32_t buckets[BENCH_BUCKETS];
+} bench_times_t;
+
+typedef struct
+{
+    uint32_t t_ms;
+    uint16_t cm;
+    uint8_t valid;
+} ping_t;
+
+static ping_t *g_pings;
+static size_t g_ping_count;
+static int g_changes = -1;
+static uint32_t g_passes = 100;
+
+static int bucket_of(uint64_t ns)
+{
+    int b = 0;
+
+    while (ns > 1 && b < BENCH_BUCKETS - 1)
+    {
+        ns >>= 1;
+        b++;
+    }
+    return b;
+}
+
+static void record(bench_times_t *t, uint64_t ns)
+{
+    t->total_ns += ns;
+    t->buckets[bucket_of(ns)]++;
+    if (ns > t->max_ns)
+    {
+        t->max_ns = ns;
+    }
+}
+
+// Upper bound (ns) of the bucket holding the given fraction of calls
+static uint64_t percentile(const uint32_t *buckets, uint64_t total, double fraction)
+{
+    uint64_t seen = 0;
+    int b;
+
+    for (b = 0; b < BENCH_BUCKETS; b++)
+    {
+        seen += buckets[b];
+        if (seen >= (uint64_t)(fraction * total))
+        {
+            return 2ULL << b;
+        }
+    }
+    return UINT64_MAX;
+}
+
+static int load_pings(const char *path)
+{
+    FILE *file = fopen(path, "r");
+    char line[128];
+    size_t cap = 0;
+    int lineno = 0;
+
+    if (!file)
+    {
+        fprintf(stderr, "Cannot open %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+    while (fgets(line, sizeof(line), file))
+    {
+        unsigned long t_ms;
+        long cm;
+
+        lineno++;
+        if (sscanf(line, "# changes: %d", &g_changes) == 1 || line[0] == '#' || line[0] == '\n')
+        {
+            continue;
+        }
+        if (sscanf(line, "ping %lu %ld", &t_ms, &cm) != 2 || cm > UINT16_MAX)
+        {
+            fprintf(stderr, "%s:%d: bad line\n", path, lineno);
+            fclose(file);
+            return -1;
+        }
+        if (g_ping_count == cap)
+        {
+            ping_t *grown;
+
+            cap = cap ? cap * 2 : 4096;
+            grown = realloc(g_pings, cap * sizeof(*g_pings));
+            if (!grown)
+            {
+                fclose(file);
+                return -1;
+            }
+            g_pings = grown;
+        }
+        g_pings[g_ping_count].t_ms = (uint32_t)t_ms;
+        g_pings[g_ping_count].valid = cm >= 0;
+        g_pings[g_ping_count].cm = cm >= 0 ? (uint16_t)cm : 0;
+        g_ping_count++;
+    }
+    fclose(file);
+    return 0;
+}
+
+static void run(int k)
+{
+    bench_times_t t = {0};
+    sensor_filter_t filter;
+    uint32_t readings = 0;
+    uint32_t lost = 0;
+    uint32_t ignored = 0;
+    uint32_t pass;
+    size_t first;
+
+    sensor_filter_init(&filter, 1);
+    for (pass = 0; pass < g_passes; pass++)
+    {
+        for (first = 0; first + (size_t)k <= g_ping_count; first += (size_t)k)
+        {
+            uint16_t samples[BURST_MAX_SAMPLES];
+            uint8_t valid[BURST_MAX_SAMPLES];
+            uint16_t distance = 0;
+            uint8_t confidence = 0;
+            uint64_t start;
+            int used;
+            int i;
+
+            for (i = 0; i < k; i++)
+            {
+                samples[i] = g_pings[first + i].cm;
+                valid[i] = g_pings[first + i].valid;
+            }
+            start = mono_time_ns();
+            used = burst_filter(samples, valid, k, &distance, &confidence);
+            record(&t, mono_time_ns() - start);
+
+            // Door state and counts from the first pass only
+            if (pass > 0)
+            {
+                continue;
+            }
+            readings++;
+            if (used == 0)
+            {
+                lost++;
+            }
+            else if (confidence < BENCH_MIN_CONFIDENCE)
+            {
+                ignored++;
+            }
+            else
+            {
+                sensor_filter_update_below(&filter, distance, BENCH_CLOSED_CM + 1, BENCH_HYSTERESIS_CM,
+                                           BENCH_DWELL_MS, g_pings[first + k - 1].t_ms);
+            }
+        }
+    }
+    if (readings == 0)
+    {
+        printf("k=%d: fewer pings than one burst\n", k);
+        return;
+    }
+
+    printf("k=%d %7u %6u %8u %6u %8u", k, readings, lost, ignored, filter.raw_transitions, filter.transitions);
+    if (g_changes >= 0)
+    {
+        printf(" %+7d", (int)filter.transitions - g_changes);
+    }
+    else
+    {
+        printf(" %7s", "-");
+    }
+    printf("  %7.1f  <%5llu  <%5llu  %7.1f\n", (double)t.total_ns / (readings * (uint64_t)g_passes),
+           (unsigned long long)percentile(t.buckets, readings * (uint64_t)g_passes, 0.50),
+           (unsigned long long)percentile(t.buckets, readings * (uint64_t)g_passes, 0.99), t.max_ns / 1e3);
+}
+
+// Record one ping every ULTRASONIC_MIN_INTERVAL_MS for the given time
+static int capture(const char *pins, unsigned seconds, const char *path)
+{
+    struct timespec gap = {.tv_sec = 0, .tv_nsec = ULTRASONIC_MIN_INTERVAL_MS * 1000000L};
+    int trig, echo;
+    uint64_t start_ms;
+    uint64_t now_ms;
+    FILE *file;
+
+    if (sscanf(pins, "%d,%d", &trig, &echo) != 2)
+    {
+        fprintf(stderr, "-C needs trig,echo pins\n");
+        return -1;
+    }
+    if (ultrasonic_sensor_init(trig, echo) != 0)
+    {
+        fprintf(stderr, "Cannot set up the ultrasonic sensor on pins %d,%d\n", trig, echo);
+        return -1;
+    }
+    file = fopen(path, "w");
+    if (!file)
+    {
+        fprintf(stderr, "Cannot create %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+
+    fprintf(file, "# HC-SR04 trig=%d echo=%d, one ping every %d ms for %u s\n", trig, echo,
+            ULTRASONIC_MIN_INTERVAL_MS, seconds);
+    start_ms = mono_time_ms();
+    do
+    {
+        uint16_t cm;
+        int ok = ultrasonic_sensor_read(trig, echo, &cm) == 0;
+
+        now_ms = mono_time_ms();
+        fprintf(file, "ping %llu %d\n", (unsigned long long)(now_ms - start_ms), ok ? (int)cm : -1);
+        nanosleep(&gap, NULL);
+    } while (now_ms - start_ms < seconds * 1000ULL);
+
+    return fclose(file);
+}
+
+int main(int argc, char *argv[])
+{
+    const char *counts = "1,3,5,7,9";
+    const char *capture_pins = NULL;
+    unsigned seconds = 600;
+    uint64_t clock_ns;
+    int opt;
+    int i;
+
+    while ((opt = getopt(argc, argv, "k:n:C:t:")) != -1)
+    {
+        switch (opt)
+        {
+        case 'k':
+            counts = optarg;
+            break;
+        case 'n':
+            g_passes = (uint32_t)strtoul(optarg, NULL, 10);
+            break;
+        case 'C':
+            capture_pins = optarg;
+            break;
+        case 't':
+            seconds = (unsigned)strtoul(optarg, NULL, 10);
+            break;
+        default:
+            optind = argc;
+            break;
+        }
+    }
+    if (optind != argc - 1)
+    {
+        fprintf(stderr, "Usage: %s [-k counts] [-n passes] pings.txt\n"
+                        "       %s -C trig,echo [-t seconds] pings.txt\n",
+                argv[0], argv[0]);
+        return EXIT_FAILURE;
+    }
+    if (capture_pins)
+    {
+        return capture(capture_pins, seconds, argv[optind]) == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+    if (g_passes == 0)
+    {
+        fprintf(stderr, "Need at least one pass\n");
+        return EXIT_FAILURE;
+    }
+    if (load_pings(argv[optind]) != 0)
+    {
+        return EXIT_FAILURE;
+    }
+
+    // Every timing includes one clock read
+    clock_ns = mono_time_ns();
+    for (i = 0; i < 100000; i++)
+    {
+        mono_time_ns();
+    }
+    clock_ns = (mono_time_ns() - clock_ns) / 100000;
+    printf("%zu pings, %u passes, clock read %llu ns (included below)\n\n", g_ping_count, g_passes,
+           (unsigned long long)clock_ns);
+
+    printf("    %7s %6s %8s %6s %8s %7s  %7s  %6s  %6s  %7s\n", "reads", "lost", "ignored", "flips", "toggles",
+           "vs real", "mean ns", "p50 ns", "p99 ns", "max us");
+    while (*counts)
+    {
+        char *end;
+        long k = strtol(counts, &end, 10);
+
+        if (end == counts || k < 1 || k > BURST_MAX_SAMPLES)
+        {
+            fprintf(stderr, "Burst lengths are 1..%d\n", BURST_MAX_SAMPLES);
+            return EXIT_FAILURE;
+        }
+        run((int)k);
+        counts = end + (*end == ',');
+    }
+    return EXIT_SUCCESS;
+}
@@ -2,7 +2,8 @@
  * central_analyzer.c
  *
  *  Central Analyzer Process:
- *  - Spawns threads for each sensor (temperature, gas, PIR motion, ultrasonic)
+ *  - Polls the registered sensors (temperature, gas, PIR motion, ultrasonic;
+ *    see common/sensor_registry.h) on a fixed worker pool (common/worker_pool.h)
  *  - Aggregates sensor data
  *  - Sends required data to other processes
  *
@@ -13,6 +14,7 @@
 
 #include <errno.h>
 #include <pthread.h>
+#include <signal.h>
 #include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
@@ -25,6 +27,23 @@
 #include <unistd.h>
 
 #include "alert_pulse_def.h"
+#include "analysis/anomaly_detector.h"
+#include "analysis/event_correlator.h"
+#include "analysis/rolling_stats.h"
+#include "analysis/sample_window.h"
+#include "analysis/sample_rate.h"
+#include "analysis/sensor_filter.h"
+#include "analysis/sensor_health.h"
+#include "common/binlog.h"
+#include "common/checkpoint.h"
+#include "common/heartbeat.h"
+#include "common/mono_time.h"
+#include "common/runtime_config.h"
+#include "common/sensor_registry.h"
+#include "common/sensor_trace.h"
+#include "common/span_trace.h"
+#include "common/thread_policy.h"
+#include "common/worker_pool.h"
 #include "msg_def.h"
 
 // Sensor modules
@@ -36,7 +55,7 @@
 // Global GPIO register pointer for ultrasonic sensor
 volatile uint32_t *__RPI_GPIO_REGS = NULL;
 
-// GPIO pin definitions
+// GPIO pins of the on-board sensors (used when the config file declares no "sensor" lines)
 #define DHT_GPIO_PIN GPIO4     // DHT11 temperature/humidity sensor
 #define MQ135_GPIO_PIN GPIO27  // MQ135 gas sensor
 #define PIR_GPIO_PIN GPIO21    // PIR motion sensor
@@ -45,368 +64,1755 @@ volatile uint32_t *__RPI_GPIO_REGS = NULL;
 
 // Timing configuration
 #define AGGREGATION_INTERVAL_SEC 2   // Send aggregated data every 5 seconds
-#define SENSOR_READ_INTERVAL_MS 1000 // Read sensors every 1 second
+#define SENSOR_READ_INTERVAL_MS 1000 // Read gas/motion sensors every 1 second
 
-// Threshold configuration (can be adjusted)
-static threshold_config_t thresholds = {
+// Change in a reading that counts as activity for adaptive sampling
+#define TEMP_RATE_TOLERANCE 1       // °C (DHT11 flickers by one step)
+#define ULTRASONIC_RATE_TOLERANCE 5 // cm
+
+// Runtime configuration file (reloaded on change or SIGHUP, see common/runtime_config.h)
+#define CONFIG_FILE "/home/qnxuser/home_safety.conf"
+#define CONFIG_POLL_MS 1000 // How often the config file is checked for changes
+
+// Worker pool
+#define POOL_BLOCKING_WORKERS_MIN 2 // Blocking reads mostly sleep, so allow more workers than cores
+#define POOL_REPORT_INTERVAL_SEC 30 // How often worker utilization and latency are printed
+#define SERVICE_RETRY_MS 1000       // Connection attempts to a server that is not running
+#define AGGREGATOR_STALL_MS (3 * AGGREGATION_INTERVAL_SEC * 1000) // Heartbeats stop past this
+
+// Warm restart (see common/checkpoint.h): state is saved after every aggregation
+#define CHECKPOINT_FILE_FMT "/home/qnxuser/central_analyzer_zone%u.state"
+#define CHECKPOINT_MAX_AGE_SEC 600        // Older snapshots only restore the sequence number
+#define CHECKPOINT_BOOT_TOLERANCE_MS 2000 // Wall/monotonic clock drift still taken as the same boot
+
+// Default thresholds, used for anything the config file does not set
+static const threshold_config_t default_thresholds = {
     .temp_high_threshold = 30,     // 30°C
     .temp_low_threshold = 15,      // 15°C
     .humidity_high_threshold = 80, // 80%
     .humidity_low_threshold = 20,  // 20%
-    .door_closed_dist_cm = 10      // 10 cm or less = door closed
+    .door_closed_dist_cm = 10,     // 10 cm or less = door closed
+    .temp_hysteresis = 1,          // Clear temperature alerts 1°C inside the limit
+    .door_hysteresis_cm = 3,       // Door reads open again beyond 13 cm
+    .temp_dwell_ms = 3000,         // Temperature state must hold for 3 s
+    .gas_dwell_ms = 0,             // Gas is reported immediately
+    .motion_dwell_ms = 0,          // PIR module already holds its output
+    .door_dwell_ms = 1000,         // Door state must hold for 1 s
+    .temp_rise_per_min = 5.0f,     // 5°C/min rise = possible fire
+    .humidity_rise_per_min = 20.0f, // 20%/min rise = steam/leak
+    .anomaly_z_threshold = 4.0f,   // |z| > 4 against the learned baseline
+    .armed = 0,                    // Intrusion rules disarmed
+    .sensor_fail_threshold = 5,    // 5 failed reads in a row = failed
+    .sensor_backoff_max_ms = 60000, // Poll a failed sensor at most once a minute
+    .temp_stuck_ms = 7200000,      // DHT11 reading frozen for 2 hours = stuck
+    .pir_stuck_ms = 3600000,       // PIR high for 1 hour = stuck
+    .temp_min_interval_ms = 1000,  // DHT11 limit
+    .temp_max_interval_ms = 10000, // 10 s while the temperature is steady
+    .ultrasonic_min_interval_ms = 200, // 5 Hz around door activity
+    .ultrasonic_max_interval_ms = 5000, // 5 s while the door is untouched
+    .rate_boost_hold_ms = 30000,   // Stay fast for 30 s after activity
+    .ultrasonic_burst_count = 5,   // 5 pings per reading
+    .ultrasonic_burst_spacing_ms = 60, // HC-SR04 echo settling time
+    .ultrasonic_min_confidence = 60, // 3 of 5 pings must agree
+    .temp_read_retries = 2,        // Up to 3 attempts per DHT11 read
+    .temp_retry_delay_ms = 200,
+    .temp_stale_ms = 30000,        // Serve the last good reading for up to 30 s
+    .gas_stale_ms = 5000,          // Five missed 1 s polls
+    .motion_stale_ms = 5000,
+    .ultrasonic_stale_ms = 15000,  // Three polls at the quiet rate
+    .event_publish_min_ms = 500    // At most two early snapshots per second per sensor
 };
 
-// Shared sensor data structure (protected by mutex)
+// Minimum baseline standard deviation (DHT11 reports whole °C / %)
+#define ANOMALY_MIN_STDDEV 0.5
+
+// Sensor registry (filled in main before the worker pool starts, read-only afterwards)
+static sensor_registry_t g_registry;
+
+// Per-type storage banks: struct-of-arrays indexed by sensor_instance_t.slot.
+// Everything in a bank is protected by g_data_mutex.
+typedef struct
+{
+    const sensor_instance_t *sensor[SENSOR_MAX_PER_TYPE];
+    int count;
+
+    int temperature[SENSOR_MAX_PER_TYPE];
+    int humidity[SENSOR_MAX_PER_TYPE];
+    uint8_t valid[SENSOR_MAX_PER_TYPE];         // Reading no older than temp_stale_ms
+    uint8_t have_value[SENSOR_MAX_PER_TYPE];    // 1 once read successfully
+    uint64_t last_good_ms[SENSOR_MAX_PER_TYPE]; // Monotonic time of the last good read
+    uint8_t high[SENSOR_MAX_PER_TYPE];          // Filtered "above high threshold" state
+    uint8_t low[SENSOR_MAX_PER_TYPE];           // Filtered "below low threshold" state
+    uint8_t anomaly_flags[SENSOR_MAX_PER_TYPE]; // Active ANOMALY_* flags
+
+    sensor_filter_t high_filter[SENSOR_MAX_PER_TYPE];
+    sensor_filter_t low_filter[SENSOR_MAX_PER_TYPE];
+    rolling_stats_t temp_stats[SENSOR_MAX_PER_TYPE];
+    rolling_stats_t humidity_stats[SENSOR_MAX_PER_TYPE];
+    anomaly_detector_t temp_anomaly[SENSOR_MAX_PER_TYPE];
+    anomaly_detector_t humidity_anomaly[SENSOR_MAX_PER_TYPE];
+    sample_rate_t rate[SENSOR_MAX_PER_TYPE];
+    dht_read_stats_t read_stats[SENSOR_MAX_PER_TYPE];
+    sample_window_t window[SENSOR_MAX_PER_TYPE];   // Temperature samples since the last snapshot
+    sensor_window_t closed[SENSOR_MAX_PER_TYPE];   // Window of the snapshot being checked
+
+    uint32_t reports[SENSOR_MAX_PER_TYPE];      // Aggregator reports ...
+    uint32_t available[SENSOR_MAX_PER_TYPE];    // ... with a valid reading
+
+    // Last state seen by check_thresholds_and_alert()
+    uint8_t alerted_high[SENSOR_MAX_PER_TYPE];
+    uint8_t alerted_low[SENSOR_MAX_PER_TYPE];
+    uint8_t alerted_flags[SENSOR_MAX_PER_TYPE];
+} dht_bank_t;
+
 typedef struct
 {
-    int temperature;
-    int humidity;
-    uint8_t temp_sensor_valid;
+    const sensor_instance_t *sensor[SENSOR_MAX_PER_TYPE];
+    int count;
+
+    uint8_t detected[SENSOR_MAX_PER_TYPE]; // Filtered state
+    uint8_t valid[SENSOR_MAX_PER_TYPE];    // Last read good and not stale
+    uint64_t sample_ms[SENSOR_MAX_PER_TYPE]; // Monotonic time of the last good read
+    sensor_filter_t filter[SENSOR_MAX_PER_TYPE];
+    sample_window_t window[SENSOR_MAX_PER_TYPE]; // Samples since the last snapshot
+    sensor_window_t closed[SENSOR_MAX_PER_TYPE]; // Window of the snapshot being checked
+    uint8_t alerted[SENSOR_MAX_PER_TYPE];  // Last state seen by check_thresholds_and_alert()
+    uint8_t fast_pulsed[SENSOR_MAX_PER_TYPE]; // Gas: LED pulse already sent by the fast lane
+} binary_bank_t; // Gas and PIR motion sensors
 
-    uint8_t gas_detected;
-    uint8_t gas_sensor_valid;
+typedef struct
+{
+    const sensor_instance_t *sensor[SENSOR_MAX_PER_TYPE];
+    int count;
+
+    uint16_t distance_cm[SENSOR_MAX_PER_TYPE];
+    uint8_t confidence[SENSOR_MAX_PER_TYPE];
+    uint8_t door_closed[SENSOR_MAX_PER_TYPE];
+    uint8_t valid[SENSOR_MAX_PER_TYPE];    // Last burst accepted and not stale
+    uint64_t sample_ms[SENSOR_MAX_PER_TYPE]; // Monotonic time of the last accepted burst
+    sensor_filter_t filter[SENSOR_MAX_PER_TYPE];
+    rolling_stats_t stats[SENSOR_MAX_PER_TYPE];
+    sample_rate_t rate[SENSOR_MAX_PER_TYPE];
+    sample_window_t window[SENSOR_MAX_PER_TYPE]; // Accepted bursts since the last snapshot
+    sensor_window_t closed[SENSOR_MAX_PER_TYPE]; // Window of the snapshot being checked
+    uint8_t alerted[SENSOR_MAX_PER_TYPE];  // Last state seen by check_thresholds_and_alert()
+} ultrasonic_bank_t;
+
+static dht_bank_t g_dht;
+static binary_bank_t g_gas;
+static binary_bank_t g_motion;
+static ultrasonic_bank_t g_ultrasonic;
+
+// Per-instance health, indexed by sensor_instance_t.id (written under g_data_mutex
+// by the sensor's own task)
+static sensor_health_t g_health[SENSOR_MAX_INSTANCES];
 
-    uint8_t motion_detected;
-    uint8_t motion_sensor_valid;
+static pthread_mutex_t g_data_mutex = PTHREAD_MUTEX_INITIALIZER;
+static uint8_t g_alert_level = ALERT_LEVEL_INFO;
+// Sequence number of the snapshot being collected. Sensor tasks read it to tag
+// their spans; the aggregator moves it on once the snapshot has been checked.
+static _Atomic uint32_t g_sequence_num = 0;
 
-    uint16_t distance_cm;
-    uint8_t door_closed;
-    uint8_t ultrasonic_valid;
+// Checkpointed state of one sensor instance, matched by type and name on restore. The
+// rolling statistics are saved without their min/max deques, so a record stays small.
+typedef struct
+{
+    char name[SENSOR_NAME_LEN];
+    uint8_t type;
+    union
+    {
+        struct
+        {
+            int temperature;
+            int humidity;
+            uint8_t have_value;
+            uint8_t high;
+            uint8_t low;
+            uint8_t anomaly_flags;
+            uint8_t alerted_high;
+            uint8_t alerted_low;
+            uint8_t alerted_flags;
+            uint64_t last_good_ms;
+            sensor_filter_t high_filter;
+            sensor_filter_t low_filter;
+            rolling_stats_saved_t temp_stats;
+            rolling_stats_saved_t humidity_stats;
+            anomaly_detector_t temp_anomaly;
+            anomaly_detector_t humidity_anomaly;
+        } dht;
+        struct
+        {
+            uint8_t detected;
+            uint8_t alerted;
+            sensor_filter_t filter;
+        } binary;
+        struct
+        {
+            uint16_t distance_cm;
+            uint8_t confidence;
+            uint8_t door_closed;
+            uint8_t alerted;
+            sensor_filter_t filter;
+            rolling_stats_saved_t stats;
+        } ultrasonic;
+    } u;
+} sensor_checkpoint_t;
 
+typedef struct
+{
+    uint32_t sequence_num;
     uint8_t alert_level;
-} shared_sensor_data_t;
+    uint16_t sensor_count;
+    sensor_checkpoint_t sensors[SENSOR_MAX_INSTANCES]; // Only sensor_count entries are saved
+} analyzer_checkpoint_t;
+
+#define ANALYZER_CHECKPOINT_SIZE(n) \
+    (offsetof(analyzer_checkpoint_t, sensors) + (size_t)(n) * sizeof(sensor_checkpoint_t))
+
+static checkpoint_t g_checkpoint; // Not mapped when checkpoints are off (-S none) or replaying
+
+// Composite event rules
+static const corr_rule_t g_corr_rules[] = {
+    {.first = CORR_EVT_DOOR_OPENED,
+     .first_count = 1,
+     .second = CORR_EVT_MOTION,
+     .window_ms = 30000,
+     .requires_armed = 1,
+     .cooldown_ms = 60000,
+     .alert_type = ALERT_TYPE_INTRUSION,
+     .alert_level = ALERT_LEVEL_CRITICAL,
+     .pulse_code = DOOR_OPEN,
+     .description = "Intrusion: door opened then motion while armed"},
+    {.first = CORR_EVT_GAS,
+     .first_count = 1,
+     .second = CORR_EVT_TEMP_RISE,
+     .window_ms = 60000,
+     .unordered = 1,
+     .cooldown_ms = 60000,
+     .alert_type = ALERT_TYPE_FIRE,
+     .alert_level = ALERT_LEVEL_CRITICAL,
+     .pulse_code = HIGH_CO2,
+     .description = "Possible fire: gas and temperature rise"},
+};
 
-// Global shared data
-static shared_sensor_data_t g_sensor_data = {0};
-static pthread_mutex_t g_data_mutex = PTHREAD_MUTEX_INITIALIZER;
-static uint32_t g_sequence_num = 0;
+// Event correlator (protected by g_data_mutex)
+static correlator_t g_correlator;
 
-// Connection IDs for message passing
-static int stats_update_coid = -1;
-static int event_logger_coid = -1;
-static int alert_manager_coid = -1;
+// Sensor tasks: one per initialized instance, indexed by sensor_instance_t.id (-1 = not running)
+static worker_pool_t g_pool;
+static int g_sensor_task[SENSOR_MAX_INSTANCES];
+
+// Connections to the other processes. A server that was restarted (see
+// supervisor.c) gets a new channel: a send failing with ESRCH/EBADF drops the
+// connection and reopens it at once; a missing server is retried every
+// SERVICE_RETRY_MS.
+typedef struct
+{
+    const char *name;
+    int coid;             // -1 while not connected
+    uint64_t retry_ms;    // Next connection attempt while not connected
+    uint32_t reconnects;
+    pthread_mutex_t lock;
+} service_t;
+
+static service_t g_stats_update = {"stats_update", -1, 0, 0, PTHREAD_MUTEX_INITIALIZER};
+static service_t g_event_logger = {"event_logger", -1, 0, 0, PTHREAD_MUTEX_INITIALIZER};
+static service_t g_alert_manager = {"alert_manager", -1, 0, 0, PTHREAD_MUTEX_INITIALIZER};
+
+// Aggregator progress, watched by the heartbeat thread
+static volatile uint64_t g_aggregator_progress_ms;
+
+// Event-triggered publishing: a safety-relevant state change (gas, motion, door,
+// temperature high) wakes the aggregator at once instead of waiting for its tick.
+// Everything here is protected by g_data_mutex.
+typedef struct
+{
+    pthread_cond_t cond;                    // Signalled when wake is set (CLOCK_MONOTONIC)
+    uint8_t wake;                           // Publish before the next tick
+    uint64_t pending_ns;                    // Oldest state change not yet published (0 = none)
+    uint64_t last_ms[SENSOR_MAX_INSTANCES]; // Last early publish per sensor (rate limit)
+    uint32_t events;                        // State changes since the last report ...
+    uint32_t limited;                       // ... left to the tick by the rate limit
+    uint32_t early;                         // Snapshots published ahead of the tick
+    uint32_t carried;                       // Snapshots carrying a state change ...
+    uint64_t latency_sum_ns;                // ... and the time from the change to all sends done
+    uint64_t latency_max_ns;
+} publish_state_t;
+
+static publish_state_t g_publish;
 
 // Thread control
 static volatile bool g_running = true;
 
+// Config file path and reload request (set from the SIGHUP handler)
+static const char *g_config_path = CONFIG_FILE;
+static volatile sig_atomic_t g_config_reload_requested = 0;
+
+// Recording (-T) and replay (-r): g_replay points at the trace header while replaying
+static trace_writer_t g_trace;
+static const trace_header_t *g_replay;
+static bool g_log_readings = true; // Print every reading (-q turns it off)
+static uint64_t g_aggregate_ns;     // Time spent aggregating and checking thresholds
+static uint64_t g_aggregate_max_ns;
+
+// Zone this analyzer reports for (-z / -n)
+static uint16_t g_zone_id = 0;
+static char g_zone_name[ZONE_NAME_LEN] = "main";
+
+// One raw reading, taken from the hardware or from a trace
+typedef struct
+{
+    uint64_t now;       // Monotonic ms when the read finished
+    bool ok;
+    int value;          // Temperature, detected flag or distance
+    int value2;         // Humidity
+    uint8_t aux;        // DHT11 attempts, ultrasonic confidence
+    uint32_t read_us;   // Time spent reading
+    uint32_t wasted_us; // DHT11: busy-wait in failed attempts
+} sensor_sample_t;
+
+// Per-type sensor driver: how to set up an instance, read it, and analyse a reading.
+// read() only touches the hardware; ingest() only uses the sample, so a trace can
+// be replayed through the same analysis code.
+typedef struct
+{
+    const char *tag;   // Log prefix
+    const char *label; // Sensor kind in logs and alerts
+    pool_class_t cls;  // Worker class: blocking reads run apart from short ones
+    int (*init)(const sensor_instance_t *sensor);
+    void (*read)(const sensor_instance_t *sensor, int cfg_slot, sensor_sample_t *sample);
+    uint32_t (*ingest)(const sensor_instance_t *sensor, const sensor_sample_t *sample,
+                       int cfg_slot); // Returns ms until the next poll
+} sensor_driver_t;
+
 // Function prototypes
-static void *temperature_sensor_thread(void *arg);
-static void *gas_sensor_thread(void *arg);
-static void *motion_sensor_thread(void *arg);
-static void *ultrasonic_sensor_thread(void *arg);
+static uint32_t sensor_task(void *arg, int cfg_slot);
 static void *aggregator_thread(void *arg);
-static void check_thresholds_and_alert(shared_sensor_data_t *data);
+static void *config_watch_thread(void *arg);
+static void check_thresholds_and_alert(void);
 static void send_alert(uint8_t alert_type, uint8_t alert_level, int sensor_value, const char *description);
-static void send_pulse(uint8_t pulse_type, uint8_t alert_level);
+static int send_pulse(uint8_t pulse_type, uint8_t alert_level);
 static void send_log(const char *message);
-static int connect_to_service(const char *service_name);
+static void connect_to_service(service_t *svc);
+static int service_coid(service_t *svc);
+static int service_send(service_t *svc, int coid, const void *msg, size_t size);
+
+// Record a read outcome in a sensor's health state and pick the next polling interval.
+// Must be called with g_data_mutex held.
+static uint32_t update_sensor_health(sensor_health_t *health, bool ok, int value, uint32_t read_us,
+                                     uint64_t now, uint32_t stuck_after_ms, uint32_t base_ms,
+                                     const threshold_config_t *cfg)
+{
+    if (ok)
+    {
+        sensor_health_success(health, value, read_us, now, stuck_after_ms, cfg->sensor_fail_threshold);
+    }
+    else
+    {
+        sensor_health_failure(health, read_us, cfg->sensor_fail_threshold);
+    }
+    health->poll_interval_ms = sensor_health_interval_ms(
+        health, base_ms, cfg->sensor_backoff_max_ms, cfg->sensor_fail_threshold);
+    return health->poll_interval_ms;
+}
 
-// Temperature sensor thread
-static void *temperature_sensor_thread(void *arg)
+// A safety-relevant state change: wake the aggregator now, unless this sensor already
+// did within event_publish_min_ms (then the tick publishes it). g_data_mutex held.
+static void request_publish(const sensor_instance_t *sensor, uint64_t now, const threshold_config_t *cfg)
 {
-    (void)arg;
-    int temp, hum;
+    uint64_t *last_ms = &g_publish.last_ms[sensor->id];
+
+    g_publish.events++;
+    if (g_publish.pending_ns == 0)
+    {
+        g_publish.pending_ns = mono_time_ns();
+    }
+    if (cfg->event_publish_min_ms == 0 || (*last_ms != 0 && now - *last_ms < cfg->event_publish_min_ms))
+    {
+        g_publish.limited++;
+        return;
+    }
+    *last_ms = now;
+    g_publish.wake = 1;
+    pthread_cond_signal(&g_publish.cond);
+}
+
+// Record a raw reading when tracing (-T)
+static void trace_sample(const sensor_instance_t *sensor, const sensor_sample_t *sample)
+{
+    trace_record_t rec;
+
+    memset(&rec, 0, sizeof(rec));
+    rec.kind = TRACE_REC_SAMPLE;
+    rec.sensor = sensor->id;
+    rec.ok = sample->ok;
+    rec.aux = sample->aux;
+    rec.value = sample->value;
+    rec.value2 = sample->value2;
+    rec.read_us = sample->read_us;
+    rec.extra = sample->wasted_us;
+    trace_writer_put(&g_trace, &rec, sample->now, NULL, 0);
+}
+
+// Record the outcome of a message or pulse to another process (rc = MsgSend result)
+static void trace_ipc(trace_ipc_target_t target, int rc)
+{
+    trace_record_t rec;
+
+    memset(&rec, 0, sizeof(rec));
+    rec.kind = TRACE_REC_IPC;
+    rec.sensor = (uint8_t)target;
+    rec.ok = rc != -1;
+    rec.extra = rc == -1 ? (uint32_t)errno : 0;
+    trace_writer_put(&g_trace, &rec, mono_time_ms(), NULL, 0);
+}
+
+// Record the active config. Only called by the thread that publishes configs,
+// so the config cannot be reclaimed while it is copied.
+static void trace_config(void)
+{
+    trace_record_t rec;
+    const threshold_config_t *cfg = config_read_begin(-1);
 
-    printf("[TEMP_SENSOR] Thread started\n");
-    send_log("Temperature sensor thread started");
+    memset(&rec, 0, sizeof(rec));
+    rec.kind = TRACE_REC_CONFIG;
+    trace_writer_put(&g_trace, &rec, mono_time_ms(), cfg, sizeof(*cfg));
+    config_read_end(-1);
+}
 
-    // Initialize DHT11 sensor
-    if (temperature_sensor_init(DHT_GPIO_PIN) != 0)
+// Wall-clock time of a monotonic timestamp (a replay reports the recorded time)
+static time_t wall_time(uint64_t now)
+{
+    if (g_replay)
     {
-        printf("[TEMP_SENSOR] Failed to initialize sensor\n");
-        return NULL;
+        return (time_t)(g_replay->wall_start + (int64_t)((now - g_replay->mono_start_ms) / 1000));
     }
+    return time(NULL);
+}
 
-    while (g_running)
+// Pool threads get the acquisition policy: reads are timed by busy-waiting on GPIO levels
+static int spawn_pool_thread(pthread_t *thread, int role, void *(*fn)(void *), void *arg)
+{
+    (void)role;
+    return thread_policy_create(THREAD_CLASS_ACQUISITION, thread, fn, arg);
+}
+
+// Bring a sensor's next read forward to its boosted interval so the new rate applies immediately
+static void sensor_wake(int sensor, uint32_t interval_ms)
+{
+    worker_pool_wake(&g_pool, g_sensor_task[sensor], interval_ms);
+}
+
+// Boost an adaptive sensor to its fastest rate (g_data_mutex held)
+static void sensor_boost(int sensor, sample_rate_t *rate, uint32_t min_ms, uint64_t now,
+                         const threshold_config_t *cfg)
+{
+    if (sample_rate_boost(rate, now, min_ms, cfg->rate_boost_hold_ms))
     {
-        if (temperature_sensor_read(DHT_GPIO_PIN, &temp, &hum) == 0)
-        {
-            pthread_mutex_lock(&g_data_mutex);
-            g_sensor_data.temperature = temp;
-            g_sensor_data.humidity = hum;
-            g_sensor_data.temp_sensor_valid = 1;
-            pthread_mutex_unlock(&g_data_mutex);
+        sensor_wake(sensor, min_ms);
+    }
+}
+
+// Fastest allowed interval for the adaptive sensors (hardware limits win over config)
+static uint32_t temp_min_interval(const threshold_config_t *cfg)
+{
+    return cfg->temp_min_interval_ms > DHT11_MIN_INTERVAL_MS ? cfg->temp_min_interval_ms
+                                                             : DHT11_MIN_INTERVAL_MS;
+}
+
+static uint32_t ultrasonic_min_interval(const threshold_config_t *cfg)
+{
+    return cfg->ultrasonic_min_interval_ms > ULTRASONIC_MIN_INTERVAL_MS
+               ? cfg->ultrasonic_min_interval_ms
+               : ULTRASONIC_MIN_INTERVAL_MS;
+}
+
+// Idle interval of an adaptive sensor: its own period_ms, else the global maximum
+static uint32_t sensor_max_interval(const sensor_instance_t *sensor, uint32_t global_max_ms,
+                                    uint32_t min_ms)
+{
+    uint32_t max_ms = sensor->period_ms ? sensor->period_ms : global_max_ms;
+    return max_ms > min_ms ? max_ms : min_ms;
+}
 
-            printf("[TEMP_SENSOR] Temp: %d°C, Humidity: %d%%\n", temp, hum);
+// Age of a sample; a sample stored after the caller read its clock counts as new
+static uint32_t sample_age_ms(uint64_t sample_ms, uint64_t now)
+{
+    return now > sample_ms ? (uint32_t)(now - sample_ms) : 0;
+}
+
+// Oldest sample of an instance that is still acted on: the type's *_stale_ms,
+// but never less than two polling periods of a sensor configured to poll slower
+static uint32_t stale_limit_ms(const sensor_instance_t *sensor, const threshold_config_t *cfg)
+{
+    uint32_t limit_ms;
+
+    switch (sensor->type)
+    {
+    case SENSOR_TYPE_TEMPERATURE:
+        limit_ms = cfg->temp_stale_ms;
+        break;
+    case SENSOR_TYPE_GAS:
+        limit_ms = cfg->gas_stale_ms;
+        break;
+    case SENSOR_TYPE_MOTION:
+        limit_ms = cfg->motion_stale_ms;
+        break;
+    default:
+        limit_ms = cfg->ultrasonic_stale_ms;
+        break;
+    }
+    return sensor->period_ms > limit_ms / 2 ? 2 * sensor->period_ms : limit_ms;
+}
+
+// Per-sensor thresholds fall back to the global ones
+static int sensor_threshold(int own, int global)
+{
+    return own != SENSOR_THRESHOLD_DEFAULT ? own : global;
+}
+
+// Log a sensor health state change (called without g_data_mutex held)
+static void report_health_change(const sensor_instance_t *sensor, const char *label, uint8_t old_state,
+                                 uint8_t new_state)
+{
+    char text[96];
+
+    if (old_state == new_state)
+    {
+        return;
+    }
+    snprintf(text, sizeof(text), "%s sensor %s health: %s -> %s", label, sensor->name,
+             sensor_health_name(old_state), sensor_health_name(new_state));
+    LOG_INFO("[HEALTH] %s", text);
+    send_log(text);
+}
+
+// Alert tagged with the sensor instance it came from
+static void send_sensor_alert(const sensor_instance_t *sensor, uint8_t alert_type, uint8_t alert_level,
+                              int sensor_value, const char *description)
+{
+    char text[96];
+
+    snprintf(text, sizeof(text), "%s [%s/%s]", description, g_zone_name, sensor->name);
+    send_alert(alert_type, alert_level, sensor_value, text);
+}
+
+static int dht_init(const sensor_instance_t *sensor)
+{
+    return temperature_sensor_init(sensor->pin);
+}
+
+// Read one DHT11 frame (temperature + humidity), retrying failed frames
+static void dht_read(const sensor_instance_t *sensor, int cfg_slot, sensor_sample_t *sample)
+{
+    dht_read_stats_t stats;
+    int temp = 0, hum = 0;
+    int retries;
+    uint32_t retry_delay_ms;
+
+    // Retries sleep between attempts; keep them outside the config read section
+    const threshold_config_t *cfg = config_read_begin(cfg_slot);
+    retries = cfg->temp_read_retries;
+    retry_delay_ms = cfg->temp_retry_delay_ms;
+    config_read_end(cfg_slot);
+
+    memset(&stats, 0, sizeof(stats));
+    sample->ok = temperature_sensor_read_retry(sensor->pin, retries, retry_delay_ms, &temp, &hum,
+                                               &sample->read_us, &stats) == 0;
+    sample->now = mono_time_ms();
+    sample->value = temp;
+    sample->value2 = hum;
+    sample->aux = (uint8_t)stats.attempts;
+    sample->wasted_us = (uint32_t)stats.wasted_busy_us;
+}
+
+// Feed a DHT11 sample to the filters, baselines and health state
+static uint32_t dht_ingest(const sensor_instance_t *sensor, const sensor_sample_t *sample, int cfg_slot)
+{
+    int i = sensor->slot;
+    int temp = sample->value, hum = sample->value2;
+    bool ok = sample->ok;
+    uint64_t now = sample->now;
+    sensor_health_t *health = &g_health[sensor->id];
+    dht_read_stats_t *stats = &g_dht.read_stats[i];
+    uint8_t old_health = health->state;
+    uint32_t interval_ms;
+    const threshold_config_t *cfg = config_read_begin(cfg_slot);
+    uint32_t base_ms = temp_min_interval(cfg);
+
+    pthread_mutex_lock(&g_data_mutex);
+    stats->cycles++;
+    stats->attempts += sample->aux;
+    stats->retries += sample->aux > 1 ? sample->aux - 1 : 0;
+    stats->recovered += ok && sample->aux > 1;
+    stats->busy_us += sample->read_us;
+    stats->wasted_busy_us += sample->wasted_us;
+    if (ok)
+    {
+        uint8_t was_rising = g_dht.temp_anomaly[i].rise_alarm;
+        int high = sensor_threshold(sensor->threshold_high, cfg->temp_high_threshold);
+        int low = sensor_threshold(sensor->threshold_low, cfg->temp_low_threshold);
+
+        g_dht.temperature[i] = temp;
+        g_dht.humidity[i] = hum;
+        g_dht.valid[i] = 1;
+        g_dht.have_value[i] = 1;
+        g_dht.last_good_ms[i] = now;
+        if (sensor_filter_update_above(&g_dht.high_filter[i], temp, high, cfg->temp_hysteresis,
+                                       cfg->temp_dwell_ms, now) &&
+            g_dht.high_filter[i].state)
+        {
+            correlator_post(&g_correlator, CORR_EVT_TEMP_RISE, now, cfg->armed);
+            request_publish(sensor, now, cfg);
         }
-        else
+        sensor_filter_update_below(&g_dht.low_filter[i], temp, low, cfg->temp_hysteresis,
+                                   cfg->temp_dwell_ms, now);
+        g_dht.high[i] = g_dht.high_filter[i].state;
+        g_dht.low[i] = g_dht.low_filter[i].state;
+        sample_window_add(&g_dht.window[i], temp, g_dht.high[i]);
+        rolling_stats_add(&g_dht.temp_stats[i], temp, now);
+        rolling_stats_add(&g_dht.humidity_stats[i], hum, now);
+        anomaly_detector_update(&g_dht.temp_anomaly[i], temp, now, cfg->temp_rise_per_min,
+                                cfg->anomaly_z_threshold, ANOMALY_MIN_STDDEV);
+        anomaly_detector_update(&g_dht.humidity_anomaly[i], hum, now, cfg->humidity_rise_per_min,
+                                cfg->anomaly_z_threshold, ANOMALY_MIN_STDDEV);
+        g_dht.anomaly_flags[i] = (g_dht.temp_anomaly[i].rise_alarm ? ANOMALY_TEMP_RISE : 0) |
+                                 (g_dht.temp_anomaly[i].outlier ? ANOMALY_TEMP_OUTLIER : 0) |
+                                 (g_dht.humidity_anomaly[i].rise_alarm ? ANOMALY_HUMIDITY_RISE : 0) |
+                                 (g_dht.humidity_anomaly[i].outlier ? ANOMALY_HUMIDITY_OUTLIER : 0);
+        if (g_dht.temp_anomaly[i].rise_alarm && !was_rising)
         {
-            pthread_mutex_lock(&g_data_mutex);
-            g_sensor_data.temp_sensor_valid = 0;
-            pthread_mutex_unlock(&g_data_mutex);
+            correlator_post(&g_correlator, CORR_EVT_TEMP_RISE, now, cfg->armed);
+        }
 
-            printf("[TEMP_SENSOR] Read failed\n");
+        // Temperature climbing (well before the alarm level): sample as fast as allowed
+        if (g_dht.temp_anomaly[i].rate_per_min > cfg->temp_rise_per_min / 4)
+        {
+            sample_rate_boost(&g_dht.rate[i], now, base_ms, cfg->rate_boost_hold_ms);
         }
+        base_ms = sample_rate_update(&g_dht.rate[i], temp, now, base_ms,
+                                     sensor_max_interval(sensor, cfg->temp_max_interval_ms, base_ms),
+                                     TEMP_RATE_TOLERANCE, cfg->rate_boost_hold_ms);
+    }
+    else
+    {
+        // Keep serving the last good reading until it goes stale
+        g_dht.valid[i] = g_dht.have_value[i] &&
+                         sample_age_ms(g_dht.last_good_ms[i], now) <= stale_limit_ms(sensor, cfg);
+    }
+    // Stuck-at check on the combined reading: both values frozen
+    interval_ms = update_sensor_health(health, ok, (temp << 8) | hum, sample->read_us, now, cfg->temp_stuck_ms,
+                                       base_ms, cfg);
+    pthread_mutex_unlock(&g_data_mutex);
+    config_read_end(cfg_slot);
 
-        usleep(SENSOR_READ_INTERVAL_MS * 1000);
+    if (g_log_readings && ok)
+    {
+        LOG_DEBUG("[TEMP_SENSOR] %s: Temp: %d°C, Humidity: %d%%", sensor->name, temp, hum);
     }
+    else if (g_log_readings)
+    {
+        LOG_DEBUG("[TEMP_SENSOR] %s: Read failed after %u attempts", sensor->name, sample->aux);
+    }
+    report_health_change(sensor, "Temperature", old_health, health->state);
 
-    return NULL;
+    return interval_ms;
 }
 
-// Gas sensor thread
-static void *gas_sensor_thread(void *arg)
+static int gas_init(const sensor_instance_t *sensor)
 {
-    (void)arg;
-    bool gas_detected;
+    return gas_sensor_init(sensor->pin);
+}
 
-    printf("[GAS_SENSOR] Thread started\n");
-    send_log("Gas sensor thread started");
+// Read the MQ135 digital output
+static void gas_read(const sensor_instance_t *sensor, int cfg_slot, sensor_sample_t *sample)
+{
+    bool gas_detected = false;
+    uint64_t start_ns = mono_time_ns();
+
+    (void)cfg_slot;
+    sample->ok = gas_sensor_read(sensor->pin, &gas_detected) == 0;
+    uint64_t end_ns = mono_time_ns();
+    sample->read_us = (uint32_t)((end_ns - start_ns) / 1000);
+    sample->now = end_ns / 1000000;
+    sample->value = gas_detected;
+}
 
-    // Initialize MQ135 sensor
-    if (gas_sensor_init(MQ135_GPIO_PIN) != 0)
+// Feed an MQ135 sample to its filter and health state
+static uint32_t gas_ingest(const sensor_instance_t *sensor, const sensor_sample_t *sample, int cfg_slot)
+{
+    int i = sensor->slot;
+    bool gas_detected = sample->value != 0;
+    bool ok = sample->ok;
+    uint64_t now = sample->now;
+    sensor_health_t *health = &g_health[sensor->id];
+    uint8_t old_health = health->state;
+    uint32_t interval_ms;
+    uint8_t fast_pulse = 0;
+    int j;
+    const threshold_config_t *cfg = config_read_begin(cfg_slot);
+
+    pthread_mutex_lock(&g_data_mutex);
+    if (ok)
     {
-        printf("[GAS_SENSOR] Failed to initialize sensor\n");
-        return NULL;
+        if (sensor_filter_update(&g_gas.filter[i], gas_detected, cfg->gas_dwell_ms, now) &&
+            g_gas.filter[i].state)
+        {
+            // Claimed here so the aggregator does not pulse the same edge again
+            fast_pulse = !g_gas.fast_pulsed[i];
+            g_gas.fast_pulsed[i] = 1;
+            correlator_post(&g_correlator, CORR_EVT_GAS, now, cfg->armed);
+            request_publish(sensor, now, cfg);
+            // Gas may mean fire: watch the temperature closely
+            for (j = 0; j < g_dht.count; j++)
+            {
+                sensor_boost(g_dht.sensor[j]->id, &g_dht.rate[j], temp_min_interval(cfg), now, cfg);
+            }
+        }
+        g_gas.detected[i] = g_gas.filter[i].state;
+        g_gas.valid[i] = 1;
+        sample_window_add(&g_gas.window[i], g_gas.detected[i], g_gas.detected[i]);
+        g_gas.sample_ms[i] = now;
+    }
+    else
+    {
+        g_gas.valid[i] = 0;
+    }
+    // "Clean" for hours is normal for a gas sensor, so no stuck-at check
+    interval_ms = update_sensor_health(health, ok, gas_detected, sample->read_us, now, 0,
+                                       sensor->period_ms ? sensor->period_ms : SENSOR_READ_INTERVAL_MS,
+                                       cfg);
+    pthread_mutex_unlock(&g_data_mutex);
+    config_read_end(cfg_slot);
+
+    // Fast lane: light the LED from here; the alert, log and dashboard follow
+    // with the snapshot the edge has already requested
+    if (fast_pulse && send_pulse(HIGH_CO2, ALERT_LEVEL_CRITICAL) != 0)
+    {
+        pthread_mutex_lock(&g_data_mutex);
+        g_gas.fast_pulsed[i] = 0; // Let the aggregator try again
+        pthread_mutex_unlock(&g_data_mutex);
     }
 
-    while (g_running)
+    if (g_log_readings && ok)
     {
-        if (gas_sensor_read(MQ135_GPIO_PIN, &gas_detected) == 0)
-        {
-            pthread_mutex_lock(&g_data_mutex);
-            g_sensor_data.gas_detected = gas_detected ? 1 : 0;
-            g_sensor_data.gas_sensor_valid = 1;
-            pthread_mutex_unlock(&g_data_mutex);
+        LOG_DEBUG("[GAS_SENSOR] %s: Gas: %s", sensor->name, gas_detected ? "DETECTED" : "Clean");
+    }
+    else if (g_log_readings)
+    {
+        LOG_DEBUG("[GAS_SENSOR] %s: Read failed", sensor->name);
+    }
+    report_health_change(sensor, "Gas", old_health, health->state);
 
-            printf("[GAS_SENSOR] Gas: %s\n", gas_detected ? "DETECTED" : "Clean");
-        }
-        else
+    return interval_ms;
+}
+
+static int motion_init(const sensor_instance_t *sensor)
+{
+    return motion_sensor_init(sensor->pin);
+}
+
+// Read the PIR output
+static void motion_read(const sensor_instance_t *sensor, int cfg_slot, sensor_sample_t *sample)
+{
+    bool motion_detected = false;
+    uint64_t start_ns = mono_time_ns();
+
+    (void)cfg_slot;
+    sample->ok = motion_sensor_read(sensor->pin, &motion_detected) == 0;
+    uint64_t end_ns = mono_time_ns();
+    sample->read_us = (uint32_t)((end_ns - start_ns) / 1000);
+    sample->now = end_ns / 1000000;
+    sample->value = motion_detected;
+}
+
+// Feed a PIR sample to its filter and health state
+static uint32_t motion_ingest(const sensor_instance_t *sensor, const sensor_sample_t *sample, int cfg_slot)
+{
+    int i = sensor->slot;
+    bool motion_detected = sample->value != 0;
+    bool ok = sample->ok;
+    uint64_t now = sample->now;
+    sensor_health_t *health = &g_health[sensor->id];
+    uint8_t old_health = health->state;
+    uint32_t interval_ms;
+    int j;
+    const threshold_config_t *cfg = config_read_begin(cfg_slot);
+
+    pthread_mutex_lock(&g_data_mutex);
+    if (ok)
+    {
+        if (sensor_filter_update(&g_motion.filter[i], motion_detected, cfg->motion_dwell_ms, now) &&
+            g_motion.filter[i].state)
         {
-            pthread_mutex_lock(&g_data_mutex);
-            g_sensor_data.gas_sensor_valid = 0;
-            pthread_mutex_unlock(&g_data_mutex);
+            correlator_post(&g_correlator, CORR_EVT_MOTION, now, cfg->armed);
+            request_publish(sensor, now, cfg);
+            // Someone is moving: a door may be next
+            for (j = 0; j < g_ultrasonic.count; j++)
+            {
+                sensor_boost(g_ultrasonic.sensor[j]->id, &g_ultrasonic.rate[j],
+                             ultrasonic_min_interval(cfg), now, cfg);
+            }
+        }
+        g_motion.detected[i] = g_motion.filter[i].state;
+        g_motion.valid[i] = 1;
+        sample_window_add(&g_motion.window[i], g_motion.detected[i], g_motion.detected[i]);
+        g_motion.sample_ms[i] = now;
+    }
+    else
+    {
+        g_motion.valid[i] = 0;
+    }
+    // Only a PIR output stuck high is suspicious; an empty room stays low for hours
+    interval_ms = update_sensor_health(health, ok, motion_detected, sample->read_us, now,
+                                       motion_detected ? cfg->pir_stuck_ms : 0,
+                                       sensor->period_ms ? sensor->period_ms : SENSOR_READ_INTERVAL_MS,
+                                       cfg);
+    pthread_mutex_unlock(&g_data_mutex);
+    config_read_end(cfg_slot);
+
+    if (g_log_readings && ok)
+    {
+        LOG_DEBUG("[MOTION_SENSOR] %s: Motion: %s", sensor->name, motion_detected ? "DETECTED" : "None");
+    }
+    else if (g_log_readings)
+    {
+        LOG_DEBUG("[MOTION_SENSOR] %s: Read failed", sensor->name);
+    }
+    report_health_change(sensor, "Motion", old_health, health->state);
+
+    return interval_ms;
+}
+
+static int ultrasonic_init(const sensor_instance_t *sensor)
+{
+    return ultrasonic_sensor_init(sensor->pin, sensor->pin2);
+}
 
-            printf("[GAS_SENSOR] Read failed\n");
+// Take one ultrasonic burst (door distance)
+static void ultrasonic_read(const sensor_instance_t *sensor, int cfg_slot, sensor_sample_t *sample)
+{
+    uint16_t distance = 0;
+    uint8_t confidence = 0;
+    int burst_count;
+    uint32_t burst_spacing_ms;
+
+    // Copy the burst settings out: the burst itself takes a few hundred ms
+    // and must not hold up config reclamation
+    const threshold_config_t *cfg = config_read_begin(cfg_slot);
+    burst_count = cfg->ultrasonic_burst_count;
+    burst_spacing_ms = cfg->ultrasonic_burst_spacing_ms;
+    config_read_end(cfg_slot);
+
+    uint64_t start_ns = mono_time_ns();
+    sample->ok = ultrasonic_sensor_read_burst(sensor->pin, sensor->pin2, burst_count, burst_spacing_ms,
+                                              &distance, &confidence) == 0;
+    uint64_t end_ns = mono_time_ns();
+    sample->read_us = (uint32_t)((end_ns - start_ns) / 1000);
+    sample->now = end_ns / 1000000;
+    sample->value = distance;
+    sample->aux = confidence;
+}
+
+// Feed an ultrasonic burst result to the door filter and health state
+static uint32_t ultrasonic_ingest(const sensor_instance_t *sensor, const sensor_sample_t *sample, int cfg_slot)
+{
+    int i = sensor->slot;
+    uint16_t distance = (uint16_t)sample->value;
+    uint8_t confidence = sample->aux;
+    bool ok = sample->ok;
+    uint64_t now = sample->now;
+    sensor_health_t *health = &g_health[sensor->id];
+    uint8_t old_health = health->state;
+    uint8_t door_closed = 0;
+    uint32_t interval_ms;
+    const threshold_config_t *cfg = config_read_begin(cfg_slot);
+    uint32_t base_ms = ultrasonic_min_interval(cfg);
+
+    pthread_mutex_lock(&g_data_mutex);
+    if (ok && confidence < cfg->ultrasonic_min_confidence)
+    {
+        // Pings disagree: report the reading but leave the door state alone
+        g_ultrasonic.distance_cm[i] = distance;
+        g_ultrasonic.confidence[i] = confidence;
+        door_closed = g_ultrasonic.filter[i].state;
+    }
+    else if (ok)
+    {
+        int closed_cm = sensor_threshold(sensor->threshold_high, cfg->door_closed_dist_cm);
+
+        // Closed at <= closed_cm, open again only beyond the hysteresis band
+        if (sensor_filter_update_below(&g_ultrasonic.filter[i], distance, closed_cm + 1,
+                                       cfg->door_hysteresis_cm, cfg->door_dwell_ms, now))
+        {
+            correlator_post(&g_correlator,
+                            g_ultrasonic.filter[i].state ? CORR_EVT_DOOR_CLOSED : CORR_EVT_DOOR_OPENED,
+                            now, cfg->armed);
+            sample_rate_boost(&g_ultrasonic.rate[i], now, base_ms, cfg->rate_boost_hold_ms);
+            request_publish(sensor, now, cfg);
         }
+        base_ms = sample_rate_update(&g_ultrasonic.rate[i], distance, now, base_ms,
+                                     sensor_max_interval(sensor, cfg->ultrasonic_max_interval_ms, base_ms),
+                                     ULTRASONIC_RATE_TOLERANCE, cfg->rate_boost_hold_ms);
+        rolling_stats_add(&g_ultrasonic.stats[i], distance, now);
+        door_closed = g_ultrasonic.filter[i].state;
+        g_ultrasonic.distance_cm[i] = distance;
+        g_ultrasonic.confidence[i] = confidence;
+        g_ultrasonic.door_closed[i] = door_closed;
+        g_ultrasonic.valid[i] = 1;
+        sample_window_add(&g_ultrasonic.window[i], distance, door_closed);
+        g_ultrasonic.sample_ms[i] = now;
+    }
+    else
+    {
+        g_ultrasonic.confidence[i] = 0;
+        g_ultrasonic.valid[i] = 0;
+    }
+    // A door can legitimately stay put for days, so no stuck-at check
+    interval_ms = update_sensor_health(health, ok, distance, sample->read_us, now, 0, base_ms, cfg);
+    pthread_mutex_unlock(&g_data_mutex);
+    config_read_end(cfg_slot);
 
-        usleep(SENSOR_READ_INTERVAL_MS * 1000);
+    if (g_log_readings && ok)
+    {
+        LOG_DEBUG("[ULTRASONIC_SENSOR] %s: Distance: %d cm (confidence %u%%), Door: %s", sensor->name,
+                  distance, confidence, door_closed ? "CLOSED" : "OPEN");
+    }
+    else if (g_log_readings)
+    {
+        LOG_DEBUG("[ULTRASONIC_SENSOR] %s: Read failed", sensor->name);
     }
+    report_health_change(sensor, "Ultrasonic", old_health, health->state);
 
-    return NULL;
+    return interval_ms;
+}
+
+static const sensor_driver_t sensor_drivers[SENSOR_TYPE_COUNT] = {
+    [SENSOR_TYPE_TEMPERATURE] = {"TEMP_SENSOR", "Temperature", POOL_CLASS_BLOCKING, dht_init, dht_read,
+                                 dht_ingest},
+    [SENSOR_TYPE_GAS] = {"GAS_SENSOR", "Gas", POOL_CLASS_SHORT, gas_init, gas_read, gas_ingest},
+    [SENSOR_TYPE_MOTION] = {"MOTION_SENSOR", "Motion", POOL_CLASS_SHORT, motion_init, motion_read, motion_ingest},
+    [SENSOR_TYPE_ULTRASONIC] = {"ULTRASONIC_SENSOR", "Ultrasonic", POOL_CLASS_BLOCKING, ultrasonic_init,
+                                ultrasonic_read, ultrasonic_ingest},
+};
+
+// Sensor task - takes one sample of an instance on whichever worker picks it up
+static uint32_t sensor_task(void *arg, int cfg_slot)
+{
+    const sensor_instance_t *sensor = arg;
+    const sensor_driver_t *driver = &sensor_drivers[sensor->type];
+    sensor_sample_t sample;
+
+    uint32_t seq = g_sequence_num;
+    uint64_t span = span_begin(seq);
+
+    memset(&sample, 0, sizeof(sample));
+    driver->read(sensor, cfg_slot, &sample);
+    span_end(span, "sensor_read", seq, sensor->name);
+    trace_sample(sensor, &sample);
+    return driver->ingest(sensor, &sample, cfg_slot);
 }
 
-// PIR motion sensor thread
-static void *motion_sensor_thread(void *arg)
+// Print per-worker utilization and task latency since the last report
+static void report_pool_stats(void)
 {
-    (void)arg;
-    bool motion_detected;
+    static const char *const class_names[POOL_CLASS_COUNT] = {"short", "blocking"};
+    int i;
+
+    for (i = 0; i < g_pool.worker_count; i++)
+    {
+        pool_worker_stats_t st;
+
+        worker_pool_take_stats(&g_pool, i, &st);
+        printf("[POOL] worker %d (%s): %.1f%% busy, %u runs, %u stolen, latency avg %.2f ms max %.2f ms\n", i,
+               class_names[g_pool.workers[i].cls], st.window_ns ? 100.0 * st.busy_ns / st.window_ns : 0.0,
+               st.runs, st.steals, st.runs ? st.latency_sum_ns / 1e6 / st.runs : 0.0, st.latency_max_ns / 1e6);
+    }
+}
 
-    printf("[MOTION_SENSOR] Thread started\n");
-    send_log("Motion sensor thread started");
+// Drop readings whose last good sample is too old to act on (g_data_mutex held).
+// A read failure clears valid in the sensor's own task; this also catches a task
+// that has stopped delivering samples at all.
+static void expire_stale(uint8_t *valid, const uint64_t *sample_ms, const sensor_instance_t *const *sensor,
+                         int count, const threshold_config_t *cfg, uint64_t now)
+{
+    int i;
 
-    // Initialize PIR sensor
-    if (motion_sensor_init(PIR_GPIO_PIN) != 0)
+    for (i = 0; i < count; i++)
     {
-        printf("[MOTION_SENSOR] Failed to initialize sensor\n");
-        return NULL;
+        if (sample_age_ms(sample_ms[i], now) > stale_limit_ms(sensor[i], cfg))
+        {
+            valid[i] = 0;
+        }
     }
+}
 
-    while (g_running)
+// Print state-change publishing and its latency since the last report
+static void report_publish_stats(void)
+{
+    publish_state_t st;
+
+    pthread_mutex_lock(&g_data_mutex);
+    st = g_publish;
+    g_publish.events = g_publish.limited = g_publish.early = g_publish.carried = 0;
+    g_publish.latency_sum_ns = g_publish.latency_max_ns = 0;
+    pthread_mutex_unlock(&g_data_mutex);
+
+    printf("[PUBLISH] %u state changes (%u left to the tick), %u early snapshots, "
+           "change to sent avg %.2f ms max %.2f ms\n",
+           st.events, st.limited, st.early, st.carried ? st.latency_sum_ns / 1e6 / st.carried : 0.0,
+           st.latency_max_ns / 1e6);
+}
+
+// Fill the aggregated message from the storage banks (g_data_mutex held).
+// The named message fields describe the first sensor of each type.
+static void aggregate_sensors(sensor_data_msg_t *msg, const threshold_config_t *cfg, uint64_t now)
+{
+    int i;
+
+    // The DHT11 threads may be sleeping (slow rate, back-off), so age the
+    // cached readings here as well
+    for (i = 0; i < g_dht.count; i++)
+    {
+        g_dht.valid[i] = g_dht.have_value[i] &&
+                         sample_age_ms(g_dht.last_good_ms[i], now) <= stale_limit_ms(g_dht.sensor[i], cfg);
+        g_dht.reports[i]++;
+        g_dht.available[i] += g_dht.valid[i];
+    }
+    expire_stale(g_gas.valid, g_gas.sample_ms, g_gas.sensor, g_gas.count, cfg, now);
+    expire_stale(g_motion.valid, g_motion.sample_ms, g_motion.sensor, g_motion.count, cfg, now);
+    expire_stale(g_ultrasonic.valid, g_ultrasonic.sample_ms, g_ultrasonic.sensor, g_ultrasonic.count, cfg, now);
+
+    memset(msg, 0, offsetof(sensor_data_msg_t, sensors));
+    msg->msg_type = MSG_TYPE_SENSOR_DATA;
+    msg->timestamp = wall_time(now);
+    msg->mono_ms = now;
+    msg->zone_id = g_zone_id;
+    memcpy(msg->zone_name, g_zone_name, sizeof(msg->zone_name));
+
+    if (g_dht.count > 0)
+    {
+        msg->temperature = g_dht.temperature[0];
+        msg->humidity = g_dht.humidity[0];
+        msg->temp_sensor_valid = g_dht.valid[0];
+        msg->temp_age_ms = g_dht.have_value[0] ? sample_age_ms(g_dht.last_good_ms[0], now) : 0;
+        msg->temp_sample_ms = g_dht.have_value[0] ? g_dht.last_good_ms[0] : 0;
+        msg->temp_availability = 100.0f * g_dht.available[0] / g_dht.reports[0];
+        msg->temp_retries = g_dht.read_stats[0].retries;
+        msg->temp_recovered = g_dht.read_stats[0].recovered;
+        msg->temp_busy_ms = (uint32_t)(g_dht.read_stats[0].busy_us / 1000);
+        msg->temp_wasted_busy_ms = (uint32_t)(g_dht.read_stats[0].wasted_busy_us / 1000);
+        msg->temp_filtered = sensor_filter_suppressed(&g_dht.high_filter[0]) +
+                             sensor_filter_suppressed(&g_dht.low_filter[0]);
+        rolling_stats_snapshot(&g_dht.temp_stats[0], &msg->temp_stats);
+        rolling_stats_snapshot(&g_dht.humidity_stats[0], &msg->humidity_stats);
+        msg->temp_rate_per_min = g_dht.temp_anomaly[0].rate_per_min;
+        msg->humidity_rate_per_min = g_dht.humidity_anomaly[0].rate_per_min;
+        msg->temp_zscore = g_dht.temp_anomaly[0].zscore;
+        msg->humidity_zscore = g_dht.humidity_anomaly[0].zscore;
+        msg->anomaly_flags = g_dht.anomaly_flags[0];
+        sensor_health_snapshot(&g_health[g_dht.sensor[0]->id], &msg->temp_health);
+    }
+    if (g_gas.count > 0)
+    {
+        msg->gas_detected = g_gas.detected[0];
+        msg->gas_sensor_valid = g_gas.valid[0];
+        msg->gas_sample_ms = g_gas.sample_ms[0];
+        msg->gas_filtered = sensor_filter_suppressed(&g_gas.filter[0]);
+        sensor_health_snapshot(&g_health[g_gas.sensor[0]->id], &msg->gas_health);
+    }
+    if (g_motion.count > 0)
+    {
+        msg->motion_detected = g_motion.detected[0];
+        msg->motion_sensor_valid = g_motion.valid[0];
+        msg->motion_sample_ms = g_motion.sample_ms[0];
+        msg->motion_filtered = sensor_filter_suppressed(&g_motion.filter[0]);
+        sensor_health_snapshot(&g_health[g_motion.sensor[0]->id], &msg->motion_health);
+    }
+    if (g_ultrasonic.count > 0)
+    {
+        msg->distance_cm = g_ultrasonic.distance_cm[0];
+        msg->door_closed = g_ultrasonic.door_closed[0];
+        msg->ultrasonic_valid = g_ultrasonic.valid[0];
+        msg->distance_confidence = g_ultrasonic.confidence[0];
+        msg->distance_sample_ms = g_ultrasonic.sample_ms[0];
+        msg->door_filtered = sensor_filter_suppressed(&g_ultrasonic.filter[0]);
+        rolling_stats_snapshot(&g_ultrasonic.stats[0], &msg->distance_stats);
+        sensor_health_snapshot(&g_health[g_ultrasonic.sensor[0]->id], &msg->ultrasonic_health);
+    }
+
+    msg->alert_level = g_alert_level;
+    msg->armed = cfg->armed;
+    msg->correlated_alerts = g_correlator.total_matches;
+
+    // Every instance, in registration order
+    msg->sensor_count = (uint16_t)g_registry.count;
+    for (i = 0; i < g_registry.count; i++)
     {
-        if (motion_sensor_read(PIR_GPIO_PIN, &motion_detected) == 0)
+        const sensor_instance_t *sensor = &g_registry.sensors[i];
+        sensor_reading_t *r = &msg->sensors[i];
+        int s = sensor->slot;
+
+        memcpy(r->name, sensor->name, sizeof(r->name));
+        r->type = sensor->type;
+        r->health = g_health[i].state;
+        switch (sensor->type)
         {
-            pthread_mutex_lock(&g_data_mutex);
-            g_sensor_data.motion_detected = motion_detected ? 1 : 0;
-            g_sensor_data.motion_sensor_valid = 1;
-            pthread_mutex_unlock(&g_data_mutex);
+        case SENSOR_TYPE_TEMPERATURE:
+            r->valid = g_dht.valid[s];
+            r->state = (g_dht.high[s] ? SENSOR_STATE_ACTIVE : 0) | (g_dht.low[s] ? SENSOR_STATE_LOW : 0);
+            r->value = g_dht.temperature[s];
+            r->value2 = g_dht.humidity[s];
+            r->sample_ms = g_dht.have_value[s] ? g_dht.last_good_ms[s] : 0;
+            sample_window_close(&g_dht.window[s], &g_dht.closed[s]);
+            r->window = g_dht.closed[s];
+            break;
+        case SENSOR_TYPE_GAS:
+            r->valid = g_gas.valid[s];
+            r->state = g_gas.detected[s] ? SENSOR_STATE_ACTIVE : 0;
+            r->value = g_gas.detected[s];
+            r->value2 = 0;
+            r->sample_ms = g_gas.sample_ms[s];
+            sample_window_close(&g_gas.window[s], &g_gas.closed[s]);
+            r->window = g_gas.closed[s];
+            break;
+        case SENSOR_TYPE_MOTION:
+            r->valid = g_motion.valid[s];
+            r->state = g_motion.detected[s] ? SENSOR_STATE_ACTIVE : 0;
+            r->value = g_motion.detected[s];
+            r->value2 = 0;
+            r->sample_ms = g_motion.sample_ms[s];
+            sample_window_close(&g_motion.window[s], &g_motion.closed[s]);
+            r->window = g_motion.closed[s];
+            break;
+        case SENSOR_TYPE_ULTRASONIC:
+            r->valid = g_ultrasonic.valid[s];
+            r->state = g_ultrasonic.door_closed[s] ? SENSOR_STATE_ACTIVE : 0;
+            r->value = g_ultrasonic.distance_cm[s];
+            r->value2 = g_ultrasonic.confidence[s];
+            r->sample_ms = g_ultrasonic.sample_ms[s];
+            sample_window_close(&g_ultrasonic.window[s], &g_ultrasonic.closed[s]);
+            r->window = g_ultrasonic.closed[s];
+            break;
+        default:
+            r->valid = 0;
+            r->state = 0;
+            r->value = r->value2 = 0;
+            r->sample_ms = 0;
+            memset(&r->window, 0, sizeof(r->window));
+            break;
+        }
+        if (r->sample_ms != 0 && sample_age_ms(r->sample_ms, now) > stale_limit_ms(sensor, cfg))
+        {
+            r->state |= SENSOR_STATE_STALE;
+        }
+    }
+}
 
-            printf("[MOTION_SENSOR] Motion: %s\n", motion_detected ? "DETECTED" : "None");
+// Aggregate the sensor banks, check thresholds and send the result to stats_update
+static void run_aggregation(sensor_data_msg_t *msg, int cfg_slot, uint64_t now)
+{
+    trace_record_t rec;
+    uint64_t event_ns;
+    uint64_t start_ns;
+    int rc;
+
+    memset(&rec, 0, sizeof(rec));
+    rec.kind = TRACE_REC_AGGREGATE;
+    trace_writer_put(&g_trace, &rec, now, NULL, 0);
+
+    // Collect all sensor data
+    const threshold_config_t *cfg = config_read_begin(cfg_slot);
+    pthread_mutex_lock(&g_data_mutex);
+    start_ns = mono_time_ns();
+
+    aggregate_sensors(msg, cfg, now);
+    msg->sequence_num = g_sequence_num;
+    event_ns = g_publish.pending_ns;
+    g_publish.pending_ns = 0;
+
+    // Check thresholds and generate alerts if needed (alerts are traced under this snapshot)
+    uint64_t span = span_begin(msg->sequence_num);
+    check_thresholds_and_alert();
+    span_end(span, "threshold_check", msg->sequence_num, g_zone_name);
+    g_sequence_num++;
+
+    start_ns = mono_time_ns() - start_ns;
+    g_aggregate_ns += start_ns;
+    g_aggregate_max_ns = start_ns > g_aggregate_max_ns ? start_ns : g_aggregate_max_ns;
+    pthread_mutex_unlock(&g_data_mutex);
+    config_read_end(cfg_slot);
+
+    // Send aggregated data to stats_update server (only the used part of sensors[])
+    int coid = service_coid(&g_stats_update);
+    if (coid != -1)
+    {
+        span = span_begin(msg->sequence_num);
+        rc = service_send(&g_stats_update, coid, msg, SENSOR_DATA_MSG_SIZE(msg->sensor_count));
+        span_end(span, "snapshot_publish", msg->sequence_num, g_zone_name);
+        trace_ipc(TRACE_IPC_STATS, rc);
+        if (rc == -1)
+        {
+            LOG_ERROR("[AGGREGATOR] Failed to send to stats_update: %s", strerror(errno));
         }
         else
         {
-            pthread_mutex_lock(&g_data_mutex);
-            g_sensor_data.motion_sensor_valid = 0;
-            pthread_mutex_unlock(&g_data_mutex);
-
-            printf("[MOTION_SENSOR] Read failed\n");
+            LOG_INFO("[AGGREGATOR] Sent data packet #%u to stats_update (dashboard.json updated)",
+                     msg->sequence_num);
         }
-
-        usleep(SENSOR_READ_INTERVAL_MS * 1000);
+    }
+    else
+    {
+        LOG_INFO("[AGGREGATOR] Stats Update not connected (simulated send)");
+        LOG_INFO("[AGGREGATOR] Data packet #%u: Temp=%d°C, Hum=%d%%, Gas=%s, Motion=%s, Door=%s "
+                 "(%u sensors)",
+                 msg->sequence_num, msg->temperature, msg->humidity, msg->gas_detected ? "DETECTED" : "Clean",
+                 msg->motion_detected ? "YES" : "NO", msg->door_closed ? "CLOSED" : "OPEN", msg->sensor_count);
     }
 
-    return NULL;
+    // State change to alerts and snapshot sent (a replay runs on recorded time, so not there)
+    if (event_ns != 0 && !g_replay)
+    {
+        uint64_t latency_ns = mono_time_ns() - event_ns;
+
+        pthread_mutex_lock(&g_data_mutex);
+        g_publish.carried++;
+        g_publish.latency_sum_ns += latency_ns;
+        if (latency_ns > g_publish.latency_max_ns)
+        {
+            g_publish.latency_max_ns = latency_ns;
+        }
+        pthread_mutex_unlock(&g_data_mutex);
+    }
 }
 
-// Ultrasonic sensor thread (door closing detection)
-static void *ultrasonic_sensor_thread(void *arg)
+// Snapshot the analysis state into the checkpoint file
+static void save_checkpoint(uint64_t now)
 {
-    (void)arg;
-    uint16_t distance;
-
-    printf("[ULTRASONIC_SENSOR] Thread started\n");
-    send_log("Ultrasonic sensor thread started");
+    // Filled under g_data_mutex, then copied into the mapping, hashed and synced outside it
+    static analyzer_checkpoint_t snapshot;
+    analyzer_checkpoint_t *cp = &snapshot;
+    size_t size;
+    int i;
 
-    // Initialize ultrasonic sensor
-    if (ultrasonic_sensor_init(ULTRASONIC_TRIG_PIN, ULTRASONIC_ECHO_PIN) != 0)
+    if (!g_checkpoint.map)
     {
-        printf("[ULTRASONIC_SENSOR] Failed to initialize sensor\n");
-        return NULL;
+        return;
     }
 
-    while (g_running)
+    pthread_mutex_lock(&g_data_mutex);
+    cp->sequence_num = g_sequence_num;
+    cp->alert_level = g_alert_level;
+    cp->sensor_count = (uint16_t)g_registry.count;
+    for (i = 0; i < g_registry.count; i++)
     {
-        if (ultrasonic_sensor_read(ULTRASONIC_TRIG_PIN, ULTRASONIC_ECHO_PIN, &distance) == 0)
+        const sensor_instance_t *sensor = &g_registry.sensors[i];
+        sensor_checkpoint_t *rec = &cp->sensors[i];
+        const binary_bank_t *bank = sensor->type == SENSOR_TYPE_GAS ? &g_gas : &g_motion;
+        int j = sensor->slot;
+
+        memcpy(rec->name, sensor->name, sizeof(rec->name));
+        rec->type = sensor->type;
+        switch (sensor->type)
         {
-            bool door_closed = (distance <= thresholds.door_closed_dist_cm);
+        case SENSOR_TYPE_TEMPERATURE:
+            rec->u.dht.temperature = g_dht.temperature[j];
+            rec->u.dht.humidity = g_dht.humidity[j];
+            rec->u.dht.have_value = g_dht.have_value[j];
+            rec->u.dht.high = g_dht.high[j];
+            rec->u.dht.low = g_dht.low[j];
+            rec->u.dht.anomaly_flags = g_dht.anomaly_flags[j];
+            rec->u.dht.alerted_high = g_dht.alerted_high[j];
+            rec->u.dht.alerted_low = g_dht.alerted_low[j];
+            rec->u.dht.alerted_flags = g_dht.alerted_flags[j];
+            rec->u.dht.last_good_ms = g_dht.last_good_ms[j];
+            rec->u.dht.high_filter = g_dht.high_filter[j];
+            rec->u.dht.low_filter = g_dht.low_filter[j];
+            rolling_stats_save(&g_dht.temp_stats[j], &rec->u.dht.temp_stats);
+            rolling_stats_save(&g_dht.humidity_stats[j], &rec->u.dht.humidity_stats);
+            rec->u.dht.temp_anomaly = g_dht.temp_anomaly[j];
+            rec->u.dht.humidity_anomaly = g_dht.humidity_anomaly[j];
+            break;
+        case SENSOR_TYPE_GAS:
+        case SENSOR_TYPE_MOTION:
+            rec->u.binary.detected = bank->detected[j];
+            rec->u.binary.alerted = bank->alerted[j];
+            rec->u.binary.filter = bank->filter[j];
+            break;
+        case SENSOR_TYPE_ULTRASONIC:
+            rec->u.ultrasonic.distance_cm = g_ultrasonic.distance_cm[j];
+            rec->u.ultrasonic.confidence = g_ultrasonic.confidence[j];
+            rec->u.ultrasonic.door_closed = g_ultrasonic.door_closed[j];
+            rec->u.ultrasonic.alerted = g_ultrasonic.alerted[j];
+            rec->u.ultrasonic.filter = g_ultrasonic.filter[j];
+            rolling_stats_save(&g_ultrasonic.stats[j], &rec->u.ultrasonic.stats);
+            break;
+        default:
+            break;
+        }
+    }
+    pthread_mutex_unlock(&g_data_mutex);
 
-            pthread_mutex_lock(&g_data_mutex);
-            g_sensor_data.distance_cm = distance;
-            g_sensor_data.door_closed = door_closed ? 1 : 0;
-            g_sensor_data.ultrasonic_valid = 1;
-            pthread_mutex_unlock(&g_data_mutex);
+    size = ANALYZER_CHECKPOINT_SIZE(cp->sensor_count);
+    memcpy(checkpoint_begin(&g_checkpoint), cp, size);
+    checkpoint_commit(&g_checkpoint, (uint32_t)size, now);
+}
 
-            printf("[ULTRASONIC_SENSOR] Distance: %d cm, Door: %s\n", distance,
-                   door_closed ? "CLOSED" : "OPEN");
+/**
+ * Restore the state saved by a previous run (called before the sensor tasks start)
+ *
+ * Filter and alert states come back, so doors, motion and temperature limits
+ * that have not changed raise no alert after a restart. Within the same boot
+ * the monotonic timestamps are still meaningful, and the readings, dwell
+ * timers, rolling statistics and anomaly baselines are restored as well; after
+ * a reboot the filters restart from their saved state alone. A snapshot older
+ * than CHECKPOINT_MAX_AGE_SEC only continues the sequence number.
+ *
+ * @return number of sensors restored
+ */
+static int restore_checkpoint(const analyzer_checkpoint_t *cp, const checkpoint_info_t *info)
+{
+    uint64_t now = mono_time_ms();
+    int64_t age_ms = checkpoint_wall_ms() - info->wall_ms;
+    int64_t drift_ms = (int64_t)(now - info->mono_ms) - age_ms;
+    bool same_boot = now >= info->mono_ms && drift_ms <= CHECKPOINT_BOOT_TOLERANCE_MS &&
+                     drift_ms >= -CHECKPOINT_BOOT_TOLERANCE_MS;
+    int restored = 0;
+    int i, k;
+
+    g_sequence_num = cp->sequence_num;
+    if (age_ms < 0 || age_ms > CHECKPOINT_MAX_AGE_SEC * 1000LL || info->size < ANALYZER_CHECKPOINT_SIZE(0) ||
+        info->size < ANALYZER_CHECKPOINT_SIZE(cp->sensor_count))
+    {
+        return 0;
+    }
+    g_alert_level = cp->alert_level;
+
+    for (k = 0; k < cp->sensor_count; k++)
+    {
+        const sensor_checkpoint_t *rec = &cp->sensors[k];
+        const sensor_instance_t *sensor = NULL;
+
+        for (i = 0; i < g_registry.count; i++)
+        {
+            if (g_registry.sensors[i].type == rec->type &&
+                strncmp(g_registry.sensors[i].name, rec->name, SENSOR_NAME_LEN) == 0)
+            {
+                sensor = &g_registry.sensors[i];
+                break;
+            }
         }
-        else
+        if (!sensor)
         {
-            pthread_mutex_lock(&g_data_mutex);
-            g_sensor_data.ultrasonic_valid = 0;
-            pthread_mutex_unlock(&g_data_mutex);
-
-            printf("[ULTRASONIC_SENSOR] Read failed\n");
+            continue; // Removed from the config since the snapshot
         }
 
-        usleep(SENSOR_READ_INTERVAL_MS * 1000);
+        int j = sensor->slot;
+        binary_bank_t *bank = sensor->type == SENSOR_TYPE_GAS ? &g_gas : &g_motion;
+
+        switch (sensor->type)
+        {
+        case SENSOR_TYPE_TEMPERATURE:
+            g_dht.high[j] = rec->u.dht.high;
+            g_dht.low[j] = rec->u.dht.low;
+            g_dht.anomaly_flags[j] = rec->u.dht.anomaly_flags;
+            g_dht.alerted_high[j] = rec->u.dht.alerted_high;
+            g_dht.alerted_low[j] = rec->u.dht.alerted_low;
+            g_dht.alerted_flags[j] = rec->u.dht.alerted_flags;
+            if (same_boot)
+            {
+                g_dht.temperature[j] = rec->u.dht.temperature;
+                g_dht.humidity[j] = rec->u.dht.humidity;
+                g_dht.have_value[j] = rec->u.dht.have_value;
+                g_dht.last_good_ms[j] = rec->u.dht.last_good_ms;
+                g_dht.high_filter[j] = rec->u.dht.high_filter;
+                g_dht.low_filter[j] = rec->u.dht.low_filter;
+                rolling_stats_restore(&g_dht.temp_stats[j], &rec->u.dht.temp_stats);
+                rolling_stats_restore(&g_dht.humidity_stats[j], &rec->u.dht.humidity_stats);
+                g_dht.temp_anomaly[j] = rec->u.dht.temp_anomaly;
+                g_dht.humidity_anomaly[j] = rec->u.dht.humidity_anomaly;
+            }
+            else
+            {
+                sensor_filter_init(&g_dht.high_filter[j], rec->u.dht.high);
+                sensor_filter_init(&g_dht.low_filter[j], rec->u.dht.low);
+            }
+            break;
+        case SENSOR_TYPE_GAS:
+        case SENSOR_TYPE_MOTION:
+            bank->detected[j] = rec->u.binary.detected;
+            bank->alerted[j] = rec->u.binary.alerted;
+            if (same_boot)
+            {
+                bank->filter[j] = rec->u.binary.filter;
+            }
+            else
+            {
+                sensor_filter_init(&bank->filter[j], rec->u.binary.detected);
+            }
+            break;
+        case SENSOR_TYPE_ULTRASONIC:
+            g_ultrasonic.door_closed[j] = rec->u.ultrasonic.door_closed;
+            g_ultrasonic.alerted[j] = rec->u.ultrasonic.alerted;
+            if (same_boot)
+            {
+                g_ultrasonic.distance_cm[j] = rec->u.ultrasonic.distance_cm;
+                g_ultrasonic.confidence[j] = rec->u.ultrasonic.confidence;
+                g_ultrasonic.filter[j] = rec->u.ultrasonic.filter;
+                rolling_stats_restore(&g_ultrasonic.stats[j], &rec->u.ultrasonic.stats);
+            }
+            else
+            {
+                sensor_filter_init(&g_ultrasonic.filter[j], rec->u.ultrasonic.door_closed);
+            }
+            break;
+        default:
+            break;
+        }
+        restored++;
     }
 
-    return NULL;
+    printf("[CHECKPOINT] Restored %d of %u sensors from a snapshot %lld ms old (%s)\n", restored,
+           cp->sensor_count, (long long)age_ms, same_boot ? "same boot" : "after a reboot: states only");
+    return restored;
+}
+
+// Wait for the next tick or an early publish request
+// @return 1 for the tick, 0 when woken by a state change
+static int wait_for_publish(uint64_t tick_ns)
+{
+    struct timespec deadline = {(time_t)(tick_ns / 1000000000ULL), (long)(tick_ns % 1000000000ULL)};
+    int tick;
+
+    pthread_mutex_lock(&g_data_mutex);
+    while (!g_publish.wake && mono_time_ns() < tick_ns)
+    {
+        pthread_cond_timedwait(&g_publish.cond, &g_data_mutex, &deadline);
+    }
+    tick = !g_publish.wake;
+    if (!tick)
+    {
+        g_publish.early++;
+    }
+    g_publish.wake = 0;
+    pthread_mutex_unlock(&g_data_mutex);
+    return tick;
 }
 
 // Aggregator thread - collects data and sends to stats_update server
 static void *aggregator_thread(void *arg)
 {
     (void)arg;
-    sensor_data_msg_t msg;
+    static sensor_data_msg_t msg;
+    int cfg_slot = config_reader_register();
+    uint64_t last_report = mono_time_ms();
+    uint64_t tick_ns = mono_time_ns() + AGGREGATION_INTERVAL_SEC * 1000000000ULL;
 
     printf("[AGGREGATOR] Thread started\n");
     send_log("Aggregator thread started");
 
     while (g_running)
     {
-        sleep(AGGREGATION_INTERVAL_SEC);
+        g_aggregator_progress_ms = mono_time_ms();
 
-        // Collect all sensor data
-        pthread_mutex_lock(&g_data_mutex);
-
-        msg.msg_type = MSG_TYPE_SENSOR_DATA;
-        msg.timestamp = time(NULL);
+        // A state change is published at once; the tick keeps its own cadence
+        if (!wait_for_publish(tick_ns))
+        {
+            run_aggregation(&msg, cfg_slot, mono_time_ms());
+            continue;
+        }
+        tick_ns += AGGREGATION_INTERVAL_SEC * 1000000000ULL;
+        if (tick_ns < mono_time_ns())
+        {
+            tick_ns = mono_time_ns() + AGGREGATION_INTERVAL_SEC * 1000000000ULL;
+        }
 
-        msg.temperature = g_sensor_data.temperature;
-        msg.humidity = g_sensor_data.humidity;
-        msg.temp_sensor_valid = g_sensor_data.temp_sensor_valid;
+        run_aggregation(&msg, cfg_slot, mono_time_ms());
+        save_checkpoint(mono_time_ms());
+        trace_writer_flush(&g_trace);
 
-        msg.gas_detected = g_sensor_data.gas_detected;
-        msg.gas_sensor_valid = g_sensor_data.gas_sensor_valid;
+        if (mono_time_ms() - last_report >= POOL_REPORT_INTERVAL_SEC * 1000ULL)
+        {
+            report_pool_stats();
+            report_publish_stats();
+            last_report = mono_time_ms();
+        }
+    }
 
-        msg.motion_detected = g_sensor_data.motion_detected;
-        msg.motion_sensor_valid = g_sensor_data.motion_sensor_valid;
+    return NULL;
+}
 
-        msg.distance_cm = g_sensor_data.distance_cm;
-        msg.door_closed = g_sensor_data.door_closed;
-        msg.ultrasonic_valid = g_sensor_data.ultrasonic_valid;
+// SIGHUP handler - ask the config watcher to reload now
+static void config_reload_signal(int signo)
+{
+    (void)signo;
+    g_config_reload_requested = 1;
+}
 
-        msg.alert_level = g_sensor_data.alert_level;
-        msg.sequence_num = g_sequence_num++;
+// Config watcher thread - reloads the config file when it changes
+static void *config_watch_thread(void *arg)
+{
+    (void)arg;
+    time_t last_mtime = config_file_mtime(g_config_path);
 
-        // Check thresholds and generate alerts if needed
-        check_thresholds_and_alert(&g_sensor_data);
+    printf("[CONFIG] Watching %s\n", g_config_path);
 
-        pthread_mutex_unlock(&g_data_mutex);
+    while (g_running)
+    {
+        usleep(CONFIG_POLL_MS * 1000);
 
-        // Send aggregated data to stats_update server
-        if (stats_update_coid != -1)
+        time_t mtime = config_file_mtime(g_config_path);
+        if ((mtime != 0 && mtime != last_mtime) || g_config_reload_requested)
         {
-            if (MsgSend(stats_update_coid, &msg, sizeof(msg), NULL, 0) == -1)
+            g_config_reload_requested = 0;
+            last_mtime = mtime;
+
+            if (config_reload(g_config_path, &default_thresholds) == 0)
             {
-                printf("[AGGREGATOR] Failed to send to stats_update: %s\n", strerror(errno));
+                printf("[CONFIG] Reloaded %s (generation %u)\n", g_config_path, g_config_generation);
+                trace_config();
+                send_log("Configuration reloaded");
             }
             else
             {
-                printf("[AGGREGATOR] Sent data packet #%u to stats_update (dashboard.json updated)\n",
-                       msg.sequence_num);
+                printf("[CONFIG] Reload of %s rejected, keeping current config\n", g_config_path);
+                send_log("Configuration reload rejected");
             }
         }
-        else
-        {
-            printf("[AGGREGATOR] Stats Update not connected (simulated send)\n");
-            printf("[AGGREGATOR] Data packet #%u: Temp=%d°C, Hum=%d%%, Gas=%s, Motion=%s, Door=%s\n",
-                   msg.sequence_num, msg.temperature, msg.humidity, msg.gas_detected ? "DETECTED" : "Clean",
-                   msg.motion_detected ? "YES" : "NO", msg.door_closed ? "CLOSED" : "OPEN");
-        }
+
+        // Free configs that no reader can still be using
+        config_reclaim();
     }
 
     return NULL;
 }
 
-// Check sensor thresholds and send alerts
-static void check_thresholds_and_alert(shared_sensor_data_t *data)
+// Check sensor thresholds and send alerts (g_data_mutex held)
+static void check_thresholds_and_alert(void)
 {
-    static uint8_t last_alert_level = ALERT_LEVEL_INFO;
     uint8_t current_alert_level = ALERT_LEVEL_INFO;
+    int i;
 
-    // Check temperature thresholds
-    if (data->temp_sensor_valid)
+    for (i = 0; i < g_dht.count; i++)
     {
-        if (data->temperature > thresholds.temp_high_threshold)
+        const sensor_instance_t *sensor = g_dht.sensor[i];
+
+        if (!g_dht.valid[i])
+        {
+            continue;
+        }
+
+        // Temperature thresholds (filtered states, alert only when a state is entered)
+        if (g_dht.high[i])
         {
-            send_alert(ALERT_TYPE_TEMP_HIGH, ALERT_LEVEL_WARNING, data->temperature,
-                       "Temperature above threshold");
-            send_pulse(HIGH_TEMP, ALERT_LEVEL_WARNING);
+            if (!g_dht.alerted_high[i])
+            {
+                send_sensor_alert(sensor, ALERT_TYPE_TEMP_HIGH, ALERT_LEVEL_WARNING, g_dht.temperature[i],
+                                  "Temperature above threshold");
+                send_pulse(HIGH_TEMP, ALERT_LEVEL_WARNING);
+            }
+            current_alert_level = ALERT_LEVEL_WARNING;
+        }
+        else if (g_dht.low[i])
+        {
+            if (!g_dht.alerted_low[i])
+            {
+                send_sensor_alert(sensor, ALERT_TYPE_TEMP_LOW, ALERT_LEVEL_WARNING, g_dht.temperature[i],
+                                  "Temperature below threshold");
+            }
             current_alert_level = ALERT_LEVEL_WARNING;
         }
-        else if (data->temperature < thresholds.temp_low_threshold)
+        g_dht.alerted_high[i] = g_dht.high[i];
+        g_dht.alerted_low[i] = g_dht.low[i];
+
+        // Rate-of-rise and outlier flags (alert when a flag is raised)
+        uint8_t flags = g_dht.anomaly_flags[i];
+        uint8_t raised = flags & ~g_dht.alerted_flags[i];
+
+        if (raised & ANOMALY_TEMP_RISE)
+        {
+            send_sensor_alert(sensor, ALERT_TYPE_RATE_OF_RISE, ALERT_LEVEL_CRITICAL,
+                              (int)g_dht.temp_anomaly[i].rate_per_min, "Temperature rising rapidly (C/min)");
+            send_pulse(HIGH_TEMP, ALERT_LEVEL_CRITICAL);
+        }
+        if (raised & ANOMALY_HUMIDITY_RISE)
+        {
+            send_sensor_alert(sensor, ALERT_TYPE_RATE_OF_RISE, ALERT_LEVEL_WARNING,
+                              (int)g_dht.humidity_anomaly[i].rate_per_min, "Humidity rising rapidly (%/min)");
+        }
+        if (raised & ANOMALY_TEMP_OUTLIER)
+        {
+            send_sensor_alert(sensor, ALERT_TYPE_ANOMALY, ALERT_LEVEL_WARNING, g_dht.temperature[i],
+                              "Temperature outlier against baseline");
+        }
+        if (raised & ANOMALY_HUMIDITY_OUTLIER)
+        {
+            send_sensor_alert(sensor, ALERT_TYPE_ANOMALY, ALERT_LEVEL_INFO, g_dht.humidity[i],
+                              "Humidity outlier against baseline");
+        }
+
+        if (flags & ANOMALY_TEMP_RISE)
+        {
+            current_alert_level = ALERT_LEVEL_CRITICAL;
+        }
+        else if ((flags & (ANOMALY_HUMIDITY_RISE | ANOMALY_TEMP_OUTLIER)) &&
+                 current_alert_level < ALERT_LEVEL_WARNING)
         {
-            send_alert(ALERT_TYPE_TEMP_LOW, ALERT_LEVEL_WARNING, data->temperature,
-                       "Temperature below threshold");
             current_alert_level = ALERT_LEVEL_WARNING;
         }
+        g_dht.alerted_flags[i] = flags;
     }
 
-    // Check gas sensor
-    if (data->gas_sensor_valid && data->gas_detected)
+    // Gas sensors: also alert on gas seen and gone again since the last snapshot
+    for (i = 0; i < g_gas.count; i++)
     {
-        send_alert(ALERT_TYPE_GAS_DETECTED, ALERT_LEVEL_CRITICAL, 1, "Gas detected - potential hazard!");
-        send_pulse(HIGH_CO2, ALERT_LEVEL_CRITICAL);
-        current_alert_level = ALERT_LEVEL_CRITICAL;
+        if ((g_gas.valid[i] && g_gas.detected[i]) || g_gas.closed[i].active > 0)
+        {
+            send_sensor_alert(g_gas.sensor[i], ALERT_TYPE_GAS_DETECTED, ALERT_LEVEL_CRITICAL, 1,
+                              "Gas detected - potential hazard!");
+            // The edge itself was pulsed by the fast lane; later snapshots keep the LED lit
+            if (!g_gas.fast_pulsed[i])
+            {
+                send_pulse(HIGH_CO2, ALERT_LEVEL_CRITICAL);
+            }
+            current_alert_level = ALERT_LEVEL_CRITICAL;
+        }
+        g_gas.fast_pulsed[i] = 0;
     }
 
-    // Check motion sensor
-    if (data->motion_sensor_valid && data->motion_detected)
+    // Motion sensors (alert on the rising edge only, including a blip that ended
+    // before this snapshot)
+    for (i = 0; i < g_motion.count; i++)
     {
-        static uint8_t last_motion = 0;
-        // if (!last_motion) {
-        send_alert(ALERT_TYPE_MOTION, ALERT_LEVEL_INFO, 1, "Motion detected");
-        send_pulse(MOTION_DETECTED, ALERT_LEVEL_INFO);
-        //}
-        last_motion = data->motion_detected;
-        if (current_alert_level < ALERT_LEVEL_INFO)
+        if ((g_motion.valid[i] && g_motion.detected[i] && !g_motion.alerted[i]) || g_motion.closed[i].rising > 0)
         {
-            current_alert_level = ALERT_LEVEL_INFO;
+            send_sensor_alert(g_motion.sensor[i], ALERT_TYPE_MOTION, ALERT_LEVEL_INFO, 1, "Motion detected");
+            send_pulse(MOTION_DETECTED, ALERT_LEVEL_INFO);
         }
+        g_motion.alerted[i] = g_motion.valid[i] ? g_motion.detected[i] : 0;
     }
 
-    // Check door status
-    if (data->ultrasonic_valid)
+    // Doors
+    for (i = 0; i < g_ultrasonic.count; i++)
     {
-        static uint8_t last_door_state = 0;
-        if (data->door_closed && !last_door_state)
+        if (!g_ultrasonic.valid[i])
         {
-            send_alert(ALERT_TYPE_DOOR_CLOSED, ALERT_LEVEL_INFO, data->distance_cm, "Door closed");
+            continue;
+        }
+        if (g_ultrasonic.door_closed[i] && !g_ultrasonic.alerted[i])
+        {
+            send_sensor_alert(g_ultrasonic.sensor[i], ALERT_TYPE_DOOR_CLOSED, ALERT_LEVEL_INFO,
+                              g_ultrasonic.distance_cm[i], "Door closed");
+            send_pulse(DOOR_OPEN, ALERT_LEVEL_INFO);
+        }
+        else if (!g_ultrasonic.door_closed[i] && g_ultrasonic.alerted[i])
+        {
+            send_sensor_alert(g_ultrasonic.sensor[i], ALERT_TYPE_DOOR_OPEN, ALERT_LEVEL_INFO,
+                              g_ultrasonic.distance_cm[i], "Door opened");
             send_pulse(DOOR_OPEN, ALERT_LEVEL_INFO);
         }
-        else if (!data->door_closed && last_door_state)
+        else if (g_ultrasonic.door_closed[i] && g_ultrasonic.closed[i].falling > 0)
         {
-            send_alert(ALERT_TYPE_DOOR_OPEN, ALERT_LEVEL_INFO, data->distance_cm, "Door opened");
+            send_sensor_alert(g_ultrasonic.sensor[i], ALERT_TYPE_DOOR_OPEN, ALERT_LEVEL_INFO,
+                              g_ultrasonic.closed[i].max, "Door opened and closed again");
             send_pulse(DOOR_OPEN, ALERT_LEVEL_INFO);
         }
-        last_door_state = data->door_closed;
+        g_ultrasonic.alerted[i] = g_ultrasonic.door_closed[i];
+    }
+
+    // Composite alerts matched by the correlator since the last check
+    corr_match_t match;
+    while (correlator_pop(&g_correlator, &match))
+    {
+        const corr_rule_t *rule = &g_corr_rules[match.rule];
+
+        // value = events that made up the pattern
+        send_alert(rule->alert_type, rule->alert_level, (int)match.events, rule->description);
+        if (rule->pulse_code != -1)
+        {
+            send_pulse(rule->pulse_code, rule->alert_level);
+        }
+        if (rule->alert_level > current_alert_level)
+        {
+            current_alert_level = rule->alert_level;
+        }
     }
 
     // Update alert level
-    data->alert_level = current_alert_level;
-    last_alert_level = current_alert_level;
+    g_alert_level = current_alert_level;
+}
+
+// Current connection to a service, (re)connecting when it is missing and a retry is due
+static int service_coid(service_t *svc)
+{
+    int coid;
+
+    pthread_mutex_lock(&svc->lock);
+    if (svc->coid == -1 && mono_time_ms() >= svc->retry_ms)
+    {
+        svc->coid = name_open(svc->name, 0);
+        if (svc->coid == -1)
+        {
+            svc->retry_ms = mono_time_ms() + SERVICE_RETRY_MS;
+        }
+        else
+        {
+            svc->reconnects++;
+            LOG_WARN("[CONNECT] Reconnected to %s (#%u)", svc->name, svc->reconnects);
+        }
+    }
+    coid = svc->coid;
+    pthread_mutex_unlock(&svc->lock);
+    return coid;
+}
+
+/**
+ * Handle a failed send: if the server went away, drop the connection and open a new one
+ *
+ * @return connection to retry on, or -1 (errno of the failed send kept)
+ */
+static int service_lost(service_t *svc, int coid)
+{
+    int err = errno;
+
+    if (err != ESRCH && err != EBADF && err != ENOTCONN)
+    {
+        return -1; // The server is there but refused the message
+    }
+    pthread_mutex_lock(&svc->lock);
+    if (svc->coid == coid)
+    {
+        name_close(coid);
+        svc->coid = -1;
+        svc->retry_ms = 0;
+    }
+    pthread_mutex_unlock(&svc->lock);
+
+    coid = service_coid(svc);
+    errno = err;
+    return coid;
+}
+
+static int service_send(service_t *svc, int coid, const void *msg, size_t size)
+{
+    int rc = MsgSend(coid, msg, size, NULL, 0);
+
+    if (rc == -1 && (coid = service_lost(svc, coid)) != -1)
+    {
+        rc = MsgSend(coid, msg, size, NULL, 0);
+    }
+    return rc;
+}
+
+static int service_pulse(service_t *svc, int coid, int priority, int code, int value)
+{
+    int rc = MsgSendPulse(coid, priority, code, value);
+
+    if (rc == -1 && (coid = service_lost(svc, coid)) != -1)
+    {
+        rc = MsgSendPulse(coid, priority, code, value);
+    }
+    return rc;
 }
 
 // Send alert message to event logger
@@ -416,52 +1822,72 @@ static void send_alert(uint8_t alert_type, uint8_t alert_level, int sensor_value
     {
         uint16_t type;
         char text[128];
+        uint32_t seq; // Snapshot the alert belongs to (span tracing)
     } msg;
+    const char *level = alert_level == ALERT_LEVEL_CRITICAL  ? "CRITICAL"
+                        : alert_level == ALERT_LEVEL_WARNING ? "WARNING"
+                                                             : "INFO";
 
     msg.type = alert_type;
-    snprintf(msg.text, sizeof(msg.text), "[%s] %s (value=%d)",
-             alert_level == ALERT_LEVEL_CRITICAL  ? "CRITICAL"
-             : alert_level == ALERT_LEVEL_WARNING ? "WARNING"
-                                                  : "INFO",
-             description, sensor_value);
+    msg.seq = g_sequence_num;
+    snprintf(msg.text, sizeof(msg.text), "[%s] %s (value=%d)", level, description, sensor_value);
 
-    if (event_logger_coid != -1)
+    int coid = service_coid(&g_event_logger);
+    if (coid != -1)
     {
-        if (MsgSend(event_logger_coid, &msg, sizeof(msg), NULL, 0) == -1)
+        uint64_t span = span_begin(msg.seq);
+        int rc = service_send(&g_event_logger, coid, &msg, sizeof(msg));
+
+        span_end(span, "alert_send", msg.seq, level);
+
+        trace_ipc(TRACE_IPC_LOGGER, rc);
+        if (rc == -1)
         {
-            printf("[ALERT] Failed to send to event logger: %s\n", strerror(errno));
+            LOG_ERROR("[ALERT] Failed to send to event logger: %s", strerror(errno));
         }
         else
         {
-            printf("[ALERT] Logged: %s\n", msg.text);
+            LOG_INFO("[ALERT] Logged: %s", msg.text);
         }
     }
     else
     {
-        printf("[ALERT] Event logger not connected: %s\n", msg.text);
+        LOG_INFO("[ALERT] Event logger not connected: %s", msg.text);
     }
 }
 
 // Send pulse command to alert manager
-static void send_pulse(uint8_t pulse_type, uint8_t alert_level)
+// @return 0 when the pulse was sent, -1 otherwise
+static int send_pulse(uint8_t pulse_type, uint8_t alert_level)
 {
-    (void)alert_level;
-
-    if (alert_manager_coid != -1)
+    int rc = -1;
+    int coid = service_coid(&g_alert_manager);
+    if (coid != -1)
     {
-        if (MsgSendPulse(alert_manager_coid, -1, pulse_type, 0) == -1)
+        // The pulse value carries the snapshot sequence number to the LED span.
+        // A critical pulse runs alert_mgr's receive thread above every other thread.
+        uint32_t seq = g_sequence_num;
+        int priority = alert_level == ALERT_LEVEL_CRITICAL ? ALERT_PULSE_PRIORITY_CRITICAL : -1;
+        uint64_t span = span_begin(seq);
+        rc = service_pulse(&g_alert_manager, coid, priority, pulse_type, (int)seq);
+
+        span_end(span, "alert_pulse", seq, NULL);
+
+        trace_ipc(TRACE_IPC_ALERT_PULSE, rc);
+        if (rc == -1)
         {
-            printf("[PULSE] Failed to send pulse to alert manager: %s\n", strerror(errno));
+            LOG_ERROR("[PULSE] Failed to send pulse to alert manager: %s", strerror(errno));
         }
         else
         {
-            printf("[PULSE] Sent pulse code: %d\n", pulse_type);
+            LOG_INFO("[PULSE] Sent pulse code: %d", pulse_type);
         }
     }
     else
     {
-        printf("[PULSE] Alert manager not connected (simulated pulse: %d)\n", pulse_type);
+        LOG_INFO("[PULSE] Alert manager not connected (simulated pulse: %d)", pulse_type);
     }
+    return rc == -1 ? -1 : 0;
 }
 
 // Send log message to event logger
@@ -471,102 +1897,457 @@ static void send_log(const char *message)
     {
         uint16_t type;
         char text[128];
+        uint32_t seq;
     } msg;
 
     msg.type = 0;
+    msg.seq = g_sequence_num;
     snprintf(msg.text, sizeof(msg.text), "[LOG] %s", message);
 
-    if (event_logger_coid != -1)
+    int coid = service_coid(&g_event_logger);
+    if (coid != -1)
     {
-        MsgSend(event_logger_coid, &msg, sizeof(msg), NULL, 0);
+        trace_ipc(TRACE_IPC_LOGGER, service_send(&g_event_logger, coid, &msg, sizeof(msg)));
     }
 }
 
-// Connect to a service (returns -1 if service not available)
-static int connect_to_service(const char *service_name)
+// Connect to a service at start-up (stays -1 if the service is not available)
+static void connect_to_service(service_t *svc)
 {
-    int coid = name_open(service_name, 0);
-    if (coid == -1)
+    svc->coid = name_open(svc->name, 0);
+    if (svc->coid == -1)
     {
-        printf("[CONNECT] Could not connect to %s (running in standalone mode)\n", service_name);
+        printf("[CONNECT] Could not connect to %s (running in standalone mode)\n", svc->name);
+        svc->retry_ms = mono_time_ms() + SERVICE_RETRY_MS;
     }
     else
     {
-        printf("[CONNECT] Connected to %s\n", service_name);
+        printf("[CONNECT] Connected to %s\n", svc->name);
     }
-    return coid;
 }
 
-int main(void)
+// The four on-board sensors, used when the config file declares none
+static void register_default_sensors(sensor_registry_t *reg)
 {
-    pthread_t temp_thread, gas_thread, motion_thread, ultrasonic_thread, agg_thread;
+    sensor_instance_t defaults[] = {
+        sensor_instance_make(SENSOR_TYPE_TEMPERATURE, "dht11", DHT_GPIO_PIN, -1),
+        sensor_instance_make(SENSOR_TYPE_GAS, "mq135", MQ135_GPIO_PIN, -1),
+        sensor_instance_make(SENSOR_TYPE_MOTION, "pir", PIR_GPIO_PIN, -1),
+        sensor_instance_make(SENSOR_TYPE_ULTRASONIC, "door", ULTRASONIC_TRIG_PIN, ULTRASONIC_ECHO_PIN),
+    };
+    size_t i;
+
+    for (i = 0; i < sizeof(defaults) / sizeof(defaults[0]); i++)
+    {
+        sensor_registry_add(reg, &defaults[i]);
+    }
+}
+
+// Point each storage bank slot at its registry entry
+static void bind_sensor_banks(const sensor_registry_t *reg)
+{
+    int i;
+
+    for (i = 0; i < reg->count; i++)
+    {
+        const sensor_instance_t *sensor = &reg->sensors[i];
+
+        switch (sensor->type)
+        {
+        case SENSOR_TYPE_TEMPERATURE:
+            g_dht.sensor[g_dht.count++] = sensor;
+            break;
+        case SENSOR_TYPE_GAS:
+            g_gas.sensor[g_gas.count++] = sensor;
+            break;
+        case SENSOR_TYPE_MOTION:
+            g_motion.sensor[g_motion.count++] = sensor;
+            break;
+        case SENSOR_TYPE_ULTRASONIC:
+            g_ultrasonic.sensor[g_ultrasonic.count++] = sensor;
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+// Replay a trace through the analysis code (-r). speed 1 keeps the recorded pace,
+// N replays N times faster and 0 as fast as possible.
+static int replay_trace(trace_reader_t *reader, double speed)
+{
+    static sensor_data_msg_t msg;
+    int cfg_slot = config_reader_register();
+    trace_record_t rec;
+    uint32_t samples = 0, aggregations = 0, configs = 0, ipc_failures = 0;
+    uint64_t start_ns = mono_time_ns();
+    double elapsed;
+    int rc;
+
+    while ((rc = trace_reader_next(reader, &rec)) == 1)
+    {
+        uint64_t now = reader->header.mono_start_ms + rec.t_ms;
+
+        // Pace the replay against the recorded timeline
+        if (speed > 0)
+        {
+            uint64_t due_ns = start_ns + (uint64_t)(rec.t_ms * 1e6 / speed);
+            uint64_t now_ns = mono_time_ns();
+
+            if (due_ns > now_ns)
+            {
+                struct timespec ts = {(time_t)((due_ns - now_ns) / 1000000000ULL),
+                                      (long)((due_ns - now_ns) % 1000000000ULL)};
+                nanosleep(&ts, NULL);
+            }
+        }
+
+        switch (rec.kind)
+        {
+        case TRACE_REC_SAMPLE:
+        {
+            const sensor_instance_t *sensor = &g_registry.sensors[rec.sensor];
+            sensor_sample_t sample;
+
+            sample.now = now;
+            sample.ok = rec.ok;
+            sample.value = rec.value;
+            sample.value2 = rec.value2;
+            sample.aux = rec.aux;
+            sample.read_us = rec.read_us;
+            sample.wasted_us = rec.extra;
+            sensor_drivers[sensor->type].ingest(sensor, &sample, cfg_slot);
+            samples++;
+            break;
+        }
+        case TRACE_REC_AGGREGATE:
+            run_aggregation(&msg, cfg_slot, now);
+            aggregations++;
+            break;
+        case TRACE_REC_CONFIG:
+        {
+            threshold_config_t *cfg = malloc(sizeof(*cfg));
+
+            if (cfg)
+            {
+                *cfg = reader->config;
+                if (config_publish(cfg) != 0)
+                {
+                    free(cfg);
+                }
+            }
+            configs++;
+            break;
+        }
+        case TRACE_REC_IPC:
+            ipc_failures += !rec.ok;
+            break;
+        default:
+            break;
+        }
+    }
+
+    elapsed = (mono_time_ns() - start_ns) / 1e9;
+    printf("[REPLAY] %u samples, %u aggregations, %u configs (%u IPC failures recorded) in %.3f s "
+           "(%.0f samples/s)\n",
+           samples, aggregations, configs, ipc_failures, elapsed, elapsed > 0 ? samples / elapsed : 0.0);
+    if (aggregations > 0)
+    {
+        printf("[REPLAY] aggregation and threshold check of %u sensors: mean %.1f us, max %.1f us\n",
+               g_registry.count, g_aggregate_ns / 1e3 / aggregations, g_aggregate_max_ns / 1e3);
+    }
+    if (rc < 0)
+    {
+        fprintf(stderr, "Trace is truncated or corrupt after %u samples\n", samples);
+        return -1;
+    }
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    pthread_t agg_thread, config_thread;
+    int workers[POOL_CLASS_COUNT];
+    const char *record_path = NULL;
+    const char *replay_path = NULL;
+    const char *state_path = NULL;
+    const char *log_path = NULL;
+    char default_state_path[64];
+    static trace_reader_t reader;
+    double speed = 1.0;
+    long cores;
+    int opt;
+    int i;
+
+    while ((opt = getopt(argc, argv, "c:z:n:T:r:s:qS:L:")) != -1)
+    {
+        switch (opt)
+        {
+        case 'c':
+            g_config_path = optarg;
+            break;
+        case 'z':
+            g_zone_id = (uint16_t)atoi(optarg);
+            break;
+        case 'n':
+            if (!sensor_name_valid(optarg))
+            {
+                fprintf(stderr, "Zone name must not contain quotes, backslashes or control characters\n");
+                return EXIT_FAILURE;
+            }
+            snprintf(g_zone_name, sizeof(g_zone_name), "%s", optarg);
+            break;
+        case 'T':
+            record_path = optarg;
+            break;
+        case 'r':
+            replay_path = optarg;
+            break;
+        case 's':
+            speed = strcmp(optarg, "max") == 0 ? 0.0 : atof(optarg);
+            break;
+        case 'q':
+            g_log_readings = false;
+            break;
+        case 'S':
+            state_path = optarg;
+            break;
+        case 'L':
+            log_path = optarg;
+            break;
+        default:
+            fprintf(stderr,
+                    "Usage: %s [-c config_file] [-z zone_id] [-n zone_name] [-T record_file] [-S state_file|none]\n"
+                    "       %*s [-L binary_log_file]\n"
+                    "       %s -r trace_file [-s speed|max] [-q] [-c config_file]\n",
+                    argv[0], (int)strlen(argv[0]), "", argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
 
     printf("=================================================\n");
     printf("    Central Analyzer - Sensor Aggregation System\n");
     printf("=================================================\n");
 
-    // Attempt to connect to other processes (optional)
-    stats_update_coid = connect_to_service("stats_update");
-    event_logger_coid = connect_to_service("event_logger");
-    alert_manager_coid = connect_to_service("alert_manager");
+    // Load the config file, falling back to the built-in defaults
+    if (config_reload(g_config_path, &default_thresholds) == 0)
+    {
+        printf("[CONFIG] Loaded %s\n", g_config_path);
+    }
+    else
+    {
+        printf("[CONFIG] Using built-in thresholds (%s not loaded)\n", g_config_path);
+        config_init_defaults(&default_thresholds);
+    }
+    signal(SIGHUP, config_reload_signal);
 
-    printf("\nStarting sensor threads...\n");
+    // The aggregator waits for state changes with a monotonic deadline
+    pthread_condattr_t cond_attr;
+    pthread_condattr_init(&cond_attr);
+    pthread_condattr_setclock(&cond_attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&g_publish.cond, &cond_attr);
+    pthread_condattr_destroy(&cond_attr);
 
-    // Create sensor threads
-    if (pthread_create(&temp_thread, NULL, temperature_sensor_thread, NULL) != 0)
+    if (replay_path)
+    {
+        // Sensors and zone as recorded; the config follows the trace's CONFIG records
+        if (trace_reader_open(&reader, replay_path) != 0)
+        {
+            fprintf(stderr, "Cannot replay %s: not a valid trace of this version\n", replay_path);
+            return EXIT_FAILURE;
+        }
+        for (i = 0; i < reader.header.sensor_count; i++)
+        {
+            if (!sensor_registry_add(&g_registry, &reader.sensors[i]))
+            {
+                fprintf(stderr, "Cannot replay %s: sensor %d (%.*s) does not fit (max %d, %d per type)\n",
+                        replay_path, i, SENSOR_NAME_LEN, reader.sensors[i].name, SENSOR_MAX_INSTANCES,
+                        SENSOR_MAX_PER_TYPE);
+                return EXIT_FAILURE;
+            }
+        }
+        g_zone_id = reader.header.zone_id;
+        snprintf(g_zone_name, sizeof(g_zone_name), "%.*s", ZONE_NAME_LEN, reader.header.zone_name);
+        g_replay = &reader.header;
+    }
+    // Sensor instances from the config file, or the on-board set
+    else if (sensor_registry_load(&g_registry, g_config_path) < 0)
     {
-        fprintf(stderr, "Failed to create temperature sensor thread\n");
+        fprintf(stderr, "Invalid sensor definitions in %s\n", g_config_path);
         return EXIT_FAILURE;
     }
+    if (g_registry.count == 0 && !replay_path)
+    {
+        register_default_sensors(&g_registry);
+    }
+    bind_sensor_banks(&g_registry);
 
-    if (pthread_create(&gas_thread, NULL, gas_sensor_thread, NULL) != 0)
+    // Scheduling policy per thread class
+    if (thread_policy_load(g_config_path) < 0)
     {
-        fprintf(stderr, "Failed to create gas sensor thread\n");
+        fprintf(stderr, "Invalid thread policies in %s\n", g_config_path);
         return EXIT_FAILURE;
     }
+    thread_policy_print();
+    printf("[ZONE] %u (%s)\n", g_zone_id, g_zone_name);
+    printf("[SENSORS] %d registered (%d temperature, %d gas, %d motion, %d ultrasonic)\n",
+           g_registry.count, g_dht.count, g_gas.count, g_motion.count, g_ultrasonic.count);
+
+    // Attempt to connect to other processes (optional)
+    connect_to_service(&g_stats_update);
+    connect_to_service(&g_event_logger);
+    connect_to_service(&g_alert_manager);
+
+    correlator_init(&g_correlator, g_corr_rules, sizeof(g_corr_rules) / sizeof(g_corr_rules[0]));
+
+    if (replay_path)
+    {
+        if (speed > 0)
+        {
+            printf("[REPLAY] %s at %gx\n", replay_path, speed);
+        }
+        else
+        {
+            printf("[REPLAY] %s at max speed\n", replay_path);
+        }
+        int rc = replay_trace(&reader, speed);
+        trace_reader_close(&reader);
+        return rc == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
 
-    if (pthread_create(&motion_thread, NULL, motion_sensor_thread, NULL) != 0)
+    if (record_path)
     {
-        fprintf(stderr, "Failed to create motion sensor thread\n");
-        return EXIT_FAILURE;
+        if (trace_writer_open(&g_trace, record_path, &g_registry, g_zone_id, g_zone_name, mono_time_ms()) != 0)
+        {
+            fprintf(stderr, "Cannot record to %s: %s\n", record_path, strerror(errno));
+            return EXIT_FAILURE;
+        }
+        trace_config();
+        printf("[TRACE] Recording to %s\n", record_path);
     }
 
-    if (pthread_create(&ultrasonic_thread, NULL, ultrasonic_sensor_thread, NULL) != 0)
+    // Warm restart: pick up the state of the previous run, then keep saving it
+    if (!state_path)
+    {
+        snprintf(default_state_path, sizeof(default_state_path), CHECKPOINT_FILE_FMT, g_zone_id);
+        state_path = default_state_path;
+    }
+    if (strcmp(state_path, "none") != 0)
     {
-        fprintf(stderr, "Failed to create ultrasonic sensor thread\n");
+        analyzer_checkpoint_t *saved = malloc(sizeof(*saved));
+        checkpoint_info_t info;
+
+        // A recording starts cold, so replaying it reproduces the run
+        if (saved && !record_path && checkpoint_load(state_path, saved, sizeof(*saved), &info) == 0)
+        {
+            restore_checkpoint(saved, &info);
+        }
+        free(saved);
+        if (checkpoint_open(&g_checkpoint, state_path, (uint32_t)ANALYZER_CHECKPOINT_SIZE(g_registry.count)) != 0)
+        {
+            printf("[CHECKPOINT] Cannot write %s: %s (no warm restart)\n", state_path, strerror(errno));
+        }
+        else
+        {
+            printf("[CHECKPOINT] Saving state to %s\n", state_path);
+        }
+    }
+
+    // Log records are formatted (or written to the binary log) off the sensor and aggregator threads.
+    // A replay keeps logging synchronously, so its output never loses records to a full ring.
+    if (binlog_init(log_path) != 0)
+    {
+        printf("[LOG] Cannot write %s: %s (logging synchronously)\n", log_path ? log_path : "stdout",
+               strerror(errno));
+    }
+    else if (log_path)
+    {
+        printf("[LOG] Writing binary log to %s (read it with log_decode)\n", log_path);
+    }
+    if (span_trace_init("central_analyzer") != 0)
+    {
+        printf("[SPAN] Cannot write %s: %s (no span tracing)\n", getenv(SPAN_FILE_ENV), strerror(errno));
+    }
+
+    printf("\nStarting sensors...\n");
+
+    // Initialize each instance (one at a time: they share GPIO set-up) and give it a pool task
+    worker_pool_init(&g_pool);
+    for (i = 0; i < g_registry.count; i++)
+    {
+        const sensor_instance_t *sensor = &g_registry.sensors[i];
+        const sensor_driver_t *driver = &sensor_drivers[sensor->type];
+        char text[64];
+
+        g_sensor_task[i] = -1;
+        if (driver->init(sensor) != 0)
+        {
+            printf("[%s] %s: Failed to initialize sensor\n", driver->tag, sensor->name);
+            continue;
+        }
+        g_sensor_task[i] = worker_pool_add(&g_pool, sensor_task, (void *)sensor, driver->cls);
+        printf("[%s] %s: Started\n", driver->tag, sensor->name);
+        snprintf(text, sizeof(text), "%s sensor started (%s)", driver->label, sensor->name);
+        send_log(text);
+    }
+
+    // One short-task worker per core; blocking reads get their own workers
+    cores = sysconf(_SC_NPROCESSORS_ONLN);
+    if (cores < 1)
+    {
+        cores = 1;
+    }
+    workers[POOL_CLASS_SHORT] = (int)cores;
+    workers[POOL_CLASS_BLOCKING] = cores > POOL_BLOCKING_WORKERS_MIN ? (int)cores : POOL_BLOCKING_WORKERS_MIN;
+    g_pool.spawn = spawn_pool_thread;
+    if (worker_pool_start(&g_pool, workers, config_reader_register) != 0)
+    {
+        fprintf(stderr, "Failed to start sensor worker pool\n");
         return EXIT_FAILURE;
     }
+    printf("[POOL] %d tasks on %d short + %d blocking workers\n", g_pool.task_count,
+           g_pool.class_workers[POOL_CLASS_SHORT], g_pool.class_workers[POOL_CLASS_BLOCKING]);
 
-    if (pthread_create(&agg_thread, NULL, aggregator_thread, NULL) != 0)
+    if (thread_policy_create(THREAD_CLASS_ANALYSIS, &agg_thread, aggregator_thread, NULL) != 0)
     {
         fprintf(stderr, "Failed to create aggregator thread\n");
         return EXIT_FAILURE;
     }
 
+    if (thread_policy_create(THREAD_CLASS_LOGGING, &config_thread, config_watch_thread, NULL) != 0)
+    {
+        fprintf(stderr, "Failed to create config watcher thread\n");
+        return EXIT_FAILURE;
+    }
+
+    // Heartbeats to the supervisor stop if the aggregator gets stuck
+    g_aggregator_progress_ms = mono_time_ms();
+    heartbeat_start(&g_aggregator_progress_ms, AGGREGATOR_STALL_MS);
+
     printf("\nAll threads started. Central Analyzer running...\n");
     printf("Press Ctrl+C to stop.\n\n");
 
-    // Main thread waits for all sensor threads
-    pthread_join(temp_thread, NULL);
-    pthread_join(gas_thread, NULL);
-    pthread_join(motion_thread, NULL);
-    pthread_join(ultrasonic_thread, NULL);
+    // Main thread waits for the sensor workers
+    worker_pool_join(&g_pool);
     pthread_join(agg_thread, NULL);
+    pthread_join(config_thread, NULL);
 
     // Cleanup
-    if (stats_update_coid != -1)
+    if (g_stats_update.coid != -1)
     {
-        name_close(stats_update_coid);
+        name_close(g_stats_update.coid);
     }
-    if (event_logger_coid != -1)
+    if (g_event_logger.coid != -1)
     {
-        name_close(event_logger_coid);
+        name_close(g_event_logger.coid);
     }
-    if (alert_manager_coid != -1)
+    if (g_alert_manager.coid != -1)
     {
-        name_close(alert_manager_coid);
+        name_close(g_alert_manager.coid);
     }
 
+    checkpoint_close(&g_checkpoint);
+    binlog_shutdown();
     rpi_gpio_cleanup();
 
     printf("\nCentral Analyzer shut down.\n");
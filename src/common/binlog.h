@@ -0,0 +1,687 @@
+/*
+ * binlog.h - Asynchronous binary logging with compile-time levels
+ *
+ * LOG_ERROR/LOG_WARN/LOG_INFO/LOG_DEBUG take a printf format and arguments,
+ * but nothing is formatted on the calling thread: the call stores a 128-byte
+ * record (timestamp, call site, raw arguments) in the thread's own ring
+ * buffer and returns. A background thread drains the rings in time order and
+ * either formats the records to stdout or appends them unformatted to a log
+ * file that log_decode turns into text later.
+ *
+ *     record  t_ns, site, thread, size, arguments (112 bytes)
+ *     site    level, format, file, line; one static per call site, collected
+ *             in the "binlog_sites" section and written to the head of a log file
+ *
+ * Arguments are stored by type: integers as 64 bits, float/double as double,
+ * strings copied inline (truncated to what fits). A full ring drops the
+ * record and counts it; logging never blocks. Before binlog_init() (and in
+ * processes that never call it) records are formatted and printed on the spot.
+ *
+ * A thread gets its ring on its first record. When it exits, the ring is
+ * retired and handed to the next new thread once it has been drained, so
+ * servers whose receive pools keep creating and retiring threads stay within
+ * BINLOG_MAX_THREADS rings (the record's thread index is then reused too).
+ *
+ * Levels above LOG_LEVEL are compiled out; build with -DLOG_LEVEL=2 (make
+ * LOG_LEVEL=2) to drop debug records, such as every single sensor reading.
+ */
+
+#ifndef BINLOG_H
+#define BINLOG_H
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "mono_time.h"
+#include "thread_policy.h"
+
+#define LOG_LEVEL_ERROR 0
+#define LOG_LEVEL_WARN 1
+#define LOG_LEVEL_INFO 2
+#define LOG_LEVEL_DEBUG 3
+
+#ifndef LOG_LEVEL
+#define LOG_LEVEL LOG_LEVEL_DEBUG
+#endif
+
+#define BINLOG_MAGIC 0x474f4c42u // "BLOG"
+#define BINLOG_VERSION 1
+#define BINLOG_ARGS_SIZE 112
+#define BINLOG_RING_RECORDS 1024 // Per thread (power of two)
+#define BINLOG_MAX_THREADS 64    // Rings, i.e. threads logging at the same time
+#define BINLOG_FLUSH_MS 20       // Background drain period
+#define BINLOG_LINE_MAX 512
+
+#define BINLOG_RING_ACTIVE 0     // Owned by a live thread
+#define BINLOG_RING_RETIRED 1    // Owner exited; taken over by a new thread once drained
+
+typedef struct
+{
+    const char *fmt;
+    const char *file;
+    uint32_t line;
+    uint8_t level;
+} binlog_site_t;
+
+typedef struct
+{
+    uint64_t t_ns;                   // Monotonic time of the call
+    uint16_t site;                   // Index in the binlog_sites section
+    uint8_t thread;                  // Ring (thread) index
+    uint8_t size;                    // Bytes of args used
+    uint32_t reserved;
+    uint8_t args[BINLOG_ARGS_SIZE];
+} binlog_record_t;
+
+typedef struct
+{
+    _Atomic uint32_t head;           // Next record to drain (background thread)
+    _Atomic uint32_t tail;           // Next free record (owning thread)
+    _Atomic uint32_t dropped;        // Records lost to a full ring
+    _Atomic int state;               // BINLOG_RING_ACTIVE / BINLOG_RING_RETIRED
+    uint8_t index;
+    binlog_record_t records[BINLOG_RING_RECORDS];
+} binlog_ring_t;
+
+// Log file layout: binlog_file_t, then site_count entries of binlog_file_site_t
+// each followed by its format and file name, then binlog_record_t until the end
+typedef struct
+{
+    uint32_t magic;
+    uint16_t version;
+    uint16_t site_count;
+    uint64_t mono_start_ns;          // Monotonic time ...
+    int64_t wall_start_ns;           // ... and wall-clock time at binlog_init()
+} binlog_file_t;
+
+typedef struct
+{
+    uint32_t line;
+    uint16_t fmt_len;
+    uint16_t file_len;
+    uint8_t level;
+    uint8_t reserved[3];
+} binlog_file_site_t;
+
+typedef struct
+{
+    binlog_ring_t *rings[BINLOG_MAX_THREADS];
+    _Atomic int ring_count;          // Slots claimed, at most BINLOG_MAX_THREADS
+    _Atomic uint32_t lost_threads;   // Records from threads beyond BINLOG_MAX_THREADS
+    _Atomic int running;
+    pthread_key_t ring_key;          // Destructor retires the ring of an exiting thread
+    FILE *out;                       // Log file, or NULL to format to stdout
+    pthread_t thread;
+    uint32_t dropped_reported;
+} binlog_t;
+
+static binlog_t g_binlog;
+static __thread binlog_ring_t *tl_binlog_ring;
+static __thread binlog_record_t tl_binlog_scratch; // Synchronous path before binlog_init()
+
+// Call sites (GNU ld provides the bounds of a section named like a C identifier)
+extern const binlog_site_t __start_binlog_sites[] __attribute__((weak));
+extern const binlog_site_t __stop_binlog_sites[] __attribute__((weak));
+
+static const char *const binlog_level_names[] = {"ERROR", "WARN", "INFO", "DEBUG"};
+
+typedef struct
+{
+    uint8_t *p;
+    uint8_t used;
+} binlog_cursor_t;
+
+static inline void binlog_put_int(binlog_cursor_t *c, int64_t v)
+{
+    if (c->used + sizeof(v) <= BINLOG_ARGS_SIZE)
+    {
+        memcpy(c->p + c->used, &v, sizeof(v));
+        c->used += sizeof(v);
+    }
+}
+
+static inline void binlog_put_f64(binlog_cursor_t *c, double v)
+{
+    if (c->used + sizeof(v) <= BINLOG_ARGS_SIZE)
+    {
+        memcpy(c->p + c->used, &v, sizeof(v));
+        c->used += sizeof(v);
+    }
+}
+
+// Strings: length byte and the bytes (no terminator), cut to the space left
+static inline void binlog_put_str(binlog_cursor_t *c, const char *s)
+{
+    size_t room = BINLOG_ARGS_SIZE - c->used;
+    size_t len = s ? strlen(s) : 0;
+
+    if (room == 0)
+    {
+        return;
+    }
+    if (len > room - 1)
+    {
+        len = room - 1;
+    }
+    c->p[c->used] = (uint8_t)len;
+    memcpy(c->p + c->used + 1, s, len);
+    c->used += (uint8_t)(len + 1);
+}
+
+#define BINLOG_PUT(c, x)                                                                                   \
+    _Generic((x), char *: binlog_put_str, const char *: binlog_put_str, float: binlog_put_f64,              \
+             double: binlog_put_f64, default: binlog_put_int)(c, x)
+
+// Encode up to 8 arguments
+#define BINLOG_NARG(...) BINLOG_NARG_(__VA_ARGS__, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0)
+#define BINLOG_NARG_(_1, _2, _3, _4, _5, _6, _7, _8, _9, N, ...) N
+#define BINLOG_CAT(a, b) BINLOG_CAT_(a, b)
+#define BINLOG_CAT_(a, b) a##b
+#define BINLOG_E1(c)
+#define BINLOG_E2(c, a) BINLOG_PUT(c, a);
+#define BINLOG_E3(c, a, ...) BINLOG_PUT(c, a); BINLOG_E2(c, __VA_ARGS__)
+#define BINLOG_E4(c, a, ...) BINLOG_PUT(c, a); BINLOG_E3(c, __VA_ARGS__)
+#define BINLOG_E5(c, a, ...) BINLOG_PUT(c, a); BINLOG_E4(c, __VA_ARGS__)
+#define BINLOG_E6(c, a, ...) BINLOG_PUT(c, a); BINLOG_E5(c, __VA_ARGS__)
+#define BINLOG_E7(c, a, ...) BINLOG_PUT(c, a); BINLOG_E6(c, __VA_ARGS__)
+#define BINLOG_E8(c, a, ...) BINLOG_PUT(c, a); BINLOG_E7(c, __VA_ARGS__)
+#define BINLOG_E9(c, a, ...) BINLOG_PUT(c, a); BINLOG_E8(c, __VA_ARGS__)
+#define BINLOG_ENCODE(...) BINLOG_CAT(BINLOG_E, BINLOG_NARG(__VA_ARGS__))(__VA_ARGS__)
+
+// printf format checking of every call, without generating code
+static inline void binlog_check(const char *fmt, ...) __attribute__((format(printf, 1, 2)));
+static inline void binlog_check(const char *fmt, ...)
+{
+    (void)fmt;
+}
+
+#define BINLOG_AT(lvl, fmt, ...)                                                                           \
+    do                                                                                                     \
+    {                                                                                                      \
+        static const binlog_site_t binlog_site_                                                           \
+            __attribute__((section("binlog_sites"), used, aligned(8))) = {fmt, __FILE__, __LINE__, lvl};   \
+        binlog_record_t *binlog_rec_ = binlog_begin(&binlog_site_);                                       \
+        if (0)                                                                                             \
+        {                                                                                                  \
+            binlog_check(fmt, ##__VA_ARGS__);                                                              \
+        }                                                                                                  \
+        if (binlog_rec_)                                                                                   \
+        {                                                                                                  \
+            binlog_cursor_t binlog_cur_ = {binlog_rec_->args, 0};                                          \
+            BINLOG_ENCODE(&binlog_cur_, ##__VA_ARGS__)                                                     \
+            binlog_commit(binlog_rec_, &binlog_site_, binlog_cur_.used);                                   \
+        }                                                                                                  \
+    } while (0)
+
+#define BINLOG_OFF(fmt, ...)                                                                               \
+    do                                                                                                     \
+    {                                                                                                      \
+        if (0)                                                                                             \
+        {                                                                                                  \
+            binlog_check(fmt, ##__VA_ARGS__);                                                              \
+        }                                                                                                  \
+    } while (0)
+
+#define LOG_ERROR(fmt, ...) BINLOG_AT(LOG_LEVEL_ERROR, fmt, ##__VA_ARGS__)
+#if LOG_LEVEL >= LOG_LEVEL_WARN
+#define LOG_WARN(fmt, ...) BINLOG_AT(LOG_LEVEL_WARN, fmt, ##__VA_ARGS__)
+#else
+#define LOG_WARN(fmt, ...) BINLOG_OFF(fmt, ##__VA_ARGS__)
+#endif
+#if LOG_LEVEL >= LOG_LEVEL_INFO
+#define LOG_INFO(fmt, ...) BINLOG_AT(LOG_LEVEL_INFO, fmt, ##__VA_ARGS__)
+#else
+#define LOG_INFO(fmt, ...) BINLOG_OFF(fmt, ##__VA_ARGS__)
+#endif
+#if LOG_LEVEL >= LOG_LEVEL_DEBUG
+#define LOG_DEBUG(fmt, ...) BINLOG_AT(LOG_LEVEL_DEBUG, fmt, ##__VA_ARGS__)
+#else
+#define LOG_DEBUG(fmt, ...) BINLOG_OFF(fmt, ##__VA_ARGS__)
+#endif
+
+/**
+ * Format a record's arguments with its format string
+ *
+ * @param fmt  Format of the call site
+ * @param args Encoded arguments
+ * @param size Bytes of args used
+ * @param out  Output buffer (always terminated)
+ * @return length written
+ */
+static inline size_t binlog_format(const char *fmt, const uint8_t *args, size_t size, char *out, size_t out_size)
+{
+    size_t pos = 0;
+    size_t used = 0;
+
+    while (*fmt && pos + 1 < out_size)
+    {
+        char spec[32];
+        size_t n = 0;
+        int written = 0;
+
+        if (*fmt != '%')
+        {
+            out[pos++] = *fmt++;
+            continue;
+        }
+        if (fmt[1] == '%')
+        {
+            out[pos++] = '%';
+            fmt += 2;
+            continue;
+        }
+
+        // Flags, width and precision are kept; length modifiers are replaced
+        spec[n++] = *fmt++;
+        while (*fmt && strchr("-+ #0123456789.", *fmt) && n < sizeof(spec) - 4)
+        {
+            spec[n++] = *fmt++;
+        }
+        while (*fmt && strchr("hlLqjzt", *fmt))
+        {
+            fmt++;
+        }
+        if (!*fmt)
+        {
+            break;
+        }
+
+        switch (*fmt)
+        {
+        case 'd':
+        case 'i':
+        case 'u':
+        case 'x':
+        case 'X':
+        case 'o':
+        case 'c':
+        case 'p':
+        {
+            int64_t v = 0;
+            char conv = *fmt == 'p' ? 'x' : *fmt;
+
+            if (used + sizeof(v) <= size)
+            {
+                memcpy(&v, args + used, sizeof(v));
+                used += sizeof(v);
+            }
+            if (conv == 'c')
+            {
+                spec[n++] = 'c';
+                spec[n] = '\0';
+                written = snprintf(out + pos, out_size - pos, spec, (int)v);
+            }
+            else
+            {
+                spec[n++] = 'l';
+                spec[n++] = 'l';
+                spec[n++] = conv;
+                spec[n] = '\0';
+                written = snprintf(out + pos, out_size - pos, spec, (long long)v);
+            }
+            break;
+        }
+        case 'f':
+        case 'F':
+        case 'e':
+        case 'E':
+        case 'g':
+        case 'G':
+        {
+            double v = 0.0;
+
+            if (used + sizeof(v) <= size)
+            {
+                memcpy(&v, args + used, sizeof(v));
+                used += sizeof(v);
+            }
+            spec[n++] = *fmt;
+            spec[n] = '\0';
+            written = snprintf(out + pos, out_size - pos, spec, v);
+            break;
+        }
+        case 's':
+        {
+            char text[BINLOG_ARGS_SIZE];
+            size_t len = 0;
+
+            if (used < size)
+            {
+                len = args[used];
+                if (used + 1 + len > size)
+                {
+                    len = size - used - 1;
+                }
+                memcpy(text, args + used + 1, len);
+                used += 1 + len;
+            }
+            text[len] = '\0';
+            spec[n++] = 's';
+            spec[n] = '\0';
+            written = snprintf(out + pos, out_size - pos, spec, text);
+            break;
+        }
+        default:
+            break;
+        }
+        fmt++;
+        if (written > 0)
+        {
+            pos += (size_t)written < out_size - pos ? (size_t)written : out_size - pos - 1;
+        }
+    }
+    out[pos] = '\0';
+    return pos;
+}
+
+// Key destructor, run by an exiting thread that has logged: give up its ring
+static inline void binlog_ring_retire(void *arg)
+{
+    binlog_ring_t *ring = arg;
+
+    tl_binlog_ring = NULL;
+    atomic_store_explicit(&ring->state, BINLOG_RING_RETIRED, memory_order_release);
+}
+
+static inline binlog_ring_t *binlog_ring_self(void)
+{
+    binlog_ring_t *ring;
+    int count = atomic_load(&g_binlog.ring_count);
+    int index;
+
+    if (tl_binlog_ring)
+    {
+        return tl_binlog_ring;
+    }
+
+    // Take over the ring of an exited thread once the background thread has emptied it.
+    // Its owner no longer writes, so the ring keeps a single producer.
+    for (index = 0; index < count && index < BINLOG_MAX_THREADS; index++)
+    {
+        int retired = BINLOG_RING_RETIRED;
+
+        ring = g_binlog.rings[index];
+        if (ring && atomic_load_explicit(&ring->state, memory_order_acquire) == BINLOG_RING_RETIRED &&
+            atomic_load_explicit(&ring->head, memory_order_acquire) ==
+                atomic_load_explicit(&ring->tail, memory_order_relaxed) &&
+            atomic_compare_exchange_strong(&ring->state, &retired, BINLOG_RING_ACTIVE))
+        {
+            tl_binlog_ring = ring;
+            pthread_setspecific(g_binlog.ring_key, ring);
+            return ring;
+        }
+    }
+
+    // Claim a new slot. The count stops at BINLOG_MAX_THREADS, however often a thread
+    // without a ring logs; its records are only counted in lost_threads.
+    index = count;
+    do
+    {
+        if (index >= BINLOG_MAX_THREADS)
+        {
+            return NULL;
+        }
+    } while (!atomic_compare_exchange_weak(&g_binlog.ring_count, &index, index + 1));
+    ring = calloc(1, sizeof(*ring));
+    if (!ring)
+    {
+        return NULL;
+    }
+    ring->index = (uint8_t)index;
+    tl_binlog_ring = ring;
+    pthread_setspecific(g_binlog.ring_key, ring);
+    // Published last: the background thread picks the ring up on its next pass
+    g_binlog.rings[index] = ring;
+    return ring;
+}
+
+/**
+ * Reserve a record for a call site (used by the LOG_* macros)
+ *
+ * @return the record to fill, or NULL if it was dropped
+ */
+static inline binlog_record_t *binlog_begin(const binlog_site_t *site)
+{
+    binlog_ring_t *ring;
+    binlog_record_t *rec;
+    uint32_t tail;
+
+    if (!atomic_load_explicit(&g_binlog.running, memory_order_acquire))
+    {
+        return &tl_binlog_scratch;
+    }
+    ring = binlog_ring_self();
+    if (!ring)
+    {
+        atomic_fetch_add_explicit(&g_binlog.lost_threads, 1, memory_order_relaxed);
+        return NULL;
+    }
+    tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    if (tail - atomic_load_explicit(&ring->head, memory_order_acquire) >= BINLOG_RING_RECORDS)
+    {
+        atomic_fetch_add_explicit(&ring->dropped, 1, memory_order_relaxed);
+        return NULL;
+    }
+    rec = &ring->records[tail & (BINLOG_RING_RECORDS - 1)];
+    rec->t_ns = mono_time_ns();
+    rec->site = (uint16_t)(site - __start_binlog_sites);
+    rec->thread = ring->index;
+    return rec;
+}
+
+static inline void binlog_commit(binlog_record_t *rec, const binlog_site_t *site, uint8_t size)
+{
+    rec->size = size;
+    if (rec == &tl_binlog_scratch)
+    {
+        char line[BINLOG_LINE_MAX];
+
+        binlog_format(site->fmt, rec->args, size, line, sizeof(line));
+        puts(line);
+        return;
+    }
+    atomic_store_explicit(&tl_binlog_ring->tail, atomic_load_explicit(&tl_binlog_ring->tail, memory_order_relaxed) + 1,
+                          memory_order_release);
+}
+
+// Write one drained record
+static inline void binlog_emit(const binlog_record_t *rec)
+{
+    if (g_binlog.out)
+    {
+        fwrite(rec, sizeof(*rec), 1, g_binlog.out);
+    }
+    else
+    {
+        char line[BINLOG_LINE_MAX];
+
+        binlog_format(__start_binlog_sites[rec->site].fmt, rec->args, rec->size, line, sizeof(line));
+        puts(line);
+    }
+}
+
+/**
+ * Drain every ring, oldest record first
+ */
+static inline void binlog_drain(void)
+{
+    uint32_t tails[BINLOG_MAX_THREADS];
+    uint32_t dropped = 0;
+    int count = atomic_load(&g_binlog.ring_count);
+    int i;
+
+    if (count > BINLOG_MAX_THREADS)
+    {
+        count = BINLOG_MAX_THREADS;
+    }
+    for (i = 0; i < count; i++)
+    {
+        binlog_ring_t *ring = g_binlog.rings[i];
+
+        tails[i] = ring ? atomic_load_explicit(&ring->tail, memory_order_acquire) : 0;
+        dropped += ring ? atomic_load_explicit(&ring->dropped, memory_order_relaxed) : 0;
+    }
+
+    // Merge the rings by timestamp up to the tails seen above
+    while (1)
+    {
+        binlog_ring_t *oldest = NULL;
+        uint64_t oldest_ns = UINT64_MAX;
+
+        for (i = 0; i < count; i++)
+        {
+            binlog_ring_t *ring = g_binlog.rings[i];
+            uint32_t head;
+
+            if (!ring || (head = atomic_load_explicit(&ring->head, memory_order_relaxed)) == tails[i])
+            {
+                continue;
+            }
+            if (ring->records[head & (BINLOG_RING_RECORDS - 1)].t_ns < oldest_ns)
+            {
+                oldest = ring;
+                oldest_ns = ring->records[head & (BINLOG_RING_RECORDS - 1)].t_ns;
+            }
+        }
+        if (!oldest)
+        {
+            break;
+        }
+        uint32_t head = atomic_load_explicit(&oldest->head, memory_order_relaxed);
+        binlog_emit(&oldest->records[head & (BINLOG_RING_RECORDS - 1)]);
+        atomic_store_explicit(&oldest->head, head + 1, memory_order_release);
+    }
+
+    dropped += atomic_load_explicit(&g_binlog.lost_threads, memory_order_relaxed);
+    if (dropped != g_binlog.dropped_reported && !g_binlog.out)
+    {
+        printf("[LOG] %u records dropped (ring full)\n", dropped - g_binlog.dropped_reported);
+    }
+    g_binlog.dropped_reported = dropped;
+    fflush(g_binlog.out ? g_binlog.out : stdout);
+}
+
+static inline void *binlog_thread(void *arg)
+{
+    (void)arg;
+    while (atomic_load(&g_binlog.running))
+    {
+        usleep(BINLOG_FLUSH_MS * 1000);
+        binlog_drain();
+    }
+    return NULL;
+}
+
+// Write the header and call-site table of a log file
+static inline int binlog_write_header(FILE *out)
+{
+    binlog_file_t header;
+    struct timespec ts;
+    size_t count = __start_binlog_sites ? (size_t)(__stop_binlog_sites - __start_binlog_sites) : 0;
+    size_t i;
+
+    clock_gettime(CLOCK_REALTIME, &ts);
+    memset(&header, 0, sizeof(header));
+    header.magic = BINLOG_MAGIC;
+    header.version = BINLOG_VERSION;
+    header.site_count = (uint16_t)count;
+    header.mono_start_ns = mono_time_ns();
+    header.wall_start_ns = (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+    if (fwrite(&header, sizeof(header), 1, out) != 1)
+    {
+        return -1;
+    }
+
+    for (i = 0; i < count; i++)
+    {
+        const binlog_site_t *site = &__start_binlog_sites[i];
+        binlog_file_site_t entry;
+
+        memset(&entry, 0, sizeof(entry));
+        entry.line = site->line;
+        entry.level = site->level;
+        entry.fmt_len = (uint16_t)strlen(site->fmt);
+        entry.file_len = (uint16_t)strlen(site->file);
+        if (fwrite(&entry, sizeof(entry), 1, out) != 1 || fwrite(site->fmt, entry.fmt_len, 1, out) > 1 ||
+            fwrite(site->file, entry.file_len, 1, out) > 1)
+        {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Start the background writer (call once, after the thread policies are loaded)
+ *
+ * @param path Binary log file for log_decode, or NULL to print formatted records
+ * @return 0 on success, -1 on error (errno set; logging stays synchronous)
+ */
+static inline int binlog_init(const char *path)
+{
+    int rc;
+
+    if (path)
+    {
+        g_binlog.out = fopen(path, "wb");
+        if (!g_binlog.out || binlog_write_header(g_binlog.out) != 0)
+        {
+            if (g_binlog.out)
+            {
+                fclose(g_binlog.out);
+                g_binlog.out = NULL;
+            }
+            return -1;
+        }
+    }
+    rc = pthread_key_create(&g_binlog.ring_key, binlog_ring_retire);
+    if (rc != 0)
+    {
+        if (g_binlog.out)
+        {
+            fclose(g_binlog.out);
+            g_binlog.out = NULL;
+        }
+        errno = rc;
+        return -1;
+    }
+    atomic_store(&g_binlog.running, 1);
+    rc = thread_policy_create(THREAD_CLASS_LOGGING, &g_binlog.thread, binlog_thread, NULL);
+    if (rc != 0)
+    {
+        atomic_store(&g_binlog.running, 0);
+        errno = rc;
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * Stop the background writer and write out what is left
+ *
+ * Records logged concurrently with the shutdown may be lost.
+ */
+static inline void binlog_shutdown(void)
+{
+    if (!atomic_exchange(&g_binlog.running, 0))
+    {
+        return;
+    }
+    pthread_join(g_binlog.thread, NULL);
+    binlog_drain();
+    if (g_binlog.out)
+    {
+        fclose(g_binlog.out);
+        g_binlog.out = NULL;
+    }
+}
+
+#endif // BINLOG_H
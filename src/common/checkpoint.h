@@ -0,0 +1,273 @@
+/*
+ * checkpoint.h - Periodic state snapshots in a memory-mapped file
+ *
+ * The file holds two slots. A save fills the older slot, checksums it and
+ * then publishes it by writing its sequence number last, so a crash in the
+ * middle of a save leaves the previous snapshot intact. The stores go straight
+ * into the page cache through the mapping: they survive a crash or kill of the
+ * process at once, and msync() (MS_ASYNC) pushes them to the disk without
+ * waiting for it.
+ *
+ *     checkpoint_file_t  magic, version, slot size
+ *     checkpoint_slot_t  sequence, checksum, save times, payload (x2)
+ *
+ * checkpoint_load() reads the newest valid snapshot of an existing file at
+ * start-up (whatever its slot size was); checkpoint_open() then maps the file
+ * for the current payload size, keeping the loaded snapshot until the first
+ * save replaces the other slot (a file of another layout is cleared).
+ */
+
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#define CHECKPOINT_MAGIC 0x54504b43u // "CKPT"
+#define CHECKPOINT_VERSION 2 // Bump with any payload layout change: other versions are discarded
+#define CHECKPOINT_SLOTS 2
+
+typedef struct
+{
+    uint32_t magic;
+    uint16_t version;
+    uint16_t reserved;
+    uint32_t slot_size;  // Bytes of payload per slot
+    uint32_t reserved2;
+} checkpoint_file_t;
+
+typedef struct
+{
+    uint64_t sequence;   // 0 = never written; written last
+    uint32_t size;       // Payload bytes
+    uint32_t checksum;   // FNV-1a of the payload
+    int64_t wall_ms;     // Wall-clock time of the save
+    uint64_t mono_ms;    // Monotonic time of the save
+} checkpoint_slot_t;
+
+typedef struct
+{
+    int fd;
+    uint8_t *map;
+    size_t map_size;
+    uint32_t slot_size;
+    uint64_t sequence;   // Of the newest published slot
+    uint32_t saves;
+} checkpoint_t;
+
+typedef struct
+{
+    uint64_t sequence;
+    int64_t wall_ms;
+    uint64_t mono_ms;
+    uint32_t size;
+} checkpoint_info_t;
+
+static inline uint32_t checkpoint_checksum(const void *data, size_t size)
+{
+    const uint8_t *p = data;
+    uint32_t hash = 2166136261u;
+    size_t i;
+
+    for (i = 0; i < size; i++)
+    {
+        hash = (hash ^ p[i]) * 16777619u;
+    }
+    return hash;
+}
+
+static inline int64_t checkpoint_wall_ms(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static inline size_t checkpoint_slot_offset(uint32_t slot_size, int slot)
+{
+    return sizeof(checkpoint_file_t) + (size_t)slot * (sizeof(checkpoint_slot_t) + slot_size);
+}
+
+/**
+ * Read the newest valid snapshot of a checkpoint file
+ *
+ * @param path Checkpoint file
+ * @param buf  Receives the payload
+ * @param max  Size of buf (a larger payload is treated as invalid)
+ * @param info Sequence, save times and size of the snapshot
+ * @return 0 on success, -1 if there is no file or no valid snapshot
+ */
+static inline int checkpoint_load(const char *path, void *buf, size_t max, checkpoint_info_t *info)
+{
+    checkpoint_file_t header;
+    checkpoint_slot_t slot;
+    int fd = open(path, O_RDONLY);
+    int best = -1;
+    int i;
+
+    if (fd == -1)
+    {
+        return -1;
+    }
+    if (pread(fd, &header, sizeof(header), 0) != (ssize_t)sizeof(header) || header.magic != CHECKPOINT_MAGIC ||
+        header.version != CHECKPOINT_VERSION || header.slot_size > max)
+    {
+        close(fd);
+        return -1;
+    }
+
+    memset(info, 0, sizeof(*info));
+    for (i = 0; i < CHECKPOINT_SLOTS; i++)
+    {
+        off_t offset = (off_t)checkpoint_slot_offset(header.slot_size, i);
+
+        if (pread(fd, &slot, sizeof(slot), offset) != (ssize_t)sizeof(slot) || slot.sequence == 0 ||
+            slot.sequence <= info->sequence || slot.size > header.slot_size)
+        {
+            continue;
+        }
+        // Read into buf, keep it only if it checks out (the other slot may be better)
+        if (pread(fd, buf, slot.size, offset + (off_t)sizeof(slot)) != (ssize_t)slot.size ||
+            checkpoint_checksum(buf, slot.size) != slot.checksum)
+        {
+            continue;
+        }
+        info->sequence = slot.sequence;
+        info->wall_ms = slot.wall_ms;
+        info->mono_ms = slot.mono_ms;
+        info->size = slot.size;
+        best = i;
+    }
+    // If slot 1 won, buf holds it; if slot 0 won but slot 1 failed its check, re-read slot 0
+    if (best == 0)
+    {
+        pread(fd, buf, info->size, (off_t)checkpoint_slot_offset(header.slot_size, 0) + (off_t)sizeof(slot));
+    }
+    close(fd);
+    return best == -1 ? -1 : 0;
+}
+
+/**
+ * Create or reuse a checkpoint file and map it
+ *
+ * @param cp         Checkpoint
+ * @param path       File
+ * @param slot_size  Payload bytes per snapshot
+ * @return 0 on success, -1 on error (errno set)
+ */
+static inline int checkpoint_open(checkpoint_t *cp, const char *path, uint32_t slot_size)
+{
+    checkpoint_file_t *header;
+    checkpoint_file_t existing;
+    int i;
+
+    memset(cp, 0, sizeof(*cp));
+    cp->fd = open(path, O_RDWR | O_CREAT, 0644);
+    if (cp->fd == -1)
+    {
+        return -1;
+    }
+    cp->slot_size = slot_size;
+    cp->map_size = checkpoint_slot_offset(slot_size, CHECKPOINT_SLOTS);
+
+    // Another layout (or no file yet): start from an empty file
+    if (pread(cp->fd, &existing, sizeof(existing), 0) != (ssize_t)sizeof(existing) ||
+        existing.magic != CHECKPOINT_MAGIC || existing.version != CHECKPOINT_VERSION ||
+        existing.slot_size != slot_size)
+    {
+        if (ftruncate(cp->fd, 0) != 0)
+        {
+            close(cp->fd);
+            return -1;
+        }
+    }
+    if (ftruncate(cp->fd, (off_t)cp->map_size) != 0)
+    {
+        close(cp->fd);
+        return -1;
+    }
+    cp->map = mmap(NULL, cp->map_size, PROT_READ | PROT_WRITE, MAP_SHARED, cp->fd, 0);
+    if (cp->map == MAP_FAILED)
+    {
+        cp->map = NULL;
+        close(cp->fd);
+        return -1;
+    }
+
+    header = (checkpoint_file_t *)cp->map;
+    header->magic = CHECKPOINT_MAGIC;
+    header->version = CHECKPOINT_VERSION;
+    header->slot_size = slot_size;
+
+    // Numbering continues after the newest slot, so the first save replaces the older one
+    for (i = 0; i < CHECKPOINT_SLOTS; i++)
+    {
+        const checkpoint_slot_t *s = (const checkpoint_slot_t *)(cp->map + checkpoint_slot_offset(slot_size, i));
+
+        if (s->sequence > cp->sequence)
+        {
+            cp->sequence = s->sequence;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Payload area of the slot the next save goes to (fill it, then checkpoint_commit())
+ */
+static inline void *checkpoint_begin(checkpoint_t *cp)
+{
+    int slot = (int)((cp->sequence + 1) % CHECKPOINT_SLOTS);
+    checkpoint_slot_t *s = (checkpoint_slot_t *)(cp->map + checkpoint_slot_offset(cp->slot_size, slot));
+
+    s->sequence = 0; // Invalid while it is being rewritten
+    __sync_synchronize();
+    return (uint8_t *)s + sizeof(*s);
+}
+
+/**
+ * Publish the slot filled after checkpoint_begin()
+ *
+ * @param size    Payload bytes used
+ * @param mono_ms Monotonic time of the snapshot
+ */
+static inline void checkpoint_commit(checkpoint_t *cp, uint32_t size, uint64_t mono_ms)
+{
+    int slot = (int)((cp->sequence + 1) % CHECKPOINT_SLOTS);
+    size_t offset = checkpoint_slot_offset(cp->slot_size, slot);
+    checkpoint_slot_t *s = (checkpoint_slot_t *)(cp->map + offset);
+
+    s->size = size;
+    s->checksum = checkpoint_checksum((uint8_t *)s + sizeof(*s), size);
+    s->wall_ms = checkpoint_wall_ms();
+    s->mono_ms = mono_ms;
+    __sync_synchronize();
+    s->sequence = ++cp->sequence;
+    cp->saves++;
+
+    // Start write-back of the slot's pages without waiting for it
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    size_t start = offset & ~(page - 1);
+    msync(cp->map + start, offset + sizeof(*s) + size - start, MS_ASYNC);
+}
+
+static inline void checkpoint_close(checkpoint_t *cp)
+{
+    if (cp->map)
+    {
+        msync(cp->map, cp->map_size, MS_SYNC);
+        munmap(cp->map, cp->map_size);
+        close(cp->fd);
+        cp->map = NULL;
+    }
+}
+
+#endif // CHECKPOINT_H
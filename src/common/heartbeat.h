@@ -0,0 +1,98 @@
+/*
+ * heartbeat.h - Liveness pulses to the supervisor
+ *
+ * Every supervised process calls heartbeat_start() once its channel is
+ * attached. A thread then sends a pulse to the "supervisor" channel every
+ * HEARTBEAT_INTERVAL_MS carrying the process ID, so the supervisor can tell a
+ * hung process (no pulse within its deadline) from a healthy one. The first
+ * pulse also tells it that the process is ready to receive messages.
+ *
+ * A process whose work happens in one loop can pass a progress timestamp that
+ * the loop updates: the pulses stop when it has not moved for stall_ms, and
+ * the supervisor restarts the process as if it had hung completely.
+ *
+ * Without a supervisor the thread just retries the connection now and then.
+ */
+
+#ifndef HEARTBEAT_H
+#define HEARTBEAT_H
+
+#include <pthread.h>
+#include <stdint.h>
+#include <sys/dispatch.h>
+#include <sys/neutrino.h>
+#include <unistd.h>
+
+#include "mono_time.h"
+#include "thread_policy.h"
+
+#define SUPERVISOR_NAME "supervisor"
+#define HEARTBEAT_INTERVAL_MS 50      // Pulse period
+#define HEARTBEAT_CONNECT_RETRY_MS 1000 // Connection attempts while no supervisor runs
+
+#define HEARTBEAT_PULSE_CODE (_PULSE_CODE_MINAVAIL + 1) // value = sender's pid
+
+typedef struct
+{
+    const volatile uint64_t *progress_ms; // Monotonic time of the last unit of work, or NULL
+    uint32_t stall_ms;                    // Stop beating when progress is older than this
+} heartbeat_t;
+
+static heartbeat_t g_heartbeat;
+
+static inline void *heartbeat_thread(void *arg)
+{
+    int coid = -1;
+    uint64_t next_connect = 0;
+
+    (void)arg;
+    while (1)
+    {
+        uint64_t now = mono_time_ms();
+
+        if (coid == -1 && now >= next_connect)
+        {
+            coid = name_open(SUPERVISOR_NAME, 0);
+            next_connect = now + HEARTBEAT_CONNECT_RETRY_MS;
+        }
+        if (coid != -1 &&
+            (!g_heartbeat.progress_ms || *g_heartbeat.progress_ms + g_heartbeat.stall_ms >= now))
+        {
+            if (MsgSendPulse(coid, -1, HEARTBEAT_PULSE_CODE, (int)getpid()) == -1)
+            {
+                // Supervisor gone (or restarted): reconnect
+                name_close(coid);
+                coid = -1;
+                next_connect = 0;
+            }
+        }
+        usleep(HEARTBEAT_INTERVAL_MS * 1000);
+    }
+    return NULL;
+}
+
+/**
+ * Start sending heartbeats
+ *
+ * @param progress_ms Monotonic time of the process's last unit of work (NULL = always beat)
+ * @param stall_ms    How old progress_ms may get before the heartbeats stop
+ * @return 0 on success, an error number otherwise
+ */
+static inline int heartbeat_start(const volatile uint64_t *progress_ms, uint32_t stall_ms)
+{
+    pthread_t thread;
+    int rc;
+
+    g_heartbeat.progress_ms = progress_ms;
+    g_heartbeat.stall_ms = stall_ms;
+
+    // Beats must get through while the process is busy, so they run at IPC priority
+    rc = thread_policy_create(THREAD_CLASS_IPC, &thread, heartbeat_thread, NULL);
+    if (rc == 0)
+    {
+        pthread_detach(thread);
+    }
+    return rc;
+}
+
+#endif // HEARTBEAT_H
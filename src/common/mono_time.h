@@ -0,0 +1,32 @@
+/*
+ * mono_time.h - Monotonic time helpers
+ *
+ * Wall-clock time (time(NULL)) can jump when the clock is set, so every
+ * interval, dwell and age calculation uses CLOCK_MONOTONIC instead.
+ */
+
+#ifndef MONO_TIME_H
+#define MONO_TIME_H
+
+#include <stdint.h>
+#include <time.h>
+
+/**
+ * Current monotonic time in nanoseconds
+ */
+static inline uint64_t mono_time_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+/**
+ * Current monotonic time in milliseconds
+ */
+static inline uint64_t mono_time_ms(void)
+{
+    return mono_time_ns() / 1000000ULL;
+}
+
+#endif // MONO_TIME_H
@@ -0,0 +1,302 @@
+/*
+ * recv_pool.h - Receive thread pool with low and high water marks
+ *
+ * A server channel is serviced by a pool of threads that all block in
+ * MsgReceive() on it, so a slow handler (a file write, a large snapshot)
+ * delays only the client it is serving. The pool follows the model of QNX
+ * thread_pool_create(), reduced to a plain channel so it runs on the host
+ * build as well:
+ *
+ *     lo_water   threads kept blocked in MsgReceive(); when a message leaves
+ *                fewer waiting, increment more are created
+ *     hi_water   threads allowed to wait; a thread that finishes a message
+ *                while this many are waiting exits
+ *     increment  threads created at a time
+ *     maximum    threads in the pool, busy or waiting
+ *
+ * The marks of a server can be set in the config file:
+ *
+ *     recv_pool_event_logger = 1 4 1 16   # lo_water hi_water increment maximum
+ *
+ * Handlers run concurrently. Every client blocks in MsgSend() until its
+ * reply, so the messages of one client thread are still handled in the order
+ * they were sent as long as a handler replies only when it is done with the
+ * resource it orders (e.g. after appending to a log file).
+ */
+
+#ifndef RECV_POOL_H
+#define RECV_POOL_H
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/neutrino.h>
+
+#include "thread_policy.h"
+
+#define RECV_POOL_MAX 64
+
+typedef struct
+{
+    uint32_t lo_water;
+    uint32_t hi_water;
+    uint32_t increment;
+    uint32_t maximum;
+} recv_pool_attr_t;
+
+/**
+ * Handle one message or pulse (rcvid 0); the handler replies to messages itself
+ */
+typedef void (*recv_pool_handler_t)(int rcvid, void *msg, const struct _msg_info *info, void *arg);
+
+typedef struct
+{
+    const char *name;
+    int chid;
+    size_t msg_size;             // Receive buffer per thread
+    thread_class_t cls;          // Policy of the pool's threads
+    recv_pool_handler_t handler;
+    void *arg;
+    recv_pool_attr_t attr;
+
+    pthread_mutex_t lock;
+    pthread_cond_t done;         // Signalled when the last thread exits
+    uint32_t threads;            // Alive, busy or waiting
+    uint32_t waiting;            // Blocked in MsgReceive()
+    uint32_t peak;               // Most threads alive at once
+    uint32_t created;
+    uint32_t retired;            // Exited above hi_water
+} recv_pool_t;
+
+/**
+ * Parse "lo_water hi_water increment maximum"
+ *
+ * @return 0 on success, -1 on a syntax error or marks out of order
+ */
+static inline int recv_pool_parse(const char *text, recv_pool_attr_t *out)
+{
+    recv_pool_attr_t attr;
+    char extra;
+
+    if (sscanf(text, " %u %u %u %u %c", &attr.lo_water, &attr.hi_water, &attr.increment, &attr.maximum,
+               &extra) != 4)
+    {
+        return -1;
+    }
+    if (attr.lo_water < 1 || attr.hi_water < attr.lo_water || attr.maximum < attr.hi_water ||
+        attr.increment < 1 || attr.maximum > RECV_POOL_MAX)
+    {
+        return -1;
+    }
+    *out = attr;
+    return 0;
+}
+
+/**
+ * Read the "recv_pool_<name>" line of a config file into attr
+ *
+ * @return 1 if set, 0 if the file or line is missing (attr unchanged), -1 on a bad line
+ */
+static inline int recv_pool_load(const char *path, const char *name, recv_pool_attr_t *attr)
+{
+    FILE *file = fopen(path, "r");
+    char line[256];
+    int line_no = 0;
+    int rc = 0;
+
+    if (!file)
+    {
+        return 0;
+    }
+
+    while (fgets(line, sizeof(line), file))
+    {
+        char *comment = strchr(line, '#');
+        char *eq;
+        char key[32];
+
+        line_no++;
+        if (comment)
+        {
+            *comment = '\0';
+        }
+        // Other keys belong to runtime_config.h, thread_policy.h or another server
+        if (sscanf(line, " recv_pool_%31[a-z_] =", key) != 1 || strcmp(key, name) != 0 ||
+            (eq = strchr(line, '=')) == NULL)
+        {
+            continue;
+        }
+        if (recv_pool_parse(eq + 1, attr) != 0)
+        {
+            printf("[RECV_POOL] %s:%d: bad pool, expected lo_water hi_water increment maximum\n", path,
+                   line_no);
+            rc = -1;
+            break;
+        }
+        rc = 1;
+    }
+    fclose(file);
+    return rc;
+}
+
+static inline void *recv_pool_thread(void *arg);
+
+/**
+ * Create one thread (pool lock held)
+ *
+ * @return 0 on success, -1 if the thread could not be created
+ */
+static inline int recv_pool_spawn(recv_pool_t *pool)
+{
+    pthread_t thread;
+
+    pool->threads++;
+    if (thread_policy_create(pool->cls, &thread, recv_pool_thread, pool) != 0)
+    {
+        pool->threads--;
+        return -1;
+    }
+    pthread_detach(thread);
+    pool->created++;
+    if (pool->threads > pool->peak)
+    {
+        pool->peak = pool->threads;
+    }
+    return 0;
+}
+
+/**
+ * Create up to increment threads, never more than maximum (pool lock held)
+ */
+static inline void recv_pool_grow(recv_pool_t *pool)
+{
+    uint32_t n;
+
+    for (n = 0; n < pool->attr.increment && pool->threads < pool->attr.maximum; n++)
+    {
+        if (recv_pool_spawn(pool) != 0)
+        {
+            break;
+        }
+    }
+}
+
+static inline void *recv_pool_thread(void *arg)
+{
+    recv_pool_t *pool = arg;
+    void *msg = malloc(pool->msg_size);
+    struct _msg_info info;
+    int rcvid;
+
+    pthread_mutex_lock(&pool->lock);
+    while (msg)
+    {
+        pool->waiting++;
+        pthread_mutex_unlock(&pool->lock);
+
+        rcvid = MsgReceive(pool->chid, msg, pool->msg_size, &info);
+
+        pthread_mutex_lock(&pool->lock);
+        pool->waiting--;
+        if (rcvid == -1 && errno != EINTR)
+        {
+            fprintf(stderr, "[RECV_POOL] %s: MsgReceive: %s\n", pool->name, strerror(errno));
+            break;
+        }
+        // Keep lo_water threads receiving while this one handles the message
+        if (pool->waiting < pool->attr.lo_water)
+        {
+            recv_pool_grow(pool);
+        }
+        pthread_mutex_unlock(&pool->lock);
+
+        if (rcvid != -1)
+        {
+            pool->handler(rcvid, msg, &info, pool->arg);
+        }
+
+        pthread_mutex_lock(&pool->lock);
+        if (pool->waiting >= pool->attr.hi_water)
+        {
+            pool->retired++;
+            break;
+        }
+    }
+    if (--pool->threads == 0)
+    {
+        pthread_cond_broadcast(&pool->done);
+    }
+    pthread_mutex_unlock(&pool->lock);
+    free(msg);
+    return NULL;
+}
+
+/**
+ * Initialise a pool; the marks can then be changed with recv_pool_load()
+ *
+ * @param name     Server name (config key "recv_pool_<name>", messages)
+ * @param chid     Channel to receive on
+ * @param msg_size Largest message the handler accepts
+ * @param cls      Thread class of the pool's threads
+ */
+static inline void recv_pool_init(recv_pool_t *pool, const char *name, int chid, size_t msg_size,
+                                  thread_class_t cls, recv_pool_handler_t handler, void *arg,
+                                  const recv_pool_attr_t *attr)
+{
+    memset(pool, 0, sizeof(*pool));
+    pool->name = name;
+    pool->chid = chid;
+    pool->msg_size = msg_size;
+    pool->cls = cls;
+    pool->handler = handler;
+    pool->arg = arg;
+    pool->attr = *attr;
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->done, NULL);
+}
+
+/**
+ * Start lo_water threads
+ *
+ * @return 0 on success, -1 if no thread could be created
+ */
+static inline int recv_pool_start(recv_pool_t *pool)
+{
+    int rc = 0;
+
+    pthread_mutex_lock(&pool->lock);
+    while (rc == 0 && pool->threads < pool->attr.lo_water)
+    {
+        rc = recv_pool_spawn(pool);
+    }
+    rc = pool->threads > 0 ? 0 : -1;
+    pthread_mutex_unlock(&pool->lock);
+    return rc;
+}
+
+/**
+ * Block until every thread of the pool has exited (the channel failed)
+ */
+static inline void recv_pool_wait(recv_pool_t *pool)
+{
+    pthread_mutex_lock(&pool->lock);
+    while (pool->threads > 0)
+    {
+        pthread_cond_wait(&pool->done, &pool->lock);
+    }
+    pthread_mutex_unlock(&pool->lock);
+}
+
+/**
+ * Print the marks, e.g. "[RECV_POOL] stats_update: lo_water 2 hi_water 4 increment 1 maximum 16"
+ */
+static inline void recv_pool_print(const recv_pool_t *pool)
+{
+    printf("[RECV_POOL] %s: lo_water %u hi_water %u increment %u maximum %u\n", pool->name,
+           pool->attr.lo_water, pool->attr.hi_water, pool->attr.increment, pool->attr.maximum);
+}
+
+#endif // RECV_POOL_H
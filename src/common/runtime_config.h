@@ -0,0 +1,461 @@
+/*
+ * runtime_config.h - Hot-reloadable threshold configuration
+ *
+ * The active threshold_config_t is published through a single atomic pointer.
+ * Readers never take a lock: they bracket their use of the config with
+ * config_read_begin()/config_read_end(), which only bump a per-thread counter.
+ *
+ * A reload parses the file into a fresh copy, validates it and swaps the
+ * pointer (RCU-style). The old copy is freed once every registered reader has
+ * either been outside a read section or has passed through one since the swap,
+ * so nobody can still be looking at it.
+ *
+ * File format: one "key = value" per line, '#' starts a comment. Keys are the
+ * threshold_config_t field names; missing keys keep their default value.
+ * "sensor" lines declare sensor instances and are left to sensor_registry.h,
+ * "thread_<class>" lines to thread_policy.h.
+ */
+
+#ifndef RUNTIME_CONFIG_H
+#define RUNTIME_CONFIG_H
+
+#include <ctype.h>
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "../analysis/burst_filter.h"
+#include "../msg_def.h"
+
+#define CONFIG_MAX_READERS 32 // Threads that may read the config
+#define CONFIG_MAX_RETIRED 8  // Old configs waiting for their grace period
+
+typedef enum
+{
+    CONFIG_FIELD_INT,
+    CONFIG_FIELD_U8,
+    CONFIG_FIELD_U16,
+    CONFIG_FIELD_U32,
+    CONFIG_FIELD_FLOAT
+} config_field_type_t;
+
+typedef struct
+{
+    const char *key;
+    config_field_type_t type;
+    size_t offset;
+} config_field_t;
+
+#define CONFIG_FIELD(name, type) {#name, type, offsetof(threshold_config_t, name)}
+
+static const config_field_t config_fields[] = {
+    CONFIG_FIELD(temp_high_threshold, CONFIG_FIELD_INT),
+    CONFIG_FIELD(temp_low_threshold, CONFIG_FIELD_INT),
+    CONFIG_FIELD(humidity_high_threshold, CONFIG_FIELD_INT),
+    CONFIG_FIELD(humidity_low_threshold, CONFIG_FIELD_INT),
+    CONFIG_FIELD(door_closed_dist_cm, CONFIG_FIELD_U16),
+    CONFIG_FIELD(temp_hysteresis, CONFIG_FIELD_INT),
+    CONFIG_FIELD(door_hysteresis_cm, CONFIG_FIELD_U16),
+    CONFIG_FIELD(temp_dwell_ms, CONFIG_FIELD_U32),
+    CONFIG_FIELD(gas_dwell_ms, CONFIG_FIELD_U32),
+    CONFIG_FIELD(motion_dwell_ms, CONFIG_FIELD_U32),
+    CONFIG_FIELD(door_dwell_ms, CONFIG_FIELD_U32),
+    CONFIG_FIELD(temp_rise_per_min, CONFIG_FIELD_FLOAT),
+    CONFIG_FIELD(humidity_rise_per_min, CONFIG_FIELD_FLOAT),
+    CONFIG_FIELD(anomaly_z_threshold, CONFIG_FIELD_FLOAT),
+    CONFIG_FIELD(armed, CONFIG_FIELD_U8),
+    CONFIG_FIELD(sensor_fail_threshold, CONFIG_FIELD_U32),
+    CONFIG_FIELD(sensor_backoff_max_ms, CONFIG_FIELD_U32),
+    CONFIG_FIELD(temp_stuck_ms, CONFIG_FIELD_U32),
+    CONFIG_FIELD(pir_stuck_ms, CONFIG_FIELD_U32),
+    CONFIG_FIELD(temp_min_interval_ms, CONFIG_FIELD_U32),
+    CONFIG_FIELD(temp_max_interval_ms, CONFIG_FIELD_U32),
+    CONFIG_FIELD(ultrasonic_min_interval_ms, CONFIG_FIELD_U32),
+    CONFIG_FIELD(ultrasonic_max_interval_ms, CONFIG_FIELD_U32),
+    CONFIG_FIELD(rate_boost_hold_ms, CONFIG_FIELD_U32),
+    CONFIG_FIELD(ultrasonic_burst_count, CONFIG_FIELD_U8),
+    CONFIG_FIELD(ultrasonic_burst_spacing_ms, CONFIG_FIELD_U16),
+    CONFIG_FIELD(ultrasonic_min_confidence, CONFIG_FIELD_U8),
+    CONFIG_FIELD(temp_read_retries, CONFIG_FIELD_U8),
+    CONFIG_FIELD(temp_retry_delay_ms, CONFIG_FIELD_U16),
+    CONFIG_FIELD(temp_stale_ms, CONFIG_FIELD_U32),
+    CONFIG_FIELD(gas_stale_ms, CONFIG_FIELD_U32),
+    CONFIG_FIELD(motion_stale_ms, CONFIG_FIELD_U32),
+    CONFIG_FIELD(ultrasonic_stale_ms, CONFIG_FIELD_U32),
+    CONFIG_FIELD(event_publish_min_ms, CONFIG_FIELD_U32),
+};
+
+typedef struct
+{
+    threshold_config_t *cfg;
+    int readers;                       // Readers registered when it was retired
+    uint64_t seen[CONFIG_MAX_READERS]; // Reader counters when it was retired
+} config_retired_t;
+
+static _Atomic(threshold_config_t *) g_config_ptr;
+static atomic_uint_fast64_t g_config_reader_seq[CONFIG_MAX_READERS];
+static atomic_int g_config_reader_count;
+static config_retired_t g_config_retired[CONFIG_MAX_RETIRED];
+static int g_config_retired_count;
+static uint32_t g_config_generation;
+
+/**
+ * Register the calling thread as a config reader
+ *
+ * @return reader slot, or -1 if all slots are taken
+ */
+static inline int config_reader_register(void)
+{
+    int slot = atomic_fetch_add(&g_config_reader_count, 1);
+    if (slot >= CONFIG_MAX_READERS)
+    {
+        return -1;
+    }
+    return slot;
+}
+
+/**
+ * Enter a read section and return the current config
+ *
+ * The returned pointer stays valid until config_read_end() on the same slot.
+ */
+static inline const threshold_config_t *config_read_begin(int slot)
+{
+    if (slot >= 0)
+    {
+        // Odd counter = inside a read section. Sequentially consistent so the
+        // publisher either sees this increment or we see its new pointer.
+        atomic_fetch_add(&g_config_reader_seq[slot], 1);
+    }
+    return atomic_load(&g_config_ptr);
+}
+
+/**
+ * Leave a read section
+ */
+static inline void config_read_end(int slot)
+{
+    if (slot >= 0)
+    {
+        atomic_fetch_add_explicit(&g_config_reader_seq[slot], 1, memory_order_release);
+    }
+}
+
+/**
+ * Free retired configs whose grace period has elapsed
+ */
+static inline void config_reclaim(void)
+{
+    int i, r;
+
+    for (i = 0; i < g_config_retired_count;)
+    {
+        config_retired_t *old = &g_config_retired[i];
+        int done = 1;
+
+        // Readers registered after the swap can only have seen the new config
+        for (r = 0; r < old->readers; r++)
+        {
+            uint64_t seen = old->seen[r];
+            // Reader was inside a section at retire time and is still in that same section
+            if ((seen & 1) && atomic_load(&g_config_reader_seq[r]) == seen)
+            {
+                done = 0;
+                break;
+            }
+        }
+
+        if (done)
+        {
+            free(old->cfg);
+            g_config_retired[i] = g_config_retired[--g_config_retired_count];
+        }
+        else
+        {
+            i++;
+        }
+    }
+}
+
+/**
+ * Publish a new config (takes ownership of a malloc'd copy)
+ *
+ * Only one thread may publish (the config watcher).
+ *
+ * @return 0 on success, -1 if too many old configs are still in use
+ */
+static inline int config_publish(threshold_config_t *cfg)
+{
+    int r;
+
+    config_reclaim();
+    if (g_config_retired_count == CONFIG_MAX_RETIRED)
+    {
+        return -1;
+    }
+
+    threshold_config_t *old = atomic_exchange(&g_config_ptr, cfg);
+    g_config_generation++;
+    if (old == NULL)
+    {
+        return 0;
+    }
+
+    config_retired_t *slot = &g_config_retired[g_config_retired_count++];
+    int readers = atomic_load(&g_config_reader_count);
+    slot->cfg = old;
+    slot->readers = readers < CONFIG_MAX_READERS ? readers : CONFIG_MAX_READERS;
+    for (r = 0; r < slot->readers; r++)
+    {
+        slot->seen[r] = atomic_load(&g_config_reader_seq[r]);
+    }
+    return 0;
+}
+
+static inline char *config_trim(char *s)
+{
+    char *end;
+
+    while (isspace((unsigned char)*s))
+    {
+        s++;
+    }
+    end = s + strlen(s);
+    while (end > s && isspace((unsigned char)end[-1]))
+    {
+        *--end = '\0';
+    }
+    return s;
+}
+
+static inline int config_set_field(threshold_config_t *cfg, const config_field_t *field, const char *value)
+{
+    char *end;
+    void *dst = (char *)cfg + field->offset;
+
+    if (field->type == CONFIG_FIELD_FLOAT)
+    {
+        float f = strtof(value, &end);
+        if (*end != '\0')
+        {
+            return -1;
+        }
+        *(float *)dst = f;
+        return 0;
+    }
+
+    long v = strtol(value, &end, 0);
+    if (*end != '\0')
+    {
+        return -1;
+    }
+
+    switch (field->type)
+    {
+    case CONFIG_FIELD_INT:
+        *(int *)dst = (int)v;
+        break;
+    case CONFIG_FIELD_U8:
+        if (v < 0 || v > UINT8_MAX)
+            return -1;
+        *(uint8_t *)dst = (uint8_t)v;
+        break;
+    case CONFIG_FIELD_U16:
+        if (v < 0 || v > UINT16_MAX)
+            return -1;
+        *(uint16_t *)dst = (uint16_t)v;
+        break;
+    case CONFIG_FIELD_U32:
+        if (v < 0)
+            return -1;
+        *(uint32_t *)dst = (uint32_t)v;
+        break;
+    default:
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * Check a parsed config for values that make no sense together
+ *
+ * @return 0 if valid, -1 otherwise
+ */
+static inline int config_validate(const threshold_config_t *cfg)
+{
+    if (cfg->temp_low_threshold >= cfg->temp_high_threshold)
+        return -1;
+    if (cfg->humidity_low_threshold >= cfg->humidity_high_threshold)
+        return -1;
+    if (cfg->temp_hysteresis < 0)
+        return -1;
+    if (cfg->sensor_fail_threshold == 0 || cfg->sensor_backoff_max_ms == 0)
+        return -1;
+    if (cfg->temp_min_interval_ms == 0 || cfg->temp_min_interval_ms > cfg->temp_max_interval_ms)
+        return -1;
+    if (cfg->ultrasonic_min_interval_ms == 0 ||
+        cfg->ultrasonic_min_interval_ms > cfg->ultrasonic_max_interval_ms)
+        return -1;
+    if (cfg->ultrasonic_burst_count == 0 || cfg->ultrasonic_burst_count > BURST_MAX_SAMPLES ||
+        cfg->ultrasonic_min_confidence > 100)
+        return -1;
+    // The drivers' floors (ULTRASONIC_MIN_INTERVAL_MS, DHT11_RETRY_MIN_MS)
+    if (cfg->ultrasonic_burst_spacing_ms < 60 || cfg->temp_retry_delay_ms < 100)
+        return -1;
+    if (cfg->temp_stale_ms < cfg->temp_max_interval_ms)
+        return -1;
+    if (cfg->gas_stale_ms == 0 || cfg->motion_stale_ms == 0 ||
+        cfg->ultrasonic_stale_ms < cfg->ultrasonic_max_interval_ms)
+        return -1;
+    if (cfg->anomaly_z_threshold <= 0.0f || cfg->temp_rise_per_min <= 0.0f ||
+        cfg->humidity_rise_per_min <= 0.0f)
+        return -1;
+    return 0;
+}
+
+/**
+ * Parse a config file on top of a set of defaults
+ *
+ * @param path     Config file path
+ * @param defaults Values used for keys not present in the file
+ * @param out      Parsed config
+ * @return 0 on success, -1 if the file cannot be read or contains errors
+ */
+static inline int config_load_file(const char *path, const threshold_config_t *defaults,
+                                   threshold_config_t *out)
+{
+    FILE *file = fopen(path, "r");
+    char line[256];
+    int line_no = 0;
+    int errors = 0;
+    size_t i;
+
+    if (!file)
+    {
+        return -1;
+    }
+
+    *out = *defaults;
+    while (fgets(line, sizeof(line), file))
+    {
+        char *comment = strchr(line, '#');
+        char *eq;
+        char *key, *value;
+        const config_field_t *field = NULL;
+
+        line_no++;
+        if (comment)
+        {
+            *comment = '\0';
+        }
+        key = config_trim(line);
+        if (*key == '\0')
+        {
+            continue;
+        }
+
+        eq = strchr(key, '=');
+        if (!eq)
+        {
+            printf("[CONFIG] %s:%d: expected key = value\n", path, line_no);
+            errors++;
+            continue;
+        }
+        *eq = '\0';
+        key = config_trim(key);
+        value = config_trim(eq + 1);
+        if (strcmp(key, "sensor") == 0)
+        {
+            continue; // Sensor instances are read by sensor_registry.h
+        }
+        if (strncmp(key, "thread_", 7) == 0)
+        {
+            continue; // Thread policies are read by thread_policy.h
+        }
+        if (strncmp(key, "recv_pool_", 10) == 0)
+        {
+            continue; // Receive pools are read by recv_pool.h
+        }
+
+        for (i = 0; i < sizeof(config_fields) / sizeof(config_fields[0]); i++)
+        {
+            if (strcmp(config_fields[i].key, key) == 0)
+            {
+                field = &config_fields[i];
+                break;
+            }
+        }
+        if (!field)
+        {
+            printf("[CONFIG] %s:%d: unknown key '%s'\n", path, line_no, key);
+            errors++;
+            continue;
+        }
+        if (config_set_field(out, field, value) != 0)
+        {
+            printf("[CONFIG] %s:%d: bad value '%s' for %s\n", path, line_no, value, key);
+            errors++;
+        }
+    }
+    fclose(file);
+
+    if (errors == 0 && config_validate(out) != 0)
+    {
+        printf("[CONFIG] %s: inconsistent thresholds\n", path);
+        errors++;
+    }
+    return errors ? -1 : 0;
+}
+
+/**
+ * Load (or reload) the config file and publish it if it is valid
+ *
+ * @param path     Config file path
+ * @param defaults Values used for keys not present in the file
+ * @return 0 if a new config was published, -1 otherwise (old config stays active)
+ */
+static inline int config_reload(const char *path, const threshold_config_t *defaults)
+{
+    threshold_config_t *cfg = malloc(sizeof(*cfg));
+
+    if (!cfg)
+    {
+        return -1;
+    }
+    if (config_load_file(path, defaults, cfg) != 0 || config_publish(cfg) != 0)
+    {
+        free(cfg);
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * Publish the built-in defaults (used when no config file is available)
+ */
+static inline int config_init_defaults(const threshold_config_t *defaults)
+{
+    threshold_config_t *cfg = malloc(sizeof(*cfg));
+
+    if (!cfg)
+    {
+        return -1;
+    }
+    *cfg = *defaults;
+    return config_publish(cfg);
+}
+
+/**
+ * Modification time of the config file (0 if it does not exist)
+ */
+static inline time_t config_file_mtime(const char *path)
+{
+    struct stat st;
+    return stat(path, &st) == 0 ? st.st_mtime : 0;
+}
+
+#endif // RUNTIME_CONFIG_H
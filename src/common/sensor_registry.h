@@ -0,0 +1,273 @@
+/*
+ * sensor_registry.h - Sensor instances declared in the config file
+ *
+ * Every sensor the analyzer polls is an entry in the registry: its type, GPIO
+ * pins, polling period and optional per-sensor thresholds. Instances come from
+ * "sensor" lines in the config file:
+ *
+ *     sensor = dht11      living   pin=4 high=28
+ *     sensor = dht11      bedroom  pin=17
+ *     sensor = pir        hallway  pin=21
+ *     sensor = gas        kitchen  pin=27
+ *     sensor = ultrasonic front    trig=13 echo=25 closed_cm=8
+ *
+ * Options: pin (data pin), trig/echo (ultrasonic), period_ms (polling period;
+ * the idle interval for adaptively sampled sensors), high/low (DHT11
+ * temperature thresholds) and closed_cm (ultrasonic door distance). Anything
+ * not given falls back to the global thresholds.
+ *
+ * Each instance also gets a slot in the storage bank of its type
+ * (sensor_instance_t.slot), so per-type state can live in plain arrays.
+ * The registry is read once at start-up; "sensor" lines are not hot-reloaded.
+ */
+
+#ifndef SENSOR_REGISTRY_H
+#define SENSOR_REGISTRY_H
+
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../msg_def.h"
+
+#define SENSOR_MAX_PER_TYPE 16           // Storage slots per sensor type
+#define SENSOR_THRESHOLD_DEFAULT INT_MIN // Use the global threshold
+
+typedef struct
+{
+    uint8_t type;                // SENSOR_TYPE_*
+    uint8_t id;                  // Index in the registry
+    uint8_t slot;                // Index in the storage bank of its type
+    char name[SENSOR_NAME_LEN];
+    int pin;                     // Data pin (ultrasonic: trigger pin)
+    int pin2;                    // Ultrasonic echo pin
+    uint32_t period_ms;          // Polling period (0 = type default)
+    int threshold_high;          // DHT11: temperature high; ultrasonic: door closed distance
+    int threshold_low;           // DHT11: temperature low
+} sensor_instance_t;
+
+typedef struct
+{
+    sensor_instance_t sensors[SENSOR_MAX_INSTANCES];
+    int count;
+    int type_count[SENSOR_TYPE_COUNT];
+} sensor_registry_t;
+
+static const char *const sensor_type_names[SENSOR_TYPE_COUNT] = {
+    [SENSOR_TYPE_TEMPERATURE] = "dht11",
+    [SENSOR_TYPE_GAS] = "gas",
+    [SENSOR_TYPE_MOTION] = "pir",
+    [SENSOR_TYPE_ULTRASONIC] = "ultrasonic",
+};
+
+/**
+ * Whether a type code has a driver (humidity is read with the DHT11 temperature)
+ */
+static inline int sensor_type_valid(uint8_t type)
+{
+    return type < SENSOR_TYPE_COUNT && sensor_type_names[type] != NULL;
+}
+
+/**
+ * Config-file name of a sensor type ("dht11", "gas", ...)
+ */
+static inline const char *sensor_type_name(uint8_t type)
+{
+    return sensor_type_valid(type) ? sensor_type_names[type] : "unknown";
+}
+
+static inline int sensor_type_from_name(const char *name)
+{
+    int type;
+
+    for (type = 0; type < SENSOR_TYPE_COUNT; type++)
+    {
+        if (sensor_type_names[type] && strcmp(sensor_type_names[type], name) == 0)
+        {
+            return type;
+        }
+    }
+    return -1;
+}
+
+/**
+ * Whether a sensor or zone name can be written into JSON and trace text as is:
+ * no quotes, backslashes or control characters
+ */
+static inline int sensor_name_valid(const char *name)
+{
+    const unsigned char *c;
+
+    for (c = (const unsigned char *)name; *c; c++)
+    {
+        if (*c == '"' || *c == '\\' || *c < 0x20 || *c == 0x7f)
+        {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/**
+ * Empty instance of a type, all options at their defaults
+ */
+static inline sensor_instance_t sensor_instance_make(uint8_t type, const char *name, int pin, int pin2)
+{
+    sensor_instance_t s;
+
+    memset(&s, 0, sizeof(s));
+    s.type = type;
+    snprintf(s.name, sizeof(s.name), "%s", name);
+    s.pin = pin;
+    s.pin2 = pin2;
+    s.threshold_high = SENSOR_THRESHOLD_DEFAULT;
+    s.threshold_low = SENSOR_THRESHOLD_DEFAULT;
+    return s;
+}
+
+/**
+ * Add an instance, assigning its id and bank slot
+ *
+ * @return the registered instance, or NULL if the registry or bank is full
+ */
+static inline sensor_instance_t *sensor_registry_add(sensor_registry_t *reg, const sensor_instance_t *s)
+{
+    sensor_instance_t *entry;
+
+    if (reg->count >= SENSOR_MAX_INSTANCES || !sensor_type_valid(s->type) ||
+        reg->type_count[s->type] >= SENSOR_MAX_PER_TYPE)
+    {
+        return NULL;
+    }
+    entry = &reg->sensors[reg->count];
+    *entry = *s;
+    entry->id = (uint8_t)reg->count;
+    entry->slot = (uint8_t)reg->type_count[s->type]++;
+    reg->count++;
+    return entry;
+}
+
+/**
+ * Parse the value of a "sensor" line: "<type> <name> [key=value ...]"
+ *
+ * @param text Line value (modified)
+ * @param out  Parsed instance
+ * @return 0 on success, -1 on a syntax error, a name with quotes or missing pins
+ */
+static inline int sensor_instance_parse(char *text, sensor_instance_t *out)
+{
+    char *save = NULL;
+    char *type_name = strtok_r(text, " \t", &save);
+    char *name = strtok_r(NULL, " \t", &save);
+    char *opt;
+    int type;
+
+    if (!type_name || !name || !sensor_name_valid(name) || (type = sensor_type_from_name(type_name)) < 0)
+    {
+        return -1;
+    }
+    *out = sensor_instance_make((uint8_t)type, name, -1, -1);
+
+    while ((opt = strtok_r(NULL, " \t", &save)) != NULL)
+    {
+        char *eq = strchr(opt, '=');
+        char *end;
+        long value;
+
+        if (!eq)
+        {
+            return -1;
+        }
+        *eq = '\0';
+        value = strtol(eq + 1, &end, 10);
+        if (end == eq + 1 || *end != '\0')
+        {
+            return -1;
+        }
+
+        if (strcmp(opt, "pin") == 0 || strcmp(opt, "trig") == 0)
+            out->pin = (int)value;
+        else if (strcmp(opt, "echo") == 0)
+            out->pin2 = (int)value;
+        else if (strcmp(opt, "period_ms") == 0 && value > 0)
+            out->period_ms = (uint32_t)value;
+        else if ((strcmp(opt, "high") == 0 || strcmp(opt, "closed_cm") == 0) && value > INT_MIN)
+            out->threshold_high = (int)value;
+        else if (strcmp(opt, "low") == 0 && value > INT_MIN)
+            out->threshold_low = (int)value;
+        else
+            return -1;
+    }
+
+    if (out->pin < 0 || (type == SENSOR_TYPE_ULTRASONIC && out->pin2 < 0))
+    {
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * Read the "sensor" lines of a config file into the registry
+ *
+ * @param reg  Registry to fill (sensors are appended)
+ * @param path Config file path
+ * @return number of sensors added, or -1 if the file has a bad sensor line
+ *         (a missing file adds nothing and returns 0)
+ */
+static inline int sensor_registry_load(sensor_registry_t *reg, const char *path)
+{
+    FILE *file = fopen(path, "r");
+    char line[256];
+    int line_no = 0;
+    int added = 0;
+    int errors = 0;
+
+    if (!file)
+    {
+        return 0;
+    }
+
+    while (fgets(line, sizeof(line), file))
+    {
+        char *comment = strchr(line, '#');
+        char *eq;
+        char key[16];
+        sensor_instance_t s;
+
+        line_no++;
+        if (comment)
+        {
+            *comment = '\0';
+        }
+        // Other keys belong to runtime_config.h
+        if (sscanf(line, " %15[a-z_] =", key) != 1 || strcmp(key, "sensor") != 0 ||
+            (eq = strchr(line, '=')) == NULL)
+        {
+            continue;
+        }
+        eq[strcspn(eq, "\r\n")] = '\0';
+
+        if (sensor_instance_parse(eq + 1, &s) != 0)
+        {
+            printf("[SENSORS] %s:%d: bad sensor definition\n", path, line_no);
+            errors++;
+        }
+        else if (!sensor_registry_add(reg, &s))
+        {
+            printf("[SENSORS] %s:%d: too many sensors (max %d, %d per type)\n", path, line_no,
+                   SENSOR_MAX_INSTANCES, SENSOR_MAX_PER_TYPE);
+            errors++;
+        }
+        else
+        {
+            added++;
+        }
+    }
+    fclose(file);
+
+    return errors ? -1 : added;
+}
+
+#endif // SENSOR_REGISTRY_H
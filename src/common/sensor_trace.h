@@ -0,0 +1,261 @@
+/*
+ * sensor_trace.h - Binary recording of everything the analyzer sees
+ *
+ * A trace starts with a header (zone, clock origins, the sensor registry)
+ * followed by fixed-size records:
+ *
+ *     SAMPLE     one raw reading: sensor id, ok, values, read time
+ *     AGGREGATE  the aggregator ran (threshold checks, message to stats_update)
+ *     IPC        outcome of a message or pulse to another process
+ *     CONFIG     a new threshold_config_t was published (the struct follows)
+ *
+ * Record times are milliseconds since the header's monotonic origin, so a
+ * replay feeds the analysis code exactly the timestamps it saw live. Traces
+ * are written and read on the same architecture (raw little-endian structs).
+ */
+
+#ifndef SENSOR_TRACE_H
+#define SENSOR_TRACE_H
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "../msg_def.h"
+#include "sensor_registry.h"
+
+#define TRACE_MAGIC 0x52545348u // "HSTR"
+#define TRACE_VERSION 1
+#define TRACE_BUFFER_SIZE 65536 // stdio buffer; records reach the file in batches
+
+typedef enum
+{
+    TRACE_REC_SAMPLE = 1,
+    TRACE_REC_AGGREGATE,
+    TRACE_REC_IPC,
+    TRACE_REC_CONFIG
+} trace_rec_kind_t;
+
+// Destination of an IPC record (trace_record_t.sensor)
+typedef enum
+{
+    TRACE_IPC_STATS,
+    TRACE_IPC_LOGGER,
+    TRACE_IPC_ALERT_PULSE
+} trace_ipc_target_t;
+
+typedef struct
+{
+    uint32_t magic;
+    uint16_t version;
+    uint16_t sensor_count;   // sensor_instance_t entries following the header
+    uint32_t config_size;    // sizeof(threshold_config_t) of the writer
+    uint16_t zone_id;
+    char zone_name[ZONE_NAME_LEN];
+    uint64_t mono_start_ms;  // Monotonic time of t_ms = 0
+    int64_t wall_start;      // Wall-clock time (time_t) at the same moment
+} trace_header_t;
+
+typedef struct
+{
+    uint32_t t_ms;           // Since trace_header_t.mono_start_ms
+    uint32_t read_us;        // SAMPLE: time spent reading
+    uint32_t extra;          // SAMPLE (DHT11): busy-wait in failed attempts; IPC: errno
+    int32_t value;           // SAMPLE: temperature, detected flag or distance
+    int32_t value2;          // SAMPLE: humidity
+    uint8_t kind;            // trace_rec_kind_t
+    uint8_t sensor;          // SAMPLE: registry id; IPC: trace_ipc_target_t
+    uint8_t ok;              // SAMPLE: read succeeded; IPC: message delivered
+    uint8_t aux;             // SAMPLE: DHT11 attempts or ultrasonic confidence
+} trace_record_t;
+
+typedef struct
+{
+    FILE *file;
+    pthread_mutex_t lock;
+    uint64_t start_ms;
+    uint32_t records;
+    uint32_t errors;         // Records that could not be written
+} trace_writer_t;
+
+typedef struct
+{
+    FILE *file;
+    trace_header_t header;
+    sensor_instance_t sensors[SENSOR_MAX_INSTANCES];
+    threshold_config_t config; // Payload of the last CONFIG record
+} trace_reader_t;
+
+/**
+ * Create a trace file and write its header
+ *
+ * @param w        Writer
+ * @param path     Output file
+ * @param reg      Sensor registry of the recording process
+ * @param zone_id  Zone of the recording process
+ * @param zone_name Zone name
+ * @param now_ms   Monotonic time used as the trace origin
+ * @return 0 on success, -1 on error (errno set)
+ */
+static inline int trace_writer_open(trace_writer_t *w, const char *path, const sensor_registry_t *reg,
+                                    uint16_t zone_id, const char *zone_name, uint64_t now_ms)
+{
+    trace_header_t header;
+
+    memset(w, 0, sizeof(*w));
+    w->file = fopen(path, "wb");
+    if (!w->file)
+    {
+        return -1;
+    }
+    setvbuf(w->file, NULL, _IOFBF, TRACE_BUFFER_SIZE);
+    pthread_mutex_init(&w->lock, NULL);
+    w->start_ms = now_ms;
+
+    memset(&header, 0, sizeof(header));
+    header.magic = TRACE_MAGIC;
+    header.version = TRACE_VERSION;
+    header.sensor_count = (uint16_t)reg->count;
+    header.config_size = sizeof(threshold_config_t);
+    header.zone_id = zone_id;
+    snprintf(header.zone_name, sizeof(header.zone_name), "%s", zone_name);
+    header.mono_start_ms = now_ms;
+    header.wall_start = (int64_t)time(NULL);
+
+    if (fwrite(&header, sizeof(header), 1, w->file) != 1 ||
+        fwrite(reg->sensors, sizeof(reg->sensors[0]), (size_t)reg->count, w->file) != (size_t)reg->count)
+    {
+        fclose(w->file);
+        w->file = NULL;
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * Append a record (thread-safe; a closed writer ignores it)
+ *
+ * @param payload Bytes written right after the record (CONFIG), or NULL
+ */
+static inline void trace_writer_put(trace_writer_t *w, trace_record_t *rec, uint64_t now_ms, const void *payload,
+                                    size_t payload_size)
+{
+    if (!w->file)
+    {
+        return;
+    }
+    rec->t_ms = (uint32_t)(now_ms - w->start_ms);
+
+    pthread_mutex_lock(&w->lock);
+    if (fwrite(rec, sizeof(*rec), 1, w->file) != 1 ||
+        (payload && fwrite(payload, payload_size, 1, w->file) != 1))
+    {
+        w->errors++;
+    }
+    else
+    {
+        w->records++;
+    }
+    pthread_mutex_unlock(&w->lock);
+}
+
+/**
+ * Push buffered records to the file
+ */
+static inline void trace_writer_flush(trace_writer_t *w)
+{
+    if (w->file)
+    {
+        pthread_mutex_lock(&w->lock);
+        fflush(w->file);
+        pthread_mutex_unlock(&w->lock);
+    }
+}
+
+static inline void trace_writer_close(trace_writer_t *w)
+{
+    if (w->file)
+    {
+        pthread_mutex_lock(&w->lock);
+        fclose(w->file);
+        w->file = NULL;
+        pthread_mutex_unlock(&w->lock);
+    }
+}
+
+/**
+ * Open a trace and read its header and sensor registry
+ *
+ * @return 0 on success, -1 if the file is missing, truncated, not a trace
+ *         of this version and architecture, or records a sensor type that
+ *         has no driver
+ */
+static inline int trace_reader_open(trace_reader_t *r, const char *path)
+{
+    int i;
+
+    memset(r, 0, sizeof(*r));
+    r->file = fopen(path, "rb");
+    if (!r->file)
+    {
+        return -1;
+    }
+    if (fread(&r->header, sizeof(r->header), 1, r->file) != 1 || r->header.magic != TRACE_MAGIC ||
+        r->header.version != TRACE_VERSION || r->header.config_size != sizeof(threshold_config_t) ||
+        r->header.sensor_count > SENSOR_MAX_INSTANCES ||
+        fread(r->sensors, sizeof(r->sensors[0]), r->header.sensor_count, r->file) != r->header.sensor_count)
+    {
+        fclose(r->file);
+        r->file = NULL;
+        return -1;
+    }
+    // Every recorded sensor must be one the analyzer has a driver for
+    for (i = 0; i < r->header.sensor_count; i++)
+    {
+        if (!sensor_type_valid(r->sensors[i].type))
+        {
+            fclose(r->file);
+            r->file = NULL;
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Read the next record (a CONFIG payload lands in r->config)
+ *
+ * @return 1 if a record was read, 0 at the end of the trace, -1 on a truncated or bad record
+ */
+static inline int trace_reader_next(trace_reader_t *r, trace_record_t *rec)
+{
+    if (fread(rec, sizeof(*rec), 1, r->file) != 1)
+    {
+        return feof(r->file) ? 0 : -1;
+    }
+    switch (rec->kind)
+    {
+    case TRACE_REC_SAMPLE:
+        return rec->sensor < r->header.sensor_count ? 1 : -1;
+    case TRACE_REC_CONFIG:
+        return fread(&r->config, sizeof(r->config), 1, r->file) == 1 ? 1 : -1;
+    case TRACE_REC_AGGREGATE:
+    case TRACE_REC_IPC:
+        return 1;
+    default:
+        return -1;
+    }
+}
+
+static inline void trace_reader_close(trace_reader_t *r)
+{
+    if (r->file)
+    {
+        fclose(r->file);
+        r->file = NULL;
+    }
+}
+
+#endif // SENSOR_TRACE_H
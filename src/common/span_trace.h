@@ -0,0 +1,182 @@
+/*
+ * span_trace.h - Pipeline stage spans in Chrome trace format
+ *
+ * Each stage of a snapshot's journey (sensor read, threshold check, snapshot
+ * publish, alert send, logger write, dashboard render, LED actuation) wraps
+ * its work in span_begin()/span_end(). A span is one "complete" event of the
+ * Chrome trace event format: name, monotonic begin time and duration, process
+ * and thread, and the snapshot sequence number it belongs to.
+ *
+ * Tracing is off unless HOME_SAFETY_SPANS names a trace file. Every process
+ * of the pipeline appends to the same file (O_APPEND, one write() per event),
+ * and CLOCK_MONOTONIC is shared by all of them, so the file shows the whole
+ * journey on one timeline. Load it in chrome://tracing or ui.perfetto.dev;
+ * both accept the unterminated JSON array it is made of.
+ *
+ * Only snapshots whose sequence number is a multiple of
+ * HOME_SAFETY_SPAN_EVERY (default SPAN_EVERY_DEFAULT) are traced. The
+ * decision needs nothing but the sequence number, so every process makes the
+ * same one, and a stage that is not sampled costs a modulo and a branch.
+ */
+
+#ifndef SPAN_TRACE_H
+#define SPAN_TRACE_H
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "mono_time.h"
+
+#define SPAN_FILE_ENV "HOME_SAFETY_SPANS"
+#define SPAN_EVERY_ENV "HOME_SAFETY_SPAN_EVERY"
+#define SPAN_EVERY_DEFAULT 10 // Every 10th snapshot (one per 20 s at the default rate)
+#define SPAN_EVENT_MAX 384
+
+typedef struct
+{
+    int fd;         // Shared trace file, -1 when tracing is off
+    uint32_t every; // Sampling period in snapshots
+    int pid;
+} span_trace_t;
+
+static span_trace_t g_span_trace = {-1, SPAN_EVERY_DEFAULT, 0};
+static atomic_int g_span_threads;
+static __thread int tl_span_tid; // Small per-process thread number, 0 until first used
+
+/**
+ * Append one event line; the leading comma lets any process write next
+ */
+static inline void span_write(const char *event, int len)
+{
+    if (len > 0 && len < SPAN_EVENT_MAX)
+    {
+        // Best effort: a lost span is not worth a retry on a hot path
+        ssize_t rc = write(g_span_trace.fd, event, (size_t)len);
+        (void)rc;
+    }
+}
+
+/**
+ * Open the trace file, creating it with the array opener if this process is
+ * the first. The file is built under a temporary name and linked into place,
+ * so no process can append to it before the opener is there.
+ */
+static inline int span_open(const char *path)
+{
+    int fd = open(path, O_WRONLY | O_APPEND);
+
+    if (fd == -1 && errno == ENOENT)
+    {
+        char tmp[256];
+        char head[SPAN_EVENT_MAX];
+        int len;
+
+        snprintf(tmp, sizeof(tmp), "%s.%d", path, (int)getpid());
+        fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd == -1)
+        {
+            return -1;
+        }
+        len = snprintf(head, sizeof(head),
+                       "[{\"name\":\"trace_start\",\"ph\":\"i\",\"s\":\"g\",\"ts\":%.3f,\"pid\":%d,\"tid\":0}\n",
+                       mono_time_ns() / 1e3, (int)getpid());
+        if (write(fd, head, (size_t)len) != len || (link(tmp, path) == -1 && errno != EEXIST))
+        {
+            close(fd);
+            unlink(tmp);
+            return -1;
+        }
+        close(fd);
+        unlink(tmp);
+        fd = open(path, O_WRONLY | O_APPEND);
+    }
+    return fd;
+}
+
+/**
+ * Enable span tracing if HOME_SAFETY_SPANS is set
+ * @param process_name Name shown for this process's track
+ * @return 0 on success or when tracing is off, -1 (errno set) if the file cannot be opened
+ */
+static inline int span_trace_init(const char *process_name)
+{
+    const char *path = getenv(SPAN_FILE_ENV);
+    const char *every = getenv(SPAN_EVERY_ENV);
+    char event[SPAN_EVENT_MAX];
+
+    if (!path || path[0] == '\0')
+    {
+        return 0;
+    }
+    if (every && atoi(every) > 0)
+    {
+        g_span_trace.every = (uint32_t)atoi(every);
+    }
+    g_span_trace.pid = (int)getpid();
+    g_span_trace.fd = span_open(path);
+    if (g_span_trace.fd == -1)
+    {
+        return -1;
+    }
+
+    span_write(event, snprintf(event, sizeof(event),
+                               ",{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":0,"
+                               "\"args\":{\"name\":\"%s\"}}\n",
+                               g_span_trace.pid, process_name));
+    printf("[SPAN] Tracing 1 in %u snapshots to %s\n", g_span_trace.every, path);
+    return 0;
+}
+
+/**
+ * Whether the stages of snapshot seq are traced
+ */
+static inline int span_sampled(uint32_t seq)
+{
+    return g_span_trace.fd != -1 && seq % g_span_trace.every == 0;
+}
+
+/**
+ * Start a span
+ * @param seq Snapshot sequence number the work belongs to
+ * @return Begin time to pass to span_end(), 0 if seq is not sampled
+ */
+static inline uint64_t span_begin(uint32_t seq)
+{
+    return span_sampled(seq) ? mono_time_ns() : 0;
+}
+
+/**
+ * Record a span that began at begin_ns and ends now
+ * @param begin_ns Value returned by span_begin() (nothing is written for 0)
+ * @param name Stage name
+ * @param seq Snapshot sequence number
+ * @param detail Sensor, alert or zone the span is about, or NULL
+ */
+static inline void span_end(uint64_t begin_ns, const char *name, uint32_t seq, const char *detail)
+{
+    char event[SPAN_EVENT_MAX];
+    uint64_t end_ns;
+
+    if (begin_ns == 0)
+    {
+        return;
+    }
+    end_ns = mono_time_ns();
+    if (tl_span_tid == 0)
+    {
+        tl_span_tid = atomic_fetch_add(&g_span_threads, 1) + 1;
+    }
+    span_write(event, snprintf(event, sizeof(event),
+                               ",{\"name\":\"%s\",\"cat\":\"pipeline\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,"
+                               "\"pid\":%d,\"tid\":%d,\"args\":{\"seq\":%u,\"detail\":\"%s\"}}\n",
+                               name, begin_ns / 1e3, (end_ns - begin_ns) / 1e3, g_span_trace.pid,
+                               tl_span_tid, seq, detail ? detail : ""));
+}
+
+#endif // SPAN_TRACE_H
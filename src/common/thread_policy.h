@@ -0,0 +1,332 @@
+/*
+ * thread_policy.h - Scheduling policy, priority, CPU mask and stack size per thread class
+ *
+ * Every thread the system creates belongs to one class:
+ *
+ *     acquisition  sensor workers and their timer (bit-banged DHT11 frames and
+ *                  ultrasonic echo timing must not be preempted mid-read)
+ *     analysis     aggregation, threshold checks and alerting
+ *     ipc          message receive/reply loops
+ *     logging      config watching, dashboard and log file writing
+ *
+ * The policy of a class can be set in the config file:
+ *
+ *     thread_acquisition = fifo 40 cpus=0x2 stack_kb=64
+ *     thread_logging     = other
+ *
+ * "fifo", "rr" or "other" picks the scheduling policy, followed by an optional
+ * priority; "default" keeps whatever the thread inherits. cpus is a runmask
+ * (bit n = CPU n, 0 = any) and stack_kb the stack size (0 = system default).
+ *
+ * Priority and CPU mask are applied by the thread itself when it starts
+ * (ThreadCtl(_NTO_TCTL_RUNMASK) on QNX, sched_setaffinity() elsewhere). If the
+ * process may not raise its priority the thread keeps running with the
+ * inherited settings and a warning is printed.
+ */
+
+#ifndef THREAD_POLICY_H
+#define THREAD_POLICY_H
+
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef __QNXNTO__
+#include <sys/neutrino.h>
+#endif
+
+#define THREAD_SCHED_DEFAULT -1 // Keep the inherited policy and priority
+
+typedef enum
+{
+    THREAD_CLASS_ACQUISITION,
+    THREAD_CLASS_ANALYSIS,
+    THREAD_CLASS_IPC,
+    THREAD_CLASS_LOGGING,
+    THREAD_CLASS_COUNT
+} thread_class_t;
+
+typedef struct
+{
+    int policy;        // SCHED_FIFO, SCHED_RR, SCHED_OTHER or THREAD_SCHED_DEFAULT
+    int priority;      // Clamped to the policy's range
+    uint32_t runmask;  // Allowed CPUs (0 = any)
+    size_t stack_size; // Bytes (0 = system default)
+} thread_policy_t;
+
+static const char *const thread_class_names[THREAD_CLASS_COUNT] = {
+    [THREAD_CLASS_ACQUISITION] = "acquisition",
+    [THREAD_CLASS_ANALYSIS] = "analysis",
+    [THREAD_CLASS_IPC] = "ipc",
+    [THREAD_CLASS_LOGGING] = "logging",
+};
+
+// Active policies (filled before any thread of the process is created)
+static thread_policy_t g_thread_policy[THREAD_CLASS_COUNT] = {
+    [THREAD_CLASS_ACQUISITION] = {SCHED_FIFO, 30, 0, 0},
+    [THREAD_CLASS_ANALYSIS] = {THREAD_SCHED_DEFAULT, 0, 0, 0},
+    [THREAD_CLASS_IPC] = {SCHED_FIFO, 20, 0, 0},
+    [THREAD_CLASS_LOGGING] = {THREAD_SCHED_DEFAULT, 0, 0, 0},
+};
+
+/**
+ * Parse a policy value: "<fifo|rr|other|default> [priority] [cpus=mask] [stack_kb=n]"
+ *
+ * @param text Value (modified)
+ * @param out  Parsed policy
+ * @return 0 on success, -1 on a syntax error
+ */
+static inline int thread_policy_parse(char *text, thread_policy_t *out)
+{
+    char *save = NULL;
+    char *tok = strtok_r(text, " \t", &save);
+
+    if (!tok)
+    {
+        return -1;
+    }
+    memset(out, 0, sizeof(*out));
+    if (strcmp(tok, "fifo") == 0)
+        out->policy = SCHED_FIFO;
+    else if (strcmp(tok, "rr") == 0)
+        out->policy = SCHED_RR;
+    else if (strcmp(tok, "other") == 0)
+        out->policy = SCHED_OTHER;
+    else if (strcmp(tok, "default") == 0)
+        out->policy = THREAD_SCHED_DEFAULT;
+    else
+        return -1;
+
+    while ((tok = strtok_r(NULL, " \t", &save)) != NULL)
+    {
+        char *end;
+        unsigned long value;
+
+        if (strncmp(tok, "cpus=", 5) == 0)
+        {
+            value = strtoul(tok + 5, &end, 0);
+            if (end == tok + 5 || *end != '\0' || value > UINT32_MAX)
+            {
+                return -1;
+            }
+            out->runmask = (uint32_t)value;
+        }
+        else if (strncmp(tok, "stack_kb=", 9) == 0)
+        {
+            value = strtoul(tok + 9, &end, 10);
+            if (end == tok + 9 || *end != '\0')
+            {
+                return -1;
+            }
+            out->stack_size = (size_t)value * 1024;
+        }
+        else
+        {
+            value = strtoul(tok, &end, 10);
+            if (end == tok || *end != '\0')
+            {
+                return -1;
+            }
+            out->priority = (int)value;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Read the "thread_<class>" lines of a config file into g_thread_policy
+ *
+ * @return number of classes set, or -1 if the file has a bad policy line
+ *         (a missing file changes nothing and returns 0)
+ */
+static inline int thread_policy_load(const char *path)
+{
+    FILE *file = fopen(path, "r");
+    char line[256];
+    int line_no = 0;
+    int set = 0;
+    int errors = 0;
+
+    if (!file)
+    {
+        return 0;
+    }
+
+    while (fgets(line, sizeof(line), file))
+    {
+        char *comment = strchr(line, '#');
+        char *eq;
+        char key[32];
+        thread_policy_t policy;
+        int cls;
+
+        line_no++;
+        if (comment)
+        {
+            *comment = '\0';
+        }
+        // Other keys belong to runtime_config.h
+        if (sscanf(line, " thread_%31[a-z] =", key) != 1 || (eq = strchr(line, '=')) == NULL)
+        {
+            continue;
+        }
+        eq[strcspn(eq, "\r\n")] = '\0';
+
+        for (cls = 0; cls < THREAD_CLASS_COUNT; cls++)
+        {
+            if (strcmp(thread_class_names[cls], key) == 0)
+            {
+                break;
+            }
+        }
+        if (cls == THREAD_CLASS_COUNT || thread_policy_parse(eq + 1, &policy) != 0)
+        {
+            printf("[SCHED] %s:%d: bad thread policy\n", path, line_no);
+            errors++;
+            continue;
+        }
+        g_thread_policy[cls] = policy;
+        set++;
+    }
+    fclose(file);
+
+    return errors ? -1 : set;
+}
+
+/**
+ * Apply a class's priority and CPU mask to the calling thread
+ *
+ * @return 0 on success, -1 if any part could not be applied (the rest still is)
+ */
+static inline int thread_policy_apply_self(thread_class_t cls)
+{
+    const thread_policy_t *p = &g_thread_policy[cls];
+    int rc = 0;
+
+    if (p->policy != THREAD_SCHED_DEFAULT)
+    {
+        struct sched_param param;
+        int min = sched_get_priority_min(p->policy);
+        int max = sched_get_priority_max(p->policy);
+        int err;
+
+        memset(&param, 0, sizeof(param));
+        param.sched_priority = p->priority < min ? min : p->priority > max ? max : p->priority;
+        if ((err = pthread_setschedparam(pthread_self(), p->policy, &param)) != 0)
+        {
+            printf("[SCHED] %s: cannot set priority %d: %s\n", thread_class_names[cls], param.sched_priority,
+                   strerror(err));
+            rc = -1;
+        }
+    }
+
+    if (p->runmask != 0)
+    {
+#ifdef __QNXNTO__
+        if (ThreadCtl(_NTO_TCTL_RUNMASK, (void *)(uintptr_t)p->runmask) == -1)
+#else
+        cpu_set_t set;
+        int cpu;
+
+        CPU_ZERO(&set);
+        for (cpu = 0; cpu < 32; cpu++)
+        {
+            if (p->runmask & (1u << cpu))
+            {
+                CPU_SET(cpu, &set);
+            }
+        }
+        if (sched_setaffinity(0, sizeof(set), &set) != 0)
+#endif
+        {
+            printf("[SCHED] %s: cannot set CPU mask 0x%x: %s\n", thread_class_names[cls], p->runmask,
+                   strerror(errno));
+            rc = -1;
+        }
+    }
+    return rc;
+}
+
+typedef struct
+{
+    thread_class_t cls;
+    void *(*fn)(void *);
+    void *arg;
+} thread_policy_start_t;
+
+static inline void *thread_policy_trampoline(void *arg)
+{
+    thread_policy_start_t start = *(thread_policy_start_t *)arg;
+
+    free(arg);
+    thread_policy_apply_self(start.cls);
+    return start.fn(start.arg);
+}
+
+/**
+ * pthread_create() with the stack size, priority and CPU mask of a thread class
+ *
+ * @return 0 on success, an error number otherwise
+ */
+static inline int thread_policy_create(thread_class_t cls, pthread_t *thread, void *(*fn)(void *), void *arg)
+{
+    thread_policy_start_t *start = malloc(sizeof(*start));
+    pthread_attr_t attr;
+    int rc;
+
+    if (!start)
+    {
+        return ENOMEM;
+    }
+    start->cls = cls;
+    start->fn = fn;
+    start->arg = arg;
+
+    pthread_attr_init(&attr);
+    if (g_thread_policy[cls].stack_size != 0)
+    {
+        pthread_attr_setstacksize(&attr, g_thread_policy[cls].stack_size);
+    }
+    rc = pthread_create(thread, &attr, thread_policy_trampoline, start);
+    pthread_attr_destroy(&attr);
+    if (rc != 0)
+    {
+        free(start);
+    }
+    return rc;
+}
+
+/**
+ * Print the active policies
+ */
+static inline void thread_policy_print(void)
+{
+    int cls;
+
+    for (cls = 0; cls < THREAD_CLASS_COUNT; cls++)
+    {
+        const thread_policy_t *p = &g_thread_policy[cls];
+
+        printf("[SCHED] %-11s %s", thread_class_names[cls],
+               p->policy == SCHED_FIFO ? "fifo" : p->policy == SCHED_RR ? "rr" :
+               p->policy == SCHED_OTHER ? "other" : "default");
+        if (p->policy == SCHED_FIFO || p->policy == SCHED_RR)
+        {
+            printf(" %d", p->priority);
+        }
+        if (p->runmask)
+        {
+            printf(" cpus=0x%x", p->runmask);
+        }
+        if (p->stack_size)
+        {
+            printf(" stack_kb=%zu", p->stack_size / 1024);
+        }
+        printf("\n");
+    }
+}
+
+#endif // THREAD_POLICY_H
@@ -0,0 +1,572 @@
+/*
+ * worker_pool.h - Fixed pool of worker threads for periodic sensor tasks
+ *
+ * A task is a function that takes one sample and returns how long until it
+ * should run again. Waiting tasks sit in a min-heap ordered by due time; a
+ * timer thread moves each due task onto the deque of the worker that ran it
+ * last. Workers pop their own deque from the back and, when it is empty, steal
+ * from the front of another worker's deque.
+ *
+ * Tasks belong to a class. Blocking tasks (bit-banged DHT11 frames, ultrasonic
+ * echo waits and burst gaps) get their own workers and are never stolen by the
+ * short-task workers, so a slow read cannot hold up a gas or PIR poll queued
+ * behind it.
+ *
+ * Threads are created through an optional spawn hook so the caller can give
+ * each class its own priority, CPU mask and stack (see thread_policy.h).
+ *
+ * Each worker counts busy time, runs, steals and the latency from a task's due
+ * time to its start; worker_pool_take_stats() returns and resets them.
+ */
+
+#ifndef WORKER_POOL_H
+#define WORKER_POOL_H
+
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <semaphore.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+#include "mono_time.h"
+
+#define POOL_MAX_TASKS 64            // Tasks (one per sensor instance)
+#define POOL_MAX_CLASS_WORKERS 8     // Workers per task class
+
+typedef enum
+{
+    POOL_CLASS_SHORT,    // Returns within microseconds (GPIO level reads)
+    POOL_CLASS_BLOCKING, // Busy-waits or sleeps for milliseconds
+    POOL_CLASS_COUNT
+} pool_class_t;
+
+#define POOL_ROLE_TIMER POOL_CLASS_COUNT // Spawn hook role of the timer thread
+
+typedef enum
+{
+    POOL_TASK_WAITING, // In the timer heap
+    POOL_TASK_QUEUED,  // On a worker deque
+    POOL_TASK_RUNNING
+} pool_task_state_t;
+
+/**
+ * Task body
+ *
+ * @param arg Task argument
+ * @param ctx Per-worker value from the pool's thread_init hook
+ * @return ms until the task should run again
+ */
+typedef uint32_t (*pool_task_fn)(void *arg, int ctx);
+
+/**
+ * Thread creation hook
+ *
+ * @param role pool_class_t of a worker, or POOL_ROLE_TIMER
+ * @return 0 on success, an error number otherwise (like pthread_create)
+ */
+typedef int (*pool_spawn_fn)(pthread_t *thread, int role, void *(*fn)(void *), void *arg);
+
+typedef struct
+{
+    pool_task_fn run;
+    void *arg;
+    uint8_t cls;           // pool_class_t
+    uint8_t state;         // pool_task_state_t (pool lock)
+    int worker;            // Worker that ran it last
+    int heap_pos;          // Index in the timer heap while waiting
+    uint64_t due_ns;       // Monotonic time it is due
+    uint64_t start_ns;     // Start of its latest run (pool lock)
+    uint64_t wake_ns;      // Woken while running: due no later than this (pool lock, 0 = not woken)
+} pool_task_t;
+
+typedef struct
+{
+    uint64_t window_ns;    // Time covered by these counters
+    uint64_t busy_ns;      // Time spent running tasks
+    uint32_t runs;
+    uint32_t steals;       // Tasks taken from another worker's deque
+    uint64_t latency_sum_ns;
+    uint64_t latency_max_ns;
+} pool_worker_stats_t;
+
+struct worker_pool;
+
+typedef struct
+{
+    struct worker_pool *pool;
+    int index;
+    uint8_t cls;
+    pthread_t thread;
+
+    // Deque of task indices (lock); the owner works at the tail, thieves at the head
+    pthread_mutex_t lock;
+    int deque[POOL_MAX_TASKS];
+    unsigned head;
+    unsigned tail;
+    pool_worker_stats_t stats; // Counters of the current window (lock)
+    uint64_t window_start_ns;
+} pool_worker_t;
+
+typedef struct worker_pool
+{
+    pool_task_t tasks[POOL_MAX_TASKS];
+    int task_count;
+
+    pool_worker_t workers[POOL_CLASS_COUNT * POOL_MAX_CLASS_WORKERS];
+    int worker_count;
+    int class_first[POOL_CLASS_COUNT]; // First worker of each class
+    int class_workers[POOL_CLASS_COUNT];
+    sem_t ready[POOL_CLASS_COUNT];     // Tasks queued on the class's deques
+
+    // Timer heap of waiting tasks, ordered by due_ns (lock)
+    pthread_mutex_t lock;
+    pthread_cond_t timer_cond;
+    int heap[POOL_MAX_TASKS];
+    int heap_size;
+    pthread_t timer_thread;
+
+    int (*thread_init)(void);
+    pool_spawn_fn spawn;               // NULL = plain pthread_create
+    volatile bool running;
+} worker_pool_t;
+
+static inline bool pool_heap_less(const worker_pool_t *pool, int a, int b)
+{
+    return pool->tasks[pool->heap[a]].due_ns < pool->tasks[pool->heap[b]].due_ns;
+}
+
+static inline void pool_heap_swap(worker_pool_t *pool, int a, int b)
+{
+    int t = pool->heap[a];
+    pool->heap[a] = pool->heap[b];
+    pool->heap[b] = t;
+    pool->tasks[pool->heap[a]].heap_pos = a;
+    pool->tasks[pool->heap[b]].heap_pos = b;
+}
+
+static inline void pool_heap_up(worker_pool_t *pool, int i)
+{
+    while (i > 0 && pool_heap_less(pool, i, (i - 1) / 2))
+    {
+        pool_heap_swap(pool, i, (i - 1) / 2);
+        i = (i - 1) / 2;
+    }
+}
+
+static inline void pool_heap_down(worker_pool_t *pool, int i)
+{
+    for (;;)
+    {
+        int smallest = i;
+        int l = 2 * i + 1;
+        int r = l + 1;
+
+        if (l < pool->heap_size && pool_heap_less(pool, l, smallest))
+        {
+            smallest = l;
+        }
+        if (r < pool->heap_size && pool_heap_less(pool, r, smallest))
+        {
+            smallest = r;
+        }
+        if (smallest == i)
+        {
+            return;
+        }
+        pool_heap_swap(pool, i, smallest);
+        i = smallest;
+    }
+}
+
+// Put a task into the timer heap and wake the timer if it is now the earliest (pool lock held)
+static inline void pool_schedule(worker_pool_t *pool, int task, uint64_t due_ns)
+{
+    pool_task_t *t = &pool->tasks[task];
+
+    t->state = POOL_TASK_WAITING;
+    t->due_ns = due_ns;
+    t->heap_pos = pool->heap_size;
+    pool->heap[pool->heap_size++] = task;
+    pool_heap_up(pool, t->heap_pos);
+    if (t->heap_pos == 0)
+    {
+        pthread_cond_signal(&pool->timer_cond);
+    }
+}
+
+static inline int pool_heap_pop(worker_pool_t *pool)
+{
+    int task = pool->heap[0];
+
+    pool->heap_size--;
+    if (pool->heap_size > 0)
+    {
+        pool->heap[0] = pool->heap[pool->heap_size];
+        pool->tasks[pool->heap[0]].heap_pos = 0;
+        pool_heap_down(pool, 0);
+    }
+    pool->tasks[task].heap_pos = -1;
+    return task;
+}
+
+// Hand a due task to the deque of the worker that ran it last
+static inline void pool_dispatch(worker_pool_t *pool, int task)
+{
+    pool_task_t *t = &pool->tasks[task];
+    pool_worker_t *w = &pool->workers[t->worker];
+
+    pthread_mutex_lock(&w->lock);
+    w->deque[w->tail++ % POOL_MAX_TASKS] = task;
+    pthread_mutex_unlock(&w->lock);
+    sem_post(&pool->ready[t->cls]);
+}
+
+// Take a task: own deque first (newest), then steal from the others of the class (oldest)
+static inline int pool_take(worker_pool_t *pool, pool_worker_t *self)
+{
+    int first = pool->class_first[self->cls];
+    int n = pool->class_workers[self->cls];
+    int task = -1;
+    int i;
+
+    pthread_mutex_lock(&self->lock);
+    if (self->head != self->tail)
+    {
+        task = self->deque[--self->tail % POOL_MAX_TASKS];
+    }
+    pthread_mutex_unlock(&self->lock);
+
+    for (i = 1; task < 0 && i < n; i++)
+    {
+        pool_worker_t *victim = &pool->workers[first + (self->index - first + i) % n];
+
+        pthread_mutex_lock(&victim->lock);
+        if (victim->head != victim->tail)
+        {
+            task = victim->deque[victim->head++ % POOL_MAX_TASKS];
+        }
+        pthread_mutex_unlock(&victim->lock);
+        if (task >= 0)
+        {
+            pthread_mutex_lock(&self->lock);
+            self->stats.steals++;
+            pthread_mutex_unlock(&self->lock);
+        }
+    }
+    return task;
+}
+
+static inline void *pool_worker_thread(void *arg)
+{
+    pool_worker_t *self = arg;
+    worker_pool_t *pool = self->pool;
+    int ctx = pool->thread_init ? pool->thread_init() : 0;
+
+    while (pool->running)
+    {
+        // The semaphore counts queued tasks of this class, so one is on some deque
+        if (sem_wait(&pool->ready[self->cls]) != 0)
+        {
+            continue;
+        }
+        int task;
+        while ((task = pool_take(pool, self)) < 0 && pool->running)
+        {
+            sched_yield(); // Another worker is mid-way through taking it
+        }
+        if (task < 0)
+        {
+            break;
+        }
+
+        pool_task_t *t = &pool->tasks[task];
+        pthread_mutex_lock(&pool->lock);
+        t->state = POOL_TASK_RUNNING;
+        t->worker = self->index;
+        t->start_ns = mono_time_ns();
+        uint64_t start = t->start_ns;
+        pthread_mutex_unlock(&pool->lock);
+
+        uint32_t delay_ms = t->run(t->arg, ctx);
+        uint64_t end = mono_time_ns();
+        uint64_t latency = start > t->due_ns ? start - t->due_ns : 0;
+
+        pthread_mutex_lock(&self->lock);
+        self->stats.busy_ns += end - start;
+        self->stats.runs++;
+        self->stats.latency_sum_ns += latency;
+        if (latency > self->stats.latency_max_ns)
+        {
+            self->stats.latency_max_ns = latency;
+        }
+        pthread_mutex_unlock(&self->lock);
+
+        // A wake during the run (even before the task read its rate) moves the next run up
+        uint64_t due = end + (uint64_t)delay_ms * 1000000ULL;
+        pthread_mutex_lock(&pool->lock);
+        if (t->wake_ns != 0 && t->wake_ns < due)
+        {
+            due = t->wake_ns > end ? t->wake_ns : end;
+        }
+        t->wake_ns = 0;
+        pool_schedule(pool, task, due);
+        pthread_mutex_unlock(&pool->lock);
+    }
+    return NULL;
+}
+
+static inline void *pool_timer_thread(void *arg)
+{
+    worker_pool_t *pool = arg;
+
+    pthread_mutex_lock(&pool->lock);
+    while (pool->running)
+    {
+        if (pool->heap_size == 0)
+        {
+            pthread_cond_wait(&pool->timer_cond, &pool->lock);
+            continue;
+        }
+
+        uint64_t due = pool->tasks[pool->heap[0]].due_ns;
+        if (due > mono_time_ns())
+        {
+            struct timespec deadline = {(time_t)(due / 1000000000ULL), (long)(due % 1000000000ULL)};
+            pthread_cond_timedwait(&pool->timer_cond, &pool->lock, &deadline);
+            continue;
+        }
+
+        int task = pool_heap_pop(pool);
+        pool->tasks[task].state = POOL_TASK_QUEUED;
+        pthread_mutex_unlock(&pool->lock);
+        pool_dispatch(pool, task);
+        pthread_mutex_lock(&pool->lock);
+    }
+    pthread_mutex_unlock(&pool->lock);
+    return NULL;
+}
+
+static inline int pool_spawn(worker_pool_t *pool, pthread_t *thread, int role, void *(*fn)(void *), void *arg)
+{
+    return pool->spawn ? pool->spawn(thread, role, fn, arg) : pthread_create(thread, NULL, fn, arg);
+}
+
+/**
+ * Prepare an empty pool
+ */
+static inline void worker_pool_init(worker_pool_t *pool)
+{
+    pthread_condattr_t attr;
+    int c;
+
+    memset(pool, 0, sizeof(*pool));
+    pthread_mutex_init(&pool->lock, NULL);
+    // Due times are CLOCK_MONOTONIC
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&pool->timer_cond, &attr);
+    pthread_condattr_destroy(&attr);
+    for (c = 0; c < POOL_CLASS_COUNT; c++)
+    {
+        sem_init(&pool->ready[c], 0, 0);
+    }
+}
+
+/**
+ * Add a task, due immediately (before worker_pool_start)
+ *
+ * @return task index, or -1 if the pool is full
+ */
+static inline int worker_pool_add(worker_pool_t *pool, pool_task_fn run, void *arg, pool_class_t cls)
+{
+    pool_task_t *t;
+
+    if (pool->task_count >= POOL_MAX_TASKS || cls >= POOL_CLASS_COUNT)
+    {
+        return -1;
+    }
+    t = &pool->tasks[pool->task_count];
+    t->run = run;
+    t->arg = arg;
+    t->cls = (uint8_t)cls;
+    t->heap_pos = -1;
+    return pool->task_count++;
+}
+
+/**
+ * Start the workers and the timer
+ *
+ * @param workers     Workers per class (a class with tasks gets at least one)
+ * @param thread_init Called once on each worker; its result is passed to every task run there
+ * @return 0 on success, -1 if a thread could not be created
+ */
+static inline int worker_pool_start(worker_pool_t *pool, const int workers[POOL_CLASS_COUNT],
+                                    int (*thread_init)(void))
+{
+    int class_tasks[POOL_CLASS_COUNT] = {0};
+    int next[POOL_CLASS_COUNT];
+    uint64_t now = mono_time_ns();
+    int c, i;
+
+    for (i = 0; i < pool->task_count; i++)
+    {
+        class_tasks[pool->tasks[i].cls]++;
+    }
+
+    for (c = 0; c < POOL_CLASS_COUNT; c++)
+    {
+        int n = workers[c];
+
+        if (n > class_tasks[c])
+        {
+            n = class_tasks[c];
+        }
+        if (n < 1 && class_tasks[c] > 0)
+        {
+            n = 1;
+        }
+        if (n > POOL_MAX_CLASS_WORKERS)
+        {
+            n = POOL_MAX_CLASS_WORKERS;
+        }
+        pool->class_first[c] = pool->worker_count;
+        pool->class_workers[c] = n;
+        next[c] = pool->worker_count;
+        for (i = 0; i < n; i++)
+        {
+            pool_worker_t *w = &pool->workers[pool->worker_count];
+
+            w->pool = pool;
+            w->index = pool->worker_count++;
+            w->cls = (uint8_t)c;
+            w->window_start_ns = now;
+            pthread_mutex_init(&w->lock, NULL);
+        }
+    }
+
+    // Spread the tasks over their class's workers; stealing evens out the rest
+    pthread_mutex_lock(&pool->lock);
+    for (i = 0; i < pool->task_count; i++)
+    {
+        pool_task_t *t = &pool->tasks[i];
+
+        t->worker = next[t->cls];
+        if (++next[t->cls] == pool->class_first[t->cls] + pool->class_workers[t->cls])
+        {
+            next[t->cls] = pool->class_first[t->cls];
+        }
+        pool_schedule(pool, i, now);
+    }
+    pthread_mutex_unlock(&pool->lock);
+
+    pool->thread_init = thread_init;
+    pool->running = true;
+    for (i = 0; i < pool->worker_count; i++)
+    {
+        if (pool_spawn(pool, &pool->workers[i].thread, pool->workers[i].cls, pool_worker_thread,
+                       &pool->workers[i]) != 0)
+        {
+            return -1;
+        }
+    }
+    if (pool_spawn(pool, &pool->timer_thread, POOL_ROLE_TIMER, pool_timer_thread, pool) != 0)
+    {
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * Run a task at most interval_ms after the start of its previous run, or at
+ * once if that has passed, instead of at its scheduled time. A task woken
+ * while it runs is held to the same limit after it finishes, so a sensor with
+ * a minimum read interval is never read again too soon.
+ */
+static inline void worker_pool_wake(worker_pool_t *pool, int task, uint32_t interval_ms)
+{
+    pool_task_t *t;
+    uint64_t now = mono_time_ns();
+    uint64_t due;
+
+    if (task < 0 || task >= pool->task_count)
+    {
+        return;
+    }
+    t = &pool->tasks[task];
+
+    pthread_mutex_lock(&pool->lock);
+    due = t->start_ns + (uint64_t)interval_ms * 1000000ULL;
+    if (due < now)
+    {
+        due = now;
+    }
+    if (t->state == POOL_TASK_WAITING && t->heap_pos >= 0 && due < t->due_ns)
+    {
+        t->due_ns = due;
+        pool_heap_up(pool, t->heap_pos);
+        if (t->heap_pos == 0)
+        {
+            pthread_cond_signal(&pool->timer_cond);
+        }
+    }
+    else if (t->state == POOL_TASK_RUNNING && (t->wake_ns == 0 || due < t->wake_ns))
+    {
+        t->wake_ns = due;
+    }
+    pthread_mutex_unlock(&pool->lock);
+}
+
+/**
+ * Read and reset a worker's counters
+ */
+static inline void worker_pool_take_stats(worker_pool_t *pool, int worker, pool_worker_stats_t *out)
+{
+    pool_worker_t *w = &pool->workers[worker];
+    uint64_t now = mono_time_ns();
+
+    pthread_mutex_lock(&w->lock);
+    *out = w->stats;
+    out->window_ns = now - w->window_start_ns;
+    memset(&w->stats, 0, sizeof(w->stats));
+    w->window_start_ns = now;
+    pthread_mutex_unlock(&w->lock);
+}
+
+/**
+ * Wait for the workers to exit (after worker_pool_stop, or forever)
+ */
+static inline void worker_pool_join(worker_pool_t *pool)
+{
+    int i;
+
+    for (i = 0; i < pool->worker_count; i++)
+    {
+        pthread_join(pool->workers[i].thread, NULL);
+    }
+    pthread_join(pool->timer_thread, NULL);
+}
+
+/**
+ * Ask the timer and the workers to exit once their current task is done
+ */
+static inline void worker_pool_stop(worker_pool_t *pool)
+{
+    int c, i;
+
+    pthread_mutex_lock(&pool->lock);
+    pool->running = false;
+    pthread_cond_broadcast(&pool->timer_cond);
+    pthread_mutex_unlock(&pool->lock);
+    for (c = 0; c < POOL_CLASS_COUNT; c++)
+    {
+        for (i = 0; i < pool->class_workers[c]; i++)
+        {
+            sem_post(&pool->ready[c]);
+        }
+    }
+}
+
+#endif // WORKER_POOL_H
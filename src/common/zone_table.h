@@ -0,0 +1,193 @@
+/*
+ * zone_table.h - Latest snapshot per zone and the house-wide view
+ *
+ * Every room or floor runs its own central_analyzer, tagged with a zone ID.
+ * stats_update keeps the most recent sensor_data_msg_t of each zone here,
+ * sorted by zone ID (the lowest one is the "primary" zone whose data fills
+ * the legacy dashboard fields), and merges them into one house-wide summary.
+ *
+ * A zone that has not reported for ZONE_OFFLINE_MS is shown as offline and
+ * left out of the house-wide readings. The table itself does no locking.
+ */
+
+#ifndef ZONE_TABLE_H
+#define ZONE_TABLE_H
+
+#include <stdint.h>
+#include <string.h>
+
+#include "../msg_def.h"
+
+#define ZONE_MAX 64            // Zones tracked by one stats_update
+#define ZONE_OFFLINE_MS 10000  // Silence after which a zone counts as offline
+
+typedef struct
+{
+    sensor_data_msg_t snapshot; // Latest message (only the used part of sensors[] is valid)
+    uint64_t updated_ms;        // Monotonic time of the latest message
+    uint32_t updates;           // Messages received from this zone
+} zone_entry_t;
+
+typedef struct
+{
+    zone_entry_t zones[ZONE_MAX];
+    int count;
+    uint32_t generation;        // Bumped on every update
+    uint32_t rejected;          // Messages from zones beyond ZONE_MAX
+} zone_table_t;
+
+typedef struct
+{
+    int zones;                  // Zones seen
+    int zones_online;           // ... that reported recently
+    int sensors;                // Sensor instances in online zones
+    int sensors_unhealthy;      // ... whose health is not ok
+    uint8_t alert_level;        // Highest alert level of any online zone
+    int temp_count;             // Valid temperature readings
+    int temp_min;
+    int temp_max;
+    float temp_avg;
+    float humidity_avg;
+    int smoke_detected;         // Gas sensors reporting gas (now or within the last interval)
+    int motion_detected;        // PIR sensors reporting motion (now or within the last interval)
+    int doors_open;             // Ultrasonic sensors reporting an open door
+} house_view_t;
+
+static inline int zone_online(const zone_entry_t *zone, uint64_t now_ms)
+{
+    return now_ms - zone->updated_ms <= ZONE_OFFLINE_MS;
+}
+
+/**
+ * Store a zone's latest snapshot
+ *
+ * @param table  Zone table
+ * @param msg    Received message
+ * @param len    Bytes of msg that were received
+ * @param now_ms Monotonic time of reception
+ * @return index of the zone's entry, or -1 if the table is full
+ */
+static inline int zone_table_update(zone_table_t *table, const sensor_data_msg_t *msg, size_t len,
+                                    uint64_t now_ms)
+{
+    int lo = 0;
+    int hi = table->count;
+
+    // Binary search for the zone (entries are sorted by zone ID)
+    while (lo < hi)
+    {
+        int mid = lo + (hi - lo) / 2;
+        if (table->zones[mid].snapshot.zone_id < msg->zone_id)
+        {
+            lo = mid + 1;
+        }
+        else
+        {
+            hi = mid;
+        }
+    }
+
+    if (lo == table->count || table->zones[lo].snapshot.zone_id != msg->zone_id)
+    {
+        if (table->count == ZONE_MAX)
+        {
+            table->rejected++;
+            return -1;
+        }
+        memmove(&table->zones[lo + 1], &table->zones[lo],
+                (size_t)(table->count - lo) * sizeof(table->zones[0]));
+        table->zones[lo].updates = 0;
+        table->count++;
+    }
+
+    zone_entry_t *zone = &table->zones[lo];
+    if (len > sizeof(zone->snapshot))
+    {
+        len = sizeof(zone->snapshot);
+    }
+    memcpy(&zone->snapshot, msg, len);
+    zone->updated_ms = now_ms;
+    zone->updates++;
+    table->generation++;
+    return lo;
+}
+
+/**
+ * Merge the online zones into one house-wide summary
+ */
+static inline void zone_table_house_view(const zone_table_t *table, uint64_t now_ms, house_view_t *out)
+{
+    float temp_sum = 0.0f;
+    float humidity_sum = 0.0f;
+    int z, i;
+
+    memset(out, 0, sizeof(*out));
+    out->zones = table->count;
+
+    for (z = 0; z < table->count; z++)
+    {
+        const zone_entry_t *zone = &table->zones[z];
+        const sensor_data_msg_t *msg = &zone->snapshot;
+
+        if (!zone_online(zone, now_ms))
+        {
+            continue;
+        }
+        out->zones_online++;
+        if (msg->alert_level > out->alert_level)
+        {
+            out->alert_level = msg->alert_level;
+        }
+
+        for (i = 0; i < msg->sensor_count; i++)
+        {
+            const sensor_reading_t *r = &msg->sensors[i];
+
+            out->sensors++;
+            if (r->health != SENSOR_HEALTH_OK)
+            {
+                out->sensors_unhealthy++;
+            }
+            if (!r->valid)
+            {
+                continue;
+            }
+            switch (r->type)
+            {
+            case SENSOR_TYPE_TEMPERATURE:
+                if (out->temp_count == 0 || r->value < out->temp_min)
+                {
+                    out->temp_min = r->value;
+                }
+                if (out->temp_count == 0 || r->value > out->temp_max)
+                {
+                    out->temp_max = r->value;
+                }
+                temp_sum += r->value;
+                humidity_sum += r->value2;
+                out->temp_count++;
+                break;
+            // Gas or motion seen at any time since the zone's previous snapshot counts
+            case SENSOR_TYPE_GAS:
+                out->smoke_detected += (r->state & SENSOR_STATE_ACTIVE) != 0 || r->window.active > 0;
+                break;
+            case SENSOR_TYPE_MOTION:
+                out->motion_detected += (r->state & SENSOR_STATE_ACTIVE) != 0 || r->window.active > 0;
+                break;
+            case SENSOR_TYPE_ULTRASONIC:
+                out->doors_open += (r->state & SENSOR_STATE_ACTIVE) == 0;
+                break;
+            default:
+                break;
+            }
+        }
+    }
+
+    if (out->temp_count > 0)
+    {
+        out->temp_avg = temp_sum / out->temp_count;
+        out->humidity_avg = humidity_sum / out->temp_count;
+    }
+}
+
+#endif // ZONE_TABLE_H
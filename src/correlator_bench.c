@@ -0,0 +1,193 @@
+/*
+ * correlator_bench.c
+ *
+ *  Event Correlation Benchmark:
+ *  - Measures the cost of one correlator_post() (analysis/event_correlator.h)
+ *    at synthetic event rates from 10 to 1,000,000 events per second of
+ *    simulated time
+ *  - Events are drawn at random from every kind; the rule table has the
+ *    analyzer's two rules plus ordered, counted and unordered rules over the
+ *    other kinds, up to CORR_MAX_RULES, all armed
+ *  - Matches are drained every 500 ms of simulated time, as the aggregation
+ *    tick does, so a fast rate also shows how many matches would be dropped
+ *  - Reports the mean, p50, p99 and worst per-post time, matches and drops
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "analysis/event_correlator.h"
+#include "common/mono_time.h"
+#include "msg_def.h"
+
+#define BENCH_BUCKETS 64 // Power-of-two histogram of per-call ns
+#define BENCH_DRAIN_MS 500
+
+typedef struct
+{
+    uint64_t total_ns;
+    uint64_t max_ns;
+    uint32_t buckets[BENCH_BUCKETS];
+} bench_times_t;
+
+static corr_rule_t g_rules[CORR_MAX_RULES];
+static int g_rule_count;
+static uint32_t g_events = 1000000;
+
+static int bucket_of(uint64_t ns)
+{
+    int b = 0;
+
+    while (ns > 1 && b < BENCH_BUCKETS - 1)
+    {
+        ns >>= 1;
+        b++;
+    }
+    return b;
+}
+
+static void record(bench_times_t *t, uint64_t ns)
+{
+    t->total_ns += ns;
+    t->buckets[bucket_of(ns)]++;
+    if (ns > t->max_ns)
+    {
+        t->max_ns = ns;
+    }
+}
+
+// Upper bound (ns) of the bucket holding the given fraction of calls
+static uint64_t percentile(const uint32_t *buckets, uint64_t total, double fraction)
+{
+    uint64_t seen = 0;
+    int b;
+
+    for (b = 0; b < BENCH_BUCKETS; b++)
+    {
+        seen += buckets[b];
+        if (seen >= (uint64_t)(fraction * total))
+        {
+            return 2ULL << b;
+        }
+    }
+    return UINT64_MAX;
+}
+
+static void add_rule(corr_event_t first, uint8_t count, corr_event_t second, uint32_t window_ms, uint8_t unordered)
+{
+    corr_rule_t *rule = &g_rules[g_rule_count++];
+
+    rule->first = first;
+    rule->first_count = count;
+    rule->second = second;
+    rule->window_ms = window_ms;
+    rule->unordered = unordered;
+    rule->requires_armed = 1;
+    rule->cooldown_ms = 60000;
+    rule->alert_type = ALERT_TYPE_INTRUSION;
+    rule->alert_level = ALERT_LEVEL_CRITICAL;
+    rule->pulse_code = -1;
+    rule->description = "bench";
+}
+
+// The analyzer's rules, then every other pair of kinds until the table is full
+static void build_rules(void)
+{
+    int a, b;
+
+    add_rule(CORR_EVT_DOOR_OPENED, 1, CORR_EVT_MOTION, 30000, 0);
+    add_rule(CORR_EVT_GAS, 1, CORR_EVT_TEMP_RISE, 60000, 1);
+    for (a = 0; a < CORR_EVT_COUNT && g_rule_count < CORR_MAX_RULES; a++)
+    {
+        for (b = 0; b < CORR_EVT_COUNT && g_rule_count < CORR_MAX_RULES; b++)
+        {
+            if (a != b)
+            {
+                add_rule((corr_event_t)a, (uint8_t)(1 + (a + b) % 3), (corr_event_t)b, 10000u * (uint32_t)(1 + b),
+                         (uint8_t)((a + b) % 2));
+            }
+        }
+    }
+}
+
+static void run(uint32_t rate)
+{
+    static correlator_t corr;
+    bench_times_t t = {0};
+    corr_match_t match;
+    uint64_t next_drain = BENCH_DRAIN_MS;
+    uint32_t i;
+
+    srand(1);
+    correlator_init(&corr, g_rules, g_rule_count);
+    for (i = 0; i < g_events; i++)
+    {
+        // Simulated time in ms of event i at the given rate
+        uint64_t now = 1 + (uint64_t)i * 1000 / rate;
+        corr_event_t event = (corr_event_t)(rand() % CORR_EVT_COUNT);
+        uint64_t start;
+
+        start = mono_time_ns();
+        correlator_post(&corr, event, now, true);
+        record(&t, mono_time_ns() - start);
+
+        if (now >= next_drain)
+        {
+            while (correlator_pop(&corr, &match))
+            {
+            }
+            next_drain = now + BENCH_DRAIN_MS;
+        }
+    }
+
+    printf("%8u ev/s: mean %6.1f ns  p50 <%5llu ns  p99 <%5llu ns  max %7.1f us  matches %6u  dropped %6u\n",
+           rate, (double)t.total_ns / g_events, (unsigned long long)percentile(t.buckets, g_events, 0.50),
+           (unsigned long long)percentile(t.buckets, g_events, 0.99), t.max_ns / 1e3, corr.total_matches,
+           corr.dropped);
+}
+
+int main(int argc, char *argv[])
+{
+    static const uint32_t rates[] = {10, 1000, 100000, 1000000};
+    uint64_t clock_ns;
+    size_t r;
+    int opt;
+    int i;
+
+    while ((opt = getopt(argc, argv, "n:")) != -1)
+    {
+        switch (opt)
+        {
+        case 'n':
+            g_events = (uint32_t)strtoul(optarg, NULL, 10);
+            break;
+        default:
+            fprintf(stderr, "Usage: %s [-n events]\n", argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+    if (g_events == 0)
+    {
+        fprintf(stderr, "Need at least one event\n");
+        return EXIT_FAILURE;
+    }
+    build_rules();
+
+    // Every timing includes one clock read
+    clock_ns = mono_time_ns();
+    for (i = 0; i < 100000; i++)
+    {
+        mono_time_ns();
+    }
+    clock_ns = (mono_time_ns() - clock_ns) / 100000;
+    printf("%u events per run, %d rules, %d events per kind kept, clock read %llu ns (included below)\n\n",
+           g_events, g_rule_count, CORR_QUEUE_CAP, (unsigned long long)clock_ns);
+
+    for (r = 0; r < sizeof(rates) / sizeof(rates[0]); r++)
+    {
+        run(rates[r]);
+    }
+    return EXIT_SUCCESS;
+}
@@ -5,24 +5,129 @@
  *      Author: Manjari
  */
 
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 #include <sys/neutrino.h>
 #include <sys/dispatch.h>
 
+#include "common/binlog.h"
+#include "common/heartbeat.h"
+#include "common/recv_pool.h"
+#include "common/span_trace.h"
+#include "common/thread_policy.h"
+
 #define MAX_MSG_LEN 128
+#define LOG_FILE "/home/qnxuser/home_safety.log"
+#define LOG_FILE_FALLBACK "./home_safety.log"
+#define CONFIG_FILE "/home/qnxuser/home_safety.conf" // Thread policies and receive pool
 
 typedef struct {
     uint16_t type;
     char text[MAX_MSG_LEN];
+    uint32_t seq;            // Snapshot the event belongs to (absent from older senders)
 } event_msg_t;
 
 typedef struct {
     uint16_t status;
 } event_reply_t;
 
-int main() {
+// The log file is shared by every receive thread. Lines are appended under
+// the lock in the order the threads get to it; one thread at a time flushes
+// everything appended so far, so concurrent events share one write.
+typedef struct {
+    FILE *file;
+    pthread_mutex_t lock;
+    pthread_cond_t flushed_cond;
+    uint64_t appended;       // Lines appended
+    uint64_t flushed;        // Lines known to be written
+    int flushing;            // A thread is in fflush()
+} event_log_t;
+
+static event_log_t g_log = {
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+    .flushed_cond = PTHREAD_COND_INITIALIZER,
+};
+
+// Receive pool: lo_water, hi_water, increment, maximum (recv_pool_event_logger)
+static const recv_pool_attr_t g_recv_pool_default = {1, 4, 1, 16};
+
+/**
+ * Append a line and return once it has been written
+ */
+static void log_append(const char *text) {
+    uint64_t line;
+
+    pthread_mutex_lock(&g_log.lock);
+    fprintf(g_log.file, "EVENT: %s\n", text);
+    line = ++g_log.appended;
+    while (g_log.flushed < line) {
+        if (g_log.flushing) {
+            pthread_cond_wait(&g_log.flushed_cond, &g_log.lock);
+            continue;
+        }
+        // Everything appended so far is in the buffer this flush writes
+        uint64_t upto = g_log.appended;
+
+        g_log.flushing = 1;
+        pthread_mutex_unlock(&g_log.lock);
+        fflush(g_log.file);
+        pthread_mutex_lock(&g_log.lock);
+        g_log.flushing = 0;
+        g_log.flushed = upto;
+        pthread_cond_broadcast(&g_log.flushed_cond);
+    }
+    pthread_mutex_unlock(&g_log.lock);
+}
+
+/**
+ * Receive pool handler - replies only after the event is written, so the
+ * events of one sender reach the file in the order it sent them
+ */
+static void receive_event(int rcvid, void *buf, const struct _msg_info *info, void *arg) {
+    event_msg_t *msg = buf;
+    event_reply_t reply;
+
+    (void)arg;
+    if (rcvid == 0) {
+        return; // system pulse, ignore
+    }
+    // Older senders send no sequence number, shorter ones less text
+    if (info->msglen < sizeof(*msg)) {
+        memset((char *)msg + info->msglen, 0, sizeof(*msg) - info->msglen);
+    }
+    msg->text[MAX_MSG_LEN - 1] = '\0';
+
+    // Log the event
+    uint64_t span = info->msglen >= sizeof(*msg) ? span_begin(msg->seq) : 0;
+    log_append(msg->text);
+    span_end(span, "logger_write", msg->seq, NULL);
+
+    LOG_INFO("Logged: %s", msg->text);
+
+    // Send reply
+    reply.status = 0;
+    MsgReply(rcvid, 0, &reply, sizeof(reply));
+}
+
+int main(int argc, char *argv[]) {
+    const char *config_path = CONFIG_FILE;
+    recv_pool_attr_t pool_attr = g_recv_pool_default;
+    recv_pool_t pool;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "c:")) != -1) {
+        switch (opt) {
+        case 'c':
+            config_path = optarg;
+            break;
+        default:
+            fprintf(stderr, "Usage: %s [-c config_file]\n", argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
 
     // Attach a named channel
     name_attach_t *attach = name_attach(NULL, "event_logger", 0);
@@ -33,41 +138,37 @@ int main() {
 
     printf("Event Logger Server started. Name: /event_logger\n");
 
-    FILE *logfile = fopen("/home/qnxuser/home_safety.log", "a");
-    if (!logfile) {
+    if (thread_policy_load(config_path) < 0 || recv_pool_load(config_path, "event_logger", &pool_attr) < 0) {
+        fprintf(stderr, "Invalid thread policies or receive pool in %s\n", config_path);
+        return EXIT_FAILURE;
+    }
+    // Log writes must not compete with sensor reads
+    thread_policy_apply_self(THREAD_CLASS_LOGGING);
+
+    g_log.file = fopen(LOG_FILE, "a");
+    if (!g_log.file) {
+        g_log.file = fopen(LOG_FILE_FALLBACK, "a");
+    }
+    if (!g_log.file) {
         perror("fopen");
         return -1;
     }
+    heartbeat_start(NULL, 0);
+    binlog_init(NULL);
+    if (span_trace_init("event_logger") != 0) {
+        perror("span_trace_init");
+    }
 
-
-    while (1) {
-        event_msg_t msg;
-        event_reply_t reply;
-        memset(&msg, 0, sizeof(msg));
-
-        int rcvid = MsgReceive(attach->chid, &msg, sizeof(msg), NULL);
-
-        if (rcvid == -1) {
-            perror("MsgReceive");
-            continue;
-        }
-
-        if (rcvid == 0) {
-            continue; // system pulse, ignore
-        }
-
-        // Log the event
-        fprintf(logfile, "EVENT: %s\n", msg.text);
-        fflush(logfile);
-
-        printf("Logged: %s\n", msg.text);
-
-        // Send reply
-        reply.status = 0;
-        MsgReply(rcvid, 0, &reply, sizeof(reply));
+    recv_pool_init(&pool, "event_logger", attach->chid, sizeof(event_msg_t), THREAD_CLASS_LOGGING,
+                   receive_event, NULL, &pool_attr);
+    recv_pool_print(&pool);
+    if (recv_pool_start(&pool) != 0) {
+        fprintf(stderr, "Failed to create receive threads\n");
+        return EXIT_FAILURE;
     }
+    recv_pool_wait(&pool);
 
-    fclose(logfile);
+    fclose(g_log.file);
     name_detach(attach, 0);
     return 0;
 }
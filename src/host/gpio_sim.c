@@ -0,0 +1,439 @@
+/*
+ * gpio_sim.c - Simulated Raspberry Pi GPIO for the Linux host build
+ *
+ * Implements the rpi_gpio API (common/public/rpi_gpio.h) and the register
+ * calls of sys/rpi_gpio.h against simulated devices, so the sensor drivers
+ * run unchanged and with their real timing:
+ *
+ *  - DHT11: a pin switched back to input after a start signal (output LOW,
+ *    then HIGH) plays the sensor's response and 40-bit frame in real time,
+ *    from a temperature/humidity following the time of day. About 1 frame
+ *    in 50 has a corrupted bit, so the retry path is exercised.
+ *  - HC-SR04: releasing a trigger pin schedules an echo pulse whose length
+ *    matches the distance of a door that is closed (4 cm) most of the time.
+ *    About 1 ping in 30 gets no echo (a timeout) and 1 in 20 a stray echo at
+ *    a random distance, so the burst filter has something to reject.
+ *    rpi_gpio_read() returns the echo of the last trigger of the calling thread.
+ *  - Gas (MQ135, active LOW) and PIR (active HIGH) inputs raise random
+ *    events with exponentially distributed gaps.
+ *  - LED outputs print their changes.
+ *
+ * Pin roles default to the on-board wiring (gas 27, PIR 21, LED 16) and can be
+ * set with GPIO_SIM_PINS, e.g. "27=gas,21=pir,22=pir,16=led". GPIO_SIM_EVENTS
+ * scales the event rates (default 1) and GPIO_SIM_SEED fixes the random seed.
+ */
+
+#include <math.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../common/public/rpi_gpio.h"
+
+#define SIM_DHT_START_WINDOW_NS 100000000ULL // Output LOW -> input within 100 ms starts a frame
+#define SIM_DHT_CORRUPT_PER_1000 20
+#define SIM_ECHO_DELAY_US 250                // Trigger to echo start
+#define SIM_SPEED_OF_SOUND_CM_PER_US 0.0343
+#define SIM_DOOR_CLOSED_CM 4
+#define SIM_DOOR_OPEN_CM 120
+#define SIM_ECHO_LOST_PER_1000 33
+#define SIM_ECHO_STRAY_PER_1000 50
+#define SIM_ECHO_STRAY_MAX_CM 300
+
+typedef enum
+{
+    SIM_PIN_NONE,
+    SIM_PIN_GAS,
+    SIM_PIN_PIR,
+    SIM_PIN_LED
+} sim_role_t;
+
+// Random on/off events: off for an exponential gap (mean_gap_s), on for hold_s
+typedef struct
+{
+    double mean_gap_s;
+    double hold_s;
+    bool active;
+    uint64_t next_ns;
+} sim_events_t;
+
+typedef struct
+{
+    sim_role_t role;
+    int function;             // RPI_GPIO_FUNC_IN / OUT
+    unsigned level;           // Output level (GPIO_LOW / GPIO_HIGH)
+    uint64_t low_since_ns;    // Start signal: time the output went LOW
+    uint64_t dht_start_ns;    // Frame start (0 = none)
+    uint64_t dht_edges[84];   // Offsets (ns) at which the level toggles
+    int dht_edge_count;
+    sim_events_t events;      // Gas/PIR events, or door openings for a trigger pin
+} sim_pin_t;
+
+typedef struct
+{
+    uint64_t start_ns;
+    uint64_t end_ns;
+} sim_echo_t;
+
+// central_analyzer defines its own (as on the target)
+__attribute__((weak)) volatile uint32_t *__RPI_GPIO_REGS;
+
+static uint32_t g_sim_regs[64];
+static sim_pin_t g_pins[GPIO_COUNT];
+static pthread_mutex_t g_sim_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t g_sim_once = PTHREAD_ONCE_INIT;
+static unsigned g_sim_seed;
+static double g_sim_event_scale = 1.0;
+static __thread sim_echo_t tl_echo;
+
+static uint64_t sim_now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static double sim_uniform(void)
+{
+    return (rand_r(&g_sim_seed) + 1.0) / ((double)RAND_MAX + 2.0);
+}
+
+// Advance an event source to now; caller holds g_sim_lock
+static bool sim_events_active(sim_events_t *ev, uint64_t now)
+{
+    while (now >= ev->next_ns)
+    {
+        double span = ev->active ? -log(sim_uniform()) * ev->mean_gap_s / g_sim_event_scale : ev->hold_s;
+
+        ev->active = !ev->active;
+        ev->next_ns += (uint64_t)(span * 1e9);
+    }
+    return ev->active;
+}
+
+static void sim_events_init(sim_events_t *ev, double mean_gap_s, double hold_s, uint64_t now)
+{
+    ev->mean_gap_s = mean_gap_s;
+    ev->hold_s = hold_s;
+    ev->active = false;
+    ev->next_ns = now + (uint64_t)(-log(sim_uniform()) * mean_gap_s / g_sim_event_scale * 1e9);
+}
+
+static void sim_init(void)
+{
+    const char *pins = getenv("GPIO_SIM_PINS");
+    const char *scale = getenv("GPIO_SIM_EVENTS");
+    const char *seed = getenv("GPIO_SIM_SEED");
+    uint64_t now = sim_now_ns();
+    int i;
+
+    g_sim_seed = seed ? (unsigned)strtoul(seed, NULL, 10) : (unsigned)now;
+    if (scale && atof(scale) > 0)
+    {
+        g_sim_event_scale = atof(scale);
+    }
+    if (!pins)
+    {
+        pins = "27=gas,21=pir,16=led";
+    }
+
+    while (*pins)
+    {
+        char role[8] = "";
+        int pin = -1;
+        int used = 0;
+
+        if (sscanf(pins, "%d=%7[a-z]%n", &pin, role, &used) != 2 || used == 0)
+        {
+            break;
+        }
+        if (pin >= 0 && pin < GPIO_COUNT)
+        {
+            g_pins[pin].role = strcmp(role, "gas") == 0   ? SIM_PIN_GAS
+                               : strcmp(role, "pir") == 0 ? SIM_PIN_PIR
+                               : strcmp(role, "led") == 0 ? SIM_PIN_LED
+                                                          : SIM_PIN_NONE;
+        }
+        pins += used;
+        pins += *pins == ',';
+    }
+
+    printf("[GPIO_SIM] Simulated pins:");
+    for (i = 0; i < GPIO_COUNT; i++)
+    {
+        g_pins[i].level = GPIO_HIGH;
+        switch (g_pins[i].role)
+        {
+        case SIM_PIN_GAS:
+            sim_events_init(&g_pins[i].events, 3600.0, 20.0, now); // Rare, lasting
+            printf(" gas=%d", i);
+            break;
+        case SIM_PIN_PIR:
+            sim_events_init(&g_pins[i].events, 60.0, 5.0, now);
+            printf(" pir=%d", i);
+            break;
+        case SIM_PIN_LED:
+            g_pins[i].level = GPIO_LOW;
+            printf(" led=%d", i);
+            break;
+        default:
+            // Door behind any ultrasonic trigger on this pin: opened every few minutes
+            sim_events_init(&g_pins[i].events, 180.0, 15.0, now);
+            break;
+        }
+    }
+    printf(" (DHT11 and HC-SR04 on any other pin)\n");
+}
+
+static sim_pin_t *sim_pin(int gpio_pin)
+{
+    pthread_once(&g_sim_once, sim_init);
+    return gpio_pin >= 0 && gpio_pin < GPIO_COUNT ? &g_pins[gpio_pin] : NULL;
+}
+
+// Build the DHT11 response and frame; caller holds g_sim_lock
+static void sim_dht_start(sim_pin_t *p, uint64_t now)
+{
+    time_t wall = time(NULL);
+    struct tm tm;
+    double hour;
+    uint8_t data[5];
+    uint64_t t = 30000; // Sensor answers 20-40 us after the line is released
+    int i;
+
+    localtime_r(&wall, &tm);
+    hour = tm.tm_hour + tm.tm_min / 60.0;
+    data[0] = (uint8_t)(50 - 10 * cos((hour - 15) * M_PI / 12) + (sim_uniform() - 0.5) * 2);
+    data[1] = 0;
+    data[2] = (uint8_t)(22 + 3 * cos((hour - 15) * M_PI / 12) + (sim_uniform() - 0.5) * 1.5);
+    data[3] = 0;
+    data[4] = (uint8_t)(data[0] + data[1] + data[2] + data[3]);
+    if (rand_r(&g_sim_seed) % 1000 < SIM_DHT_CORRUPT_PER_1000)
+    {
+        data[rand_r(&g_sim_seed) % 5] ^= 0x04;
+    }
+
+    p->dht_edge_count = 0;
+    p->dht_edges[p->dht_edge_count++] = t; // LOW 80 us
+    t += 80000;
+    p->dht_edges[p->dht_edge_count++] = t; // HIGH 80 us
+    t += 80000;
+    for (i = 0; i < 40; i++)
+    {
+        int bit = (data[i / 8] >> (7 - i % 8)) & 1;
+
+        p->dht_edges[p->dht_edge_count++] = t; // LOW 50 us
+        t += 50000;
+        p->dht_edges[p->dht_edge_count++] = t; // HIGH 27 us (0) or 70 us (1)
+        t += bit ? 70000 : 27000;
+    }
+    p->dht_edges[p->dht_edge_count++] = t; // LOW 50 us, then released
+    t += 50000;
+    p->dht_edges[p->dht_edge_count++] = t;
+    p->dht_start_ns = now;
+}
+
+// Line level during a DHT11 frame (HIGH before and after); caller holds g_sim_lock
+static unsigned sim_dht_level(sim_pin_t *p, uint64_t now)
+{
+    uint64_t offset = now - p->dht_start_ns;
+    int toggles = 0;
+
+    while (toggles < p->dht_edge_count && p->dht_edges[toggles] <= offset)
+    {
+        toggles++;
+    }
+    if (toggles == p->dht_edge_count)
+    {
+        p->dht_start_ns = 0;
+    }
+    return toggles % 2 ? GPIO_LOW : GPIO_HIGH;
+}
+
+int rpi_gpio_setup(int gpio_pin, unsigned configuration)
+{
+    sim_pin_t *p = sim_pin(gpio_pin);
+    uint64_t now = sim_now_ns();
+
+    if (!p || (configuration != GPIO_IN && configuration != GPIO_OUT))
+    {
+        return GPIO_ERROR_INPUT_OUT_OF_RANGE;
+    }
+    pthread_mutex_lock(&g_sim_lock);
+    if (configuration == GPIO_IN && p->function == RPI_GPIO_FUNC_OUT && p->level == GPIO_HIGH &&
+        p->low_since_ns && now - p->low_since_ns < SIM_DHT_START_WINDOW_NS)
+    {
+        sim_dht_start(p, now);
+    }
+    p->function = configuration == GPIO_IN ? RPI_GPIO_FUNC_IN : RPI_GPIO_FUNC_OUT;
+    pthread_mutex_unlock(&g_sim_lock);
+    return GPIO_SUCCESS;
+}
+
+int rpi_gpio_setup_pull(int gpio_pin, unsigned configuration, unsigned direction)
+{
+    (void)direction;
+    return rpi_gpio_setup(gpio_pin, configuration);
+}
+
+int rpi_gpio_setup_pwm(int gpio_pin, unsigned frequency, unsigned mode)
+{
+    (void)frequency;
+    (void)mode;
+    return sim_pin(gpio_pin) ? GPIO_SUCCESS : GPIO_ERROR_INPUT_OUT_OF_RANGE;
+}
+
+int rpi_gpio_set_pwm_duty_cycle(int gpio_pin, float percentage)
+{
+    (void)percentage;
+    return sim_pin(gpio_pin) ? GPIO_SUCCESS : GPIO_ERROR_INPUT_OUT_OF_RANGE;
+}
+
+int rpi_gpio_get_setup(int gpio_pin, unsigned *configuration)
+{
+    sim_pin_t *p = sim_pin(gpio_pin);
+
+    if (!p)
+    {
+        return GPIO_ERROR_INPUT_OUT_OF_RANGE;
+    }
+    *configuration = p->function == RPI_GPIO_FUNC_OUT ? GPIO_OUT : GPIO_IN;
+    return GPIO_SUCCESS;
+}
+
+int rpi_gpio_output(int gpio_pin, unsigned level)
+{
+    sim_pin_t *p = sim_pin(gpio_pin);
+
+    if (!p || (level != GPIO_LOW && level != GPIO_HIGH))
+    {
+        return GPIO_ERROR_INPUT_OUT_OF_RANGE;
+    }
+    pthread_mutex_lock(&g_sim_lock);
+    if (level == GPIO_LOW && p->level != GPIO_LOW)
+    {
+        p->low_since_ns = sim_now_ns();
+    }
+    if (p->role == SIM_PIN_LED && level != p->level)
+    {
+        printf("[GPIO_SIM] LED on GPIO%d %s\n", gpio_pin, level == GPIO_HIGH ? "ON" : "OFF");
+    }
+    p->level = level;
+    pthread_mutex_unlock(&g_sim_lock);
+    return GPIO_SUCCESS;
+}
+
+int rpi_gpio_input(int gpio_pin, unsigned *level)
+{
+    sim_pin_t *p = sim_pin(gpio_pin);
+    uint64_t now = sim_now_ns();
+
+    if (!p)
+    {
+        return GPIO_ERROR_INPUT_OUT_OF_RANGE;
+    }
+    pthread_mutex_lock(&g_sim_lock);
+    if (p->dht_start_ns)
+    {
+        *level = sim_dht_level(p, now);
+    }
+    else if (p->role == SIM_PIN_GAS)
+    {
+        *level = sim_events_active(&p->events, now) ? GPIO_LOW : GPIO_HIGH;
+    }
+    else if (p->role == SIM_PIN_PIR)
+    {
+        *level = sim_events_active(&p->events, now) ? GPIO_HIGH : GPIO_LOW;
+    }
+    else
+    {
+        *level = p->function == RPI_GPIO_FUNC_OUT ? p->level : GPIO_HIGH; // Idle DHT11 line is pulled up
+    }
+    pthread_mutex_unlock(&g_sim_lock);
+    return GPIO_SUCCESS;
+}
+
+int rpi_gpio_add_event_detect(int gpio_pin, int coid, unsigned event, unsigned event_id)
+{
+    (void)coid;
+    (void)event;
+    (void)event_id;
+    return sim_pin(gpio_pin) ? GPIO_SUCCESS : GPIO_ERROR_INPUT_OUT_OF_RANGE;
+}
+
+int rpi_gpio_cleanup(void)
+{
+    return GPIO_SUCCESS;
+}
+
+bool rpi_gpio_map_regs(uint64_t base)
+{
+    (void)base;
+    __RPI_GPIO_REGS = g_sim_regs;
+    return true;
+}
+
+void rpi_gpio_set_select(int gpio, int function)
+{
+    sim_pin_t *p = sim_pin(gpio);
+
+    if (p)
+    {
+        p->function = function;
+    }
+}
+
+void rpi_gpio_set_pud_bcm2711(int gpio, int pud)
+{
+    (void)gpio;
+    (void)pud;
+}
+
+void rpi_gpio_set(int gpio)
+{
+    sim_pin(gpio);
+}
+
+// Trigger released: the echo of this ping starts shortly and lasts for the round trip
+void rpi_gpio_clear(int gpio)
+{
+    sim_pin_t *p = sim_pin(gpio);
+    uint64_t now = sim_now_ns();
+    double distance_cm;
+    double fault;
+
+    if (!p)
+    {
+        return;
+    }
+    pthread_mutex_lock(&g_sim_lock);
+    distance_cm = (sim_events_active(&p->events, now) ? SIM_DOOR_OPEN_CM : SIM_DOOR_CLOSED_CM) +
+                  (sim_uniform() - 0.5);
+    fault = sim_uniform() * 1000;
+    if (fault >= SIM_ECHO_LOST_PER_1000 && fault < SIM_ECHO_LOST_PER_1000 + SIM_ECHO_STRAY_PER_1000)
+    {
+        distance_cm = 2 + sim_uniform() * (SIM_ECHO_STRAY_MAX_CM - 2);
+    }
+    pthread_mutex_unlock(&g_sim_lock);
+    if (fault < SIM_ECHO_LOST_PER_1000)
+    {
+        // No echo: the driver times out waiting for the rising edge
+        tl_echo.start_ns = tl_echo.end_ns = 0;
+        return;
+    }
+    tl_echo.start_ns = now + SIM_ECHO_DELAY_US * 1000ULL;
+    tl_echo.end_ns = tl_echo.start_ns + (uint64_t)(2.0 * distance_cm / SIM_SPEED_OF_SOUND_CM_PER_US * 1000.0);
+}
+
+unsigned rpi_gpio_read(int gpio)
+{
+    uint64_t now = sim_now_ns();
+
+    (void)gpio;
+    return now >= tl_echo.start_ns && now < tl_echo.end_ns;
+}
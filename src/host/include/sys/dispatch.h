@@ -0,0 +1,29 @@
+/*
+ * sys/dispatch.h - QNX name service for the Linux host build
+ *
+ * name_attach() binds a Unix socket named after the service in the directory
+ * given by HOME_SAFETY_IPC_DIR (default /tmp/home_safety_ipc), and
+ * name_open() connects to it; see host/qnx_shim.c.
+ */
+
+#ifndef HOST_SYS_DISPATCH_H
+#define HOST_SYS_DISPATCH_H
+
+#include <sys/neutrino.h>
+
+typedef struct _dispatch dispatch_t;
+
+typedef struct _name_attach
+{
+    dispatch_t *dpp;
+    int chid;
+    int mntid;
+    int zero[2];
+} name_attach_t;
+
+name_attach_t *name_attach(dispatch_t *dpp, const char *path, unsigned flags);
+int name_detach(name_attach_t *attach, unsigned flags);
+int name_open(const char *name, int flags);
+int name_close(int coid);
+
+#endif // HOST_SYS_DISPATCH_H
@@ -0,0 +1,10 @@
+/*
+ * sys/netmgr.h - QNX network manager constants for the Linux host build
+ */
+
+#ifndef HOST_SYS_NETMGR_H
+#define HOST_SYS_NETMGR_H
+
+#define ND_LOCAL_NODE 0
+
+#endif // HOST_SYS_NETMGR_H
@@ -0,0 +1,84 @@
+/*
+ * sys/neutrino.h - QNX kernel calls for the Linux host build
+ *
+ * Channels, connections, messages and pulses are emulated with Unix
+ * sockets (see host/qnx_shim.c); ClockCycles() counts nanoseconds. Only what
+ * this project uses is provided, with the QNX semantics it relies on:
+ * MsgSend() blocks until MsgReply()/MsgError(), MsgReceive() returns 0 for a
+ * pulse and fails with EINTR when a signal arrives, and a send to a server
+ * that has gone away fails with ESRCH.
+ */
+
+#ifndef HOST_SYS_NEUTRINO_H
+#define HOST_SYS_NEUTRINO_H
+
+#include <errno.h>
+#include <signal.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+#include <time.h>
+
+#define EOK 0
+
+#define _PULSE_CODE_MINAVAIL 0
+#define _PULSE_CODE_MAXAVAIL 127
+#define _IO_MSG 0x10f
+
+#define _NTO_SIDE_CHANNEL 0x40000000
+#define _NTO_TCTL_IO 14
+#define _NTO_TCTL_RUNMASK 4
+
+#define SIGEV_PULSE_PRIO_INHERIT (-1)
+
+struct _pulse
+{
+    uint16_t type;
+    uint16_t subtype;
+    int8_t code;
+    uint8_t zero[3];
+    union sigval value;
+    int32_t scoid;
+};
+
+struct _msg_info
+{
+    uint32_t nd;
+    uint32_t srcnd;
+    pid_t pid;
+    int32_t tid;
+    int32_t chid;
+    int32_t scoid;
+    int32_t coid;
+    int32_t priority;
+    size_t msglen;      // Bytes received
+    size_t srcmsglen;   // Bytes sent
+    size_t dstmsglen;
+};
+
+struct _clockperiod
+{
+    uint32_t nsec;
+    int32_t fract;
+};
+
+int ChannelCreate(unsigned flags);
+int ChannelDestroy(int chid);
+int ConnectAttach(uint32_t nd, pid_t pid, int chid, unsigned index, int flags);
+int ConnectDetach(int coid);
+
+long MsgSend(int coid, const void *smsg, size_t sbytes, void *rmsg, size_t rbytes);
+int MsgReceive(int chid, void *msg, size_t bytes, struct _msg_info *info);
+int MsgReply(int rcvid, long status, const void *msg, size_t bytes);
+int MsgError(int rcvid, int error);
+int MsgSendPulse(int coid, int priority, int code, int value);
+
+uint64_t ClockCycles(void);
+int ClockPeriod(clockid_t id, const struct _clockperiod *period, struct _clockperiod *old, int reserved);
+int ThreadCtl(int cmd, void *data);
+
+// Timers deliver pulses from a notification thread (SIGEV_THREAD)
+void host_sigev_pulse_init(struct sigevent *event, int coid, int priority, int code, int value);
+#define SIGEV_PULSE_INIT(event, coid, priority, code, value) host_sigev_pulse_init(event, coid, priority, code, value)
+
+#endif // HOST_SYS_NEUTRINO_H
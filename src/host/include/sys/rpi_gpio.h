@@ -0,0 +1,29 @@
+/*
+ * sys/rpi_gpio.h - Raspberry Pi GPIO definitions for the Linux host build
+ *
+ * The register-level calls act on the simulated pins of host/gpio_sim.c.
+ */
+
+#ifndef HOST_SYS_RPI_GPIO_H
+#define HOST_SYS_RPI_GPIO_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define RPI_GPIO_FUNC_IN 0
+#define RPI_GPIO_FUNC_OUT 1
+
+#define RPI_GPIO_PUD_OFF 0
+#define RPI_GPIO_PUD_DOWN 1
+#define RPI_GPIO_PUD_UP 2
+
+extern volatile uint32_t *__RPI_GPIO_REGS;
+
+bool rpi_gpio_map_regs(uint64_t base);
+void rpi_gpio_set_select(int gpio, int function);
+void rpi_gpio_set_pud_bcm2711(int gpio, int pud);
+void rpi_gpio_set(int gpio);
+void rpi_gpio_clear(int gpio);
+unsigned rpi_gpio_read(int gpio);
+
+#endif // HOST_SYS_RPI_GPIO_H
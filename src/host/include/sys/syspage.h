@@ -0,0 +1,21 @@
+/*
+ * sys/syspage.h - QNX system page for the Linux host build
+ *
+ * Only the clock rate is provided: ClockCycles() counts nanoseconds.
+ */
+
+#ifndef HOST_SYS_SYSPAGE_H
+#define HOST_SYS_SYSPAGE_H
+
+#include <stdint.h>
+
+struct qtime_entry
+{
+    uint64_t cycles_per_sec;
+};
+
+extern struct qtime_entry host_qtime;
+
+#define SYSPAGE_ENTRY(entry) (&host_##entry)
+
+#endif // HOST_SYS_SYSPAGE_H
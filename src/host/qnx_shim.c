@@ -0,0 +1,655 @@
+/*
+ * qnx_shim.c - QNX message passing and timing calls on Linux
+ *
+ * Used by the host build (make HOST=1) in place of the QNX kernel calls:
+ *
+ *  - A channel is an epoll set. name_attach() adds a listening AF_UNIX
+ *    SOCK_SEQPACKET socket at $HOME_SAFETY_IPC_DIR/<name> to it, and every
+ *    accepted client connection. Local pulses (ConnectAttach() to the
+ *    process's own channel, timer pulses) go through a pipe in the same set.
+ *  - name_open() connects a socket; the socket is the connection ID.
+ *  - A message or pulse is one packet: host_frame_t, then the payload. The
+ *    receive ID is the server side of the client's socket, which stays out of
+ *    the epoll set (EPOLLONESHOT) until the reply, so several threads can
+ *    MsgReceive() on one channel while each client has one message in flight.
+ *  - ClockCycles() is CLOCK_MONOTONIC in nanoseconds.
+ *
+ * A server that exits closes its sockets: the client's next MsgSend() or
+ * MsgSendPulse() fails with ESRCH, as on QNX.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <sys/dispatch.h>
+#include <sys/neutrino.h>
+#include <sys/syspage.h>
+
+#define HOST_IPC_DIR_ENV "HOME_SAFETY_IPC_DIR"
+#define HOST_IPC_DIR_DEFAULT "/tmp/home_safety_ipc"
+#define HOST_MAX_CHANNELS 16
+#define HOST_MAX_FDS 1024
+#define HOST_LISTEN_BACKLOG 64
+
+enum
+{
+    FRAME_MSG = 1,
+    FRAME_PULSE,
+    FRAME_REPLY,
+    FRAME_ERROR
+};
+
+typedef struct
+{
+    uint32_t type;
+    int32_t code;     // Pulse code
+    int32_t value;    // Pulse value, reply status or error number
+    int32_t pid;      // Sender
+} host_frame_t;
+
+typedef struct
+{
+    int used;
+    int epfd;
+    int listen_fd;    // -1 for an unnamed channel
+    int pulse_rd;
+    int pulse_wr;
+    char path[sizeof(((struct sockaddr_un *)0)->sun_path)];
+} host_channel_t;
+
+typedef struct
+{
+    int coid;
+    int code;
+    int value;
+} host_timer_pulse_t;
+
+struct qtime_entry host_qtime = {1000000000ULL};
+
+static host_channel_t g_channels[HOST_MAX_CHANNELS];
+static pthread_mutex_t g_channels_lock = PTHREAD_MUTEX_INITIALIZER;
+
+// Per file descriptor: channel of a server-side socket, local-pulse flag of a
+// connection, and the lock that keeps one MsgSend() at a time on a connection
+static int g_fd_chid[HOST_MAX_FDS];
+static uint8_t g_fd_local[HOST_MAX_FDS];
+static pthread_mutex_t g_fd_lock[HOST_MAX_FDS] = {[0 ... HOST_MAX_FDS - 1] = PTHREAD_MUTEX_INITIALIZER};
+
+static host_channel_t *channel_get(int chid)
+{
+    if (chid < 1 || chid > HOST_MAX_CHANNELS || !g_channels[chid - 1].used)
+    {
+        errno = EINVAL;
+        return NULL;
+    }
+    return &g_channels[chid - 1];
+}
+
+static int fd_valid(int fd)
+{
+    if (fd < 0 || fd >= HOST_MAX_FDS)
+    {
+        errno = EBADF;
+        return 0;
+    }
+    return 1;
+}
+
+// A peer that has gone away is reported the QNX way
+static int peer_errno(int err)
+{
+    return (err == EPIPE || err == ECONNRESET || err == ENOTCONN || err == ECONNREFUSED) ? ESRCH : err;
+}
+
+static void ipc_path(const char *name, char *path, size_t size)
+{
+    const char *dir = getenv(HOST_IPC_DIR_ENV);
+
+    if (!dir || !*dir)
+    {
+        dir = HOST_IPC_DIR_DEFAULT;
+    }
+    mkdir(dir, 0777);
+    snprintf(path, size, "%s/%s", dir, name[0] == '/' ? name + 1 : name);
+}
+
+static int send_frame(int fd, const host_frame_t *frame, const void *data, size_t size)
+{
+    struct iovec iov[2] = {{(void *)frame, sizeof(*frame)}, {(void *)data, size}};
+    struct msghdr mh;
+
+    memset(&mh, 0, sizeof(mh));
+    mh.msg_iov = iov;
+    mh.msg_iovlen = data && size ? 2 : 1;
+    if (sendmsg(fd, &mh, MSG_NOSIGNAL) == -1)
+    {
+        errno = peer_errno(errno);
+        return -1;
+    }
+    return 0;
+}
+
+// Receive one packet; returns the payload size as sent (may exceed size), 0 if the peer closed
+static ssize_t recv_frame(int fd, host_frame_t *frame, void *data, size_t size, int flags)
+{
+    struct iovec iov[2] = {{frame, sizeof(*frame)}, {data, size}};
+    struct msghdr mh;
+    ssize_t n;
+
+    memset(&mh, 0, sizeof(mh));
+    mh.msg_iov = iov;
+    mh.msg_iovlen = data && size ? 2 : 1;
+    do
+    {
+        n = recvmsg(fd, &mh, flags | MSG_TRUNC);
+    } while (n == -1 && errno == EINTR && !(flags & MSG_DONTWAIT));
+    if (n == -1)
+    {
+        errno = peer_errno(errno);
+        return -1;
+    }
+    if (n == 0)
+    {
+        return 0;
+    }
+    if ((size_t)n < sizeof(*frame))
+    {
+        errno = EBADMSG;
+        return -1;
+    }
+    return n - (ssize_t)sizeof(*frame) + 1; // +1 so an empty payload is not "closed"
+}
+
+int ChannelCreate(unsigned flags)
+{
+    host_channel_t *ch = NULL;
+    struct epoll_event ev;
+    int fds[2];
+    int i;
+
+    (void)flags;
+    pthread_mutex_lock(&g_channels_lock);
+    for (i = 0; i < HOST_MAX_CHANNELS; i++)
+    {
+        if (!g_channels[i].used)
+        {
+            ch = &g_channels[i];
+            break;
+        }
+    }
+    if (!ch)
+    {
+        pthread_mutex_unlock(&g_channels_lock);
+        errno = EAGAIN;
+        return -1;
+    }
+    memset(ch, 0, sizeof(*ch));
+    ch->listen_fd = -1;
+    ch->epfd = epoll_create1(EPOLL_CLOEXEC);
+    if (ch->epfd == -1 || pipe2(fds, O_CLOEXEC | O_NONBLOCK) == -1)
+    {
+        int err = errno;
+
+        if (ch->epfd != -1)
+        {
+            close(ch->epfd);
+        }
+        pthread_mutex_unlock(&g_channels_lock);
+        errno = err;
+        return -1;
+    }
+    ch->pulse_rd = fds[0];
+    ch->pulse_wr = fds[1];
+    ev.events = EPOLLIN;
+    ev.data.fd = ch->pulse_rd;
+    epoll_ctl(ch->epfd, EPOLL_CTL_ADD, ch->pulse_rd, &ev);
+    ch->used = 1;
+    pthread_mutex_unlock(&g_channels_lock);
+    return i + 1;
+}
+
+int ChannelDestroy(int chid)
+{
+    host_channel_t *ch = channel_get(chid);
+
+    if (!ch)
+    {
+        return -1;
+    }
+    pthread_mutex_lock(&g_channels_lock);
+    if (ch->listen_fd != -1)
+    {
+        close(ch->listen_fd);
+        unlink(ch->path);
+    }
+    close(ch->pulse_rd);
+    close(ch->pulse_wr);
+    close(ch->epfd);
+    ch->used = 0;
+    pthread_mutex_unlock(&g_channels_lock);
+    return 0;
+}
+
+// Only connections to a channel of this process are supported (pulses to self)
+int ConnectAttach(uint32_t nd, pid_t pid, int chid, unsigned index, int flags)
+{
+    host_channel_t *ch = channel_get(chid);
+    int coid;
+
+    (void)index;
+    (void)flags;
+    if (!ch)
+    {
+        return -1;
+    }
+    if (nd != 0 || (pid != 0 && pid != getpid()))
+    {
+        errno = ENOTSUP;
+        return -1;
+    }
+    coid = fcntl(ch->pulse_wr, F_DUPFD_CLOEXEC, 3);
+    if (coid == -1 || !fd_valid(coid))
+    {
+        return -1;
+    }
+    g_fd_local[coid] = 1;
+    return coid;
+}
+
+int ConnectDetach(int coid)
+{
+    if (!fd_valid(coid))
+    {
+        return -1;
+    }
+    g_fd_local[coid] = 0;
+    return close(coid);
+}
+
+name_attach_t *name_attach(dispatch_t *dpp, const char *path, unsigned flags)
+{
+    struct sockaddr_un addr;
+    struct epoll_event ev;
+    name_attach_t *attach;
+    host_channel_t *ch;
+    int probe;
+    int chid;
+
+    (void)flags;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    ipc_path(path, addr.sun_path, sizeof(addr.sun_path));
+
+    // A live server already owns the name; a stale socket file is replaced
+    probe = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+    if (probe != -1 && connect(probe, (struct sockaddr *)&addr, sizeof(addr)) == 0)
+    {
+        close(probe);
+        errno = EEXIST;
+        return NULL;
+    }
+    if (probe != -1)
+    {
+        close(probe);
+    }
+    unlink(addr.sun_path);
+
+    chid = ChannelCreate(0);
+    if (chid == -1)
+    {
+        return NULL;
+    }
+    ch = channel_get(chid);
+    ch->listen_fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+    if (ch->listen_fd == -1 || bind(ch->listen_fd, (struct sockaddr *)&addr, sizeof(addr)) == -1 ||
+        listen(ch->listen_fd, HOST_LISTEN_BACKLOG) == -1)
+    {
+        int err = errno;
+
+        if (ch->listen_fd != -1)
+        {
+            close(ch->listen_fd);
+            ch->listen_fd = -1;
+        }
+        ChannelDestroy(chid);
+        errno = err;
+        return NULL;
+    }
+    snprintf(ch->path, sizeof(ch->path), "%s", addr.sun_path);
+    ev.events = EPOLLIN;
+    ev.data.fd = ch->listen_fd;
+    epoll_ctl(ch->epfd, EPOLL_CTL_ADD, ch->listen_fd, &ev);
+
+    attach = calloc(1, sizeof(*attach));
+    if (!attach)
+    {
+        ChannelDestroy(chid);
+        errno = ENOMEM;
+        return NULL;
+    }
+    attach->dpp = dpp;
+    attach->chid = chid;
+    return attach;
+}
+
+int name_detach(name_attach_t *attach, unsigned flags)
+{
+    int rc;
+
+    (void)flags;
+    if (!attach)
+    {
+        errno = EINVAL;
+        return -1;
+    }
+    rc = ChannelDestroy(attach->chid);
+    free(attach);
+    return rc;
+}
+
+int name_open(const char *name, int flags)
+{
+    struct sockaddr_un addr;
+    int fd;
+
+    (void)flags;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    ipc_path(name, addr.sun_path, sizeof(addr.sun_path));
+
+    fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+    if (fd == -1)
+    {
+        return -1;
+    }
+    if (!fd_valid(fd) || connect(fd, (struct sockaddr *)&addr, sizeof(addr)) == -1)
+    {
+        int err = errno == ECONNREFUSED ? ENOENT : errno;
+
+        close(fd);
+        errno = err;
+        return -1;
+    }
+    g_fd_local[fd] = 0;
+    return fd;
+}
+
+int name_close(int coid)
+{
+    return ConnectDetach(coid);
+}
+
+long MsgSend(int coid, const void *smsg, size_t sbytes, void *rmsg, size_t rbytes)
+{
+    host_frame_t frame = {FRAME_MSG, 0, 0, 0};
+    ssize_t n;
+
+    if (!fd_valid(coid))
+    {
+        return -1;
+    }
+    if (g_fd_local[coid])
+    {
+        errno = ENOTSUP;
+        return -1;
+    }
+    frame.pid = getpid();
+
+    pthread_mutex_lock(&g_fd_lock[coid]);
+    if (send_frame(coid, &frame, smsg, sbytes) == -1)
+    {
+        pthread_mutex_unlock(&g_fd_lock[coid]);
+        return -1;
+    }
+    n = recv_frame(coid, &frame, rmsg, rbytes, 0);
+    pthread_mutex_unlock(&g_fd_lock[coid]);
+
+    if (n <= 0)
+    {
+        if (n == 0)
+        {
+            errno = ESRCH; // Server exited before replying
+        }
+        return -1;
+    }
+    if (frame.type == FRAME_ERROR)
+    {
+        errno = frame.value;
+        return -1;
+    }
+    return frame.value;
+}
+
+int MsgSendPulse(int coid, int priority, int code, int value)
+{
+    host_frame_t frame = {FRAME_PULSE, code, value, 0};
+
+    (void)priority;
+    if (!fd_valid(coid))
+    {
+        return -1;
+    }
+    frame.pid = getpid();
+    if (g_fd_local[coid])
+    {
+        // Pipe writes of this size are atomic
+        return write(coid, &frame, sizeof(frame)) == (ssize_t)sizeof(frame) ? 0 : -1;
+    }
+    return send_frame(coid, &frame, NULL, 0);
+}
+
+static void fill_pulse(void *msg, size_t bytes, const host_frame_t *frame)
+{
+    struct _pulse pulse;
+
+    memset(&pulse, 0, sizeof(pulse));
+    pulse.code = (int8_t)frame->code;
+    pulse.value.sival_int = frame->value;
+    memcpy(msg, &pulse, bytes < sizeof(pulse) ? bytes : sizeof(pulse));
+}
+
+static void rearm(host_channel_t *ch, int fd)
+{
+    struct epoll_event ev;
+
+    ev.events = EPOLLIN | EPOLLONESHOT;
+    ev.data.fd = fd;
+    epoll_ctl(ch->epfd, EPOLL_CTL_MOD, fd, &ev);
+}
+
+int MsgReceive(int chid, void *msg, size_t bytes, struct _msg_info *info)
+{
+    host_channel_t *ch = channel_get(chid);
+
+    if (!ch)
+    {
+        return -1;
+    }
+    while (1)
+    {
+        struct epoll_event ev;
+        host_frame_t frame;
+        ssize_t n;
+        int fd;
+
+        if (epoll_wait(ch->epfd, &ev, 1, -1) == -1)
+        {
+            return -1; // EINTR included, as on QNX
+        }
+        fd = ev.data.fd;
+
+        if (fd == ch->listen_fd)
+        {
+            int client = accept4(fd, NULL, NULL, SOCK_CLOEXEC);
+
+            if (client == -1)
+            {
+                continue; // Another thread took it
+            }
+            if (!fd_valid(client))
+            {
+                close(client);
+                continue;
+            }
+            g_fd_chid[client] = chid;
+            ev.events = EPOLLIN | EPOLLONESHOT;
+            ev.data.fd = client;
+            epoll_ctl(ch->epfd, EPOLL_CTL_ADD, client, &ev);
+            continue;
+        }
+
+        if (fd == ch->pulse_rd)
+        {
+            if (read(fd, &frame, sizeof(frame)) != (ssize_t)sizeof(frame))
+            {
+                continue;
+            }
+            fill_pulse(msg, bytes, &frame);
+            return 0;
+        }
+
+        n = recv_frame(fd, &frame, msg, bytes, MSG_DONTWAIT);
+        if (n == -1 && errno == EAGAIN)
+        {
+            rearm(ch, fd);
+            continue;
+        }
+        if (n <= 0)
+        {
+            close(fd); // Client gone
+            continue;
+        }
+        if (frame.type == FRAME_PULSE)
+        {
+            rearm(ch, fd);
+            fill_pulse(msg, bytes, &frame);
+            return 0;
+        }
+        if (info)
+        {
+            memset(info, 0, sizeof(*info));
+            info->pid = frame.pid;
+            info->chid = chid;
+            info->srcmsglen = (size_t)(n - 1);
+            info->msglen = info->srcmsglen < bytes ? info->srcmsglen : bytes;
+        }
+        return fd;
+    }
+}
+
+static int reply(int rcvid, uint32_t type, long status, const void *msg, size_t bytes)
+{
+    host_frame_t frame = {type, 0, (int32_t)status, 0};
+    host_channel_t *ch;
+    int rc;
+
+    if (!fd_valid(rcvid) || (ch = channel_get(g_fd_chid[rcvid])) == NULL)
+    {
+        errno = ESRCH;
+        return -1;
+    }
+    frame.pid = getpid();
+    rc = send_frame(rcvid, &frame, msg, bytes);
+    rearm(ch, rcvid);
+    return rc;
+}
+
+int MsgReply(int rcvid, long status, const void *msg, size_t bytes)
+{
+    return reply(rcvid, FRAME_REPLY, status, msg, bytes);
+}
+
+int MsgError(int rcvid, int error)
+{
+    return reply(rcvid, FRAME_ERROR, error, NULL, 0);
+}
+
+uint64_t ClockCycles(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+// Linux timers are already high resolution: report 1 ns and change nothing
+int ClockPeriod(clockid_t id, const struct _clockperiod *period, struct _clockperiod *old, int reserved)
+{
+    (void)id;
+    (void)period;
+    (void)reserved;
+    if (old)
+    {
+        old->nsec = 1;
+        old->fract = 0;
+    }
+    return 0;
+}
+
+int ThreadCtl(int cmd, void *data)
+{
+    switch (cmd)
+    {
+    case _NTO_TCTL_IO:
+        return 0; // No I/O privileges needed for simulated GPIO
+    case _NTO_TCTL_RUNMASK:
+    {
+        uint32_t mask = (uint32_t)(uintptr_t)data;
+        cpu_set_t set;
+        int cpu;
+
+        CPU_ZERO(&set);
+        for (cpu = 0; cpu < 32; cpu++)
+        {
+            if (mask & (1u << cpu))
+            {
+                CPU_SET(cpu, &set);
+            }
+        }
+        return sched_setaffinity(0, sizeof(set), &set);
+    }
+    default:
+        errno = EINVAL;
+        return -1;
+    }
+}
+
+static void timer_pulse(union sigval value)
+{
+    const host_timer_pulse_t *p = value.sival_ptr;
+
+    MsgSendPulse(p->coid, -1, p->code, p->value);
+}
+
+void host_sigev_pulse_init(struct sigevent *event, int coid, int priority, int code, int value)
+{
+    host_timer_pulse_t *p = malloc(sizeof(*p)); // Lives as long as the timer: never freed
+
+    (void)priority;
+    memset(event, 0, sizeof(*event));
+    if (!p)
+    {
+        event->sigev_notify = SIGEV_NONE;
+        return;
+    }
+    p->coid = coid;
+    p->code = code;
+    p->value = value;
+    event->sigev_notify = SIGEV_THREAD;
+    event->sigev_notify_function = timer_pulse;
+    event->sigev_value.sival_ptr = p;
+}
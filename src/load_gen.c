@@ -0,0 +1,731 @@
+/*
+ * load_gen.c
+ *
+ *  Load Generator:
+ *  - Simulates thousands of virtual sensors (temperature/humidity, gas, PIR,
+ *    door) with daily temperature cycles, noise and random events
+ *  - Groups them into virtual zones of up to SENSOR_MAX_INSTANCES sensors and
+ *    sends each zone's snapshot to stats_update like a central_analyzer would,
+ *    plus an event_logger message for every gas/motion/door event
+ *  - Steps through growing sensor counts and reports throughput, send latency
+ *    percentiles, its own CPU use and memory for each step
+ *  - With -o, writes one trace per zone instead (common/sensor_trace.h) so the
+ *    analyzer path can be loaded with `central_analyzer -r <trace> -s max`
+ *
+ *  Without a running stats_update (or in the plain Linux build, which has no
+ *  QNX message passing) the snapshots are merged in-process with the same zone table
+ *  stats_update uses, so the merge path is still measured.
+ */
+
+#include <errno.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#if defined(__QNXNTO__) || defined(HOST_BUILD)
+#include <sys/dispatch.h>
+#include <sys/neutrino.h>
+#else
+// Plain Linux build: no QNX message passing, every snapshot takes the in-process path
+#define name_open(name, flags) (-1)
+#define name_close(coid) ((void)(coid))
+#define MsgSend(coid, smsg, sbytes, rmsg, rbytes) (-1)
+#endif
+#include <time.h>
+#include <unistd.h>
+
+#include "common/mono_time.h"
+#include "common/sensor_registry.h"
+#include "common/sensor_trace.h"
+#include "common/zone_table.h"
+#include "msg_def.h"
+
+#define LOADGEN_MAX_THREADS 16
+#define LOADGEN_MAX_STEPS 16
+#define LOADGEN_DEFAULT_INTERVAL_MS 2000 // Snapshot period per zone, as central_analyzer
+#define LOADGEN_DEFAULT_STEP_SEC 10
+#define LOADGEN_EVENT_LEN 128
+
+// Latency histogram: 8 sub-buckets per power of two of microseconds
+#define HIST_SUB 8
+#define HIST_BUCKETS (32 * HIST_SUB)
+
+#define PI 3.14159265358979323846
+
+typedef struct
+{
+    uint64_t count[HIST_BUCKETS];
+    uint64_t total;
+    uint64_t max_us;
+} latency_hist_t;
+
+// One virtual sensor
+typedef struct
+{
+    uint8_t type;
+    float phase;           // Daily cycle offset (rad)
+    float base;            // Temperature baseline (°C)
+    uint64_t event_end_ms; // Gas/motion active, door open until then
+    uint8_t active;        // Last reported state (events are sent on changes)
+    uint32_t rng;
+} virtual_sensor_t;
+
+typedef struct
+{
+    uint16_t zone_id;
+    int first;             // Index of the zone's first sensor
+    int count;
+    uint64_t next_ms;      // Next snapshot
+    uint32_t sequence;
+    sensor_data_msg_t msg;
+} virtual_zone_t;
+
+typedef struct
+{
+    int index;
+    int zone_first;
+    int zone_count;
+    uint64_t messages;
+    uint64_t readings;
+    uint64_t events;
+    uint64_t send_errors;
+    latency_hist_t latency;
+} loadgen_worker_t;
+
+// Settings
+static int g_threads = 4;
+static uint32_t g_interval_ms = LOADGEN_DEFAULT_INTERVAL_MS;
+static int g_step_sec = LOADGEN_DEFAULT_STEP_SEC;
+static double g_time_scale = 1.0;       // Simulated seconds per real second
+static double g_events_per_hour = 2.0;  // Per gas/PIR/door sensor, in simulated time
+static const char *g_trace_prefix = NULL;
+
+// State of the current step
+static virtual_sensor_t *g_sensors;
+static virtual_zone_t *g_zones;
+static int g_zone_count;
+static loadgen_worker_t g_workers[LOADGEN_MAX_THREADS];
+static volatile bool g_step_running;
+static uint64_t g_start_ms;
+
+static int stats_update_coid = -1;
+static int event_logger_coid = -1;
+
+// In-process merge when stats_update is not running
+static zone_table_t g_local_zones;
+static pthread_mutex_t g_local_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+// Equal shares keep a full zone within SENSOR_MAX_PER_TYPE per bank
+static const uint8_t g_type_mix[] = {
+    SENSOR_TYPE_TEMPERATURE,
+    SENSOR_TYPE_MOTION,
+    SENSOR_TYPE_ULTRASONIC,
+    SENSOR_TYPE_GAS,
+};
+
+// xorshift32: cheap per-sensor random numbers
+static uint32_t rng_next(uint32_t *state)
+{
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return x;
+}
+
+static double rng_uniform(uint32_t *state)
+{
+    return (rng_next(state) >> 8) / 16777216.0;
+}
+
+static void hist_add(latency_hist_t *h, uint64_t us)
+{
+    int bucket = 0;
+
+    if (us >= HIST_SUB)
+    {
+        int msb = 63 - __builtin_clzll(us);
+        int sub = (int)((us >> (msb - 3)) & (HIST_SUB - 1));
+        bucket = (msb - 2) * HIST_SUB + sub;
+    }
+    else
+    {
+        bucket = (int)us;
+    }
+    if (bucket >= HIST_BUCKETS)
+    {
+        bucket = HIST_BUCKETS - 1;
+    }
+    h->count[bucket]++;
+    h->total++;
+    if (us > h->max_us)
+    {
+        h->max_us = us;
+    }
+}
+
+static void hist_merge(latency_hist_t *dst, const latency_hist_t *src)
+{
+    int i;
+
+    for (i = 0; i < HIST_BUCKETS; i++)
+    {
+        dst->count[i] += src->count[i];
+    }
+    dst->total += src->total;
+    if (src->max_us > dst->max_us)
+    {
+        dst->max_us = src->max_us;
+    }
+}
+
+// Upper bound (us) of the bucket holding the given percentile
+static double hist_percentile(const latency_hist_t *h, double pct)
+{
+    uint64_t target = (uint64_t)ceil(h->total * pct / 100.0);
+    uint64_t seen = 0;
+    int i;
+
+    if (h->total == 0)
+    {
+        return 0.0;
+    }
+    for (i = 0; i < HIST_BUCKETS; i++)
+    {
+        seen += h->count[i];
+        if (seen >= target)
+        {
+            uint64_t bound = i < HIST_SUB ? (uint64_t)i + 1
+                                          : (uint64_t)(HIST_SUB + i % HIST_SUB + 1) << (i / HIST_SUB - 1);
+            return (double)(bound < h->max_us ? bound : h->max_us);
+        }
+    }
+    return (double)h->max_us;
+}
+
+static void sensor_init_virtual(virtual_sensor_t *s, int index)
+{
+    memset(s, 0, sizeof(*s));
+    s->type = g_type_mix[index % (sizeof(g_type_mix) / sizeof(g_type_mix[0]))];
+    s->rng = 2463534242u ^ (uint32_t)(index * 2654435761u);
+    s->phase = (float)(rng_uniform(&s->rng) * 0.5);
+    s->base = (float)(19.0 + rng_uniform(&s->rng) * 4.0);
+}
+
+/**
+ * Advance a virtual sensor to simulated time sim_ms and take a reading
+ *
+ * @return 1 if its state changed (an event worth logging), 0 otherwise
+ */
+static int sensor_sample_virtual(virtual_sensor_t *s, uint64_t sim_ms, uint32_t step_ms, sensor_reading_t *out)
+{
+    double day = 2.0 * PI * (double)(sim_ms % 86400000ULL) / 86400000.0 + s->phase;
+    uint8_t active = s->active;
+
+    out->type = s->type;
+    out->valid = rng_next(&s->rng) % 500 != 0; // 0.2% failed reads
+    out->health = SENSOR_HEALTH_OK;
+    out->value2 = 0;
+
+    if (s->type == SENSOR_TYPE_TEMPERATURE)
+    {
+        // Daily cycle of +-3 °C around the baseline, humidity moving the other way
+        double noise = rng_uniform(&s->rng) - 0.5;
+        out->value = (int32_t)lround(s->base + 3.0 * sin(day) + noise);
+        out->value2 = (int32_t)lround(50.0 - 10.0 * sin(day) + 2.0 * noise);
+        out->state = 0;
+        return 0;
+    }
+
+    // Gas, motion and door: Poisson events with type-specific durations
+    if (sim_ms >= s->event_end_ms)
+    {
+        double p = g_events_per_hour * step_ms / 3600000.0;
+        if (s->type == SENSOR_TYPE_GAS)
+        {
+            p /= 20.0; // Gas is rare
+        }
+        if (rng_uniform(&s->rng) < p)
+        {
+            uint32_t duration_ms = s->type == SENSOR_TYPE_MOTION ? 10000 + rng_next(&s->rng) % 50000
+                                   : s->type == SENSOR_TYPE_GAS  ? 60000
+                                                                 : 5000 + rng_next(&s->rng) % 25000;
+            s->event_end_ms = sim_ms + duration_ms;
+        }
+    }
+    active = sim_ms < s->event_end_ms;
+
+    if (s->type == SENSOR_TYPE_ULTRASONIC)
+    {
+        // Closed door reads ~5 cm, open ~80 cm
+        out->value = active ? 78 + (int32_t)(rng_next(&s->rng) % 5) : 4 + (int32_t)(rng_next(&s->rng) % 3);
+        out->state = active ? 0 : SENSOR_STATE_ACTIVE; // ACTIVE = closed
+    }
+    else
+    {
+        out->value = active;
+        out->state = active ? SENSOR_STATE_ACTIVE : 0;
+    }
+
+    if (active != s->active)
+    {
+        s->active = active;
+        return 1;
+    }
+    return 0;
+}
+
+static void send_event(loadgen_worker_t *w, const virtual_zone_t *zone, const sensor_reading_t *r)
+{
+    struct
+    {
+        uint16_t type;
+        char text[LOADGEN_EVENT_LEN];
+    } msg;
+
+    w->events++;
+    msg.type = 0;
+    snprintf(msg.text, sizeof(msg.text), "[LOAD] %s [load%u/%.*s] (value=%d)", sensor_type_name(r->type),
+             zone->zone_id, SENSOR_NAME_LEN, r->name, (int)r->value);
+    if (event_logger_coid != -1 && MsgSend(event_logger_coid, &msg, sizeof(msg), NULL, 0) == -1)
+    {
+        w->send_errors++;
+    }
+}
+
+// Fill a zone's snapshot message for the current simulated time
+static void zone_build(loadgen_worker_t *w, virtual_zone_t *zone, uint64_t sim_ms, uint32_t step_ms)
+{
+    sensor_data_msg_t *msg = &zone->msg;
+    uint64_t now_ms = mono_time_ms(); // Sample times are real, even when simulated time runs faster
+    int i;
+
+    msg->msg_type = MSG_TYPE_SENSOR_DATA;
+    msg->sequence_num = zone->sequence++;
+    msg->timestamp = time(NULL);
+    msg->mono_ms = now_ms;
+    msg->zone_id = zone->zone_id;
+    msg->alert_level = ALERT_LEVEL_INFO;
+    msg->sensor_count = (uint16_t)zone->count;
+
+    for (i = 0; i < zone->count; i++)
+    {
+        virtual_sensor_t *s = &g_sensors[zone->first + i];
+        sensor_reading_t *r = &msg->sensors[i];
+
+        if (sensor_sample_virtual(s, sim_ms, step_ms, r))
+        {
+            send_event(w, zone, r);
+        }
+        if (r->valid)
+        {
+            // One sample per snapshot: the window is that sample
+            r->sample_ms = now_ms;
+            r->window.samples = 1;
+            r->window.active = (r->state & SENSOR_STATE_ACTIVE) != 0;
+            r->window.min = r->window.max = r->value;
+            r->window.mean = (float)r->value;
+        }
+        else
+        {
+            memset(&r->window, 0, sizeof(r->window));
+        }
+        if (r->type == SENSOR_TYPE_GAS && (r->state & SENSOR_STATE_ACTIVE))
+        {
+            msg->alert_level = ALERT_LEVEL_CRITICAL;
+        }
+    }
+    w->readings += (uint64_t)zone->count;
+}
+
+static void *loadgen_worker_thread(void *arg)
+{
+    loadgen_worker_t *w = arg;
+    int i;
+
+    while (g_step_running)
+    {
+        uint64_t now = mono_time_ms();
+        uint64_t next = now + g_interval_ms;
+
+        for (i = 0; i < w->zone_count && g_step_running; i++)
+        {
+            virtual_zone_t *zone = &g_zones[w->zone_first + i];
+            uint64_t sim_ms = (uint64_t)((now - g_start_ms) * g_time_scale);
+            uint64_t t0, t1;
+            int rc = 0;
+
+            if (now < zone->next_ms)
+            {
+                if (zone->next_ms < next)
+                {
+                    next = zone->next_ms;
+                }
+                continue;
+            }
+            zone->next_ms += g_interval_ms;
+            if (zone->next_ms < next)
+            {
+                next = zone->next_ms;
+            }
+
+            zone_build(w, zone, sim_ms, (uint32_t)(g_interval_ms * g_time_scale));
+
+            // Send like the analyzer's aggregator: only the used part of sensors[]
+            t0 = mono_time_ns();
+            if (stats_update_coid != -1)
+            {
+                rc = MsgSend(stats_update_coid, &zone->msg, SENSOR_DATA_MSG_SIZE(zone->msg.sensor_count), NULL, 0);
+            }
+            else
+            {
+                pthread_mutex_lock(&g_local_mutex);
+                zone_table_update(&g_local_zones, &zone->msg, SENSOR_DATA_MSG_SIZE(zone->msg.sensor_count), now);
+                pthread_mutex_unlock(&g_local_mutex);
+            }
+            t1 = mono_time_ns();
+
+            if (rc == -1)
+            {
+                w->send_errors++;
+            }
+            else
+            {
+                w->messages++;
+                hist_add(&w->latency, (t1 - t0) / 1000);
+            }
+        }
+
+        now = mono_time_ms();
+        if (next > now)
+        {
+            usleep((useconds_t)((next - now) * 1000));
+        }
+    }
+    return NULL;
+}
+
+// Set up sensors and zones for one step
+static int step_setup(int sensors)
+{
+    int i;
+
+    g_zone_count = (sensors + SENSOR_MAX_INSTANCES - 1) / SENSOR_MAX_INSTANCES;
+    g_sensors = calloc((size_t)sensors, sizeof(*g_sensors));
+    g_zones = calloc((size_t)g_zone_count, sizeof(*g_zones));
+    if (!g_sensors || !g_zones)
+    {
+        free(g_sensors);
+        free(g_zones);
+        return -1;
+    }
+
+    for (i = 0; i < sensors; i++)
+    {
+        sensor_init_virtual(&g_sensors[i], i);
+    }
+    g_start_ms = mono_time_ms();
+    for (i = 0; i < g_zone_count; i++)
+    {
+        virtual_zone_t *zone = &g_zones[i];
+        int j;
+
+        zone->zone_id = (uint16_t)i;
+        zone->first = i * SENSOR_MAX_INSTANCES;
+        zone->count = sensors - zone->first < SENSOR_MAX_INSTANCES ? sensors - zone->first : SENSOR_MAX_INSTANCES;
+        // Spread the zones over the interval like independent analyzers
+        zone->next_ms = g_start_ms + (uint64_t)i * g_interval_ms / (uint64_t)g_zone_count;
+        snprintf(zone->msg.zone_name, sizeof(zone->msg.zone_name), "load%d", i);
+        for (j = 0; j < zone->count; j++)
+        {
+            snprintf(zone->msg.sensors[j].name, SENSOR_NAME_LEN, "v%d", zone->first + j);
+        }
+    }
+    memset(&g_local_zones, 0, sizeof(g_local_zones));
+    return 0;
+}
+
+static double cpu_seconds(void)
+{
+    struct rusage ru;
+
+    getrusage(RUSAGE_SELF, &ru);
+    return ru.ru_utime.tv_sec + ru.ru_stime.tv_sec + (ru.ru_utime.tv_usec + ru.ru_stime.tv_usec) / 1e6;
+}
+
+static long max_rss_kb(void)
+{
+    struct rusage ru;
+
+    getrusage(RUSAGE_SELF, &ru);
+    return ru.ru_maxrss;
+}
+
+// Run one step with the given sensor count and print its row
+static int run_step(int sensors)
+{
+    pthread_t threads[LOADGEN_MAX_THREADS];
+    latency_hist_t latency;
+    uint64_t messages = 0, readings = 0, events = 0, errors = 0;
+    int threads_used = g_threads;
+    double cpu0, cpu1, elapsed;
+    uint64_t t0;
+    int i;
+
+    if (step_setup(sensors) != 0)
+    {
+        fprintf(stderr, "Out of memory for %d sensors\n", sensors);
+        return -1;
+    }
+    if (threads_used > g_zone_count)
+    {
+        threads_used = g_zone_count;
+    }
+
+    memset(g_workers, 0, sizeof(g_workers));
+    for (i = 0; i < threads_used; i++)
+    {
+        loadgen_worker_t *w = &g_workers[i];
+
+        w->index = i;
+        w->zone_first = g_zone_count * i / threads_used;
+        w->zone_count = g_zone_count * (i + 1) / threads_used - w->zone_first;
+    }
+
+    cpu0 = cpu_seconds();
+    t0 = mono_time_ns();
+    g_step_running = true;
+    for (i = 0; i < threads_used; i++)
+    {
+        if (pthread_create(&threads[i], NULL, loadgen_worker_thread, &g_workers[i]) != 0)
+        {
+            fprintf(stderr, "Failed to create load thread %d\n", i);
+            g_step_running = false;
+            threads_used = i;
+            break;
+        }
+    }
+    sleep((unsigned)g_step_sec);
+    g_step_running = false;
+    for (i = 0; i < threads_used; i++)
+    {
+        pthread_join(threads[i], NULL);
+    }
+    elapsed = (mono_time_ns() - t0) / 1e9;
+    cpu1 = cpu_seconds();
+
+    memset(&latency, 0, sizeof(latency));
+    for (i = 0; i < threads_used; i++)
+    {
+        messages += g_workers[i].messages;
+        readings += g_workers[i].readings;
+        events += g_workers[i].events;
+        errors += g_workers[i].send_errors;
+        hist_merge(&latency, &g_workers[i].latency);
+    }
+
+    printf("%8d %6d %9.1f %11.0f %8.1f %8.0f %8.0f %8.0f %8.0f %7.1f %6.1f %8ld %6llu\n", sensors, g_zone_count,
+           messages / elapsed, readings / elapsed, events / elapsed, hist_percentile(&latency, 50.0),
+           hist_percentile(&latency, 99.0), hist_percentile(&latency, 99.9), (double)latency.max_us,
+           100.0 * (cpu1 - cpu0) / elapsed, 100.0 * (cpu1 - cpu0) / elapsed / threads_used, max_rss_kb(),
+           (unsigned long long)errors);
+    fflush(stdout);
+
+    free(g_sensors);
+    free(g_zones);
+    return 0;
+}
+
+/**
+ * Write one trace per zone covering g_step_sec simulated seconds (-o)
+ *
+ * Every virtual sensor is sampled once per second; aggregation runs every
+ * g_interval_ms, as in a live recording.
+ */
+static int write_traces(int sensors)
+{
+    static sensor_registry_t reg;
+    trace_writer_t w;
+    char path[256];
+    int z;
+
+    if (step_setup(sensors) != 0)
+    {
+        fprintf(stderr, "Out of memory for %d sensors\n", sensors);
+        return -1;
+    }
+
+    for (z = 0; z < g_zone_count; z++)
+    {
+        virtual_zone_t *zone = &g_zones[z];
+        uint64_t origin = 1000; // Any monotonic origin will do for a replay
+        uint64_t sim_ms;
+        int i;
+
+        memset(&reg, 0, sizeof(reg));
+        for (i = 0; i < zone->count; i++)
+        {
+            sensor_instance_t s = sensor_instance_make(g_sensors[zone->first + i].type,
+                                                       zone->msg.sensors[i].name, 0, 0);
+            if (!sensor_registry_add(&reg, &s))
+            {
+                break; // Bank of this type full (SENSOR_MAX_PER_TYPE)
+            }
+        }
+
+        snprintf(path, sizeof(path), "%s%d.trc", g_trace_prefix, z);
+        if (trace_writer_open(&w, path, &reg, zone->zone_id, zone->msg.zone_name, origin) != 0)
+        {
+            fprintf(stderr, "Cannot write %s: %s\n", path, strerror(errno));
+            break;
+        }
+
+        for (sim_ms = 0; sim_ms < (uint64_t)g_step_sec * 1000; sim_ms += 1000)
+        {
+            for (i = 0; i < reg.count; i++)
+            {
+                sensor_reading_t r;
+                trace_record_t rec;
+
+                sensor_sample_virtual(&g_sensors[zone->first + i], sim_ms, 1000, &r);
+                memset(&rec, 0, sizeof(rec));
+                rec.kind = TRACE_REC_SAMPLE;
+                rec.sensor = (uint8_t)i;
+                rec.ok = r.valid;
+                rec.value = r.value;
+                rec.value2 = r.value2;
+                rec.aux = r.type == SENSOR_TYPE_TEMPERATURE ? 1 : r.type == SENSOR_TYPE_ULTRASONIC ? 90 : 0;
+                rec.read_us = r.type == SENSOR_TYPE_TEMPERATURE ? 4000 : 50;
+                trace_writer_put(&w, &rec, origin + sim_ms, NULL, 0);
+            }
+            if (sim_ms % g_interval_ms == 0)
+            {
+                trace_record_t rec;
+
+                memset(&rec, 0, sizeof(rec));
+                rec.kind = TRACE_REC_AGGREGATE;
+                trace_writer_put(&w, &rec, origin + sim_ms, NULL, 0);
+            }
+        }
+        printf("%s: %d sensors, %u records\n", path, reg.count, w.records);
+        trace_writer_close(&w);
+    }
+
+    free(g_sensors);
+    free(g_zones);
+    return 0;
+}
+
+// Parse "100,1000,5000" into step sizes
+static int parse_steps(char *text, int *steps)
+{
+    char *save = NULL;
+    char *tok;
+    int n = 0;
+
+    for (tok = strtok_r(text, ",", &save); tok && n < LOADGEN_MAX_STEPS; tok = strtok_r(NULL, ",", &save))
+    {
+        int value = atoi(tok);
+        if (value <= 0)
+        {
+            return -1;
+        }
+        steps[n++] = value;
+    }
+    return n;
+}
+
+int main(int argc, char *argv[])
+{
+    char default_steps[] = "100,500,1000,2000,5000";
+    char *step_text = default_steps;
+    int steps[LOADGEN_MAX_STEPS];
+    int step_count;
+    int opt;
+    int i;
+
+    while ((opt = getopt(argc, argv, "n:d:i:t:x:e:o:")) != -1)
+    {
+        switch (opt)
+        {
+        case 'n':
+            step_text = optarg;
+            break;
+        case 'd':
+            g_step_sec = atoi(optarg);
+            break;
+        case 'i':
+            g_interval_ms = (uint32_t)atoi(optarg);
+            break;
+        case 't':
+            g_threads = atoi(optarg);
+            break;
+        case 'x':
+            g_time_scale = atof(optarg);
+            break;
+        case 'e':
+            g_events_per_hour = atof(optarg);
+            break;
+        case 'o':
+            g_trace_prefix = optarg;
+            break;
+        default:
+            fprintf(stderr,
+                    "Usage: %s [-n sensors[,sensors...]] [-d seconds_per_step] [-i snapshot_interval_ms]\n"
+                    "          [-t threads] [-x time_scale] [-e events_per_sensor_hour] [-o trace_prefix]\n",
+                    argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+    step_count = parse_steps(step_text, steps);
+    if (step_count <= 0 || g_step_sec <= 0 || g_interval_ms == 0 || g_time_scale <= 0)
+    {
+        fprintf(stderr, "Invalid sensor counts, duration, interval or time scale\n");
+        return EXIT_FAILURE;
+    }
+    if (g_threads < 1)
+        g_threads = 1;
+    if (g_threads > LOADGEN_MAX_THREADS)
+        g_threads = LOADGEN_MAX_THREADS;
+
+    printf("===========================================\n");
+    printf("  Load Generator - Virtual Sensor Fleet\n");
+    printf("===========================================\n");
+
+    if (g_trace_prefix)
+    {
+        return write_traces(steps[step_count - 1]) == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    stats_update_coid = name_open("stats_update", 0);
+    event_logger_coid = name_open("event_logger", 0);
+    printf("stats_update: %s\n", stats_update_coid != -1 ? "connected" : "not running (in-process zone table)");
+    printf("event_logger: %s\n", event_logger_coid != -1 ? "connected" : "not running (events counted only)");
+    printf("Snapshot every %u ms per zone, %d s per step, %d threads, time x%g, %g events/sensor/h\n\n",
+           g_interval_ms, g_step_sec, g_threads, g_time_scale, g_events_per_hour);
+
+    printf("%8s %6s %9s %11s %8s %8s %8s %8s %8s %7s %6s %8s %6s\n", "sensors", "zones", "msgs/s", "readings/s",
+           "events/s", "p50_us", "p99_us", "p999_us", "max_us", "cpu%", "core%", "rss_kb", "errors");
+    for (i = 0; i < step_count; i++)
+    {
+        if (run_step(steps[i]) != 0)
+        {
+            break;
+        }
+    }
+
+    if (stats_update_coid != -1)
+    {
+        name_close(stats_update_coid);
+    }
+    if (event_logger_coid != -1)
+    {
+        name_close(event_logger_coid);
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,217 @@
+/*
+ * log_bench.c
+ *
+ *  Logging Benchmark:
+ *  - Measures the cost of one log call on the calling thread for
+ *    synchronous fprintf() and for LOG_INFO (common/binlog.h), with the same
+ *    message as a sensor reading line
+ *  - Runs the calls on several threads at once (-t), as the sensor workers
+ *    do, and reports the mean, p50, p99 and worst per-call time
+ *  - binlog records are drained to a binary log by its background thread;
+ *    calls are issued in bursts of half a ring so none are dropped, and only
+ *    the calls themselves are timed
+ *
+ *  Both write to /dev/null, so the numbers are the cost of formatting and
+ *  locking, not of the console.
+ */
+
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "common/binlog.h"
+#include "common/mono_time.h"
+
+#define BENCH_BUCKETS 64 // Power-of-two histogram of per-call ns
+
+typedef struct
+{
+    int id;
+    int binlog;
+    uint64_t total_ns;
+    uint64_t max_ns;
+    uint32_t buckets[BENCH_BUCKETS];
+} bench_thread_t;
+
+static FILE *g_sink;
+static uint32_t g_calls = 200000;
+static pthread_barrier_t g_barrier;
+
+static int bucket_of(uint64_t ns)
+{
+    int b = 0;
+
+    while (ns > 1 && b < BENCH_BUCKETS - 1)
+    {
+        ns >>= 1;
+        b++;
+    }
+    return b;
+}
+
+static void record(bench_thread_t *t, uint64_t ns)
+{
+    t->total_ns += ns;
+    t->buckets[bucket_of(ns)]++;
+    if (ns > t->max_ns)
+    {
+        t->max_ns = ns;
+    }
+}
+
+// Wait until the background thread has drained this thread's ring
+static void wait_drained(void)
+{
+    binlog_ring_t *ring = tl_binlog_ring;
+
+    while (ring && atomic_load(&ring->head) != atomic_load(&ring->tail))
+    {
+        sched_yield();
+    }
+}
+
+static void *bench_thread(void *arg)
+{
+    bench_thread_t *t = arg;
+    const char *name = t->id % 2 ? "dht11_kitchen" : "dht11_hall";
+    uint32_t i;
+
+    pthread_barrier_wait(&g_barrier);
+    for (i = 0; i < g_calls; i++)
+    {
+        int temp = 18 + (int)(i % 10);
+        int hum = 40 + (int)(i % 25);
+        uint64_t start;
+
+        if (t->binlog && i % (BINLOG_RING_RECORDS / 2) == 0)
+        {
+            wait_drained();
+        }
+        start = mono_time_ns();
+        if (t->binlog)
+        {
+            LOG_INFO("[TEMP_SENSOR] %s: Temp: %d°C, Humidity: %d%%", name, temp, hum);
+        }
+        else
+        {
+            fprintf(g_sink, "[TEMP_SENSOR] %s: Temp: %d°C, Humidity: %d%%\n", name, temp, hum);
+        }
+        record(t, mono_time_ns() - start);
+    }
+    return NULL;
+}
+
+// Upper bound (ns) of the bucket holding the given fraction of calls
+static uint64_t percentile(const uint32_t *buckets, uint64_t total, double fraction)
+{
+    uint64_t seen = 0;
+    int b;
+
+    for (b = 0; b < BENCH_BUCKETS; b++)
+    {
+        seen += buckets[b];
+        if (seen >= (uint64_t)(fraction * total))
+        {
+            return 2ULL << b;
+        }
+    }
+    return UINT64_MAX;
+}
+
+static void run(const char *label, int binlog, int threads)
+{
+    bench_thread_t *t = calloc((size_t)threads, sizeof(*t));
+    pthread_t *tids = calloc((size_t)threads, sizeof(*tids));
+    uint32_t buckets[BENCH_BUCKETS] = {0};
+    uint64_t total_ns = 0;
+    uint64_t max_ns = 0;
+    uint64_t calls = (uint64_t)g_calls * threads;
+    int i;
+    int b;
+
+    pthread_barrier_init(&g_barrier, NULL, (unsigned)threads);
+    for (i = 0; i < threads; i++)
+    {
+        t[i].id = i;
+        t[i].binlog = binlog;
+        pthread_create(&tids[i], NULL, bench_thread, &t[i]);
+    }
+    for (i = 0; i < threads; i++)
+    {
+        pthread_join(tids[i], NULL);
+        total_ns += t[i].total_ns;
+        max_ns = t[i].max_ns > max_ns ? t[i].max_ns : max_ns;
+        for (b = 0; b < BENCH_BUCKETS; b++)
+        {
+            buckets[b] += t[i].buckets[b];
+        }
+    }
+    pthread_barrier_destroy(&g_barrier);
+
+    printf("%-8s %2d thread(s): mean %7.1f ns  p50 <%6llu ns  p99 <%6llu ns  max %8.1f us\n", label, threads,
+           (double)total_ns / calls, (unsigned long long)percentile(buckets, calls, 0.50),
+           (unsigned long long)percentile(buckets, calls, 0.99), max_ns / 1e3);
+    free(t);
+    free(tids);
+}
+
+int main(int argc, char *argv[])
+{
+    int max_threads = 4;
+    uint64_t clock_ns;
+    int threads;
+    int opt;
+    int i;
+
+    while ((opt = getopt(argc, argv, "n:t:")) != -1)
+    {
+        switch (opt)
+        {
+        case 'n':
+            g_calls = (uint32_t)strtoul(optarg, NULL, 10);
+            break;
+        case 't':
+            max_threads = atoi(optarg);
+            break;
+        default:
+            fprintf(stderr, "Usage: %s [-n calls_per_thread] [-t max_threads]\n", argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+    if (g_calls == 0 || max_threads < 1)
+    {
+        fprintf(stderr, "Need at least one call and one thread\n");
+        return EXIT_FAILURE;
+    }
+
+    g_sink = fopen("/dev/null", "w");
+    if (!g_sink || binlog_init("/dev/null") != 0)
+    {
+        fprintf(stderr, "Cannot write /dev/null: %s\n", strerror(errno));
+        return EXIT_FAILURE;
+    }
+
+    // Both timings include one clock read
+    clock_ns = mono_time_ns();
+    for (i = 0; i < 100000; i++)
+    {
+        mono_time_ns();
+    }
+    clock_ns = (mono_time_ns() - clock_ns) / 100000;
+    printf("%u calls per thread, clock read %llu ns (included below)\n\n", g_calls, (unsigned long long)clock_ns);
+
+    for (threads = 1; threads <= max_threads; threads *= 2)
+    {
+        run("fprintf", 0, threads);
+        run("LOG_INFO", 1, threads);
+    }
+
+    binlog_shutdown();
+    fclose(g_sink);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,184 @@
+/*
+ * log_decode.c
+ *
+ *  Binary Log Decoder:
+ *  - Reads a log written with `central_analyzer -L <file>` (common/binlog.h)
+ *  - Rebuilds every record's message from the call-site table at the head of
+ *    the file, so it does not need the binary that wrote the log
+ *  - Prints each message with its time (since the start of the log, or wall
+ *    clock with -w), level and optionally thread and source line
+ *  - Can filter by level and stops cleanly at a truncated last record (a log
+ *    copied while the analyzer was still writing it)
+ */
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "common/binlog.h"
+
+typedef struct
+{
+    char *fmt;
+    char *file;
+    uint32_t line;
+    uint8_t level;
+} decoded_site_t;
+
+static void usage(const char *prog)
+{
+    fprintf(stderr,
+            "Usage: %s [-w] [-v] [-l max_level] log_file\n"
+            "  -w  wall-clock timestamps instead of seconds since the start of the log\n"
+            "  -v  also print the thread and source line of each record\n"
+            "  -l  highest level to print (0 error, 1 warn, 2 info, 3 debug; default 3)\n",
+            prog);
+}
+
+// Read the call-site table that follows the file header
+static decoded_site_t *read_sites(FILE *in, int count)
+{
+    decoded_site_t *sites = calloc((size_t)count + 1, sizeof(*sites));
+    int i;
+
+    if (!sites)
+    {
+        return NULL;
+    }
+    for (i = 0; i < count; i++)
+    {
+        binlog_file_site_t entry;
+
+        if (fread(&entry, sizeof(entry), 1, in) != 1)
+        {
+            return NULL;
+        }
+        sites[i].line = entry.line;
+        sites[i].level = entry.level;
+        sites[i].fmt = calloc(1, (size_t)entry.fmt_len + 1);
+        sites[i].file = calloc(1, (size_t)entry.file_len + 1);
+        if (!sites[i].fmt || !sites[i].file || fread(sites[i].fmt, 1, entry.fmt_len, in) != entry.fmt_len ||
+            fread(sites[i].file, 1, entry.file_len, in) != entry.file_len)
+        {
+            return NULL;
+        }
+    }
+    return sites;
+}
+
+int main(int argc, char *argv[])
+{
+    binlog_file_t header;
+    binlog_record_t rec;
+    decoded_site_t *sites;
+    uint32_t records = 0;
+    uint32_t unknown = 0;
+    int max_level = LOG_LEVEL_DEBUG;
+    int wall = 0;
+    int verbose = 0;
+    FILE *in;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "wvl:")) != -1)
+    {
+        switch (opt)
+        {
+        case 'w':
+            wall = 1;
+            break;
+        case 'v':
+            verbose = 1;
+            break;
+        case 'l':
+            max_level = atoi(optarg);
+            break;
+        default:
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+    if (optind != argc - 1)
+    {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    in = fopen(argv[optind], "rb");
+    if (!in)
+    {
+        fprintf(stderr, "Cannot open %s: %s\n", argv[optind], strerror(errno));
+        return EXIT_FAILURE;
+    }
+    if (fread(&header, sizeof(header), 1, in) != 1 || header.magic != BINLOG_MAGIC ||
+        header.version != BINLOG_VERSION)
+    {
+        fprintf(stderr, "%s is not a binary log of this version\n", argv[optind]);
+        fclose(in);
+        return EXIT_FAILURE;
+    }
+    sites = read_sites(in, header.site_count);
+    if (!sites)
+    {
+        fprintf(stderr, "%s: call-site table is truncated\n", argv[optind]);
+        fclose(in);
+        return EXIT_FAILURE;
+    }
+
+    while (fread(&rec, sizeof(rec), 1, in) == 1)
+    {
+        const decoded_site_t *site;
+        char message[BINLOG_LINE_MAX];
+        char stamp[48];
+        int64_t offset_ns = (int64_t)(rec.t_ns - header.mono_start_ns);
+
+        records++;
+        if (rec.site >= header.site_count || rec.size > BINLOG_ARGS_SIZE)
+        {
+            unknown++;
+            continue;
+        }
+        site = &sites[rec.site];
+        if (site->level > max_level)
+        {
+            continue;
+        }
+        binlog_format(site->fmt, rec.args, rec.size, message, sizeof(message));
+
+        if (wall)
+        {
+            int64_t ns = header.wall_start_ns + offset_ns;
+            time_t sec = (time_t)(ns / 1000000000LL);
+            struct tm tm;
+
+            localtime_r(&sec, &tm);
+            strftime(stamp, sizeof(stamp), "%Y-%m-%d %H:%M:%S", &tm);
+            snprintf(stamp + strlen(stamp), sizeof(stamp) - strlen(stamp), ".%06lld",
+                     (long long)(ns % 1000000000LL) / 1000);
+        }
+        else
+        {
+            snprintf(stamp, sizeof(stamp), "%12.6f", offset_ns / 1e9);
+        }
+
+        if (verbose)
+        {
+            printf("%s %-5s T%-2u %s:%u  %s\n", stamp, binlog_level_names[site->level & 3], rec.thread, site->file,
+                   site->line, message);
+        }
+        else
+        {
+            printf("%s %-5s %s\n", stamp, binlog_level_names[site->level & 3], message);
+        }
+    }
+
+    if (unknown > 0)
+    {
+        fprintf(stderr, "%u of %u records have an unknown call site\n", unknown, records);
+    }
+    fclose(in);
+    return EXIT_SUCCESS;
+}
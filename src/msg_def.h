@@ -5,6 +5,7 @@
 #ifndef MSG_DEF_H
 #define MSG_DEF_H
 
+#include <stddef.h>
 #include <stdint.h>
 #include <time.h>
 
@@ -25,6 +26,14 @@
 #define SENSOR_TYPE_GAS         0x03
 #define SENSOR_TYPE_MOTION      0x04
 #define SENSOR_TYPE_ULTRASONIC  0x05
+#define SENSOR_TYPE_COUNT       0x06  // One past the highest SENSOR_TYPE_*
+
+// Sensor instances (see common/sensor_registry.h)
+#define SENSOR_MAX_INSTANCES    64    // Sensors per analyzer, all types together
+#define SENSOR_NAME_LEN         16    // Instance name, including the terminator
+
+// Zones (one central_analyzer per room or floor, see common/zone_table.h)
+#define ZONE_NAME_LEN           16    // Zone name, including the terminator
 
 // Alert types
 #define ALERT_TYPE_TEMP_HIGH    0x01
@@ -33,6 +42,16 @@
 #define ALERT_TYPE_MOTION       0x04
 #define ALERT_TYPE_DOOR_CLOSED  0x05
 #define ALERT_TYPE_DOOR_OPEN    0x06
+#define ALERT_TYPE_RATE_OF_RISE 0x07  // Abnormally fast temperature/humidity rise
+#define ALERT_TYPE_ANOMALY      0x08  // Statistical outlier against the learned baseline
+#define ALERT_TYPE_INTRUSION    0x09  // Door opened followed by motion while armed
+#define ALERT_TYPE_FIRE         0x0A  // Gas together with a temperature rise
+
+// Anomaly flags (sensor_data_msg_t.anomaly_flags)
+#define ANOMALY_TEMP_RISE       0x01
+#define ANOMALY_TEMP_OUTLIER    0x02
+#define ANOMALY_HUMIDITY_RISE   0x04
+#define ANOMALY_HUMIDITY_OUTLIER 0x08
 
 // Pulse types (for alert manager LED/buzzer control)
 #define PULSE_TYPE_NONE         0x00
@@ -40,34 +59,150 @@
 #define PULSE_TYPE_FAST         0x02  // Fast blink (medium priority)
 #define PULSE_TYPE_SOLID        0x03  // Solid on (high priority)
 
+// Sensor health states (see analysis/sensor_health.h)
+#define SENSOR_HEALTH_UNKNOWN   0x00  // Not read yet
+#define SENSOR_HEALTH_OK        0x01
+#define SENSOR_HEALTH_DEGRADED  0x02  // Failing or slow more often than usual
+#define SENSOR_HEALTH_STUCK     0x03  // Reporting the same value for too long
+#define SENSOR_HEALTH_FAILED    0x04  // Failing every read, polled with back-off
+
+typedef struct {
+    uint8_t state;                  // SENSOR_HEALTH_*
+    uint8_t failure_pct;            // Recent failure rate (%)
+    uint32_t poll_interval_ms;      // Current polling interval (adaptive rate + back-off)
+    uint32_t reads;                 // Reads (wakeups) since start-up
+    uint32_t failures;              // Failed reads since start-up
+    uint32_t slow_reads;            // Abnormally slow reads since start-up
+} sensor_health_info_t;
+
+// Rolling statistics for one sensor value (see analysis/rolling_stats.h)
+#define SENSOR_STATS_EWMA_COUNT 3   // EWMA time constants: 10 s, 1 min, 10 min
+
+typedef struct {
+    float ewma[SENSOR_STATS_EWMA_COUNT]; // Exponentially weighted moving averages
+    float mean;                     // Running mean since start-up
+    float variance;                 // Running sample variance since start-up
+    float min;                      // Minimum over the last 5 minutes
+    float max;                      // Maximum over the last 5 minutes
+    uint32_t count;                 // Number of samples seen (0 = no stats yet)
+    uint32_t truncated;             // Min/max window entries dropped early (0 normally)
+} sensor_stats_t;
+
+// Every sample of one sensor since the previous snapshot (see analysis/sample_window.h)
+typedef struct {
+    uint16_t samples;               // Good samples in the aggregation interval (0 = none, rest unset)
+    uint16_t active;                // ... whose state was active (detected, closed, temperature high)
+    uint16_t rising;                // Inactive -> active edges within the interval
+    uint16_t falling;               // Active -> inactive edges within the interval
+    int32_t min;                    // Lowest value (°C, cm, 0/1)
+    int32_t max;                    // Highest value
+    float mean;                     // Mean value
+} sensor_window_t;
+
+// One sensor instance in the aggregated message
+typedef struct {
+    char name[SENSOR_NAME_LEN];     // Instance name from the registry
+    uint8_t type;                   // SENSOR_TYPE_* (TEMPERATURE = DHT11 temperature + humidity)
+    uint8_t valid;                  // 1 if value/value2 are usable
+    uint8_t state;                  // Filtered state: SENSOR_STATE_* bits
+    uint8_t health;                 // SENSOR_HEALTH_*
+    int32_t value;                  // °C, gas/motion 0/1, distance (cm)
+    int32_t value2;                 // Humidity (%), distance confidence (%), otherwise 0
+    uint64_t sample_ms;             // Monotonic time of the sample behind value (0 = none yet)
+    sensor_window_t window;         // All samples since the previous snapshot
+} sensor_reading_t;
+
+// sensor_reading_t.state bits
+#define SENSOR_STATE_ACTIVE     0x01  // Gas detected, motion detected, door closed, temperature high
+#define SENSOR_STATE_LOW        0x02  // Temperature below the low threshold
+#define SENSOR_STATE_STALE      0x04  // Last sample older than the staleness limit (valid is 0)
+
 // Aggregated sensor data message (sent to web server)
+//
+// The named fields describe the first sensor of each type (the "primary"
+// sensors, kept for existing consumers); sensors[] lists every registered
+// instance. Only the first sensor_count entries are sent, see
+// SENSOR_DATA_MSG_SIZE().
+//
+// Sample times are CLOCK_MONOTONIC milliseconds, comparable with mono_ms and
+// with the receiver's own clock on the same node: age = now - *_sample_ms.
 typedef struct {
     uint16_t msg_type;              // MSG_TYPE_SENSOR_DATA
     time_t timestamp;               // Time of reading
+    uint64_t mono_ms;               // Monotonic time the snapshot was built
+    uint16_t zone_id;               // Zone of the sending analyzer
+    char zone_name[ZONE_NAME_LEN];  // Human-readable zone name
     
     // Temperature sensor data
     int temperature;                // Temperature in Celsius
     int humidity;                   // Humidity percentage
-    uint8_t temp_sensor_valid;      // 1 if valid, 0 if error
+    uint8_t temp_sensor_valid;      // 1 if a reading no older than temp_stale_ms is available
+    uint32_t temp_age_ms;           // Age of the temperature/humidity reading (ms)
+    uint64_t temp_sample_ms;        // Monotonic time of that reading (0 = none yet)
+    float temp_availability;        // Share of reports with a valid reading since start-up (%)
+    uint32_t temp_retries;          // DHT11 retry attempts since start-up
+    uint32_t temp_recovered;        // Read cycles rescued by a retry
+    uint32_t temp_busy_ms;          // Time spent busy-waiting on the DHT11 line (ms)
+    uint32_t temp_wasted_busy_ms;   // ... of which in attempts that failed (ms)
     
     // Gas sensor data
     uint8_t gas_detected;           // 1 if gas detected, 0 if clean
-    uint8_t gas_sensor_valid;       // 1 if valid, 0 if error
+    uint8_t gas_sensor_valid;       // 1 if valid, 0 if error or stale
+    uint64_t gas_sample_ms;         // Monotonic time of the last good read (0 = none yet)
     
     // PIR motion sensor data
     uint8_t motion_detected;        // 1 if motion detected, 0 otherwise
-    uint8_t motion_sensor_valid;    // 1 if valid, 0 if error
+    uint8_t motion_sensor_valid;    // 1 if valid, 0 if error or stale
+    uint64_t motion_sample_ms;      // Monotonic time of the last good read (0 = none yet)
     
     // Ultrasonic sensor data (door closing detection)
     uint16_t distance_cm;           // Distance in centimeters
     uint8_t door_closed;            // 1 if door closed, 0 if open
-    uint8_t ultrasonic_valid;       // 1 if valid, 0 if error
+    uint8_t ultrasonic_valid;       // 1 if valid, 0 if error or stale
+    uint8_t distance_confidence;    // Share of the ping burst that agreed (0..100 %)
+    uint64_t distance_sample_ms;    // Monotonic time of the last accepted burst (0 = none yet)
     
     // System status
     uint8_t alert_level;            // Current overall alert level
     uint32_t sequence_num;          // Sequence number for tracking
+
+    // Spurious transitions removed by hysteresis/debounce (cumulative)
+    uint32_t temp_filtered;         // Temperature high/low flips suppressed
+    uint32_t gas_filtered;          // Gas detected flips suppressed
+    uint32_t motion_filtered;       // Motion flips suppressed
+    uint32_t door_filtered;         // Door open/closed flips suppressed
+
+    // Rolling statistics
+    sensor_stats_t temp_stats;      // Temperature (°C)
+    sensor_stats_t humidity_stats;  // Humidity (%)
+    sensor_stats_t distance_stats;  // Ultrasonic distance (cm)
+
+    // Anomaly detection (see analysis/anomaly_detector.h)
+    float temp_rate_per_min;        // Temperature rate of change (°C/min)
+    float humidity_rate_per_min;    // Humidity rate of change (%/min)
+    float temp_zscore;              // Temperature z-score against the baseline
+    float humidity_zscore;          // Humidity z-score against the baseline
+    uint8_t anomaly_flags;          // Active ANOMALY_* flags
+
+    // Event correlation (see analysis/event_correlator.h)
+    uint8_t armed;                  // 1 if intrusion rules are armed
+    uint32_t correlated_alerts;     // Composite alerts raised since start-up
+
+    // Sensor health
+    sensor_health_info_t temp_health;
+    sensor_health_info_t gas_health;
+    sensor_health_info_t motion_health;
+    sensor_health_info_t ultrasonic_health;
+
+    // Every registered sensor instance (must stay last)
+    uint16_t sensor_count;          // Valid entries in sensors[]
+    sensor_reading_t sensors[SENSOR_MAX_INSTANCES];
 } sensor_data_msg_t;
 
+// Bytes to send for a message carrying n sensor instances
+#define SENSOR_DATA_MSG_SIZE(n) \
+    (offsetof(sensor_data_msg_t, sensors) + (size_t)(n) * sizeof(sensor_reading_t))
+
 // Alert message (sent to event logger)
 typedef struct {
     uint16_t msg_type;              // MSG_TYPE_ALERT
@@ -101,6 +236,56 @@ typedef struct {
     int humidity_high_threshold;    // Humidity high threshold (%)
     int humidity_low_threshold;     // Humidity low threshold (%)
     uint16_t door_closed_dist_cm;   // Distance threshold for door closed (cm)
+
+    // Hysteresis bands and minimum dwell times (see analysis/sensor_filter.h)
+    int temp_hysteresis;            // °C the temperature must recover before an alert clears
+    uint16_t door_hysteresis_cm;    // Extra distance (cm) before a closed door reads open
+    uint32_t temp_dwell_ms;         // Minimum time in a temperature state before it is accepted
+    uint32_t gas_dwell_ms;          // Minimum time in a gas state before it is accepted
+    uint32_t motion_dwell_ms;       // Minimum time in a motion state before it is accepted
+    uint32_t door_dwell_ms;         // Minimum time in a door state before it is accepted
+
+    // Anomaly detection
+    float temp_rise_per_min;        // Temperature rise (°C/min) that raises an alert
+    float humidity_rise_per_min;    // Humidity rise (%/min) that raises an alert
+    float anomaly_z_threshold;      // |z-score| that marks a reading as an outlier
+
+    // Event correlation
+    uint8_t armed;                  // 1 to enable rules that only apply while armed
+
+    // Sensor health
+    uint32_t sensor_fail_threshold; // Consecutive failures before a sensor is marked failed
+    uint32_t sensor_backoff_max_ms; // Longest polling interval for a failed sensor
+    uint32_t temp_stuck_ms;         // DHT11 reading unchanged this long = stuck (0 = off)
+    uint32_t pir_stuck_ms;          // PIR output high this long = stuck (0 = off)
+
+    // Adaptive sampling (see analysis/sample_rate.h)
+    uint32_t temp_min_interval_ms;  // Fastest DHT11 polling (never below 1 s)
+    uint32_t temp_max_interval_ms;  // DHT11 polling while quiet
+    uint32_t ultrasonic_min_interval_ms; // Fastest ultrasonic polling
+    uint32_t ultrasonic_max_interval_ms; // Ultrasonic polling while quiet
+    uint32_t rate_boost_hold_ms;    // How long activity keeps a sensor at its fastest rate
+
+    // Ultrasonic burst sampling (see analysis/burst_filter.h)
+    uint8_t ultrasonic_burst_count; // Pings per distance reading (1..9)
+    uint16_t ultrasonic_burst_spacing_ms; // Time between pings of a burst (>= 60 ms)
+    uint8_t ultrasonic_min_confidence; // Confidence (%) needed before a reading can move the door state
+
+    // DHT11 read pipeline
+    uint8_t temp_read_retries;      // Extra attempts after a failed DHT11 read
+    uint16_t temp_retry_delay_ms;   // Pause before a retry (>= 100 ms)
+    uint32_t temp_stale_ms;         // Last good reading is served until it is this old
+
+    // Staleness of the other sensors: a reading older than this is reported
+    // invalid and no longer alerted on (never less than two polling periods)
+    uint32_t gas_stale_ms;
+    uint32_t motion_stale_ms;
+    uint32_t ultrasonic_stale_ms;
+
+    // Event-triggered publishing: a state change that can raise an alert is
+    // published at once, at most once per this interval per sensor (0 = only
+    // on the aggregation tick)
+    uint32_t event_publish_min_ms;
 } threshold_config_t;
 
 #endif // MSG_DEF_H
@@ -0,0 +1,147 @@
+/*
+ * recv_pool_check.c
+ *
+ *  Receive Pool Thread Cycling Check:
+ *  - Runs a receive pool (common/recv_pool.h) with lo_water = hi_water = 1
+ *    on a channel of its own, so a message mostly starts a new thread and
+ *    retires the one that handled it, as a server pool does under bursts
+ *  - The handler logs each message with LOG_INFO (common/binlog.h) to a
+ *    binary log, so every pool thread takes a binlog ring
+ *  - Sends -n pulses (default 4 * BINLOG_MAX_THREADS), one every -i ms, then
+ *    checks that every record reached the log: none lost for want of a ring
+ *    (lost_threads) or to a full one
+ *  - Exits non-zero on failure (make HOST=1 recv_pool_check)
+ */
+
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/neutrino.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "common/binlog.h"
+#include "common/recv_pool.h"
+
+#define CHECK_PULSE_CODE (_PULSE_CODE_MINAVAIL + 1)
+#define CHECK_TIMEOUT_MS 10000
+
+static _Atomic uint32_t g_handled;
+
+static void check_handler(int rcvid, void *msg, const struct _msg_info *info, void *arg)
+{
+    const struct _pulse *pulse = msg;
+
+    (void)info;
+    (void)arg;
+    if (rcvid == 0 && pulse->code == CHECK_PULSE_CODE)
+    {
+        LOG_INFO("recv_pool_check: pulse %d", pulse->value.sival_int);
+        atomic_fetch_add(&g_handled, 1);
+    }
+}
+
+static void sleep_ms(uint32_t ms)
+{
+    struct timespec ts = {.tv_sec = ms / 1000, .tv_nsec = (long)(ms % 1000) * 1000000L};
+
+    nanosleep(&ts, NULL);
+}
+
+int main(int argc, char *argv[])
+{
+    static const recv_pool_attr_t attr = {1, 1, 1, 4};
+    static recv_pool_t pool;
+    char path[] = "/tmp/recv_pool_check.XXXXXX";
+    uint32_t pulses = 4 * BINLOG_MAX_THREADS;
+    uint32_t interval_ms = 2;
+    uint32_t dropped = 0;
+    uint32_t records;
+    uint32_t lost;
+    long header_size;
+    struct stat st;
+    int rings;
+    int chid, coid;
+    int fd;
+    int opt;
+    int i;
+
+    while ((opt = getopt(argc, argv, "n:i:")) != -1)
+    {
+        switch (opt)
+        {
+        case 'n':
+            pulses = (uint32_t)strtoul(optarg, NULL, 10);
+            break;
+        case 'i':
+            interval_ms = (uint32_t)strtoul(optarg, NULL, 10);
+            break;
+        default:
+            fprintf(stderr, "Usage: %s [-n pulses] [-i interval_ms]\n", argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    fd = mkstemp(path);
+    if (fd == -1 || binlog_init(path) != 0)
+    {
+        perror("recv_pool_check: binary log");
+        return EXIT_FAILURE;
+    }
+    close(fd);
+    header_size = ftell(g_binlog.out);
+
+    chid = ChannelCreate(0);
+    coid = chid == -1 ? -1 : ConnectAttach(0, 0, chid, _NTO_SIDE_CHANNEL, 0);
+    if (coid == -1)
+    {
+        perror("recv_pool_check: channel");
+        return EXIT_FAILURE;
+    }
+    recv_pool_init(&pool, "recv_pool_check", chid, sizeof(struct _pulse), THREAD_CLASS_IPC, check_handler, NULL,
+                   &attr);
+    if (recv_pool_start(&pool) != 0)
+    {
+        perror("recv_pool_check: pool");
+        return EXIT_FAILURE;
+    }
+
+    for (i = 0; i < (int)pulses; i++)
+    {
+        MsgSendPulse(coid, -1, CHECK_PULSE_CODE, i);
+        sleep_ms(interval_ms);
+    }
+    for (i = 0; atomic_load(&g_handled) < pulses && i < CHECK_TIMEOUT_MS; i++)
+    {
+        sleep_ms(1);
+    }
+
+    // Counters before the shutdown: the pool threads may still be waiting on the channel
+    pthread_mutex_lock(&pool.lock);
+    printf("recv_pool_check: %u pulses handled, %u pool threads created, %u retired\n", atomic_load(&g_handled),
+           pool.created, pool.retired);
+    pthread_mutex_unlock(&pool.lock);
+    binlog_shutdown();
+
+    rings = atomic_load(&g_binlog.ring_count);
+    rings = rings < BINLOG_MAX_THREADS ? rings : BINLOG_MAX_THREADS;
+    lost = atomic_load(&g_binlog.lost_threads);
+    for (i = 0; i < rings; i++)
+    {
+        dropped += g_binlog.rings[i] ? atomic_load(&g_binlog.rings[i]->dropped) : 0;
+    }
+    records = stat(path, &st) == 0 ? (uint32_t)((st.st_size - header_size) / (long)sizeof(binlog_record_t)) : 0;
+    unlink(path);
+    printf("recv_pool_check: %u records logged, %d rings, %u lost without a ring, %u dropped (ring full)\n", records,
+           rings, lost, dropped);
+
+    if (atomic_load(&g_handled) != pulses || records != pulses || lost != 0 || dropped != 0)
+    {
+        printf("FAIL recv_pool_check\n");
+        return EXIT_FAILURE;
+    }
+    printf("ok   recv_pool_check\n");
+    return EXIT_SUCCESS;
+}
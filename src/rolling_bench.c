@@ -0,0 +1,193 @@
+/*
+ * rolling_bench.c
+ *
+ *  Rolling Statistics Benchmark:
+ *  - Measures the cost of one rolling_stats_add() (analysis/rolling_stats.h)
+ *    at the sample spacings the sensors run at: 1 s idle polling down to the
+ *    60 ms of a boosted ultrasonic sensor, and 10 ms beyond it
+ *  - Each spacing runs a noisy signal and a steady decline, the worst case
+ *    for the max deque (every sample is a later maximum)
+ *  - Reports the mean, p50, p99 and worst per-sample time, the largest deque
+ *    seen and the window truncation count, which should stay 0
+ *  - Every 1000th sample the 5 minute min/max is checked against the exact
+ *    window; bucketing may hold an extreme at most one bucket longer
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "analysis/rolling_stats.h"
+#include "common/mono_time.h"
+
+#define BENCH_BUCKETS 64 // Power-of-two histogram of per-call ns
+
+typedef struct
+{
+    uint64_t total_ns;
+    uint64_t max_ns;
+    uint32_t buckets[BENCH_BUCKETS];
+} bench_times_t;
+
+static uint32_t g_samples = 200000;
+
+static int bucket_of(uint64_t ns)
+{
+    int b = 0;
+
+    while (ns > 1 && b < BENCH_BUCKETS - 1)
+    {
+        ns >>= 1;
+        b++;
+    }
+    return b;
+}
+
+static void record(bench_times_t *t, uint64_t ns)
+{
+    t->total_ns += ns;
+    t->buckets[bucket_of(ns)]++;
+    if (ns > t->max_ns)
+    {
+        t->max_ns = ns;
+    }
+}
+
+// Upper bound (ns) of the bucket holding the given fraction of calls
+static uint64_t percentile(const uint32_t *buckets, uint64_t total, double fraction)
+{
+    uint64_t seen = 0;
+    int b;
+
+    for (b = 0; b < BENCH_BUCKETS; b++)
+    {
+        seen += buckets[b];
+        if (seen >= (uint64_t)(fraction * total))
+        {
+            return 2ULL << b;
+        }
+    }
+    return UINT64_MAX;
+}
+
+/**
+ * Whether the reported min/max lie between the exact extremes of the window
+ * and of the window plus one bucket
+ */
+static int window_ok(const float *values, uint32_t n, uint64_t spacing_ms, const sensor_stats_t *snap)
+{
+    uint64_t now = (uint64_t)(n - 1) * spacing_ms;
+    float lo = values[n - 1], hi = values[n - 1];
+    float lo_wide = lo, hi_wide = hi;
+    uint32_t i;
+
+    for (i = n; i-- > 0;)
+    {
+        uint64_t age = now - (uint64_t)i * spacing_ms;
+
+        if (age > ROLLING_WINDOW_MS + ROLLING_BUCKET_MS)
+        {
+            break;
+        }
+        if (age <= ROLLING_WINDOW_MS)
+        {
+            lo = values[i] < lo ? values[i] : lo;
+            hi = values[i] > hi ? values[i] : hi;
+        }
+        lo_wide = values[i] < lo_wide ? values[i] : lo_wide;
+        hi_wide = values[i] > hi_wide ? values[i] : hi_wide;
+    }
+    return snap->min <= lo && snap->min >= lo_wide && snap->max >= hi && snap->max <= hi_wide;
+}
+
+static void run(const char *label, uint64_t spacing_ms, int decline)
+{
+    static rolling_stats_t stats;
+    float *values = malloc(g_samples * sizeof(*values));
+    bench_times_t t = {0};
+    sensor_stats_t snap;
+    uint32_t largest = 0;
+    uint32_t checks = 0;
+    uint32_t bad = 0;
+    uint32_t i;
+
+    srand(1);
+    rolling_stats_init(&stats);
+    for (i = 0; i < g_samples; i++)
+    {
+        uint64_t start;
+
+        values[i] = decline ? 400.0f - (float)i * 0.001f : 100.0f + (float)(rand() % 2000) / 10.0f;
+        start = mono_time_ns();
+        rolling_stats_add(&stats, values[i], (uint64_t)i * spacing_ms);
+        record(&t, mono_time_ns() - start);
+
+        if (stats.min_q.count > largest)
+        {
+            largest = stats.min_q.count;
+        }
+        if (stats.max_q.count > largest)
+        {
+            largest = stats.max_q.count;
+        }
+        if (i % 1000 == 999)
+        {
+            rolling_stats_snapshot(&stats, &snap);
+            checks++;
+            bad += !window_ok(values, i + 1, spacing_ms, &snap);
+        }
+    }
+
+    printf("%4llu ms %-7s: mean %6.1f ns  p50 <%5llu ns  p99 <%5llu ns  max %7.1f us  deque %3u/%d  "
+           "truncated %u  window %u/%u ok\n",
+           (unsigned long long)spacing_ms, label, (double)t.total_ns / g_samples,
+           (unsigned long long)percentile(t.buckets, g_samples, 0.50),
+           (unsigned long long)percentile(t.buckets, g_samples, 0.99), t.max_ns / 1e3, largest,
+           ROLLING_WINDOW_CAP, stats.truncated, checks - bad, checks);
+    free(values);
+}
+
+int main(int argc, char *argv[])
+{
+    static const uint64_t spacings_ms[] = {1000, 250, 60, 10};
+    uint64_t clock_ns;
+    size_t s;
+    int opt;
+    int i;
+
+    while ((opt = getopt(argc, argv, "n:")) != -1)
+    {
+        switch (opt)
+        {
+        case 'n':
+            g_samples = (uint32_t)strtoul(optarg, NULL, 10);
+            break;
+        default:
+            fprintf(stderr, "Usage: %s [-n samples]\n", argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+    if (g_samples == 0)
+    {
+        fprintf(stderr, "Need at least one sample\n");
+        return EXIT_FAILURE;
+    }
+
+    // Every timing includes one clock read
+    clock_ns = mono_time_ns();
+    for (i = 0; i < 100000; i++)
+    {
+        mono_time_ns();
+    }
+    clock_ns = (mono_time_ns() - clock_ns) / 100000;
+    printf("%u samples per run, %d ms buckets, clock read %llu ns (included below)\n\n", g_samples,
+           ROLLING_BUCKET_MS, (unsigned long long)clock_ns);
+
+    for (s = 0; s < sizeof(spacings_ms) / sizeof(spacings_ms[0]); s++)
+    {
+        run("noise", spacings_ms[s], 0);
+        run("decline", spacings_ms[s], 1);
+    }
+    return EXIT_SUCCESS;
+}
@@ -14,6 +14,25 @@
 #include <sys/syspage.h>
 #include "../common/public/rpi_gpio.h"
 
+// The DHT11 needs at least 1 s between start signals
+#define DHT11_MIN_INTERVAL_MS 1000
+
+// A failed transfer leaves the sensor idle again within a few ms; give it a
+// little longer before the next start signal
+#define DHT11_RETRY_MIN_MS 100
+
+#define DHT11_START_LOW_US 20000  // Start signal: line held LOW for 20 ms (slept, not spun)
+
+// Read pipeline counters (see temperature_sensor_read_retry)
+typedef struct {
+    uint32_t cycles;          // Read cycles (one per poll)
+    uint32_t attempts;        // Start signals sent
+    uint32_t retries;         // Attempts beyond the first of a cycle
+    uint32_t recovered;       // Cycles that failed at first but succeeded on a retry
+    uint64_t busy_us;         // Time spent busy-waiting on the data line
+    uint64_t wasted_busy_us;  // ... of which in attempts that failed
+} dht_read_stats_t;
+
 // DHT11 timing helper functions
 static inline uint64_t dht_cycles_per_usec(void) {
     return SYSPAGE_ENTRY(qtime)->cycles_per_sec / 1000000ULL;
@@ -84,16 +103,20 @@ static int temperature_sensor_init(int gpio_pin) {
 }
 
 /**
- * Read temperature and humidity from DHT11 sensor
+ * Read temperature and humidity from DHT11 sensor, reporting busy-wait time
  * 
  * @param gpio_pin GPIO pin connected to DHT11 DATA line
  * @param temperature Pointer to store temperature value (°C)
  * @param humidity Pointer to store humidity value (%)
+ * @param busy_us Pointer to store the time spent busy-waiting (may be NULL)
  * @return 0 on success, -1 on error
  */
-static int temperature_sensor_read(int gpio_pin, int *temperature, int *humidity) {
+static int temperature_sensor_read_timed(int gpio_pin, int *temperature, int *humidity,
+                                         uint32_t *busy_us) {
     uint8_t data[5] = {0};
     int i, bit;
+    uint64_t busy_start;
+    int ret = -1;
     
     // 1) Start signal: MCU pulls line LOW ≥18 ms, then HIGH 20-40 us
     if (rpi_gpio_setup(gpio_pin, GPIO_OUT)) {
@@ -103,36 +126,39 @@ static int temperature_sensor_read(int gpio_pin, int *temperature, int *humidity
     if (rpi_gpio_output(gpio_pin, GPIO_LOW)) {
         return -1;
     }
-    usleep(20000);  // 20 ms
+    usleep(DHT11_START_LOW_US);  // 20 ms
+
+    // Everything from here on spins on the data line
+    busy_start = dht_get_cycles();
     
     if (rpi_gpio_output(gpio_pin, GPIO_HIGH)) {
-        return -1;
+        goto out;
     }
     dht_delay_us(40);   // 20-40 us
     
     // 2) Switch to input, sensor responds: LOW 80 us, HIGH 80 us
     if (rpi_gpio_setup(gpio_pin, GPIO_IN)) {
-        return -1;
+        goto out;
     }
     
     // Wait for sensor to pull LOW
     if (dht_wait_while_level(gpio_pin, GPIO_HIGH, 200) < 0) {
-        return -1;
+        goto out;
     }
     // LOW ~80 us
     if (dht_wait_while_level(gpio_pin, GPIO_LOW, 200) < 0) {
-        return -1;
+        goto out;
     }
     // HIGH ~80 us
     if (dht_wait_while_level(gpio_pin, GPIO_HIGH, 200) < 0) {
-        return -1;
+        goto out;
     }
     
     // 3) Read 40 bits (5 bytes)
     for (i = 0; i < 40; ++i) {
         bit = dht_read_bit(gpio_pin);
         if (bit < 0) {
-            return -1;
+            goto out;
         }
         data[i / 8] <<= 1;
         data[i / 8] |= (uint8_t)bit;
@@ -141,14 +167,79 @@ static int temperature_sensor_read(int gpio_pin, int *temperature, int *humidity
     // 4) Verify checksum: d[4] == sum(d[0..3])
     uint8_t sum = (uint8_t)(data[0] + data[1] + data[2] + data[3]);
     if (sum != data[4]) {
-        return -1;
+        goto out;
     }
     
     // DHT11 format: RH int, RH dec, T int, T dec, checksum
     if (humidity)    *humidity = (int)data[0];
     if (temperature) *temperature = (int)data[2];
-    
-    return 0;
+    ret = 0;
+
+out:
+    if (busy_us) {
+        *busy_us = (uint32_t)((dht_get_cycles() - busy_start) / dht_cycles_per_usec());
+    }
+    return ret;
+}
+
+/**
+ * Read with retries: a checksum error or timeout is retried after
+ * retry_delay_ms (at least DHT11_RETRY_MIN_MS) up to max_retries times, so a
+ * single glitch does not cost a whole polling interval.
+ * 
+ * @param gpio_pin GPIO pin connected to DHT11 DATA line
+ * @param max_retries Extra attempts after a failed read
+ * @param retry_delay_ms Pause before each retry
+ * @param temperature Pointer to store temperature value (°C)
+ * @param humidity Pointer to store humidity value (%)
+ * @param busy_us Pointer to store this cycle's busy-wait time (may be NULL)
+ * @param stats Pipeline counters to update (may be NULL)
+ * @return 0 on success, -1 if every attempt failed
+ */
+static int temperature_sensor_read_retry(int gpio_pin, int max_retries, uint32_t retry_delay_ms,
+                                         int *temperature, int *humidity, uint32_t *busy_us,
+                                         dht_read_stats_t *stats) {
+    uint32_t cycle_busy_us = 0;
+    int attempt;
+    int ret = -1;
+
+    if (retry_delay_ms < DHT11_RETRY_MIN_MS) {
+        retry_delay_ms = DHT11_RETRY_MIN_MS;
+    }
+
+    for (attempt = 0; attempt <= max_retries; ++attempt) {
+        uint32_t attempt_us = 0;
+
+        if (attempt > 0) {
+            usleep(retry_delay_ms * 1000);
+        }
+        ret = temperature_sensor_read_timed(gpio_pin, temperature, humidity, &attempt_us);
+        cycle_busy_us += attempt_us;
+        if (stats) {
+            stats->attempts++;
+            stats->busy_us += attempt_us;
+            if (attempt > 0) {
+                stats->retries++;
+            }
+            if (ret != 0) {
+                stats->wasted_busy_us += attempt_us;
+            }
+        }
+        if (ret == 0) {
+            break;
+        }
+    }
+
+    if (stats) {
+        stats->cycles++;
+        if (ret == 0 && attempt > 0) {
+            stats->recovered++;
+        }
+    }
+    if (busy_us) {
+        *busy_us = cycle_busy_us;
+    }
+    return ret;
 }
 
 #endif // TEMPERATURE_SENSOR_H
@@ -12,6 +12,7 @@
 #ifndef ULTRASONIC_SENSOR_H
 #define ULTRASONIC_SENSOR_H
 
+#include "../analysis/burst_filter.h"
 #include "../common/public/rpi_gpio.h"
 #include <stdbool.h>
 #include <stdint.h>
@@ -20,6 +21,9 @@
 #define SPEED_OF_SOUND_CM_PER_US 0.0343
 #define EDGE_TIMEOUT_MS 50.0
 
+// HC-SR04 needs ~60 ms between pings for echoes to die out
+#define ULTRASONIC_MIN_INTERVAL_MS 60
+
 #define GPIO_PERIPHERAL_BASE 0xfe000000
 
 extern volatile uint32_t *__RPI_GPIO_REGS;
@@ -116,4 +120,50 @@ static int ultrasonic_sensor_read(int trig_pin, int echo_pin, uint16_t *distance
     return 0;
 }
 
+/**
+ * Take a burst of pings and combine them (see analysis/burst_filter.h)
+ *
+ * @param trig_pin    Trigger GPIO
+ * @param echo_pin    Echo GPIO
+ * @param count       Pings in the burst (1..BURST_MAX_SAMPLES)
+ * @param spacing_ms  Time between pings (at least ULTRASONIC_MIN_INTERVAL_MS)
+ * @param distance_cm Filled with the filtered distance
+ * @param confidence  Filled with the share of pings that agreed (0..100)
+ * @return 0 on success, -1 if no ping returned a usable echo
+ */
+static inline int ultrasonic_sensor_read_burst(int trig_pin, int echo_pin, int count, uint32_t spacing_ms,
+                                               uint16_t *distance_cm, uint8_t *confidence)
+{
+    uint16_t samples[BURST_MAX_SAMPLES];
+    uint8_t valid[BURST_MAX_SAMPLES];
+    int i;
+
+    if (count < 1)
+    {
+        count = 1;
+    }
+    if (count > BURST_MAX_SAMPLES)
+    {
+        count = BURST_MAX_SAMPLES;
+    }
+    if (spacing_ms < ULTRASONIC_MIN_INTERVAL_MS)
+    {
+        spacing_ms = ULTRASONIC_MIN_INTERVAL_MS;
+    }
+
+    for (i = 0; i < count; i++)
+    {
+        if (i > 0)
+        {
+            // Let the previous echo die out before the next ping
+            struct timespec gap = {.tv_sec = spacing_ms / 1000,
+                                   .tv_nsec = (long)(spacing_ms % 1000) * 1000000L};
+            nanosleep(&gap, NULL);
+        }
+        valid[i] = ultrasonic_sensor_read(trig_pin, echo_pin, &samples[i]) == 0;
+    }
+
+    return burst_filter(samples, valid, count, distance_cm, confidence) > 0 ? 0 : -1;
+}
+
 #endif
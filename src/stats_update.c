@@ -1,8 +1,15 @@
 /*
  * stats_update.c
  *
- * This process receives sensor data from the Central Analyzer and writes 
- * it to a dashboard.json file that is then served by an HTTP server.
+ * This process receives sensor data from the Central Analyzers (one per zone)
+ * and writes it to a dashboard.json file that is then served by an HTTP server.
+ *
+ * A pool of receive threads (common/recv_pool.h) takes messages from any
+ * number of analyzers and stores the latest snapshot per zone
+ * (common/zone_table.h), replying immediately. The pool grows with the number
+ * of analyzers sending at once and shrinks again when they are quiet. A
+ * separate writer thread turns the zone table into dashboard.json, at most
+ * once per DASHBOARD_MIN_INTERVAL_MS.
  *
  *  Created on: 20-Nov-2025
  *      Author: Rohith
@@ -15,11 +22,162 @@
 #include <stdlib.h>
 #include <errno.h>
 #include <time.h>
+#include <math.h>
+#include <pthread.h>
+#include <unistd.h>
 
 #include "msg_def.h"
+#include "analysis/sensor_health.h"
+#include "common/mono_time.h"
+#include "common/binlog.h"
+#include "common/heartbeat.h"
+#include "common/recv_pool.h"
+#include "common/span_trace.h"
+#include "common/thread_policy.h"
+#include "common/zone_table.h"
 
 #define DASHBOARD_FILE "/home/qnxuser/home_safety_dash/dashboard.json"
 #define DASHBOARD_FILE_FALLBACK "./dashboard.json"
+#define CONFIG_FILE "/home/qnxuser/home_safety.conf" // Thread policies (thread_* keys)
+
+#define DASHBOARD_MIN_INTERVAL_MS 500   // Coalesce updates from many zones
+
+// Latest snapshot per zone (protected by g_zone_mutex)
+static zone_table_t g_zones;
+static pthread_mutex_t g_zone_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t g_zone_cond = PTHREAD_COND_INITIALIZER;
+
+static name_attach_t* g_attach;
+static recv_pool_t g_recv_pool;
+
+// Receive pool: lo_water, hi_water, increment, maximum (recv_pool_stats_update, -t sets the maximum)
+static const recv_pool_attr_t g_recv_pool_default = {2, 4, 1, 16};
+
+/**
+ * Write the rolling statistics object for one sensor value
+ */
+static void write_stats_json(FILE* file, const sensor_stats_t* stats) {
+    if (stats->count == 0) {
+        fprintf(file, "      \"stats\": null\n");
+        return;
+    }
+    fprintf(file, "      \"stats\": {\n");
+    fprintf(file, "        \"ewma_10s\": %.2f,\n", stats->ewma[0]);
+    fprintf(file, "        \"ewma_1m\": %.2f,\n", stats->ewma[1]);
+    fprintf(file, "        \"ewma_10m\": %.2f,\n", stats->ewma[2]);
+    fprintf(file, "        \"mean\": %.2f,\n", stats->mean);
+    fprintf(file, "        \"stddev\": %.2f,\n", sqrtf(stats->variance));
+    fprintf(file, "        \"min_5m\": %.1f,\n", stats->min);
+    fprintf(file, "        \"max_5m\": %.1f,\n", stats->max);
+    fprintf(file, "        \"count\": %u,\n", stats->count);
+    fprintf(file, "        \"window_truncated\": %u\n", stats->truncated);
+    fprintf(file, "      }\n");
+}
+
+/**
+ * Write the health object for one sensor
+ */
+static void write_health_json(FILE* file, const char* name, const sensor_health_info_t* health,
+                              int last) {
+    fprintf(file, "      \"%s\": { \"state\": \"%s\", \"failure_pct\": %u, "
+                  "\"poll_interval_ms\": %u, \"reads\": %u, \"failures\": %u, "
+                  "\"slow_reads\": %u }%s\n",
+            name, sensor_health_name(health->state), health->failure_pct,
+            health->poll_interval_ms, health->reads, health->failures, health->slow_reads,
+            last ? "" : ",");
+}
+
+/**
+ * Write "age_ms": the age of a sample at render time, or null before the first one.
+ * Sample times are monotonic, so the age includes the trip through the pipeline.
+ */
+static void write_age_json(FILE* file, uint64_t sample_ms, uint64_t now) {
+    if (sample_ms == 0) {
+        fprintf(file, "\"age_ms\": null");
+    } else {
+        fprintf(file, "\"age_ms\": %llu", (unsigned long long)(now > sample_ms ? now - sample_ms : 0));
+    }
+}
+
+/**
+ * Write a fixed-size name field as a quoted JSON string; names come from other
+ * processes, so quotes, backslashes and control characters are escaped
+ */
+static void write_name_json(FILE* file, const char* name, size_t len) {
+    size_t i;
+
+    fputc('"', file);
+    for (i = 0; i < len && name[i]; i++) {
+        unsigned char c = (unsigned char)name[i];
+        if (c == '"' || c == '\\') {
+            fprintf(file, "\\%c", c);
+        } else if (c < 0x20 || c == 0x7f) {
+            fprintf(file, "\\u%04x", c);
+        } else {
+            fputc(c, file);
+        }
+    }
+    fputc('"', file);
+}
+
+/**
+ * Write the "window" object: every sample since the previous snapshot
+ */
+static void write_window_json(FILE* file, const sensor_window_t* w) {
+    if (w->samples == 0) {
+        fprintf(file, "\"window\": { \"samples\": 0 }");
+        return;
+    }
+    fprintf(file, "\"window\": { \"samples\": %u, \"active\": %u, \"rising\": %u, \"falling\": %u, "
+                  "\"min\": %d, \"max\": %d, \"mean\": %.2f }",
+            w->samples, w->active, w->rising, w->falling, (int)w->min, (int)w->max, w->mean);
+}
+
+/**
+ * Write the entry for one sensor instance
+ */
+static void write_instance_json(FILE* file, const sensor_reading_t* r, uint64_t now, int indent, int last) {
+    fprintf(file, "%*s{ \"name\": ", indent, "");
+    write_name_json(file, r->name, SENSOR_NAME_LEN);
+    fprintf(file, ", \"health\": \"%s\", ", sensor_health_name(r->health));
+    write_age_json(file, r->sample_ms, now);
+    fprintf(file, ", \"stale\": %s, ", (r->state & SENSOR_STATE_STALE) ? "true" : "false");
+    switch (r->type) {
+    case SENSOR_TYPE_TEMPERATURE:
+        fprintf(file, "\"type\": \"temperature\", ");
+        if (r->valid) {
+            fprintf(file, "\"temperature\": %d, \"humidity\": %d, \"status\": \"%s\"",
+                    (int)r->value, (int)r->value2,
+                    (r->state & SENSOR_STATE_ACTIVE) ? "high" :
+                    (r->state & SENSOR_STATE_LOW) ? "low" : "normal");
+        } else {
+            fprintf(file, "\"temperature\": null, \"humidity\": null, \"status\": \"unknown\"");
+        }
+        break;
+    case SENSOR_TYPE_GAS:
+    case SENSOR_TYPE_MOTION:
+        fprintf(file, "\"type\": \"%s\", \"status\": \"%s\"",
+                r->type == SENSOR_TYPE_GAS ? "smoke" : "motion",
+                !r->valid ? "unknown" : (r->state & SENSOR_STATE_ACTIVE) ? "detected" : "clear");
+        break;
+    case SENSOR_TYPE_ULTRASONIC:
+        fprintf(file, "\"type\": \"door\", ");
+        if (r->valid) {
+            fprintf(file, "\"status\": \"%s\", \"distance\": %d, \"confidence\": %d",
+                    (r->state & SENSOR_STATE_ACTIVE) ? "closed" : "open",
+                    (int)r->value, (int)r->value2);
+        } else {
+            fprintf(file, "\"status\": \"unknown\", \"distance\": null, \"confidence\": null");
+        }
+        break;
+    default:
+        fprintf(file, "\"type\": \"unknown\"");
+        break;
+    }
+    fprintf(file, ", ");
+    write_window_json(file, &r->window);
+    fprintf(file, " }%s\n", last ? "" : ",");
+}
 
 /**
  * Update dashboard.json with latest sensor data
@@ -27,19 +185,111 @@
  * Format:
  * {
  *   "sensors": {
- *     "door": { "status": "open" | "closed" },
- *     "temperature": { "value": number },
- *     "humidity": { "value": number },
- *     "smoke": { "status": string, "alert": boolean },
- *     "motion": { "status": "detected" | "clear" },
+ *     "door": { "status": "open" | "closed", "distance": number, "confidence": number,
+ *               "age_ms": number, "stats": {...} },
+ *     "temperature": { "value": number, "age_ms": number, "rate_per_min": number,
+ *                      "zscore": number, "alert": boolean, "stats": {...} },
+ *     "humidity": { "value": number, "rate_per_min": number, "zscore": number,
+ *                   "stats": {...} },
+ *     "smoke": { "status": string, "alert": boolean, "age_ms": number },
+ *     "motion": { "status": "detected" | "clear", "age_ms": number },
  *     "co2": { "value": number }
- *   }
+ *   },
+ *   "instances": [ { "name": string, "type": string, "health": string, "age_ms": number,
+ *                    "stale": boolean, ..., "window": {...} }, ... ],
+ *   "house": { "zones": number, "zones_online": number, "alert_level": string, ... },
+ *   "zones": [ { "id": number, "name": string, "online": boolean, "instances": [...] }, ... ]
  * }
+ *
+ * "sensors", "instances" and "metadata" describe the primary zone (lowest zone
+ * ID): "sensors" its first sensor of each type, "instances" every sensor it
+ * has. "house" merges all online zones and "zones" lists each one.
+ *
+ * "metadata.health" reports each sensor as ok / degraded / stuck / failed
+ * together with its recent failure rate and current polling interval.
+ * "metadata.dht11" reports how often a temperature reading was available and
+ * what the retry pipeline cost in busy-wait time.
+ *
+ * "age_ms" is the age of the sample behind a value when the file is written
+ * (null before the first sample). A reading older than the analyzer's
+ * staleness limit is reported with "stale": true and no value. A zone's
+ * "latency_ms" is the time from building its snapshot to receiving it, and
+ * "updates" the number of snapshots merged from it.
+ *
+ * "window" summarizes every sample an instance took since the zone's previous
+ * snapshot: samples, how many were active (detected / closed / above the
+ * high threshold), state edges, and min/max/mean of the value. A motion blip
+ * or gas spike between two snapshots shows up there even though the current
+ * status is clear.
+ *
+ * "stats" holds EWMAs (10 s / 1 min / 10 min), running mean/stddev and
+ * 5-minute min/max, or null before the first valid sample.
+ */
+static const char* alert_level_name(uint8_t level) {
+    return level == ALERT_LEVEL_CRITICAL ? "critical" :
+           level == ALERT_LEVEL_WARNING ? "warning" : "info";
+}
+
+/**
+ * Write the house-wide view and the per-zone list
  */
-static void update_dashboard(sensor_data_msg_t* data) {
+static void write_zones_json(FILE* file, const zone_table_t* table, uint64_t now) {
+    house_view_t house;
+    int z, i;
+
+    zone_table_house_view(table, now, &house);
+    fprintf(file, "  \"house\": {\n");
+    fprintf(file, "    \"zones\": %d,\n", house.zones);
+    fprintf(file, "    \"zones_online\": %d,\n", house.zones_online);
+    fprintf(file, "    \"alert_level\": \"%s\",\n", alert_level_name(house.alert_level));
+    fprintf(file, "    \"sensors\": %d,\n", house.sensors);
+    fprintf(file, "    \"sensors_unhealthy\": %d,\n", house.sensors_unhealthy);
+    if (house.temp_count > 0) {
+        fprintf(file, "    \"temperature\": { \"min\": %d, \"max\": %d, \"avg\": %.1f },\n",
+                house.temp_min, house.temp_max, house.temp_avg);
+        fprintf(file, "    \"humidity_avg\": %.1f,\n", house.humidity_avg);
+    } else {
+        fprintf(file, "    \"temperature\": null,\n");
+        fprintf(file, "    \"humidity_avg\": null,\n");
+    }
+    fprintf(file, "    \"smoke_detected\": %d,\n", house.smoke_detected);
+    fprintf(file, "    \"motion_detected\": %d,\n", house.motion_detected);
+    fprintf(file, "    \"doors_open\": %d\n", house.doors_open);
+    fprintf(file, "  },\n");
+
+    fprintf(file, "  \"zones\": [\n");
+    for (z = 0; z < table->count; z++) {
+        const zone_entry_t* zone = &table->zones[z];
+        const sensor_data_msg_t* msg = &zone->snapshot;
+
+        fprintf(file, "    {\n");
+        fprintf(file, "      \"id\": %u,\n", msg->zone_id);
+        fprintf(file, "      \"name\": ");
+        write_name_json(file, msg->zone_name, ZONE_NAME_LEN);
+        fprintf(file, ",\n");
+        fprintf(file, "      \"online\": %s,\n", zone_online(zone, now) ? "true" : "false");
+        fprintf(file, "      \"age_ms\": %llu,\n", (unsigned long long)(now - zone->updated_ms));
+        fprintf(file, "      \"latency_ms\": %llu,\n",
+                (unsigned long long)(zone->updated_ms > msg->mono_ms ? zone->updated_ms - msg->mono_ms : 0));
+        fprintf(file, "      \"sequence\": %u,\n", msg->sequence_num);
+        fprintf(file, "      \"updates\": %u,\n", zone->updates);
+        fprintf(file, "      \"alert_level\": \"%s\",\n", alert_level_name(msg->alert_level));
+        fprintf(file, "      \"instances\": [\n");
+        for (i = 0; i < msg->sensor_count; i++) {
+            write_instance_json(file, &msg->sensors[i], now, 8, i == msg->sensor_count - 1);
+        }
+        fprintf(file, "      ]\n");
+        fprintf(file, "    }%s\n", z == table->count - 1 ? "" : ",");
+    }
+    fprintf(file, "  ],\n");
+}
+
+static void update_dashboard(const zone_table_t* table, uint64_t now) {
+    const sensor_data_msg_t* data = &table->zones[0].snapshot;
     FILE* file;
     char timestamp[64];
     struct tm* tm_info;
+    int i;
     
     // Try primary location, fallback to current directory
     file = fopen(DASHBOARD_FILE, "w");
@@ -63,29 +313,48 @@ static void update_dashboard(sensor_data_msg_t* data) {
     // Door status
     fprintf(file, "    \"door\": {\n");
     if (data->ultrasonic_valid) {
-        fprintf(file, "      \"status\": \"%s\"\n", 
+        fprintf(file, "      \"status\": \"%s\",\n", 
                 data->door_closed ? "closed" : "open");
+        fprintf(file, "      \"distance\": %u,\n", data->distance_cm);
+        fprintf(file, "      \"confidence\": %u,\n", data->distance_confidence);
     } else {
-        fprintf(file, "      \"status\": \"unknown\"\n");
+        fprintf(file, "      \"status\": \"unknown\",\n");
+        fprintf(file, "      \"distance\": null,\n");
+        fprintf(file, "      \"confidence\": null,\n");
     }
+    fprintf(file, "      ");
+    write_age_json(file, data->distance_sample_ms, now);
+    fprintf(file, ",\n");
+    write_stats_json(file, &data->distance_stats);
     fprintf(file, "    },\n");
     
     // Temperature
     fprintf(file, "    \"temperature\": {\n");
     if (data->temp_sensor_valid) {
-        fprintf(file, "      \"value\": %d\n", data->temperature);
+        fprintf(file, "      \"value\": %d,\n", data->temperature);
+        fprintf(file, "      ");
+        write_age_json(file, data->temp_sample_ms, now);
+        fprintf(file, ",\n");
+        fprintf(file, "      \"rate_per_min\": %.2f,\n", data->temp_rate_per_min);
+        fprintf(file, "      \"zscore\": %.2f,\n", data->temp_zscore);
     } else {
-        fprintf(file, "      \"value\": null\n");
+        fprintf(file, "      \"value\": null,\n");
     }
+    fprintf(file, "      \"alert\": %s,\n",
+            (data->anomaly_flags & (ANOMALY_TEMP_RISE | ANOMALY_TEMP_OUTLIER)) ? "true" : "false");
+    write_stats_json(file, &data->temp_stats);
     fprintf(file, "    },\n");
     
     // Humidity
     fprintf(file, "    \"humidity\": {\n");
     if (data->temp_sensor_valid) {
-        fprintf(file, "      \"value\": %d\n", data->humidity);
+        fprintf(file, "      \"value\": %d,\n", data->humidity);
+        fprintf(file, "      \"rate_per_min\": %.2f,\n", data->humidity_rate_per_min);
+        fprintf(file, "      \"zscore\": %.2f,\n", data->humidity_zscore);
     } else {
-        fprintf(file, "      \"value\": null\n");
+        fprintf(file, "      \"value\": null,\n");
     }
+    write_stats_json(file, &data->humidity_stats);
     fprintf(file, "    },\n");
     
     // Smoke/Gas sensor (using gas_detected as smoke)
@@ -93,22 +362,28 @@ static void update_dashboard(sensor_data_msg_t* data) {
     if (data->gas_sensor_valid) {
         fprintf(file, "      \"status\": \"%s\",\n", 
                 data->gas_detected ? "detected" : "clear");
-        fprintf(file, "      \"alert\": %s\n", 
+        fprintf(file, "      \"alert\": %s,\n", 
                 data->gas_detected ? "true" : "false");
     } else {
         fprintf(file, "      \"status\": \"unknown\",\n");
-        fprintf(file, "      \"alert\": false\n");
+        fprintf(file, "      \"alert\": false,\n");
     }
+    fprintf(file, "      ");
+    write_age_json(file, data->gas_sample_ms, now);
+    fprintf(file, "\n");
     fprintf(file, "    },\n");
     
     // Motion
     fprintf(file, "    \"motion\": {\n");
     if (data->motion_sensor_valid) {
-        fprintf(file, "      \"status\": \"%s\"\n", 
+        fprintf(file, "      \"status\": \"%s\",\n", 
                 data->motion_detected ? "detected" : "clear");
     } else {
-        fprintf(file, "      \"status\": \"unknown\"\n");
+        fprintf(file, "      \"status\": \"unknown\",\n");
     }
+    fprintf(file, "      ");
+    write_age_json(file, data->motion_sample_ms, now);
+    fprintf(file, "\n");
     fprintf(file, "    },\n");
     
     // CO2 (using gas sensor value as approximation)
@@ -123,13 +398,42 @@ static void update_dashboard(sensor_data_msg_t* data) {
     fprintf(file, "    }\n");
     
     fprintf(file, "  },\n");
+
+    // Every registered sensor instance
+    fprintf(file, "  \"instances\": [\n");
+    for (i = 0; i < data->sensor_count; i++) {
+        write_instance_json(file, &data->sensors[i], now, 4, i == data->sensor_count - 1);
+    }
+    fprintf(file, "  ],\n");
+
+    // All zones
+    write_zones_json(file, table, now);
     
     // Add metadata
     fprintf(file, "  \"metadata\": {\n");
     fprintf(file, "    \"sequence\": %u,\n", data->sequence_num);
-    fprintf(file, "    \"alert_level\": \"%s\"\n", 
-            data->alert_level == ALERT_LEVEL_CRITICAL ? "critical" :
-            data->alert_level == ALERT_LEVEL_WARNING ? "warning" : "info");
+    fprintf(file, "    \"alert_level\": \"%s\",\n", alert_level_name(data->alert_level));
+    fprintf(file, "    \"armed\": %s,\n", data->armed ? "true" : "false");
+    fprintf(file, "    \"correlated_alerts\": %u,\n", data->correlated_alerts);
+    fprintf(file, "    \"filtered_transitions\": {\n");
+    fprintf(file, "      \"temperature\": %u,\n", data->temp_filtered);
+    fprintf(file, "      \"gas\": %u,\n", data->gas_filtered);
+    fprintf(file, "      \"motion\": %u,\n", data->motion_filtered);
+    fprintf(file, "      \"door\": %u\n", data->door_filtered);
+    fprintf(file, "    },\n");
+    fprintf(file, "    \"dht11\": {\n");
+    fprintf(file, "      \"availability_pct\": %.1f,\n", data->temp_availability);
+    fprintf(file, "      \"retries\": %u,\n", data->temp_retries);
+    fprintf(file, "      \"recovered\": %u,\n", data->temp_recovered);
+    fprintf(file, "      \"busy_ms\": %u,\n", data->temp_busy_ms);
+    fprintf(file, "      \"wasted_busy_ms\": %u\n", data->temp_wasted_busy_ms);
+    fprintf(file, "    },\n");
+    fprintf(file, "    \"health\": {\n");
+    write_health_json(file, "temperature", &data->temp_health, 0);
+    write_health_json(file, "gas", &data->gas_health, 0);
+    write_health_json(file, "motion", &data->motion_health, 0);
+    write_health_json(file, "ultrasonic", &data->ultrasonic_health, 1);
+    fprintf(file, "    }\n");
     fprintf(file, "  }\n");
     
     fprintf(file, "}\n");
@@ -137,7 +441,20 @@ static void update_dashboard(sensor_data_msg_t* data) {
     fclose(file);
 }
 
-static void print_dashboard_update(sensor_data_msg_t* data) {
+/**
+ * Format the age of a sample in seconds for the console ("-" before the first one)
+ */
+static const char* format_age(char* buf, size_t size, uint64_t sample_ms, uint64_t now) {
+    if (sample_ms == 0) {
+        snprintf(buf, size, "%5s", "-");
+    } else {
+        snprintf(buf, size, "%4.1fs", (now > sample_ms ? now - sample_ms : 0) / 1000.0);
+    }
+    return buf;
+}
+
+static void print_dashboard_update(const sensor_data_msg_t* data, uint64_t now) {
+    char age[4][16];
     char timestamp[64];
     struct tm* tm_info = localtime(&data->timestamp);
     strftime(timestamp, sizeof(timestamp), "%Y-%m-%d %H:%M:%S", tm_info);
@@ -175,26 +492,147 @@ static void print_dashboard_update(sensor_data_msg_t* data) {
     } else {
         printf("│ 🚪 Door:         INVALID             │\n");
     }
+    printf("│ Age: T=%s G=%s M=%s D=%s │\n",
+           format_age(age[0], sizeof(age[0]), data->temp_sample_ms, now),
+           format_age(age[1], sizeof(age[1]), data->gas_sample_ms, now),
+           format_age(age[2], sizeof(age[2]), data->motion_sample_ms, now),
+           format_age(age[3], sizeof(age[3]), data->distance_sample_ms, now));
     
     printf("├─────────────────────────────────────────┤\n");
     printf("│ Alert Level: %-23s│\n", 
            data->alert_level == ALERT_LEVEL_CRITICAL ? "🔴 CRITICAL" :
            data->alert_level == ALERT_LEVEL_WARNING ? "🟡 WARNING" : "🟢 INFO");
+    printf("│ Health: T=%-8s G=%-8s          │\n",
+           sensor_health_name(data->temp_health.state),
+           sensor_health_name(data->gas_health.state));
+    printf("│         M=%-8s D=%-8s          │\n",
+           sensor_health_name(data->motion_health.state),
+           sensor_health_name(data->ultrasonic_health.state));
+    printf("│ Filtered: T=%-4u G=%-4u M=%-4u D=%-4u │\n",
+           data->temp_filtered, data->gas_filtered,
+           data->motion_filtered, data->door_filtered);
+    printf("│ Sensors registered: %-3u               │\n", data->sensor_count);
     printf("└─────────────────────────────────────────┘\n\n");
 }
 
-int main(void) {
-    name_attach_t* attach;
-    sensor_data_msg_t sensor_msg;
-    int rcvid;
+/**
+ * Receive pool handler - stores each snapshot in the zone table and replies at
+ * once, so analyzers never wait for dashboard.json to be written. A zone's
+ * snapshots come from one analyzer thread that waits for each reply, so they
+ * are stored in order whichever pool thread takes them.
+ */
+static void receive_message(int rcvid, void* buf, const struct _msg_info* info, void* arg) {
+    sensor_data_msg_t* msg = buf;
+
+    (void)arg;
+    if (rcvid == 0) {
+        // Pulse received (not used)
+        return;
+    }
+
+    // Process sensor data message
+    if (info->msglen >= offsetof(sensor_data_msg_t, sensors) &&
+        msg->msg_type == MSG_TYPE_SENSOR_DATA) {
+        // Only the used part of sensors[] is sent; ignore a count the message cannot hold
+        if (msg->sensor_count > SENSOR_MAX_INSTANCES ||
+            info->msglen < SENSOR_DATA_MSG_SIZE(msg->sensor_count)) {
+            msg->sensor_count = 0;
+        }
+
+        uint64_t span = span_begin(msg->sequence_num);
+        pthread_mutex_lock(&g_zone_mutex);
+        if (zone_table_update(&g_zones, msg, info->msglen, mono_time_ms()) >= 0) {
+            pthread_cond_signal(&g_zone_cond);
+        }
+        pthread_mutex_unlock(&g_zone_mutex);
+        span_end(span, "snapshot_store", msg->sequence_num, msg->zone_name);
+
+        // Reply to sender (required for MsgSend to complete)
+        MsgReply(rcvid, EOK, NULL, 0);
+    } else {
+        LOG_WARN("Received unknown message type: 0x%02X", msg->msg_type);
+        MsgReply(rcvid, EINVAL, NULL, 0);
+    }
+}
+
+/**
+ * Dashboard thread - writes dashboard.json from a copy of the zone table
+ * whenever it has changed, at most once per DASHBOARD_MIN_INTERVAL_MS
+ */
+static void* dashboard_thread(void* arg) {
+    static zone_table_t snapshot;
+    static uint32_t traced[ZONE_MAX]; // Sequence number + 1 of the last render traced per zone
+    uint32_t written = 0;
+    uint64_t start;
+    int i;
+
+    (void)arg;
+    while (1) {
+        pthread_mutex_lock(&g_zone_mutex);
+        while (g_zones.generation == written) {
+            pthread_cond_wait(&g_zone_cond, &g_zone_mutex);
+        }
+        // Copy the used entries only; the file is written without the lock
+        snapshot.count = g_zones.count;
+        snapshot.generation = g_zones.generation;
+        snapshot.rejected = g_zones.rejected;
+        memcpy(snapshot.zones, g_zones.zones, (size_t)g_zones.count * sizeof(g_zones.zones[0]));
+        written = g_zones.generation;
+        pthread_mutex_unlock(&g_zone_mutex);
+
+        start = mono_time_ns();
+        update_dashboard(&snapshot, start / 1000000ULL);
+        
+        // Print formatted update of the primary zone to console
+        print_dashboard_update(&snapshot.zones[0].snapshot, start / 1000000ULL);
+        if (snapshot.count > 1 || snapshot.rejected) {
+            printf("Zones: %d (%u updates rejected, table full)\n", snapshot.count, snapshot.rejected);
+        }
+
+        // One render covers every zone: trace it for each sampled snapshot it is the first to show
+        for (i = 0; i < snapshot.count; i++) {
+            const sensor_data_msg_t* zone = &snapshot.zones[i].snapshot;
+
+            if (span_sampled(zone->sequence_num) && traced[i] != zone->sequence_num + 1) {
+                traced[i] = zone->sequence_num + 1;
+                span_end(start, "dashboard_render", zone->sequence_num, zone->zone_name);
+            }
+        }
+
+        usleep(DASHBOARD_MIN_INTERVAL_MS * 1000);
+    }
+    return NULL;
+}
+
+int main(int argc, char* argv[]) {
+    recv_pool_attr_t pool_attr = g_recv_pool_default;
+    pthread_t writer;
+    int threads = 0;
+    int opt;
+
+    const char* config_path = CONFIG_FILE;
+
+    while ((opt = getopt(argc, argv, "c:t:")) != -1) {
+        switch (opt) {
+        case 'c':
+            config_path = optarg;
+            break;
+        case 't':
+            threads = atoi(optarg);
+            break;
+        default:
+            fprintf(stderr, "Usage: %s [-c config_file] [-t max_receive_threads]\n", argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
     
     printf("===========================================\n");
     printf("  Stats Update - Dashboard JSON Generator\n");
     printf("===========================================\n\n");
     
     // Create a channel and attach a name
-    attach = name_attach(NULL, "stats_update", 0);
-    if (attach == NULL) {
+    g_attach = name_attach(NULL, "stats_update", 0);
+    if (g_attach == NULL) {
         fprintf(stderr, "Failed to attach name: %s\n", strerror(errno));
         return EXIT_FAILURE;
     }
@@ -202,38 +640,44 @@ int main(void) {
     printf("Stats Update Server ready at /dev/name/stats_update\n");
     printf("Dashboard file: %s\n", DASHBOARD_FILE);
     printf("Fallback file: %s\n", DASHBOARD_FILE_FALLBACK);
-    printf("Waiting for sensor data from central analyzer...\n\n");
-    
-    while (1) {
-        // Receive message from Central Analyzer
-        rcvid = MsgReceive(attach->chid, &sensor_msg, sizeof(sensor_msg), NULL);
-        
-        if (rcvid == -1) {
-            fprintf(stderr, "MsgReceive error: %s\n", strerror(errno));
-            break;
-        }
-        
-        if (rcvid == 0) {
-            // Pulse received (not used)
-            continue;
-        }
-        
-        // Process sensor data message
-        if (sensor_msg.msg_type == MSG_TYPE_SENSOR_DATA) {
-            // Update dashboard.json file
-            update_dashboard(&sensor_msg);
-            
-            // Print formatted update to console
-            print_dashboard_update(&sensor_msg);
-            
-            // Reply to sender (required for MsgSend to complete)
-            MsgReply(rcvid, EOK, NULL, 0);
-        } else {
-            printf("Received unknown message type: 0x%02X\n", sensor_msg.msg_type);
-            MsgReply(rcvid, EINVAL, NULL, 0);
-        }
+    if (thread_policy_load(config_path) < 0) {
+        fprintf(stderr, "Invalid thread policies in %s\n", config_path);
+        return EXIT_FAILURE;
+    }
+    if (recv_pool_load(config_path, "stats_update", &pool_attr) < 0) {
+        fprintf(stderr, "Invalid receive pool in %s\n", config_path);
+        return EXIT_FAILURE;
     }
+    if (threads > 0) {
+        // -t caps the pool; the water marks follow it down
+        pool_attr.maximum = threads > RECV_POOL_MAX ? RECV_POOL_MAX : (uint32_t)threads;
+        if (pool_attr.hi_water > pool_attr.maximum) pool_attr.hi_water = pool_attr.maximum;
+        if (pool_attr.lo_water > pool_attr.hi_water) pool_attr.lo_water = pool_attr.hi_water;
+    }
+    recv_pool_init(&g_recv_pool, "stats_update", g_attach->chid, sizeof(sensor_data_msg_t),
+                   THREAD_CLASS_IPC, receive_message, NULL, &pool_attr);
+    recv_pool_print(&g_recv_pool);
+    thread_policy_print();
+    printf("Waiting for sensor data from central analyzers...\n\n");
+
+    // Logging and span tracing are set up before any thread that uses them starts
+    binlog_init(NULL);
+    if (span_trace_init("stats_update") != 0) {
+        fprintf(stderr, "Cannot write span trace %s: %s\n", getenv(SPAN_FILE_ENV), strerror(errno));
+    }
+    if (thread_policy_create(THREAD_CLASS_LOGGING, &writer, dashboard_thread, NULL) != 0) {
+        fprintf(stderr, "Failed to create dashboard thread\n");
+        return EXIT_FAILURE;
+    }
+    if (recv_pool_start(&g_recv_pool) != 0) {
+        fprintf(stderr, "Failed to create receive threads\n");
+        return EXIT_FAILURE;
+    }
+    // First heartbeat pulse signals readiness to the supervisor
+    heartbeat_start(NULL, 0);
+
+    recv_pool_wait(&g_recv_pool);
     
-    name_detach(attach, 0);
+    name_detach(g_attach, 0);
     return EXIT_SUCCESS;
 }
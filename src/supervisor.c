@@ -0,0 +1,536 @@
+/*
+ * supervisor.c
+ *
+ *  Supervisor:
+ *  - Launches stats_update, event_logger and alert_mgr, then central_analyzer
+ *    once the servers are up
+ *  - Receives their heartbeat pulses (common/heartbeat.h) and restarts a
+ *    component that exits or misses its heartbeat deadline (killed first)
+ *  - Tracks restarts and outages per component: an outage runs from the last
+ *    heartbeat of the failed instance to the first one of its replacement, so
+ *    it bounds the gap in alerting
+ *
+ *  Usage: supervisor [-b bin_dir] [-c config_file] [-d deadline_ms] [-- analyzer args]
+ */
+
+#include <errno.h>
+#include <signal.h>
+#include <spawn.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/dispatch.h>
+#include <sys/neutrino.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "common/heartbeat.h"
+#include "common/mono_time.h"
+#include "common/thread_policy.h"
+
+#define SUPERVISOR_TICK_MS 10            // Deadline check period
+#define HEARTBEAT_DEADLINE_MS 200        // Silence after which a component is killed and restarted
+#define HEARTBEAT_START_DEADLINE_MS 3000 // Time a new instance has to send its first heartbeat
+#define RESTART_STABLE_MS 5000           // An instance living this long resets the restart back-off
+#define RESTART_DELAY_MIN_MS 50          // Back-off after a second quick failure
+#define RESTART_DELAY_MAX_MS 5000
+#define SUPERVISOR_REPORT_SEC 60         // How often the outage table is printed
+#define STOP_GRACE_MS 1000               // SIGTERM to SIGKILL on shutdown
+#define COMPONENT_MAX_ARGS 32
+
+#define TICK_PULSE_CODE (_PULSE_CODE_MINAVAIL + 2)
+#define EXIT_PULSE_CODE (_PULSE_CODE_MINAVAIL + 3) // value = pid of the exited child
+
+typedef enum
+{
+    COMPONENT_STOPPED,  // Not started yet, or waiting for its restart delay
+    COMPONENT_STARTING, // Spawned, no heartbeat yet
+    COMPONENT_RUNNING,
+    COMPONENT_KILLED    // Killed for a missed deadline, waiting for the exit
+} component_state_t;
+
+typedef struct
+{
+    const char *name;          // Binary in the bin directory
+    bool is_client;            // Started once the servers are running
+    char *argv[COMPONENT_MAX_ARGS];
+    component_state_t state;
+    pid_t pid;
+    uint64_t started_ms;       // Spawn time of the current instance
+    uint64_t last_beat_ms;
+    uint64_t failed_ms;        // Failure detected (exit or missed deadline)
+    uint64_t outage_from_ms;   // Last heartbeat before the failure (0 = no outage)
+    uint64_t restart_at_ms;
+    uint32_t restart_delay_ms;
+    // Statistics
+    uint32_t restarts;
+    uint32_t crashes;          // Exited on their own
+    uint32_t hangs;            // Killed for a missed deadline
+    uint64_t outage_last_ms;
+    uint64_t outage_max_ms;
+    uint64_t outage_total_ms;
+    uint64_t detect_max_ms;    // Last heartbeat to failure detected
+} component_t;
+
+static component_t g_components[] = {
+    {.name = "stats_update"},
+    {.name = "event_logger"},
+    {.name = "alert_mgr"},
+    {.name = "central_analyzer", .is_client = true},
+};
+#define COMPONENT_COUNT ((int)(sizeof(g_components) / sizeof(g_components[0])))
+
+static char g_bin_dir[256] = ".";
+static uint32_t g_deadline_ms = HEARTBEAT_DEADLINE_MS;
+static uint64_t g_start_ms;
+static int g_self_coid = -1;
+static posix_spawnattr_t g_spawn_attr;
+static volatile sig_atomic_t g_stop_requested = 0;
+
+extern char **environ;
+
+static void stop_signal(int signo)
+{
+    (void)signo;
+    g_stop_requested = 1;
+}
+
+static component_t *component_by_pid(pid_t pid)
+{
+    int i;
+
+    for (i = 0; i < COMPONENT_COUNT; i++)
+    {
+        if (g_components[i].pid == pid && pid > 0)
+        {
+            return &g_components[i];
+        }
+    }
+    return NULL;
+}
+
+static int component_spawn(component_t *c, uint64_t now)
+{
+    char path[512];
+    pid_t pid;
+    int rc;
+
+    snprintf(path, sizeof(path), "%s/%s", g_bin_dir, c->name);
+    c->argv[0] = path;
+    rc = posix_spawn(&pid, path, NULL, &g_spawn_attr, c->argv, environ);
+    c->argv[0] = (char *)c->name;
+    if (rc != 0)
+    {
+        printf("[SUPERVISOR] Cannot start %s: %s\n", path, strerror(rc));
+        c->restart_at_ms = now + RESTART_DELAY_MAX_MS;
+        return -1;
+    }
+
+    c->pid = pid;
+    c->state = COMPONENT_STARTING;
+    c->started_ms = now;
+    c->last_beat_ms = now;
+    if (c->outage_from_ms)
+    {
+        c->restarts++;
+        printf("[SUPERVISOR] %s restarted as pid %d, %llu ms after the failure was detected\n", c->name, pid,
+               (unsigned long long)(now - c->failed_ms));
+    }
+    else
+    {
+        printf("[SUPERVISOR] %s started as pid %d\n", c->name, pid);
+    }
+    return 0;
+}
+
+/**
+ * Note a failure and schedule the restart
+ *
+ * @param killed true if the instance was killed for a missed deadline and is
+ *               still to be reaped (it restarts once its exit is seen)
+ */
+static void component_failed(component_t *c, uint64_t now, bool killed)
+{
+    uint64_t detect_ms = now - c->last_beat_ms;
+
+    c->failed_ms = now;
+    if (!c->outage_from_ms)
+    {
+        c->outage_from_ms = c->last_beat_ms; // A replacement failing before its first heartbeat extends the outage
+    }
+    if (detect_ms > c->detect_max_ms)
+    {
+        c->detect_max_ms = detect_ms;
+    }
+
+    // Restart right away, unless a restarted instance keeps failing quickly
+    if (c->restarts > 0 && now - c->started_ms < RESTART_STABLE_MS)
+    {
+        c->restart_delay_ms = c->restart_delay_ms ? c->restart_delay_ms * 2 : RESTART_DELAY_MIN_MS;
+        if (c->restart_delay_ms > RESTART_DELAY_MAX_MS)
+        {
+            c->restart_delay_ms = RESTART_DELAY_MAX_MS;
+        }
+    }
+    else
+    {
+        c->restart_delay_ms = 0;
+    }
+    c->restart_at_ms = now + c->restart_delay_ms;
+
+    if (killed)
+    {
+        c->state = COMPONENT_KILLED;
+    }
+    else
+    {
+        c->pid = 0;
+        c->state = COMPONENT_STOPPED;
+    }
+}
+
+static void component_heartbeat(component_t *c, uint64_t now)
+{
+    c->last_beat_ms = now;
+    if (c->state != COMPONENT_STARTING)
+    {
+        return;
+    }
+    c->state = COMPONENT_RUNNING;
+    if (c->outage_from_ms)
+    {
+        uint64_t outage = now - c->outage_from_ms;
+
+        c->outage_last_ms = outage;
+        c->outage_total_ms += outage;
+        if (outage > c->outage_max_ms)
+        {
+            c->outage_max_ms = outage;
+        }
+        c->outage_from_ms = 0;
+        printf("[SUPERVISOR] %s back after an outage of %llu ms (restart #%u)\n", c->name,
+               (unsigned long long)outage, c->restarts);
+    }
+    else
+    {
+        printf("[SUPERVISOR] %s is up (%llu ms after start)\n", c->name,
+               (unsigned long long)(now - c->started_ms));
+    }
+}
+
+// Kill components that missed their deadline, start those that are due
+static void check_components(uint64_t now)
+{
+    bool servers_up = true;
+    int i;
+
+    for (i = 0; i < COMPONENT_COUNT; i++)
+    {
+        if (!g_components[i].is_client && g_components[i].state != COMPONENT_RUNNING)
+        {
+            servers_up = false;
+        }
+    }
+
+    for (i = 0; i < COMPONENT_COUNT; i++)
+    {
+        component_t *c = &g_components[i];
+        uint32_t deadline = c->state == COMPONENT_STARTING ? HEARTBEAT_START_DEADLINE_MS : g_deadline_ms;
+
+        switch (c->state)
+        {
+        case COMPONENT_STOPPED:
+            // The client first waits for the servers (or their start deadline); once
+            // restarted it does not, it reconnects on its own
+            if (!g_stop_requested && now >= c->restart_at_ms &&
+                (!c->is_client || servers_up || c->outage_from_ms || now - g_start_ms >= HEARTBEAT_START_DEADLINE_MS))
+            {
+                component_spawn(c, now);
+            }
+            break;
+        case COMPONENT_STARTING:
+        case COMPONENT_RUNNING:
+            if (now - c->last_beat_ms > deadline)
+            {
+                printf("[SUPERVISOR] %s (pid %d) missed its heartbeat deadline (%llu ms silent), killing it\n",
+                       c->name, c->pid, (unsigned long long)(now - c->last_beat_ms));
+                c->hangs++;
+                component_failed(c, now, true);
+                kill(c->pid, SIGKILL);
+            }
+            break;
+        case COMPONENT_KILLED:
+            break;
+        }
+    }
+}
+
+static void print_report(void)
+{
+    int i;
+
+    printf("[SUPERVISOR] %-16s %-8s %8s %7s %5s %12s %11s %13s %13s\n", "component", "state", "restarts",
+           "crashes", "hangs", "last_out_ms", "max_out_ms", "total_out_ms", "max_detect_ms");
+    for (i = 0; i < COMPONENT_COUNT; i++)
+    {
+        const component_t *c = &g_components[i];
+
+        printf("[SUPERVISOR] %-16s %-8s %8u %7u %5u %12llu %11llu %13llu %13llu\n", c->name,
+               c->state == COMPONENT_RUNNING    ? "running"
+               : c->state == COMPONENT_STARTING ? "starting"
+                                                : "down",
+               c->restarts, c->crashes, c->hangs, (unsigned long long)c->outage_last_ms,
+               (unsigned long long)c->outage_max_ms, (unsigned long long)c->outage_total_ms,
+               (unsigned long long)c->detect_max_ms);
+    }
+}
+
+// Reaper thread - turns child exits into pulses for the main loop
+static void *reaper_thread(void *arg)
+{
+    (void)arg;
+
+    while (1)
+    {
+        int status;
+        pid_t pid = waitpid(-1, &status, 0);
+
+        if (pid == -1)
+        {
+            // No children yet (or between restarts)
+            usleep(SUPERVISOR_TICK_MS * 1000);
+            continue;
+        }
+        if (WIFSIGNALED(status))
+        {
+            printf("[SUPERVISOR] pid %d killed by signal %d\n", pid, WTERMSIG(status));
+        }
+        else
+        {
+            printf("[SUPERVISOR] pid %d exited with status %d\n", pid, WEXITSTATUS(status));
+        }
+        MsgSendPulse(g_self_coid, -1, EXIT_PULSE_CODE, pid);
+    }
+    return NULL;
+}
+
+// Stop every child: SIGTERM, then SIGKILL after STOP_GRACE_MS
+static void stop_components(void)
+{
+    uint64_t deadline = mono_time_ms() + STOP_GRACE_MS;
+    int i;
+
+    for (i = COMPONENT_COUNT - 1; i >= 0; i--)
+    {
+        if (g_components[i].pid > 0)
+        {
+            kill(g_components[i].pid, SIGTERM);
+        }
+    }
+    for (i = 0; i < COMPONENT_COUNT; i++)
+    {
+        while (g_components[i].pid > 0 && kill(g_components[i].pid, 0) == 0 && mono_time_ms() < deadline)
+        {
+            usleep(SUPERVISOR_TICK_MS * 1000);
+        }
+        if (g_components[i].pid > 0)
+        {
+            kill(g_components[i].pid, SIGKILL);
+        }
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    name_attach_t *attach;
+    struct sigevent event;
+    struct itimerspec tick;
+    timer_t timer;
+    pthread_t reaper;
+    const char *config_path = NULL;
+    struct sched_param param;
+    uint64_t last_report;
+    int policy;
+    int opt;
+    int i;
+
+    while ((opt = getopt(argc, argv, "b:c:d:")) != -1)
+    {
+        switch (opt)
+        {
+        case 'b':
+            snprintf(g_bin_dir, sizeof(g_bin_dir), "%s", optarg);
+            break;
+        case 'c':
+            config_path = optarg;
+            break;
+        case 'd':
+            g_deadline_ms = (uint32_t)atoi(optarg);
+            break;
+        default:
+            fprintf(stderr, "Usage: %s [-b bin_dir] [-c config_file] [-d deadline_ms] [-- analyzer args]\n",
+                    argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+    if (g_deadline_ms < 2 * HEARTBEAT_INTERVAL_MS)
+    {
+        fprintf(stderr, "Heartbeat deadline must be at least %d ms\n", 2 * HEARTBEAT_INTERVAL_MS);
+        return EXIT_FAILURE;
+    }
+    if (strcmp(g_bin_dir, ".") == 0 && strrchr(argv[0], '/'))
+    {
+        // Default: the directory the supervisor was started from
+        snprintf(g_bin_dir, sizeof(g_bin_dir), "%.*s", (int)(strrchr(argv[0], '/') - argv[0]), argv[0]);
+    }
+
+    // Command lines: -c goes to the processes that read the config file,
+    // everything after "--" to central_analyzer
+    for (i = 0; i < COMPONENT_COUNT; i++)
+    {
+        component_t *c = &g_components[i];
+        int n = 0;
+
+        c->argv[n++] = (char *)c->name;
+        if (config_path && (c->is_client || strcmp(c->name, "stats_update") == 0 ||
+                            strcmp(c->name, "event_logger") == 0))
+        {
+            c->argv[n++] = "-c";
+            c->argv[n++] = (char *)config_path;
+        }
+        if (c->is_client)
+        {
+            int a;
+            for (a = optind; a < argc && n < COMPONENT_MAX_ARGS - 1; a++)
+            {
+                c->argv[n++] = argv[a];
+            }
+        }
+        c->argv[n] = NULL;
+    }
+
+    printf("===========================================\n");
+    printf("  Supervisor - Home Safety System\n");
+    printf("===========================================\n");
+    printf("Binaries in %s, heartbeat every %d ms, deadline %u ms\n\n", g_bin_dir, HEARTBEAT_INTERVAL_MS,
+           g_deadline_ms);
+
+    attach = name_attach(NULL, SUPERVISOR_NAME, 0);
+    if (attach == NULL)
+    {
+        perror("name_attach failed");
+        return EXIT_FAILURE;
+    }
+    g_self_coid = ConnectAttach(0, 0, attach->chid, _NTO_SIDE_CHANNEL, 0);
+    if (g_self_coid == -1)
+    {
+        perror("ConnectAttach failed");
+        return EXIT_FAILURE;
+    }
+
+    // Children start with the supervisor's original priority (their threads pick
+    // their own class policies) in their own process group, so Ctrl+C only
+    // reaches the supervisor, which then stops them in order
+    pthread_getschedparam(pthread_self(), &policy, &param);
+    posix_spawnattr_init(&g_spawn_attr);
+    posix_spawnattr_setschedpolicy(&g_spawn_attr, policy);
+    posix_spawnattr_setschedparam(&g_spawn_attr, &param);
+    posix_spawnattr_setpgroup(&g_spawn_attr, 0);
+    posix_spawnattr_setflags(&g_spawn_attr, POSIX_SPAWN_SETSCHEDULER | POSIX_SPAWN_SETSCHEDPARAM | POSIX_SPAWN_SETPGROUP);
+
+    // Failures must be noticed and handled ahead of the components' own work
+    thread_policy_apply_self(THREAD_CLASS_IPC);
+
+    signal(SIGINT, stop_signal);
+    signal(SIGTERM, stop_signal);
+
+    if (thread_policy_create(THREAD_CLASS_IPC, &reaper, reaper_thread, NULL) != 0)
+    {
+        fprintf(stderr, "Failed to create reaper thread\n");
+        return EXIT_FAILURE;
+    }
+
+    SIGEV_PULSE_INIT(&event, g_self_coid, SIGEV_PULSE_PRIO_INHERIT, TICK_PULSE_CODE, 0);
+    if (timer_create(CLOCK_MONOTONIC, &event, &timer) == -1)
+    {
+        perror("timer_create failed");
+        return EXIT_FAILURE;
+    }
+    memset(&tick, 0, sizeof(tick));
+    tick.it_value.tv_nsec = SUPERVISOR_TICK_MS * 1000000L;
+    tick.it_interval.tv_nsec = SUPERVISOR_TICK_MS * 1000000L;
+    timer_settime(timer, 0, &tick, NULL);
+
+    g_start_ms = mono_time_ms();
+    last_report = g_start_ms;
+    check_components(g_start_ms);
+
+    while (!g_stop_requested)
+    {
+        struct _pulse pulse;
+        uint64_t now;
+        component_t *c;
+        int rcvid = MsgReceive(attach->chid, &pulse, sizeof(pulse), NULL);
+
+        if (rcvid == -1)
+        {
+            if (errno != EINTR)
+            {
+                perror("MsgReceive");
+            }
+            continue;
+        }
+        if (rcvid != 0)
+        {
+            MsgReply(rcvid, EOK, NULL, 0);
+            continue;
+        }
+
+        now = mono_time_ms();
+        switch (pulse.code)
+        {
+        case HEARTBEAT_PULSE_CODE:
+            c = component_by_pid(pulse.value.sival_int);
+            if (c && c->state != COMPONENT_KILLED)
+            {
+                component_heartbeat(c, now);
+            }
+            break;
+        case EXIT_PULSE_CODE:
+            c = component_by_pid(pulse.value.sival_int);
+            if (c && c->state == COMPONENT_KILLED)
+            {
+                c->pid = 0;
+                c->state = COMPONENT_STOPPED;
+                check_components(now);
+            }
+            else if (c)
+            {
+                c->crashes++;
+                printf("[SUPERVISOR] %s died, restarting\n", c->name);
+                component_failed(c, now, false);
+                check_components(now);
+            }
+            break;
+        case TICK_PULSE_CODE:
+            check_components(now);
+            if (now - last_report >= SUPERVISOR_REPORT_SEC * 1000ULL)
+            {
+                print_report();
+                last_report = now;
+            }
+            break;
+        default:
+            break;
+        }
+    }
+
+    printf("\n[SUPERVISOR] Stopping components...\n");
+    stop_components();
+    print_report();
+    name_detach(attach, 0);
+    return EXIT_SUCCESS;
+}
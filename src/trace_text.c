@@ -0,0 +1,407 @@
+/*
+ * trace_text.c
+ *
+ *  Sensor Trace Text Converter:
+ *  - Dumps a trace recorded with `central_analyzer -T <file>`
+ *    (common/sensor_trace.h) as text, one line per record
+ *  - Writes a binary trace from such text (-w), for the build it runs in, so
+ *    traces kept in the repository survive changes to threshold_config_t and
+ *    sensor_instance_t that make old binary traces unreadable
+ *  - Text traces can also be written by hand or by a script to feed the
+ *    analyzer a scenario (a temperature ramp, a door left open)
+ *
+ *  Format ('#' starts a comment; times are ms since the start of the trace):
+ *
+ *      zone      <id> <name>
+ *      start     <monotonic ms> <wall-clock time_t>
+ *      sensor    <type> <name> [key=value ...]       as in the config file
+ *      sample    <t> <sensor> <ok> <value> <value2> <aux> <read_us> <extra>
+ *      aggregate <t>
+ *      ipc       <t> stats|logger|pulse <ok> <errno>
+ *      config    <t> [key=value ...]                 missing keys are 0
+ *
+ *  zone, start and sensor lines come before the first record.
+ */
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "common/runtime_config.h"
+#include "common/sensor_registry.h"
+#include "common/sensor_trace.h"
+
+#define CONFIG_FIELD_COUNT (sizeof(config_fields) / sizeof(config_fields[0]))
+
+static const char *const ipc_target_names[] = {
+    [TRACE_IPC_STATS] = "stats",
+    [TRACE_IPC_LOGGER] = "logger",
+    [TRACE_IPC_ALERT_PULSE] = "pulse",
+};
+
+static void usage(const char *prog)
+{
+    fprintf(stderr,
+            "Usage: %s trace_file              dump a binary trace as text\n"
+            "       %s -w trace_file [text]    write a binary trace from text (default stdin)\n",
+            prog, prog);
+}
+
+// Print a sensor as the value of a config-file "sensor" line
+static void dump_sensor(const sensor_instance_t *s)
+{
+    printf("sensor %s %.*s", sensor_type_name(s->type), SENSOR_NAME_LEN, s->name);
+    if (s->type == SENSOR_TYPE_ULTRASONIC)
+    {
+        printf(" trig=%d echo=%d", s->pin, s->pin2);
+    }
+    else
+    {
+        printf(" pin=%d", s->pin);
+    }
+    if (s->period_ms)
+    {
+        printf(" period_ms=%u", s->period_ms);
+    }
+    if (s->threshold_high != SENSOR_THRESHOLD_DEFAULT)
+    {
+        printf(" %s=%d", s->type == SENSOR_TYPE_ULTRASONIC ? "closed_cm" : "high", s->threshold_high);
+    }
+    if (s->threshold_low != SENSOR_THRESHOLD_DEFAULT)
+    {
+        printf(" low=%d", s->threshold_low);
+    }
+    printf("\n");
+}
+
+static void dump_config(const threshold_config_t *cfg)
+{
+    size_t i;
+
+    for (i = 0; i < CONFIG_FIELD_COUNT; i++)
+    {
+        const void *src = (const char *)cfg + config_fields[i].offset;
+
+        printf(" %s=", config_fields[i].key);
+        switch (config_fields[i].type)
+        {
+        case CONFIG_FIELD_INT:
+            printf("%d", *(const int *)src);
+            break;
+        case CONFIG_FIELD_U8:
+            printf("%u", *(const uint8_t *)src);
+            break;
+        case CONFIG_FIELD_U16:
+            printf("%u", *(const uint16_t *)src);
+            break;
+        case CONFIG_FIELD_U32:
+            printf("%u", *(const uint32_t *)src);
+            break;
+        case CONFIG_FIELD_FLOAT:
+            printf("%.9g", *(const float *)src);
+            break;
+        }
+    }
+}
+
+static int dump(const char *path)
+{
+    static trace_reader_t reader;
+    trace_record_t rec;
+    int rc;
+    int i;
+
+    if (trace_reader_open(&reader, path) != 0)
+    {
+        fprintf(stderr, "Cannot read %s: not a trace of this version\n", path);
+        return -1;
+    }
+    printf("zone %u %.*s\n", reader.header.zone_id, ZONE_NAME_LEN, reader.header.zone_name);
+    printf("start %llu %lld\n", (unsigned long long)reader.header.mono_start_ms,
+           (long long)reader.header.wall_start);
+    for (i = 0; i < reader.header.sensor_count; i++)
+    {
+        dump_sensor(&reader.sensors[i]);
+    }
+
+    while ((rc = trace_reader_next(&reader, &rec)) == 1)
+    {
+        switch (rec.kind)
+        {
+        case TRACE_REC_SAMPLE:
+            printf("sample %u %.*s %u %d %d %u %u %u\n", rec.t_ms, SENSOR_NAME_LEN, reader.sensors[rec.sensor].name,
+                   rec.ok, rec.value, rec.value2, rec.aux, rec.read_us, rec.extra);
+            break;
+        case TRACE_REC_AGGREGATE:
+            printf("aggregate %u\n", rec.t_ms);
+            break;
+        case TRACE_REC_IPC:
+            printf("ipc %u %s %u %u\n", rec.t_ms,
+                   rec.sensor <= TRACE_IPC_ALERT_PULSE ? ipc_target_names[rec.sensor] : "unknown", rec.ok, rec.extra);
+            break;
+        case TRACE_REC_CONFIG:
+            printf("config %u", rec.t_ms);
+            dump_config(&reader.config);
+            printf("\n");
+            break;
+        }
+    }
+    trace_reader_close(&reader);
+    if (rc < 0)
+    {
+        fprintf(stderr, "%s is truncated or corrupt\n", path);
+        return -1;
+    }
+    return 0;
+}
+
+static int find_sensor(const sensor_registry_t *reg, const char *name)
+{
+    int i;
+
+    for (i = 0; i < reg->count; i++)
+    {
+        if (strncmp(reg->sensors[i].name, name, SENSOR_NAME_LEN) == 0)
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static int find_ipc_target(const char *name)
+{
+    int i;
+
+    for (i = 0; i <= TRACE_IPC_ALERT_PULSE; i++)
+    {
+        if (strcmp(ipc_target_names[i], name) == 0)
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// Parse the key=value pairs of a config line over a zeroed config
+static int parse_config(char *text, threshold_config_t *cfg)
+{
+    char *save = NULL;
+    char *opt;
+    size_t i;
+
+    memset(cfg, 0, sizeof(*cfg));
+    for (opt = strtok_r(text, " \t", &save); opt; opt = strtok_r(NULL, " \t", &save))
+    {
+        char *eq = strchr(opt, '=');
+
+        if (!eq)
+        {
+            return -1;
+        }
+        *eq = '\0';
+        for (i = 0; i < CONFIG_FIELD_COUNT && strcmp(config_fields[i].key, opt) != 0; i++)
+        {
+        }
+        if (i == CONFIG_FIELD_COUNT || config_set_field(cfg, &config_fields[i], eq + 1) != 0)
+        {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+// Write the header and registry once the first record (or the end) is reached
+static int write_header(FILE *out, trace_header_t *header, const sensor_registry_t *reg)
+{
+    header->magic = TRACE_MAGIC;
+    header->version = TRACE_VERSION;
+    header->sensor_count = (uint16_t)reg->count;
+    header->config_size = sizeof(threshold_config_t);
+    if (fwrite(header, sizeof(*header), 1, out) != 1 ||
+        fwrite(reg->sensors, sizeof(reg->sensors[0]), (size_t)reg->count, out) != (size_t)reg->count)
+    {
+        return -1;
+    }
+    return 0;
+}
+
+static int write_trace(FILE *in, const char *path)
+{
+    static sensor_registry_t reg;
+    threshold_config_t cfg;
+    trace_header_t header;
+    char line[1024];
+    int line_no = 0;
+    int started = 0;
+    FILE *out = fopen(path, "wb");
+
+    if (!out)
+    {
+        fprintf(stderr, "Cannot write %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+    memset(&header, 0, sizeof(header));
+
+    while (fgets(line, sizeof(line), in))
+    {
+        char *comment = strchr(line, '#');
+        trace_record_t rec;
+        char kind[16], name[32];
+        unsigned ok, aux, t;
+        int n = 0;
+        int bad = 0;
+
+        line_no++;
+        if (comment)
+        {
+            *comment = '\0';
+        }
+        line[strcspn(line, "\r\n")] = '\0';
+        if (sscanf(line, " %15s %n", kind, &n) != 1)
+        {
+            continue;
+        }
+
+        memset(&rec, 0, sizeof(rec));
+        if (strcmp(kind, "zone") == 0)
+        {
+            unsigned id;
+
+            bad = started || sscanf(line + n, "%u %31s", &id, name) != 2 || !sensor_name_valid(name) ||
+                  strlen(name) >= sizeof(header.zone_name);
+            header.zone_id = (uint16_t)id;
+            if (!bad)
+            {
+                memcpy(header.zone_name, name, strlen(name) + 1);
+            }
+        }
+        else if (strcmp(kind, "start") == 0)
+        {
+            unsigned long long mono;
+            long long wall;
+
+            bad = started || sscanf(line + n, "%llu %lld", &mono, &wall) != 2;
+            header.mono_start_ms = mono;
+            header.wall_start = wall;
+        }
+        else if (strcmp(kind, "sensor") == 0)
+        {
+            sensor_instance_t s;
+
+            bad = started || sensor_instance_parse(line + n, &s) != 0 || find_sensor(&reg, s.name) >= 0 ||
+                  !sensor_registry_add(&reg, &s);
+        }
+        else if (!started && write_header(out, &header, &reg) != 0)
+        {
+            break;
+        }
+        else
+        {
+            started = 1;
+            if (strcmp(kind, "sample") == 0)
+            {
+                int id = -1;
+
+                bad = sscanf(line + n, "%u %31s %u %d %d %u %u %u", &t, name, &ok, &rec.value, &rec.value2, &aux,
+                             &rec.read_us, &rec.extra) != 8 ||
+                      (id = find_sensor(&reg, name)) < 0;
+                rec.kind = TRACE_REC_SAMPLE;
+                rec.sensor = (uint8_t)id;
+                rec.ok = (uint8_t)ok;
+                rec.aux = (uint8_t)aux;
+            }
+            else if (strcmp(kind, "aggregate") == 0)
+            {
+                bad = sscanf(line + n, "%u", &t) != 1;
+                rec.kind = TRACE_REC_AGGREGATE;
+            }
+            else if (strcmp(kind, "ipc") == 0)
+            {
+                int target = -1;
+
+                bad = sscanf(line + n, "%u %31s %u %u", &t, name, &ok, &rec.extra) != 4 ||
+                      (target = find_ipc_target(name)) < 0;
+                rec.kind = TRACE_REC_IPC;
+                rec.sensor = (uint8_t)target;
+                rec.ok = (uint8_t)ok;
+            }
+            else if (strcmp(kind, "config") == 0)
+            {
+                int skip = 0;
+
+                bad = sscanf(line + n, "%u %n", &t, &skip) != 1 || parse_config(line + n + skip, &cfg) != 0;
+                rec.kind = TRACE_REC_CONFIG;
+            }
+            else
+            {
+                bad = 1;
+            }
+            rec.t_ms = t;
+            if (!bad && (fwrite(&rec, sizeof(rec), 1, out) != 1 ||
+                         (rec.kind == TRACE_REC_CONFIG && fwrite(&cfg, sizeof(cfg), 1, out) != 1)))
+            {
+                break;
+            }
+        }
+        if (bad)
+        {
+            fprintf(stderr, "line %d: bad %s line\n", line_no, kind);
+            fclose(out);
+            return -1;
+        }
+    }
+
+    if ((!started && write_header(out, &header, &reg) != 0) || ferror(in) || fclose(out) != 0)
+    {
+        fprintf(stderr, "Cannot write %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    const char *out_path = NULL;
+    FILE *in = stdin;
+    int opt;
+    int rc;
+
+    while ((opt = getopt(argc, argv, "w:")) != -1)
+    {
+        switch (opt)
+        {
+        case 'w':
+            out_path = optarg;
+            break;
+        default:
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (!out_path)
+    {
+        if (optind != argc - 1)
+        {
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+        return dump(argv[optind]) == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    if (optind < argc && (in = fopen(argv[optind], "r")) == NULL)
+    {
+        fprintf(stderr, "Cannot read %s: %s\n", argv[optind], strerror(errno));
+        return EXIT_FAILURE;
+    }
+    rc = write_trace(in, out_path);
+    if (in != stdin)
+    {
+        fclose(in);
+    }
+    return rc == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}